@@ -12,11 +12,18 @@
 #include "core/Window.h"
 #include "renderer/Shaders.h"
 #include "renderer/Renderer.h"
+#include "renderer/GLState.h"
 #include "scene/Model.h"
 #include "scene/Camera.h"
 #include "scene/Scene.h"
 #include "input/Input.h"
 #include "gui/ImguiLayer.h"
+#include "gui/SceneOutliner.h"
+#include "core/JobSystem.h"
+#include "core/FramePacer.h"
+#include "core/Benchmark.h"
+#include "core/PerfCounters.h"
+#include "scene/CameraPath.h"
 
 class Application {
 public: 
@@ -28,6 +35,11 @@ public:
 
     Window& getWindow();
 
+    // records the camera until the window closes or recording is stopped from the ui
+    void recordCameraPath(const std::string& pathFile);
+    // replays a recorded path and reports frame times, optionally closing the window when done
+    void runBenchmark(const std::string& pathFile, const std::string& csvFile, bool exitWhenDone);
+
 private: 
     std::unique_ptr<Window> m_mainWindow;
     bool m_isRunning;
@@ -35,15 +47,28 @@ private:
     // scenes related 
     std::vector<std::unique_ptr<Scene>> m_scenes;
     Scene* m_activeScene = nullptr;
+    ModelHandle m_catModel;
+    ModelHandle m_carModel;
 
-    std::unique_ptr<Shader> m_defaultShader;
     std::unique_ptr<Camera> m_camera;
+    std::unique_ptr<FramePacer> m_framePacer;
+    std::unique_ptr<SceneOutliner> m_outliner;
+    std::unique_ptr<Benchmark> m_benchmark;
+    bool m_exitAfterBenchmark = false;
+
+    // camera path recording
+    CameraPath m_recordedPath;
+    std::string m_recordingFile;
+    bool m_isRecordingPath = false;
+    double m_recordingStart = 0.0;
 
     glm::mat4 m_viewMatrix;
     glm::mat4 m_projectionMatrix;
 
     void update(float deltaTime);
     void render();
+    void stopRecordingPath();
+    void drawBenchmarkSection();
 };
 
 #endif // APPLICATION_H
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "core/FramePacer.h"
+#include "scene/Camera.h"
+#include "scene/CameraPath.h"
+
+// Flythrough benchmark over a recorded camera path.
+// The path is replayed at a fixed timestep, so every run renders the same frames no matter
+// how fast they come out, with vsync, the fps cap and dynamic resolution switched off for
+// the run. Per frame cpu and gpu scene times go to a csv and the min/avg/percentiles are
+// printed at the end.
+class Benchmark {
+public:
+    static constexpr float kTimestep = 1.0f / 60.0f;
+
+    // loads the path and takes over the pacer settings until the run ends
+    bool start(const std::string& pathFile, const std::string& csvFile, FramePacer& pacer);
+    bool isRunning() const;
+
+    // right after FramePacer::beginFrame, places the camera and returns the timestep to simulate
+    float beginFrame(Camera& camera);
+    // right after FramePacer::endFrame, true on the frame the run finishes and the results are out
+    bool endFrame();
+
+    // 0 to 1 over the recorded part of the run
+    float getProgress() const;
+
+private:
+    enum class Phase {
+        Idle,
+        Warmup, // sits at the start of the path while textures stream in, not recorded
+        Replay,
+        Drain   // waits for the last gpu queries to come back
+    };
+
+    struct FrameSample {
+        float cpuMs;
+        float gpuMs; // negative until (or if never) the query comes back
+    };
+
+    CameraPath m_path;
+    std::string m_csvFile;
+    FramePacer* m_pacer = nullptr;
+
+    Phase m_phase = Phase::Idle;
+    int m_phaseFrames = 0;
+    int m_replayFrameCount = 0;
+    uint64_t m_firstFrame = 0; // pacer frame number of the first recorded frame
+    std::vector<FrameSample> m_samples;
+
+    VSyncMode m_savedVSync = VSyncMode::On;
+    float m_savedFpsCap = 0.0f;
+    bool m_savedDynamicResolution = true;
+
+    void finish();
+    bool writeCsv() const;
+};
+
+#endif // BENCHMARK_H
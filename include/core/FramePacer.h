@@ -0,0 +1,100 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+
+enum class VSyncMode {
+    Off,
+    On,
+    Adaptive // tears instead of waiting a whole interval when a frame is late, falls back to On
+};
+
+// Frame pacing and dynamic resolution.
+// Measures the GPU time of the scene pass and the input to present latency with timer
+// queries (a small ring, results are read a few frames late so nothing ever stalls),
+// caps the frame rate by sleeping before input is sampled, and scales the 3D resolution
+// so the scene's GPU time stays inside the target frame time.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+
+    void setVSync(VSyncMode mode);
+    VSyncMode getVSync() const;
+
+    // 0 means uncapped
+    void setFpsCap(float fps);
+    float getFpsCap() const;
+
+    // the frame time the resolution scaling aims for, in ms
+    void setTargetFrameTime(float ms);
+    float getTargetFrameTime() const;
+
+    void setDynamicResolution(bool enabled);
+    bool isDynamicResolutionEnabled() const;
+
+    // start of the frame, picks up finished queries and adjusts the resolution scale
+    void beginFrame();
+    // right after polling events, latency is measured from here
+    void markInputSampled();
+    // around the scene pass
+    void beginGpuScene();
+    void endGpuScene();
+    // right after the swap, records the present timestamp and sleeps off the fps cap
+    void endFrame();
+
+    float getResolutionScale() const;
+    float getGpuSceneTime() const; // ms
+    float getLatency() const;      // ms
+    float getCpuFrameTime() const; // ms, without the cap's sleep
+
+    // counts beginFrame calls
+    uint64_t getFrameNumber() const;
+    // gets every scene gpu time as its query comes back, a few frames late, with the frame it belongs to
+    void setGpuTimeListener(std::function<void(uint64_t frame, float ms)> listener);
+
+    static constexpr float kMinResolutionScale = 0.5f;
+
+private:
+    static const int kQueryFrames = 4;
+
+    struct FrameQueries {
+        GLuint sceneTime = 0;
+        GLuint presentTimestamp = 0;
+        double inputTime = 0.0;
+        uint64_t frameNumber = 0;
+        bool pending = false;
+        bool sceneIssued = false;
+    };
+
+    FrameQueries m_frames[kQueryFrames];
+    int m_frameIndex = 0;
+    uint64_t m_frameNumber = 0;
+    std::function<void(uint64_t, float)> m_gpuTimeListener;
+    bool m_timingThisFrame = false;
+
+    VSyncMode m_vsync = VSyncMode::On;
+    float m_fpsCap = 0.0f;
+    float m_targetFrameTime = 1000.0f / 60.0f;
+    bool m_dynamicResolution = true;
+
+    double m_frameStart = 0.0;
+    double m_inputTime = 0.0;
+    double m_gpuToCpuOffset = 0.0; // seconds, gpu timestamp + offset = glfwGetTime
+
+    float m_resolutionScale = 1.0f;
+    float m_gpuSceneTime = 0.0f;
+    float m_smoothedGpuTime = 0.0f;
+    float m_latency = 0.0f;
+    float m_cpuFrameTime = 0.0f;
+    int m_scaleCooldown = 0;
+
+    void collectQueries();
+    void updateResolutionScale();
+};
+
+#endif // FRAME_PACER_H
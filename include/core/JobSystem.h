@@ -0,0 +1,48 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// static worker pool shared by the engine's data parallel passes.
+// parallelFor blocks until every chunk is done, the calling thread works on chunks too,
+// so it is safe to call from inside another job.
+class JobSystem {
+public:
+    // 0 picks one worker less than the hardware threads (the main thread also works)
+    static void init(unsigned int workerCount = 0);
+    static void shutdown();
+
+    // splits [0, count) into chunks of at least minChunk items and runs fn(begin, end) on them
+    static void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn);
+
+    static unsigned int getWorkerCount();
+    static unsigned int getThreadCount(); // workers plus the calling thread
+
+private:
+    struct Batch {
+        std::atomic<size_t> remaining{0};
+    };
+
+    struct Task {
+        std::function<void()> work;
+        std::shared_ptr<Batch> batch;
+    };
+
+    static std::vector<std::thread> s_workers;
+    static std::deque<Task> s_tasks;
+    static std::mutex s_mutex;
+    static std::condition_variable s_condition;
+    static bool s_running;
+
+    static void workerLoop();
+    static bool runOneTask();
+};
+
+#endif // JOB_SYSTEM_H
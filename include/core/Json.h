@@ -0,0 +1,54 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Small read only JSON document, enough for the asset formats the engine reads (glTF).
+// Lookups never fail: a missing key or index gives a null value, and the as*() getters
+// return their fallback when the type doesn't match.
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    // error is filled with the byte offset and reason when it returns false
+    static bool parse(const char* data, size_t size, JsonValue& out, std::string& error);
+
+    Type getType() const;
+    bool isNull() const;
+    bool isArray() const;
+    bool isObject() const;
+
+    bool asBool(bool fallback = false) const;
+    double asNumber(double fallback = 0.0) const;
+    int asInt(int fallback = 0) const;
+    const std::string& asString() const; // empty for anything but strings
+
+    // elements of an array or members of an object
+    size_t size() const;
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](int index) const; // keeps a literal 0 from looking like a null key
+    const JsonValue& operator[](const char* key) const;
+    bool has(const char* key) const;
+    const std::string& getKey(size_t index) const; // objects only
+
+private:
+    Type m_type = Type::Null;
+    bool m_bool = false;
+    double m_number = 0.0;
+    std::string m_string;
+    std::vector<JsonValue> m_values; // array elements or object member values
+    std::vector<std::string> m_keys; // object member names, same order as m_values
+
+    class Parser;
+};
+
+#endif // JSON_H
@@ -0,0 +1,21 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+
+// The LZ4 block format (no frame around it), used for the entries of asset packs.
+// The compressor is the plain greedy one with a single hash table, fast enough for the
+// packer, and the decompressor checks every length against both buffers, so a corrupt
+// pack fails the read instead of writing out of bounds.
+class Lz4 {
+public:
+    // worst case output of compress for incompressible input
+    static size_t getMaxCompressedSize(size_t size);
+
+    // bytes written to dst, 0 if capacity was too small
+    static size_t compress(const char* src, size_t size, char* dst, size_t capacity);
+    // false unless src decodes to exactly size bytes
+    static bool decompress(const char* src, size_t compressedSize, char* dst, size_t size);
+};
+
+#endif // LZ4_H
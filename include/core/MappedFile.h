@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <iostream>
+
+// Read only memory mapping of a whole file, unmapped when it goes out of scope.
+// The pages are only read in from disk as they get touched.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    const char* data() const;
+    size_t size() const;
+
+    // hint that the whole file is about to be read front to back
+    void adviseSequential() const;
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+#endif // MAPPED_FILE_H
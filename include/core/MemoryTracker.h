@@ -0,0 +1,103 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <glad/gl.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// what the bytes are for
+enum class MemoryTag {
+    Meshes,    // vertex and index data
+    Textures,  // material textures
+    Importer,  // the assimp scene while a model is loading
+    Animation, // skeletons and compressed clips
+    Renderer,  // render targets, shadow maps, light and palette buffers, environment
+    UI,        // imgui's own heap
+    Count
+};
+
+enum class MemoryDomain {
+    Cpu,
+    GpuBuffer,
+    GpuTexture,
+    GpuRenderbuffer
+};
+
+// Memory accounting for the engine, split by tag and by asset.
+// Every allocation is a record keyed by its domain and a handle (a pointer for cpu memory,
+// the GL name for buffers and textures), so calling track again with the same handle just
+// resizes it. GL sizes are computed from the requested formats, which is what the driver
+// has to allocate at minimum. ImGui goes through its own allocator hook and is counted exactly.
+class MemoryTracker {
+public:
+    static void track(MemoryDomain domain, uintptr_t handle, MemoryTag tag, size_t bytes);
+    static void untrack(MemoryDomain domain, uintptr_t handle);
+
+    static void trackCpu(const void* owner, MemoryTag tag, size_t bytes);
+    static void untrackCpu(const void* owner);
+    static void trackBuffer(GLuint buffer, MemoryTag tag, size_t bytes);
+    static void untrackBuffer(GLuint buffer);
+    static void trackTexture(GLuint texture, MemoryTag tag, size_t bytes);
+    static void untrackTexture(GLuint texture);
+    static void trackRenderbuffer(GLuint renderbuffer, MemoryTag tag, size_t bytes);
+    static void untrackRenderbuffer(GLuint renderbuffer);
+
+    // records created while a scope is alive (on the same thread) belong to that asset
+    class AssetScope {
+    public:
+        explicit AssetScope(const std::string& asset);
+        ~AssetScope();
+
+    private:
+        std::string m_previous;
+    };
+
+    // call before ImGui::CreateContext
+    static void installImguiAllocator();
+
+    static size_t getCpuBytes(MemoryTag tag);
+    static size_t getGpuBytes(MemoryTag tag);
+    static size_t getTotalCpuBytes();
+    static size_t getTotalGpuBytes();
+    static const char* getTagName(MemoryTag tag);
+
+    struct AssetUsage {
+        std::string name;
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+    };
+    // largest first
+    static std::vector<AssetUsage> getAssets();
+
+    static std::string getReport();
+    static bool writeReport(const std::string& path);
+
+    // bytes of a GL texture level for the internal formats the engine uses
+    static size_t getTextureBytes(GLenum internalFormat, int width, int height, int depth = 1);
+
+private:
+    struct Record {
+        MemoryTag tag;
+        size_t bytes;
+        bool gpu;
+        std::string asset;
+    };
+
+    static std::mutex s_mutex;
+    static std::unordered_map<uint64_t, Record> s_records;
+    static size_t s_cpuBytes[static_cast<int>(MemoryTag::Count)];
+    static size_t s_gpuBytes[static_cast<int>(MemoryTag::Count)];
+    static std::atomic<size_t> s_uiBytes;
+    static thread_local std::string s_currentAsset;
+
+    static uint64_t makeKey(MemoryDomain domain, uintptr_t handle);
+    static void* imguiAlloc(size_t size, void* user);
+    static void imguiFree(void* pointer, void* user);
+};
+
+#endif // MEMORY_TRACKER_H
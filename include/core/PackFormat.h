@@ -0,0 +1,61 @@
+#ifndef PACK_FORMAT_H
+#define PACK_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On disk layout of a .pak asset archive, written by tools/AssetPack.cc and mounted by
+// VirtualFileSystem. Little endian, read in place from the mapping:
+//   PackHeader
+//   file data, every entry starting on kPackAlignment, LZ4 blocks for compressed ones
+//   PackEntry[entryCount], sorted by pathHash for a binary search
+//   the paths, each entry points at its own to rule out hash collisions
+static const char kPackMagic[4] = { 'A', 'P', 'A', 'K' };
+static const uint32_t kPackVersion = 1;
+static const size_t kPackAlignment = 64;
+static const uint32_t kPackCompressed = 1u << 0;
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t entriesOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct PackEntry {
+    uint64_t pathHash;
+    uint64_t contentHash; // FNV-1a of the uncompressed bytes, stands in for the file time
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;        // uncompressed
+    uint32_t nameOffset;  // into the path strings, zero terminated
+    uint32_t flags;
+};
+
+static_assert(sizeof(PackHeader) == 40, "PackHeader is read straight from the file");
+static_assert(sizeof(PackEntry) == 48, "PackEntry is read straight from the file");
+
+// paths are hashed as given, normalized to forward slashes and without a leading ./
+inline uint64_t hashPackBytes(const void* data, size_t size, uint64_t hash = 1469598103934665603ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline std::string normalizePackPath(const std::string& path) {
+    std::string normalized = path;
+    for(char& c : normalized) {
+        if(c == '\\') c = '/';
+    }
+    while(normalized.compare(0, 2, "./") == 0) normalized.erase(0, 2);
+    return normalized;
+}
+
+#endif // PACK_FORMAT_H
@@ -0,0 +1,90 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Hardware performance counters around named engine scopes, through Linux perf_event_open.
+// Every thread that enters a scope gets its own counter group (user space only, so the
+// default perf_event_paranoid setting allows it) the first time it does. A Scope reads the
+// group when it starts and ends and adds the difference to its name, so nested scopes count
+// inclusively and a name used on several threads adds them all up. Each read is a syscall,
+// scopes are meant for whole passes and loaders, not for inner loops.
+// Off until setEnabled(true), and just reports itself unavailable elsewhere than Linux.
+class PerfCounters {
+public:
+    enum Counter {
+        Cycles,
+        Instructions,
+        L1Misses,     // L1 data cache read misses
+        LlcMisses,    // last level cache misses
+        BranchMisses,
+        kCounterCount
+    };
+
+    struct ScopeStats {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t counters[kCounterCount] = {};
+
+        double getIpc() const;
+        // misses per thousand instructions
+        double getMpki(Counter counter) const;
+    };
+
+    // times a scope, does nothing while the counters are off. name has to outlive the scope
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        bool m_active = false;
+        uint64_t m_start[kCounterCount];
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    // false once opening the counters failed, getError says why
+    static bool isAvailable();
+    static std::string getError();
+    static const char* getCounterName(Counter counter);
+
+    // once a frame, the scopes since the last call become the last frame
+    static void endFrame();
+    static std::vector<ScopeStats> getLastFrame();
+    // every scope since the last reset, load time work included
+    static std::vector<ScopeStats> getTotals();
+    static void resetTotals();
+
+    static std::string getReport();
+    static bool writeReport(const std::string& path);
+
+private:
+    struct Sample {
+        uint64_t calls = 0;
+        uint64_t counters[kCounterCount] = {};
+    };
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<bool> s_failed;
+    static std::mutex s_mutex;
+    static std::string s_error;
+    static std::map<std::string, Sample> s_frame;
+    static std::map<std::string, Sample> s_lastFrame;
+    static std::map<std::string, Sample> s_totals;
+
+    static bool readThreadCounters(uint64_t values[kCounterCount]);
+    static void record(const char* name, const uint64_t start[kCounterCount], const uint64_t end[kCounterCount]);
+    static std::vector<ScopeStats> toStats(const std::map<std::string, Sample>& samples);
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,149 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include "core/Window.h"
+#include "renderer/Shaders.h"
+#include "scene/Scene.h"
+
+// Headless render daemon.
+// Starts the renderer once behind an invisible window and keeps the loaded scenes, their
+// textures and the compiled programs resident between requests. Clients connect to a unix
+// domain socket and send one request per line:
+//
+//   render id=<tag> scene=<model>[,<model>...] camera=x,y,z,yaw,pitch,zoom size=<w>x<h> format=png|raw [out=<file>]
+//   shutdown
+//
+// and get back, in request order per connection:
+//
+//   ok <id> <out file>                                  when out= was given
+//   ok <id> <png|raw> <width> <height> <bytes>\n<bytes>  otherwise, raw is top down rgba8
+//   error <id> <reason>
+//
+// out= files land in the output folder given at startup, the path has to be relative and
+// can't contain .. components.
+//
+// Clients can pipeline any number of requests. They are queued and rendered one after the
+// other on the GL thread, the pixels come back through pixel buffers a request later so the
+// next render overlaps the readback, and encoding and writing happen on their own thread.
+class RenderServer {
+public:
+    // refuses to start if something other than a socket already sits at socketPath
+    explicit RenderServer(const std::string& socketPath, const std::string& outputDir = ".");
+    ~RenderServer();
+
+    // serves requests on the calling thread until a client sends shutdown
+    void run();
+
+private:
+    enum class ImageFormat {
+        Png,
+        Raw
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::mutex writeMutex;
+
+        ~Connection();
+        bool send(const void* data, size_t size);
+        bool sendLine(const std::string& line);
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> client;
+        std::string id;
+        std::string scene; // comma separated model paths, also the scene cache key
+        glm::vec3 position = glm::vec3(0.0f, 10.0f, 45.0f);
+        float yaw = -90.0f;
+        float pitch = 0.0f;
+        float zoom = 45.0f;
+        int width = 256;
+        int height = 256;
+        ImageFormat format = ImageFormat::Png;
+        std::string output; // written to this file under m_outputDir when set, sent back otherwise
+        std::string error;  // a request that failed before rendering, replied to in order like the rest
+    };
+
+    struct Readback {
+        Request request;
+        GLuint pbo = 0;
+        GLsync fence = nullptr; // none for failed requests
+    };
+
+    struct EncodeJob {
+        Request request;
+        std::vector<unsigned char> pixels; // bottom up rgba8, as read from GL
+    };
+
+    struct CachedScene {
+        std::unique_ptr<Scene> scene;
+        uint64_t lastUsed = 0;
+    };
+
+    std::string m_socketPath;
+    std::string m_outputDir; // out= paths are relative to this
+    int m_listenFd = -1;
+    std::atomic<bool> m_running{false};
+
+    std::unique_ptr<Window> m_window;
+
+    // accepting and reading, one thread per client
+    std::thread m_acceptThread;
+    std::mutex m_clientMutex;
+    std::condition_variable m_clientsDone;
+    int m_activeClients = 0; // client threads are detached, stop() waits for this to reach 0
+    std::vector<std::weak_ptr<Connection>> m_connections;
+
+    // parsed requests on their way to the GL thread
+    std::mutex m_requestMutex;
+    std::condition_variable m_requestCondition;
+    std::deque<Request> m_requests;
+
+    // GL thread only
+    std::deque<Readback> m_readbacks;
+    std::vector<GLuint> m_freePbos;
+    std::unordered_map<std::string, CachedScene> m_scenes;
+    uint64_t m_renderCount = 0;
+
+    // read back pixels on their way to the encoder
+    std::thread m_encodeThread;
+    std::mutex m_encodeMutex;
+    std::condition_variable m_encodeCondition;
+    std::deque<EncodeJob> m_encodeJobs;
+    bool m_encoding = false; // under m_encodeMutex, cleared by stop() once the last jobs are queued
+
+    bool listen();
+    void acceptLoop();
+    void clientLoop(std::shared_ptr<Connection> connection);
+    void readRequests(const std::shared_ptr<Connection>& connection);
+    bool parseRequest(const std::string& line, Request& request, std::string& error);
+    void pushRequest(Request request);
+
+    Scene* getScene(const std::string& spec, const Request& request);
+    void drawScene(Scene& scene, const Request& request);
+    void render(const Request& request);
+    // hands finished readbacks to the encoder, blocks for the oldest one when wait is set
+    void collectReadbacks(bool wait);
+
+    void encodeLoop();
+    void finishJob(EncodeJob& job);
+
+    void stop();
+};
+
+#endif // RENDER_SERVER_H
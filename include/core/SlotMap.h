@@ -0,0 +1,123 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Refers to one value in a SlotMap whose handles are keyed on T. Stays valid while the value lives, and once it is
+// removed the slot's generation moves on, so the old handle finds nothing instead of
+// whatever reused the slot.
+template<typename T>
+struct Handle {
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+    uint32_t index = kInvalidIndex;
+    uint32_t generation = 0;
+
+    bool isNull() const { return index == kInvalidIndex; }
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// Values packed in one dense array, addressed through a table of slots.
+// insert and remove are O(1): a removed value is replaced by the last one, and its slot goes
+// on a free list with its generation bumped. Iterating getValues() touches only live values,
+// in no particular order, the order changes whenever something is removed.
+// Key only types the handles, so a map of unique_ptr<Model> can hand out Handle<Model>.
+template<typename T, typename Key = T>
+class SlotMap {
+public:
+    Handle<Key> insert(T value) {
+        uint32_t slotIndex;
+        if(m_freeHead != Handle<Key>::kInvalidIndex) {
+            slotIndex = m_freeHead;
+            m_freeHead = m_slots[slotIndex].dense;
+        } else {
+            slotIndex = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+
+        Slot& slot = m_slots[slotIndex];
+        slot.dense = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_owners.push_back(slotIndex);
+
+        Handle<Key> handle;
+        handle.index = slotIndex;
+        handle.generation = slot.generation;
+        return handle;
+    }
+
+    // false if the handle was stale already
+    bool remove(Handle<Key> handle) {
+        if(!contains(handle)) return false;
+
+        Slot& slot = m_slots[handle.index];
+        uint32_t dense = slot.dense;
+        uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+        if(dense != last) {
+            m_values[dense] = std::move(m_values[last]);
+            m_owners[dense] = m_owners[last];
+            m_slots[m_owners[dense]].dense = dense;
+        }
+        m_values.pop_back();
+        m_owners.pop_back();
+
+        slot.generation++;
+        slot.dense = m_freeHead;
+        m_freeHead = handle.index;
+        return true;
+    }
+
+    bool contains(Handle<Key> handle) const {
+        return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation
+            && m_slots[handle.index].dense < m_values.size() && m_owners[m_slots[handle.index].dense] == handle.index;
+    }
+
+    // nullptr for stale handles
+    T* get(Handle<Key> handle) {
+        return contains(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+    }
+
+    const T* get(Handle<Key> handle) const {
+        return contains(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+    }
+
+    // the handle of the value at a position of getValues()
+    Handle<Key> getHandle(size_t dense) const {
+        Handle<Key> handle;
+        handle.index = m_owners[dense];
+        handle.generation = m_slots[handle.index].generation;
+        return handle;
+    }
+
+    const std::vector<T>& getValues() const { return m_values; }
+    size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+
+    void clear() {
+        for(uint32_t dense = 0; dense < m_values.size(); dense++) {
+            Slot& slot = m_slots[m_owners[dense]];
+            slot.generation++;
+            slot.dense = m_freeHead;
+            m_freeHead = m_owners[dense];
+        }
+        m_values.clear();
+        m_owners.clear();
+    }
+
+private:
+    struct Slot {
+        uint32_t dense = 0;      // position in m_values while live, the next free slot while free
+        uint32_t generation = 0;
+    };
+
+    std::vector<T> m_values;
+    std::vector<uint32_t> m_owners; // slot of each value, to fix the slot up when a value moves
+    std::vector<Slot> m_slots;
+    uint32_t m_freeHead = Handle<Key>::kInvalidIndex;
+};
+
+#endif // SLOT_MAP_H
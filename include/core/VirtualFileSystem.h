@@ -0,0 +1,92 @@
+#ifndef VIRTUAL_FILE_SYSTEM_H
+#define VIRTUAL_FILE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/MappedFile.h"
+#include "core/PackFormat.h"
+
+// The bytes of one file as the virtual file system hands them out. Points straight into a
+// mounted pack or a mapping of the loose file, only compressed entries own a decoded copy.
+class FileData {
+public:
+    FileData() = default;
+    FileData(FileData&& other) noexcept;
+    FileData& operator=(FileData&& other) noexcept;
+    FileData(const FileData&) = delete;
+    FileData& operator=(const FileData&) = delete;
+
+    bool isValid() const;
+    const char* data() const;
+    size_t size() const;
+
+    // hint that the whole file is about to be read front to back
+    void adviseSequential() const;
+
+private:
+    friend class VirtualFileSystem;
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    MappedFile m_loose;
+    std::vector<char> m_decoded;
+};
+
+// Reads fixed size fields front to back out of a FileData, like an istream that stays
+// failed after the first read past the end.
+class FileReader {
+public:
+    explicit FileReader(const FileData& file);
+
+    bool read(void* dst, size_t size);
+    explicit operator bool() const;
+
+private:
+    const char* m_cursor;
+    const char* m_end;
+    bool m_failed;
+};
+
+// Every asset read goes through here. Mounted .pak archives (see PackFormat.h) are searched
+// newest first, then the loose file on disk, so a missing pack or a file that isn't packed
+// just falls back to the old path. Reads from a pack are a binary search over a directory
+// sorted by path hash and a pointer into the mapping, no open or read per file.
+// Mount the packs before anything loads, lookups from the loader threads aren't locked.
+class VirtualFileSystem {
+public:
+    // what the build packs the asset folders into, next to the executable
+    static constexpr const char* kAssetPack = "assets.pak";
+
+    static bool mount(const std::string& packPath);
+    static void unmountAll();
+
+    // an invalid FileData if the file is nowhere
+    static FileData read(const std::string& path);
+    static bool exists(const std::string& path);
+    // changes whenever the file's contents do, 0 if it doesn't exist: the packed content
+    // hash, or the size and modification time of a loose file
+    static uint64_t getFileStamp(const std::string& path);
+
+    static size_t getPackCount();
+    static size_t getPackedFileCount();
+
+private:
+    struct Pack {
+        std::string path;
+        MappedFile file;
+        const PackEntry* entries = nullptr;
+        uint32_t entryCount = 0;
+        const char* names = nullptr;
+        size_t namesSize = 0;
+    };
+
+    static std::vector<std::unique_ptr<Pack>> s_packs;
+
+    static const PackEntry* find(const std::string& path, const Pack** pack);
+};
+
+#endif // VIRTUAL_FILE_SYSTEM_H
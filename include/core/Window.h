@@ -7,7 +7,8 @@
 
 class Window {
 public:
-    Window(int width, int height, const std::string& title);
+    // an invisible window still gives a full GL context, for headless rendering
+    Window(int width, int height, const std::string& title, bool visible = true);
     ~Window();
 
     bool shouldClose() const;
@@ -7,6 +7,8 @@
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
 
+#include "core/MemoryTracker.h"
+
 // static class for handling ImGui operations
 class ImguiLayer {
 public:
@@ -0,0 +1,57 @@
+#ifndef SCENE_OUTLINER_H
+#define SCENE_OUTLINER_H
+
+#include "imgui.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "scene/Scene.h"
+
+// Outliner for scenes with a lot of objects.
+// The model/mesh hierarchy is flattened into a cached pre-order array that is only rebuilt
+// when the hierarchy changes, and only the rows on screen are submitted (ImGuiListClipper).
+// The search box filters through a trigram index over the cached lower case names, and a
+// query that extends the previous one only re-checks the previous matches.
+class SceneOutliner {
+public:
+    // draws into the current ImGui window
+    void draw(Scene& scene);
+
+private:
+    struct Node {
+        Model* model;
+        int mesh;         // -1 for model rows, otherwise the index into model->m_meshes
+        int parent;       // -1 for roots
+        int depth;
+        int subtreeEnd;   // one past the last descendant, skipping a collapsed node jumps here
+        std::string name;
+        std::string lowerName;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint8_t> m_expanded;
+    std::vector<int> m_rows; // nodes currently listed, in display order
+    bool m_rowsDirty = true;
+
+    uint64_t m_sceneVersion = ~0ull;
+
+    // search
+    char m_filterText[128] = {};
+    std::string m_filter;               // lower case, what m_matches was computed for
+    std::vector<int> m_matches;         // nodes whose name contains m_filter
+    std::vector<uint8_t> m_filterShown; // matches plus their ancestors
+    std::unordered_map<uint32_t, std::vector<int>> m_trigrams;
+
+    ModelHandle m_selected;
+    std::string m_selectedName;
+
+    void rebuild(Scene& scene);
+    void updateFilter(const std::string& filter);
+    void rebuildRows();
+    void drawRow(int nodeIndex);
+};
+
+#endif // SCENE_OUTLINER_H
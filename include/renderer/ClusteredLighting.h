@@ -0,0 +1,72 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "renderer/Shaders.h"
+#include "scene/Light.h"
+#include "core/MemoryTracker.h"
+
+// Clustered forward shading for the scene's point and spot lights.
+// The view frustum is cut into a froxel grid (screen tiles x exponential depth slices),
+// every frame the CPU assigns each light to the froxels its bounding sphere touches and
+// uploads the result, the lit shader then only loops over the lights of its own froxel.
+//
+// Uploaded as two texture buffers:
+//   u_LightData   (RGBA32F) four texels per light, see packLights()
+//   u_ClusterData (R32UI)   (offset, count) per froxel followed by the light index lists
+class ClusteredLighting {
+public:
+    static const int kTilesX = 16;
+    static const int kTilesY = 9;
+    static const int kSlicesZ = 24;
+    static const int kNumClusters = kTilesX * kTilesY * kSlicesZ;
+    static const int kMaxLightsPerCluster = 256;
+
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    void update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+    void bind(Shader& shader, int lightUnit, int clusterUnit, int viewportWidth, int viewportHeight) const;
+
+    int getLightCount() const;
+    int getAssignedIndices() const;
+
+private:
+    // view space bounds of the froxels of one depth slice, structure of arrays so the
+    // sphere test can run on four froxels at a time
+    struct SliceBounds {
+        float minX[kTilesX * kTilesY], minY[kTilesX * kTilesY], minZ[kTilesX * kTilesY];
+        float maxX[kTilesX * kTilesY], maxY[kTilesX * kTilesY], maxZ[kTilesX * kTilesY];
+        float nearDepth, farDepth; // positive distances
+    };
+
+    struct LightSphere {
+        glm::vec3 center; // view space
+        float radius;
+    };
+
+    GLuint m_lightBuffer = 0, m_lightTexture = 0;
+    GLuint m_clusterBuffer = 0, m_clusterTexture = 0;
+
+    std::vector<SliceBounds> m_slices;
+    glm::mat4 m_cachedProjection = glm::mat4(0.0f);
+    float m_nearPlane = 0.1f, m_farPlane = 100.0f;
+
+    std::vector<glm::vec4> m_lightData;
+    std::vector<LightSphere> m_spheres;
+    std::vector<std::vector<uint32_t>> m_clusterLights;
+    std::vector<uint32_t> m_clusterData;
+
+    int m_assignedIndices = 0;
+
+    void buildSlices(const glm::mat4& projection);
+    void packLights(const std::vector<Light>& lights, const glm::mat4& view);
+    void assignSlice(int slice);
+    void upload();
+};
+
+#endif // CLUSTERED_LIGHTING_H
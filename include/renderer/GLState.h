@@ -0,0 +1,77 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/gl.h>
+
+#include <cstdint>
+
+// Shadow copy of the GL state the draw path touches: program, vertex array, texture bindings
+// per unit, framebuffers, viewport, blend and depth state.
+// Every change goes through here and is only sent to the driver when it differs from what is
+// already set, so callers can state what they need without reading state back or restoring it.
+// Anything that changes this state has to go through GLState too (or call invalidate), and
+// deleted textures, vertex arrays and framebuffers have to be forgotten, since GL unbinds them
+// and may hand the name out again.
+class GLState {
+public:
+    // everything unknown, the next call of each kind goes to the driver
+    static void invalidate();
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+    // also makes unit the active texture unit
+    static void bindTexture(int unit, GLenum target, GLuint texture);
+
+    // GL_FRAMEBUFFER sets both the draw and the read binding
+    static void bindFramebuffer(GLenum target, GLuint framebuffer);
+    static GLuint getDrawFramebuffer();
+
+    static void setViewport(int x, int y, int width, int height);
+    // x, y, width, height, without a glGet round trip
+    static void getViewport(int viewport[4]);
+
+    static void setEnabled(GLenum capability, bool enabled);
+    static void setBlendFunc(GLenum source, GLenum destination);
+    static void setDepthFunc(GLenum func);
+    static void setDepthMask(bool write);
+
+    static void forgetTexture(GLuint texture);
+    static void forgetVertexArray(GLuint vertexArray);
+    static void forgetFramebuffer(GLuint framebuffer);
+
+    // calls sent to the driver and calls skipped, since the last resetStats
+    static uint64_t getIssuedCalls();
+    static uint64_t getSkippedCalls();
+    // keeps the finished frame's counts for getLastFrame*
+    static void resetStats();
+    static uint64_t getLastFrameIssued();
+    static uint64_t getLastFrameSkipped();
+
+private:
+    static const int kTextureUnits = 16;
+    static const int kTextureTargets = 4; // 2D, 2D array, cube map, buffer
+    static const int kCapabilities = 5;   // blend, depth test, cull face, polygon offset fill, scissor test
+
+    static GLuint s_program;
+    static GLuint s_vertexArray;
+    static int s_activeUnit;
+    static GLuint s_textures[kTextureUnits][kTextureTargets];
+    static GLuint s_drawFramebuffer;
+    static GLuint s_readFramebuffer;
+    static int s_viewport[4];
+    static bool s_viewportKnown;
+    static int8_t s_capabilities[kCapabilities]; // -1 unknown
+    static GLenum s_blendSource;
+    static GLenum s_blendDestination;
+    static GLenum s_depthFunc;
+    static int8_t s_depthMask;
+
+    static uint64_t s_issued;
+    static uint64_t s_skipped;
+    static uint64_t s_lastFrameIssued;
+    static uint64_t s_lastFrameSkipped;
+
+    static void setActiveUnit(int unit);
+};
+
+#endif // GL_STATE_H
@@ -0,0 +1,70 @@
+#ifndef IMAGE_BASED_LIGHTING_H
+#define IMAGE_BASED_LIGHTING_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "renderer/Shaders.h"
+#include "stb_image.h"
+#include "core/MemoryTracker.h"
+
+// Image based lighting precomputed from an environment image.
+// The source (a 6:1 horizontal strip of cube faces or a 2:1 equirectangular image) is
+// turned into a cubemap on the CPU, then three things are baked over the JobSystem:
+//   - 9 spherical harmonic coefficients for the diffuse irradiance
+//   - a GGX prefiltered specular cubemap, one roughness step per mip
+//   - the split sum BRDF lookup table
+// The results are written next to the source as <source>.iblcache and reused as long as
+// the source file doesn't change, so the bake only runs once.
+class ImageBasedLighting {
+public:
+    ImageBasedLighting();
+    ~ImageBasedLighting();
+
+    // loads from the cache when it is valid, bakes and writes it otherwise
+    bool load(const std::string& path);
+    bool isLoaded() const;
+
+    void bind(Shader& shader, int specularUnit, int brdfUnit) const;
+
+private:
+    // float rgb cubemap on the cpu, faces in GL order (+X, -X, +Y, -Y, +Z, -Z)
+    struct CubeImage {
+        int size = 0;
+        std::vector<glm::vec3> faces[6];
+    };
+
+    struct BakedData {
+        glm::vec3 sh[9];
+        int specularSize = 0;
+        int specularLevels = 0;
+        std::vector<std::vector<glm::vec3>> specular; // [level * 6 + face]
+        int brdfSize = 0;
+        std::vector<glm::vec2> brdf;
+    };
+
+    GLuint m_specularCubemap = 0;
+    GLuint m_brdfLut = 0;
+    glm::vec3 m_sh[9];
+    int m_specularLevels = 0;
+    bool m_loaded = false;
+
+    static std::string getCachePath(const std::string& path);
+    static uint64_t getSourceKey(const std::string& path);
+    static bool readCache(const std::string& cachePath, uint64_t key, BakedData& data);
+    static void writeCache(const std::string& cachePath, uint64_t key, const BakedData& data);
+
+    static bool loadSourceCube(const std::string& path, int faceSize, CubeImage& cube);
+    static std::vector<CubeImage> buildMipChain(const CubeImage& base);
+    static void computeSH(const CubeImage& cube, glm::vec3 sh[9]);
+    static void prefilterSpecular(const std::vector<CubeImage>& chain, BakedData& data);
+    static void integrateBRDF(BakedData& data);
+
+    void upload(const BakedData& data);
+};
+
+#endif // IMAGE_BASED_LIGHTING_H
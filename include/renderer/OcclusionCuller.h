@@ -0,0 +1,63 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+
+#include "scene/Model.h"
+#include "scene/Bounds.h"
+#include "core/MemoryTracker.h"
+
+// CPU occlusion culling against a small software depth buffer.
+// Each frame the biggest on screen meshes are picked as occluders and rasterized (SSE,
+// split into horizontal bands over the JobSystem workers) into a low resolution depth
+// buffer, which is reduced into a max depth pyramid. Mesh bounds are then tested against
+// the pyramid before draw submission. No GPU readback is involved, the result is ready
+// in the same frame.
+class OcclusionCuller {
+public:
+    static const int kWidth = 320;
+    static const int kHeight = 192;
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    // picks the occluders, rasterizes them and builds the depth pyramid
+    void render(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection);
+
+    // false only if the world space box is entirely behind the rasterized occluders
+    bool isVisible(const BoundingBox& worldBox) const;
+
+    int getOccluderCount() const;
+    int getOccluderTriangles() const;
+
+private:
+    struct ScreenTriangle {
+        glm::vec3 v[3]; // x, y in pixels (y up), z as depth in [0, 1]
+        float minY, maxY;
+    };
+
+    struct Occluder {
+        const Mesh* mesh;
+        glm::mat4 mvp;
+        float screenSize;
+    };
+
+    std::vector<float> m_depth;                   // nearest occluder depth per pixel, 1 = nothing
+    std::vector<std::vector<float>> m_pyramid;    // farthest depth per texel, level 0 is m_depth
+    std::vector<glm::ivec2> m_pyramidSizes;
+
+    std::vector<Occluder> m_occluders;
+    std::vector<std::vector<ScreenTriangle>> m_perOccluderTriangles;
+    std::vector<ScreenTriangle> m_triangles;
+
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+
+    void selectOccluders(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection);
+    void setupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& out) const;
+    void rasterizeBand(int y0, int y1);
+    void buildPyramid();
+};
+
+#endif // OCCLUSION_CULLER_H
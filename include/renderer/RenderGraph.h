@@ -0,0 +1,141 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// The passes of a frame and the resources they read and write, rebuilt every frame.
+// compile() drops the passes nothing reads from (walking back from the outputs), then works
+// out the first and last pass that touches each transient texture. execute() runs the
+// remaining passes in declaration order, binding a framebuffer for whatever each one draws
+// into and clearing attachments that are written for the first time.
+// Transient textures come from a pool that survives across frames and go back to it after
+// their last pass, so transients whose lifetimes don't overlap end up in the same texture.
+// GL 3.3 has no placed resources, sharing the texture object is how the memory is aliased.
+class RenderGraph {
+public:
+    using Resource = int;
+    using Pass = int;
+
+    struct TextureDesc {
+        int width = 0;
+        int height = 0;
+        GLenum format = GL_RGBA8; // depth formats become the depth attachment
+
+        bool operator==(const TextureDesc& other) const {
+            return width == other.width && height == other.height && format == other.format;
+        }
+    };
+
+    enum class Load {
+        Keep,
+        Clear
+    };
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // forgets the last frame's passes and resources, the pooled textures stay
+    void reset();
+
+    Resource createTexture(const std::string& name, const TextureDesc& desc);
+    // a framebuffer the graph doesn't own, outputs are what keeps passes from being culled
+    Resource importFramebuffer(const std::string& name, GLuint framebuffer, int width, int height, bool output);
+    // state kept outside the graph (shadow maps, light lists, visibility), only orders the passes
+    Resource importExternal(const std::string& name, bool output = false);
+    void setClearColor(Resource resource, const glm::vec4& color);
+
+    Pass addPass(const std::string& name, std::function<void()> execute);
+    void read(Pass pass, Resource resource);
+    // transient textures are always cleared on their first write, their old contents belong to someone else
+    void write(Pass pass, Resource resource, Load load = Load::Keep);
+
+    // false if the graph can't run, the errors are printed
+    bool compile();
+    void execute();
+
+    // the texture behind a transient, valid from compile() to the next reset()
+    GLuint getTexture(Resource resource) const;
+
+    int getPassCount() const;
+    int getCulledPassCount() const;
+    int getTransientCount() const;         // transient textures used this frame
+    int getPhysicalTextureCount() const;   // pooled textures they were placed in
+    size_t getPoolBytes() const;
+
+    // a pooled texture unused for this many frames is deleted
+    static const int kMaxIdleFrames = 120;
+
+private:
+    enum class ResourceType {
+        Transient,
+        Framebuffer,
+        External
+    };
+
+    struct ResourceNode {
+        std::string name;
+        ResourceType type;
+        TextureDesc desc;
+        GLuint framebuffer = 0;
+        bool output = false;
+        glm::vec4 clearColor = glm::vec4(0.0f);
+
+        std::vector<Pass> writers;
+        int readers = 0;
+        int references = 0;
+
+        Pass firstUse = -1;
+        Pass lastUse = -1;
+        int physical = -1; // index into m_pool
+    };
+
+    struct Write {
+        Resource resource;
+        Load load;
+    };
+
+    struct PassNode {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Resource> reads;
+        std::vector<Write> writes;
+        int references = 0;
+        bool culled = false;
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        GLuint texture = 0;
+        bool inUse = false;
+        int idleFrames = 0;
+    };
+
+    std::vector<ResourceNode> m_resources;
+    std::vector<PassNode> m_passes;
+    std::vector<PooledTexture> m_pool;
+    // keyed by the attached textures, color first and depth last
+    std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+    bool m_compiled = false;
+
+    int m_culledPasses = 0;
+    int m_transients = 0;
+    int m_physicalTextures = 0;
+
+    bool isValid(Resource resource) const;
+    int acquireTexture(const TextureDesc& desc);
+    void trimPool();
+    void deleteFramebuffersUsing(GLuint texture);
+    GLuint getFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment);
+    void bindTargets(Pass index);
+};
+
+#endif // RENDER_GRAPH_H
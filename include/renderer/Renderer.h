@@ -7,8 +7,21 @@
 #include <GLFW/glfw3.h>
 
 #include "renderer/Shaders.h"
+#include "renderer/ShaderVariants.h"
 #include "scene/Model.h"
+#include "scene/Material.h"
 #include "scene/Skybox.h"
+#include "scene/Bounds.h"
+#include "renderer/TextureStreamer.h"
+#include "renderer/ShadowMap.h"
+#include "renderer/ClusteredLighting.h"
+#include "renderer/OcclusionCuller.h"
+#include "renderer/ImageBasedLighting.h"
+#include "renderer/SkinningPalette.h"
+#include "renderer/SceneTarget.h"
+#include "renderer/StreamBuffer.h"
+#include "renderer/RenderGraph.h"
+#include "scene/Light.h"
 
 class Renderer {
 public:
@@ -16,25 +29,128 @@ public:
     static void init();
     static void shutdown();
 
-    // core drawing method
-    static void submit(Shader& shader, Model& model, const glm::mat4& view, const glm::mat4& projection);
+    // queues the model's visible meshes, they are drawn sorted by shader variant and material
+    static void submit(Model& model, const glm::mat4& view, const glm::mat4& projection);
 
 
     // managing viewport and the frame on the screen
     static void clear(float r, float g, float b, float a =1.0f);
     static void setViewport(int x, int y, int width, int height);
-    static void drawViewportGizmo(const glm::mat4& cameraRotation, const glm::mat4& projection);
-    static void beginScene(glm::mat4& view, glm::mat4& projection);
+
+    // everything between beginFrame and endFrame for one view, declared as a render graph:
+    // skinning, shadows, light binning, culling, the sky and the models. The grid, axes and
+    // view gizmo are editor overlays, off for offscreen renders
+    static void renderScene(const std::vector<std::unique_ptr<Model>>& models, const std::vector<Light>& lights,
+                            const glm::mat4& view, const glm::mat4& projection, bool drawOverlays = true);
+    static const RenderGraph* getRenderGraph();
+
+    // the lit shader's keywords are the material feature flags, then this
+    static const uint32_t kVariantSkinned = 1u << 3;
+    static const ShaderVariants* getLitShader();
+    static int getQueuedDrawCount();
+    static int getProgramSwitchCount();
+
+    // back faces of single sided materials are dropped by GL in the lit pass, and their meshlets
+    // whose normal cone faces away from the camera before they are drawn. Off for models with
+    // inconsistent winding
+    static void setBackfaceCulling(bool enabled);
+    static bool isBackfaceCullingEnabled();
+    // meshlets of the meshes that passed the mesh level culling, and why the rest were dropped
+    static int getTestedMeshletCount();
+    static int getOutsideMeshletCount();
+    static int getBackfacingMeshletCount();
+
+    // the 3d scene goes into an offscreen target at a fraction of the output size,
+    // endFrame upscales it onto the default framebuffer
+    static void beginFrame(int outputWidth, int outputHeight, float resolutionScale);
+    static void endFrame();
+    // the offscreen target of the current frame, read it instead of calling endFrame to keep the frame off screen
+    static const SceneTarget* getSceneTarget();
+
+    // directional light, the direction points towards the light
+    static void setLightDirection(const glm::vec3& direction);
+    static void renderShadows(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection);
+    static const CascadedShadowMap* getShadowMap();
+
+    // bins the scene's point and spot lights into the froxel grid for this frame
+    static void updateLights(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+    static const ClusteredLighting* getClusteredLighting();
+
+    // frustum and software occlusion culling, marks the hidden meshes before submit
+    static void cullScene(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection);
+    static void setOcclusionCulling(bool enabled);
+    static bool isOcclusionCullingEnabled();
+    static const OcclusionCuller* getOcclusionCuller();
+    static int getFrustumCulledCount();
+    static int getOccludedCount();
+
+    // gathers the animators' joint matrices into the palette the skinned draws read
+    static void updateSkinning(const std::vector<std::unique_ptr<Model>>& models);
+    static const SkinningPalette* getSkinningPalette();
+
+    // ambient lighting baked from the environment image
+    static const ImageBasedLighting* getEnvironment();
+
+    // per frame uniforms and debug vertices are written through this
+    static const StreamBuffer* getStreamBuffer();
+    static const GLuint kFrameBlockBinding = 1;
 
 private:
-    static GLuint s_LineVAO, s_LineVBO;
+    static GLuint s_LineVAO;
+    static int s_viewportWidth, s_viewportHeight;
 
     static std::unique_ptr<Shader> s_lineShader;
     static std::unique_ptr<Skybox> s_skybox;
+    static std::unique_ptr<CascadedShadowMap> s_shadowMap;
+    static glm::vec3 s_lightDir;
+    static std::unique_ptr<ClusteredLighting> s_clusteredLighting;
+    static std::unique_ptr<OcclusionCuller> s_occlusionCuller;
+    static bool s_occlusionCullingEnabled;
+    static int s_frustumCulled, s_occluded;
+    static std::unique_ptr<ImageBasedLighting> s_environment;
+    static std::unique_ptr<SkinningPalette> s_skinningPalette;
+    static std::unique_ptr<SceneTarget> s_sceneTarget;
+    static std::unique_ptr<StreamBuffer> s_streamBuffer;
+    static GLint s_uniformAlignment;
+    static GLintptr s_frameBlockOffset; // -1 until this frame's block is uploaded
+    static std::vector<unsigned int> s_frameBlockPrograms;
+    static std::unique_ptr<RenderGraph> s_renderGraph;
+    static std::unique_ptr<Shader> s_compositeShader;
+    static GLuint s_emptyVAO; // for draws that make their vertices in the shader
+
+    struct DrawItem {
+        uint64_t key; // variant in the high half, material in the low half
+        const Mesh* mesh;
+        const Model* model;
+        glm::mat4 world;
+        // the surviving meshlets' index ranges in s_rangeCounts/s_rangeOffsets, none draws the whole mesh
+        int firstRange = 0;
+        int rangeCount = 0;
+    };
+    static std::unique_ptr<ShaderVariants> s_litShader;
+    static std::vector<DrawItem> s_drawQueue;
+    static int s_queuedDraws, s_programSwitches;
+    static bool s_backfaceCullingEnabled;
+    static std::vector<GLsizei> s_rangeCounts;
+    static std::vector<const void*> s_rangeOffsets;
+    static int s_meshletsTested, s_meshletsOutside, s_meshletsBackfacing;
+
+    static void drawQueue(const glm::mat4& view, const glm::mat4& projection);
+    static void bindLitProgram(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
+    static bool cullMeshlets(const Mesh& mesh, const glm::mat4& world, const glm::vec3& cameraPos, const Frustum& frustum,
+                             bool cullBackfaces, DrawItem& item);
 
+    static void drawViewportGizmo(const glm::mat4& cameraRotation);
+    // blends a texture over the given rectangle of the bound target
+    static void compositeTexture(GLuint texture, int x, int y, int width, int height);
     static void drawGrid(const glm::mat4& view, const glm::mat4& projection);
     static void drawAxes(const glm::mat4& view, const glm::mat4& projection);
+    static void requestTextureFootprints(const Model& model, const glm::mat4& view, const glm::mat4& projection);
     static void renderLine(glm::vec3 start, glm::vec3 end, glm::vec3 color, const glm::mat4& view, const glm::mat4& projection);
+    // pairs of points, all in one draw
+    static void renderLines(const glm::vec3* points, size_t count, glm::vec3 color, const glm::mat4& view, const glm::mat4& projection);
+    static void setupFrameBlock(const Shader& shader);
+    static void uploadFrameBlock(const glm::mat4& view, const glm::mat4& projection);
 
 
 };
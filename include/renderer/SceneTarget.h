@@ -0,0 +1,40 @@
+#ifndef SCENE_TARGET_H
+#define SCENE_TARGET_H
+
+#include <glad/gl.h>
+
+#include "core/MemoryTracker.h"
+
+// Offscreen color + depth target the 3D scene is drawn into at a scaled resolution.
+// The attachments are sized for the full output and the scene only uses the lower
+// left corner, so changing the scale every few frames never reallocates anything.
+// resolve() stretches that corner onto the default framebuffer with a linear blit.
+class SceneTarget {
+public:
+    SceneTarget(int width, int height);
+    ~SceneTarget();
+
+    // binds the target and returns the scaled size to render at
+    void bind(float scale, int& renderWidth, int& renderHeight);
+    void resolve();
+
+    void resize(int width, int height);
+    int getWidth() const;
+    int getHeight() const;
+    GLuint getFramebuffer() const;
+
+private:
+    GLuint m_FBO = 0;
+    GLuint m_color = 0;
+    GLuint m_depth = 0;
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_renderWidth = 0;
+    int m_renderHeight = 0;
+
+    void create();
+    void destroy();
+};
+
+#endif // SCENE_TARGET_H
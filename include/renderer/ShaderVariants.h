@@ -0,0 +1,32 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "renderer/Shaders.h"
+
+// Compile time permutations of one vertex/fragment pair.
+// Each bit of a feature mask stands for a keyword that is #defined at the top of both
+// stages, so a variant only contains the code for the features it has instead of
+// branching on uniforms per fragment. Variants are compiled the first time a mask is asked
+// for and kept, keyed by the mask.
+class ShaderVariants {
+public:
+    // keywords[i] is defined when bit i of a mask is set
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, std::vector<std::string> keywords);
+
+    Shader& get(uint32_t features);
+    size_t getCompiledCount() const;
+
+private:
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::vector<std::string> m_keywords;
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> m_variants;
+};
+
+#endif // SHADER_VARIANTS_H
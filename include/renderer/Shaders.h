@@ -7,6 +7,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 
 class Shader {
@@ -15,6 +16,8 @@ public:
     unsigned int m_ID;
 
     Shader(const std::string& vertexPath, const std::string& fragmentPath);
+    // each define goes in as "#define <define>" right after the #version line of both stages
+    Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines);
 
     //activating the shader
     void use();
@@ -0,0 +1,82 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "renderer/Shaders.h"
+#include "renderer/ShaderVariants.h"
+#include "scene/Model.h"
+#include "scene/Bounds.h"
+#include "renderer/SkinningPalette.h"
+#include "core/MemoryTracker.h"
+
+// Cascaded shadow maps for the directional light.
+// Every cascade keeps two depth layers: a cached one with only the static casters and
+// the one that gets sampled, which is the cached layer plus the dynamic casters drawn
+// on top. The cached layer is only redrawn when the light, a static caster or the
+// (snapped) cascade bounds change, so a mostly static scene pays for the dynamic
+// casters only.
+class CascadedShadowMap {
+public:
+    static const int kNumCascades = 4;
+
+    CascadedShadowMap(int resolution = 1024);
+    ~CascadedShadowMap();
+
+    // fits the cascades to the camera and redraws whatever is out of date,
+    // skinned casters read their joints from the palette on paletteUnit
+    void update(const std::vector<std::unique_ptr<Model>>& models,
+                const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir,
+                const SkinningPalette* skinning = nullptr, int paletteUnit = 0);
+
+    // binds the sampled depth array and sets the cascade uniforms on the lit shader
+    void bind(Shader& shader, int textureUnit) const;
+
+    // forces every cached cascade to be redrawn on the next update
+    void invalidate();
+
+    // counters for the performance panel, reset every update
+    int getStaticRedraws() const;
+    int getCasterDraws() const;
+
+private:
+    struct Cascade {
+        glm::mat4 lightViewProjection = glm::mat4(1.0f);
+        glm::vec3 snappedCenter = glm::vec3(0.0f); // light space, decides when the cache is stale
+        float radius = 0.0f;
+        float splitFar = 0.0f; // view space distance where the next cascade takes over
+        bool staticDirty = true;
+        bool hadDynamic = false; // sampled layer still holds last frame's dynamic casters
+    };
+
+    int m_resolution;
+    GLuint m_staticDepth = 0; // cached static casters, one layer per cascade
+    GLuint m_depth = 0;       // what the lit shader samples
+    GLuint m_staticFBO = 0;
+    GLuint m_FBO = 0;
+
+    // bit 0 is SKINNED, like the lit shader the depth pass doesn't branch on it per vertex
+    static const uint32_t kDepthSkinned = 1u << 0;
+
+    Cascade m_cascades[kNumCascades];
+    std::unique_ptr<ShaderVariants> m_depthShaders;
+    const SkinningPalette* m_skinning = nullptr; // for the current update only
+    int m_paletteUnit = 0;
+
+    glm::vec3 m_lightDir = glm::vec3(0.0f);
+    uint64_t m_staticHash = 0;
+
+    int m_staticRedraws = 0;
+    int m_casterDraws = 0;
+
+    void fitCascades(const glm::mat4& view, const glm::mat4& projection);
+    uint64_t hashStaticCasters(const std::vector<std::unique_ptr<Model>>& models) const;
+    void drawCasters(const std::vector<std::unique_ptr<Model>>& models, const Cascade& cascade, bool staticCasters);
+};
+
+#endif // SHADOW_MAP_H
@@ -0,0 +1,37 @@
+#ifndef SKINNING_PALETTE_H
+#define SKINNING_PALETTE_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+
+#include "renderer/Shaders.h"
+#include "scene/Model.h"
+#include "core/MemoryTracker.h"
+
+// Joint matrices of every skinned model in one texture buffer (RGBA32F, 3 texels per
+// joint holding the rows of the affine matrix). Rebuilt once a frame from the animators,
+// each model remembers where its joints start in m_paletteOffset and the vertex shader
+// skins with u_JointPalette. One upload for the whole scene instead of one per character.
+class SkinningPalette {
+public:
+    SkinningPalette();
+    ~SkinningPalette();
+
+    void update(const std::vector<std::unique_ptr<Model>>& models);
+    void bind(Shader& shader, int textureUnit) const;
+
+    // stats for the performance panel
+    int getSkinnedModelCount() const;
+    int getJointCount() const;
+
+private:
+    GLuint m_buffer = 0;
+    GLuint m_texture = 0;
+
+    std::vector<glm::vec4> m_data;
+    int m_skinnedModels = 0;
+};
+
+#endif // SKINNING_PALETTE_H
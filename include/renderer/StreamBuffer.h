@@ -0,0 +1,63 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <vector>
+
+// Ring buffer for data that is written every frame (uniform blocks, debug vertices, instance data).
+// The buffer is split into one region per frame in flight. Uploads are bump allocated from the
+// current frame's region, and a fence is placed when the frame moves on, so a region is only
+// written again once the GPU has finished reading it. Nothing ever waits on an implicit sync.
+// With GL_ARB_buffer_storage the whole buffer stays persistently and coherently mapped and an
+// upload is a memcpy. Otherwise each upload maps just its range unsynchronized, which the
+// fences make safe.
+class StreamBuffer {
+public:
+    static const int kRegionCount = 3;
+
+    explicit StreamBuffer(size_t regionSize);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // once per frame before any upload, only waits if the GPU is a whole ring behind
+    void nextFrame();
+
+    // copies the data into this frame's region and returns its offset in getBuffer(),
+    // the region grows (into a new buffer) when a frame needs more than it holds
+    GLintptr upload(const void* data, size_t size, size_t alignment);
+
+    // changes when the region grows, re-point anything that reads it after every upload
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+    size_t getRegionSize() const;
+    size_t getFrameBytes() const; // uploaded so far this frame
+    int getStalls() const;        // frames that had to wait for their region
+
+private:
+    struct RetiredBuffer {
+        GLuint buffer;
+        int framesLeft;
+    };
+
+    GLuint m_buffer = 0;
+    unsigned char* m_mapped = nullptr; // persistent mapping, null on the fallback path
+    bool m_persistent = false;
+
+    size_t m_regionSize = 0;
+    int m_region = 0;
+    size_t m_cursor = 0; // within the current region
+    GLsync m_fences[kRegionCount] = {};
+    int m_stalls = 0;
+
+    // outgrown buffers stay alive until the frames that drew from them are done
+    std::vector<RetiredBuffer> m_retired;
+
+    void create(size_t regionSize);
+    void grow(size_t needed);
+};
+
+#endif // STREAM_BUFFER_H
@@ -0,0 +1,107 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/gl.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+#include "stb_image.h"
+#include "core/MemoryTracker.h"
+
+// Streams 2D textures mip by mip.
+// A texture starts with only its small tail mips resident, the renderer reports how
+// many screen pixels each texture covers, and the streamer decodes the missing higher
+// mips on a worker thread and uploads them on the main (GL) thread. When the resident
+// total goes over the budget the least important textures drop their top mips again.
+class TextureStreamer {
+public:
+    static void init(size_t budgetBytes = 512ull * 1024 * 1024);
+    static void shutdown();
+
+    // creates the GL texture right away (with a 1x1 placeholder) and queues the tail mips,
+    // the returned id stays the same no matter how many mips get streamed in or out
+    static unsigned int registerTexture(const std::string& path);
+    // deletes the GL texture, gives its resident bytes back and forgets any work queued for it
+    static void unregisterTexture(unsigned int textureID);
+
+    // footprint is the size in screen pixels of the geometry the texture is mapped onto,
+    // the largest footprint reported during a frame wins
+    static void requestFootprint(unsigned int textureID, float screenPixels);
+
+    // once per frame after rendering: upload finished mips, pick targets, enforce the budget
+    static void update();
+
+    static void setBudget(size_t budgetBytes);
+    static size_t getBudget();
+    static size_t getResidentBytes();
+    static size_t getTextureCount();
+    static size_t getPendingJobs();
+
+private:
+    struct StreamedTexture {
+        std::string path;
+        unsigned int id = 0;
+        int width = 0, height = 0, channels = 0;
+        int numLevels = 1;
+        int tailMip = 0;        // smallest set of mips that always stays resident
+        int residentMip = 0;    // highest detail level currently on the gpu
+        int targetMip = 0;
+        bool hasTail = false;   // false while only the placeholder is resident
+        bool pending = false;   // a decode job is in flight
+        float footprint = 0.0f; // largest footprint this frame
+        uint64_t lastVisibleFrame = 0;
+        uint32_t generation = 0; // bumped when the slot is freed, jobs for the old texture are dropped
+    };
+
+    struct StreamJob {
+        size_t index;
+        uint32_t generation;
+        std::string path;
+        int firstMip, lastMip; // [firstMip, lastMip)
+    };
+
+    struct StreamResult {
+        size_t index;
+        uint32_t generation;
+        int firstMip;
+        int width, height, channels;
+        std::vector<std::vector<unsigned char>> levels; // levels[0] is firstMip
+    };
+
+    // slots keep their position so jobs can refer to them by index, id 0 marks a free slot
+    static std::vector<StreamedTexture> s_textures;
+    static std::vector<size_t> s_freeSlots;
+    static std::unordered_map<unsigned int, size_t> s_indexByID;
+
+    static std::thread s_worker;
+    static std::mutex s_mutex;
+    static std::condition_variable s_condition;
+    static std::deque<StreamJob> s_jobs;
+    static std::deque<StreamResult> s_results;
+    static std::atomic<bool> s_running;
+
+    static size_t s_budgetBytes;
+    static size_t s_residentBytes;
+    static uint64_t s_frame;
+
+    static void workerLoop();
+    static StreamResult decodeMips(const StreamJob& job);
+
+    static void uploadResult(StreamResult& result);
+    static void dropMips(StreamedTexture& texture, int newResidentMip);
+    static void selectTargets();
+
+    static GLenum getFormat(int channels);
+    static size_t getLevelBytes(const StreamedTexture& texture, int level);
+    static size_t getBytesFrom(const StreamedTexture& texture, int firstMip);
+};
+
+#endif // TEXTURE_STREAMER_H
@@ -0,0 +1,36 @@
+#ifndef AMBIENT_OCCLUSION_BAKER_H
+#define AMBIENT_OCCLUSION_BAKER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scene/Mesh.h"
+
+// Per vertex ambient occlusion, baked once at load time instead of every frame on the GPU.
+// All triangles of a model's meshes go into a BVH, then every vertex casts kRayCount cosine
+// weighted rays over the hemisphere around its normal, four at a time as an SSE packet, with
+// the vertices spread over the JobSystem. The fraction of rays that escape within
+// kMaxDistance of the model's size becomes one byte per vertex, which the default shader
+// multiplies into the ambient term.
+// The result is written next to the model as <model>.aocache and reused as long as the
+// model file and the bake settings don't change.
+class AmbientOcclusionBaker {
+public:
+    static const int kRayCount = 64;
+    static constexpr float kMaxDistance = 0.1f; // ray length as a fraction of the bounds diagonal
+
+    // one entry per mesh, sized like its cpu vertices (empty for meshes without any),
+    // false if there was nothing to bake
+    static bool bake(const std::string& modelPath, const std::vector<Mesh>& meshes, std::vector<std::vector<uint8_t>>& occlusion);
+
+private:
+    static std::string getCachePath(const std::string& modelPath);
+    static uint64_t getSourceKey(const std::string& modelPath, const std::vector<Mesh>& meshes);
+    static bool readCache(const std::string& cachePath, uint64_t key, const std::vector<Mesh>& meshes, std::vector<std::vector<uint8_t>>& occlusion);
+    static void writeCache(const std::string& cachePath, uint64_t key, const std::vector<std::vector<uint8_t>>& occlusion);
+};
+
+#endif // AMBIENT_OCCLUSION_BAKER_H
@@ -0,0 +1,114 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Local joint transforms of a whole skeleton, stored as separate arrays of vec4 so
+// sampling and blending can run 4 floats at a time (SSE) without any shuffling.
+struct Pose {
+    std::vector<glm::vec4> rotations;    // quaternion as x, y, z, w
+    std::vector<glm::vec4> translations; // w unused
+    std::vector<glm::vec4> scales;       // w unused
+
+    void resize(size_t jointCount);
+    size_t size() const;
+};
+
+// Joints are sorted parent first, so the global transforms can be built in one pass.
+struct Skeleton {
+    // joint indices are packed into one byte per influence in the vertex
+    static const int kMaxJoints = 256;
+
+    std::vector<std::string> names;
+    std::vector<int> parents;            // -1 for the root, otherwise always below the joint's own index
+    std::vector<glm::mat4> inverseBind;  // mesh space to joint space, identity for joints without a bone
+    Pose bindPose;
+    glm::mat4 globalInverse = glm::mat4(1.0f);
+
+    int findJoint(const std::string& name) const;
+    size_t getJointCount() const;
+};
+
+// An animation resampled to a fixed rate and stored with quantized keys:
+// rotations as 4 x int16, translations and scales as 3 x uint16 inside a per track
+// range. Tracks that never change keep a single key. Sampling is two key lookups
+// and a lerp per joint, no key search.
+class AnimationClip {
+public:
+    static const int kSampleRate = 30;
+
+    // one track per skeleton joint, joints without a channel hold the bind pose
+    static AnimationClip fromAssimp(const aiAnimation* animation, const Skeleton& skeleton);
+
+    // time wraps around the clip's duration
+    void sample(float time, Pose& out) const;
+
+    const std::string& getName() const;
+    float getDuration() const;
+    size_t getCompressedBytes() const;
+
+private:
+    struct Track {
+        uint32_t rotationOffset = 0, rotationCount = 0;       // in keys
+        uint32_t translationOffset = 0, translationCount = 0;
+        uint32_t scaleOffset = 0, scaleCount = 0;
+        // decoded value = min + key * step, step.w stays 0
+        glm::vec4 translationMin = glm::vec4(0.0f), translationStep = glm::vec4(0.0f);
+        glm::vec4 scaleMin = glm::vec4(0.0f), scaleStep = glm::vec4(0.0f);
+    };
+
+    std::string m_name;
+    float m_duration = 0.0f;
+    int m_frameCount = 1;
+    std::vector<Track> m_tracks;
+
+    // the 3 component arrays carry one spare value so the SIMD decode can always read 8 bytes
+    std::vector<int16_t> m_rotationKeys;     // 4 per key
+    std::vector<uint16_t> m_translationKeys; // 3 per key
+    std::vector<uint16_t> m_scaleKeys;       // 3 per key
+};
+
+// out = mix(a, b, weight), rotations are nlerped along the shortest path
+void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out);
+
+// Plays the clips of one model instance and produces its skinning palette.
+// update() only touches this animator's own data, so many of them can run in parallel.
+class Animator {
+public:
+    Animator(const Skeleton* skeleton, const std::vector<AnimationClip>* clips);
+
+    // cross fades from whatever is playing over fadeSeconds
+    void play(int clip, float fadeSeconds = 0.0f);
+    void update(float deltaTime);
+
+    int getCurrentClip() const;
+    float m_speed = 1.0f;
+
+    // 3 rows of the affine skinning matrix per joint, ready for the texture buffer
+    const std::vector<glm::vec4>& getPalette() const;
+
+private:
+    const Skeleton* m_skeleton;
+    const std::vector<AnimationClip>* m_clips;
+
+    int m_clip = -1;
+    int m_previousClip = -1;
+    float m_time = 0.0f;
+    float m_previousTime = 0.0f;
+    float m_fade = 0.0f;         // seconds left in the cross fade
+    float m_fadeDuration = 0.0f;
+
+    Pose m_pose;
+    Pose m_previousPose;
+    std::vector<glm::mat4> m_globals;
+    std::vector<glm::vec4> m_palette;
+
+    void buildPalette();
+};
+
+#endif // ANIMATION_H
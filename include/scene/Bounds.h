@@ -0,0 +1,41 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+
+// axis aligned box in the local space of whatever owns it (usually a mesh)
+struct BoundingBox {
+    glm::vec3 min = glm::vec3( 1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    void expand(const glm::vec3& point);
+    bool isValid() const;
+
+    glm::vec3 getCenter() const;
+    glm::vec3 getExtents() const; // half size
+
+    // returns the box that encloses this one after being transformed by the matrix
+    BoundingBox transformed(const glm::mat4& transform) const;
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// world space sphere that encloses the box after the transform (handles non uniform scale)
+BoundingSphere getWorldSphere(const BoundingBox& box, const glm::mat4& transform);
+
+// six planes extracted from a view projection matrix, normals pointing inwards
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    bool intersectsSphere(const BoundingSphere& sphere) const;
+    bool intersectsBox(const BoundingBox& box) const;
+};
+
+#endif // BOUNDS_H
@@ -43,6 +43,8 @@ class Camera {
         void processMouseMovement(float xoffset, float yoffset);
         void processMouseScroll(float yoffset); // for zooming and such 
         void preProcessMouseMovement();
+        // sets the euler angles directly, used when replaying a recorded path
+        void setOrientation(float yaw, float pitch);
 
         ~Camera();
     
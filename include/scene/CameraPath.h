@@ -0,0 +1,42 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "scene/Camera.h"
+
+// A recorded camera flight: position, yaw/pitch and zoom keyed by time since the start.
+// Keys are taken at whatever rate the frames come in while recording and interpolated
+// on playback, so a replay can step through the path at any fixed timestep.
+class CameraPath {
+public:
+    struct Key {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+        float zoom;
+    };
+
+    void clear();
+    // keys must come in with increasing time, repeats of the last time are dropped
+    void addKey(float time, const Camera& camera);
+
+    // moves the camera to where the path is at time, clamped to the ends
+    void apply(float time, Camera& camera) const;
+
+    float getDuration() const;
+    size_t getKeyCount() const;
+
+    // plain text, one key per line
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    std::vector<Key> m_keys;
+};
+
+#endif // CAMERA_PATH_H
@@ -0,0 +1,49 @@
+#ifndef GEOMETRY_REGISTRY_H
+#define GEOMETRY_REGISTRY_H
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// Content addressed store for the static vertex and index buffers of meshes.
+// Uploads are hashed, and an upload with the same size and 128 bit digest as a resident buffer
+// gets that buffer back instead of a new one, without reading anything back from the gpu, so a model loaded twice or a part repeated across
+// meshes only takes its VRAM once. Buffers are reference counted and deleted with the
+// last release. GL thread only.
+class GeometryRegistry {
+public:
+    // a buffer holding exactly these bytes, uploaded unless identical data is already
+    // resident, either way the caller holds one reference; 0 for empty data
+    static GLuint acquire(const void* data, size_t size);
+    static void release(GLuint buffer);
+
+    static size_t getBufferCount();    // distinct buffers
+    static size_t getReferenceCount(); // acquires not released yet
+    static size_t getResidentBytes();
+    static size_t getSharedBytes();    // what the shared references would have uploaded again
+
+private:
+    // two independent 64 bit hashes of the bytes, hash also keys s_byHash
+    struct Digest {
+        uint64_t hash;
+        uint64_t check;
+    };
+
+    struct Entry {
+        Digest digest;
+        size_t size;
+        int references;
+    };
+
+    static std::unordered_map<GLuint, Entry> s_buffers;
+    static std::unordered_multimap<uint64_t, GLuint> s_byHash;
+    static size_t s_references;
+    static size_t s_residentBytes;
+    static size_t s_sharedBytes;
+
+    static Digest hashBytes(const void* data, size_t size);
+};
+
+#endif // GEOMETRY_REGISTRY_H
@@ -0,0 +1,79 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+#include "scene/Mesh.h"
+#include "core/Json.h"
+#include "core/VirtualFileSystem.h"
+#include "core/MemoryTracker.h"
+
+// texture paths are relative to the model's directory
+struct GltfMaterial {
+    std::string name;
+    glm::vec4 baseColor = glm::vec4(1.0f);
+    float roughness = 1.0f;
+    std::string diffuseMap;
+    std::string normalMap;
+    bool doubleSided = false; // the glTF default
+};
+
+// one per node and primitive, primitives of meshes used by several nodes share their buffers
+struct GltfPrimitive {
+    std::string name;
+    int material = -1; // into GltfData::materials
+    glm::mat4 transform = glm::mat4(1.0f); // node to model space
+    GpuGeometry geometry;
+};
+
+struct GltfData {
+    std::vector<GLuint> buffers; // one GeometryRegistry reference per bufferView, released by the caller
+    std::vector<GltfMaterial> materials;
+    std::vector<GltfPrimitive> primitives;
+};
+
+// Native glTF 2.0 (.gltf and .glb) loader.
+// The binary buffers are mapped (or come straight out of the asset pack) and every bufferView the meshes use goes into a GL buffer
+// straight from the mapping, the VAOs then read the accessors in their stored layout, so no
+// vertex is ever copied or converted on the cpu. Only base64 data URIs need a decode first.
+// Skins and animations are left to the assimp path, load() returns false for those files.
+class GltfLoader {
+public:
+    static bool load(const std::string& path, GltfData& out);
+
+private:
+    struct Source {
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct Context {
+        JsonValue document;
+        std::string directory;
+        std::vector<Source> buffers;
+        std::vector<std::unique_ptr<FileData>> mappedBuffers;
+        std::vector<std::vector<char>> decodedBuffers;
+        std::unordered_map<int, GLuint> viewBuffers; // bufferView index to GL buffer
+        GltfData* out = nullptr;
+    };
+
+    static bool loadBuffers(Context& context, const Source& binaryChunk);
+    static void loadMaterials(Context& context);
+    static void loadNode(Context& context, int nodeIndex, const glm::mat4& parent, int depth);
+    static void loadPrimitive(Context& context, const JsonValue& primitive, const std::string& name, const glm::mat4& transform);
+
+    static GLuint getViewBuffer(Context& context, int viewIndex);
+    static bool getAttribute(Context& context, int accessorIndex, VertexAttribute& attribute);
+    static BoundingBox getPositionBounds(Context& context, int accessorIndex);
+    static std::string getImagePath(Context& context, const JsonValue& textureInfo);
+};
+
+#endif // GLTF_LOADER_H
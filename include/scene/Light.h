@@ -0,0 +1,28 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <glm/glm.hpp>
+
+enum class LightType {
+    Point,
+    Spot
+};
+
+// punctual light living in the scene, the directional sun stays on the Renderer
+struct Light {
+    LightType type = LightType::Point;
+
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // spot lights only
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    float range = 10.0f; // the light has no effect past this distance
+
+    // spot cone in degrees, full light inside the inner angle, fades out to the outer one
+    float innerAngle = 20.0f;
+    float outerAngle = 30.0f;
+
+    bool enabled = true;
+};
+
+#endif // LIGHT_H
@@ -0,0 +1,96 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "renderer/Shaders.h"
+#include "core/MemoryTracker.h"
+
+// texture slots of a material, each slot always lives on the texture unit with the same number
+enum class MaterialSlot {
+    Diffuse = 0,
+    Specular,
+    Normal,
+    Count
+};
+
+// feature bits in MaterialParams::flags, kept in sync with default.frag
+enum MaterialFlags : uint32_t {
+    kMaterialHasDiffuse   = 1u << 0,
+    kMaterialHasSpecular  = 1u << 1,
+    kMaterialHasNormalMap = 1u << 2
+};
+
+// std140 layout of the MaterialBlock uniform block
+struct MaterialParams {
+    glm::vec4 baseColor = glm::vec4(1.0f);
+    uint32_t flags = 0;
+    float specularStrength = 0.5f; // used when there is no specular map
+    float padding[2] = { 0.0f, 0.0f };
+};
+
+// Everything a draw needs from the material, resolved once at load time.
+struct Material {
+    std::string name;
+    GLuint textures[static_cast<int>(MaterialSlot::Count)] = { 0, 0, 0 };
+    MaterialParams params;
+    // back faces are only culled for single sided materials. assimp and OBJ materials don't
+    // say, so they stay two sided like they always were
+    bool doubleSided = true;
+
+    // also sets the matching feature flag, 0 clears the slot
+    void setTexture(MaterialSlot slot, GLuint texture);
+    GLuint getTexture(MaterialSlot slot) const;
+};
+
+using MaterialHandle = uint32_t;
+
+// Owns every material in the engine. The parameters of all materials sit in one uniform
+// buffer, one aligned block each, so a draw only binds its textures and a range of that
+// buffer. Sampler units and the block binding are set once per shader program.
+class MaterialLibrary {
+public:
+    // white, untextured, used by meshes without a material
+    static const MaterialHandle kDefaultMaterial = 0;
+    static const GLuint kBlockBinding = 0;
+
+    static void init();
+    static void shutdown();
+
+    static MaterialHandle create(const Material& material);
+    static void destroy(MaterialHandle handle);
+
+    // unknown or destroyed handles give the default material
+    static const Material& get(MaterialHandle handle);
+    static void setParams(MaterialHandle handle, const MaterialParams& params);
+
+    // points the program's samplers and MaterialBlock at the fixed slots, only does work
+    // the first time it sees a program
+    static void setupProgram(const Shader& shader);
+
+    // binds the slot textures and the parameter block, uploads pending changes first
+    static void bind(MaterialHandle handle);
+
+    static size_t getMaterialCount();
+
+private:
+    static std::vector<Material> s_materials;
+    static std::vector<bool> s_alive;
+    static std::vector<MaterialHandle> s_freeHandles;
+    static std::vector<unsigned int> s_configuredPrograms;
+
+    static GLuint s_UBO;
+    static size_t s_stride;   // sizeof(MaterialParams) rounded up to the offset alignment
+    static size_t s_capacity; // materials the buffer has room for
+    static bool s_dirty;
+
+    static bool isValid(MaterialHandle handle);
+    static void upload();
+};
+
+#endif // MATERIAL_H
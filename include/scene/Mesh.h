@@ -2,38 +2,161 @@
 #define MESH_H
 
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include <vector>
+#include <cstdint>
 #include <glad/gl.h>
 #include <string>
 
 #include "renderer/Shaders.h"
-#include "scene/TextureLoader.h"
+#include "scene/Material.h"
+#include "scene/Bounds.h"
+#include "core/MemoryTracker.h"
 
 struct Vertex{
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 texCoords;
+    // up to 4 skeleton joints per vertex, weights are normalized bytes that sum to 255
+    glm::u8vec4 joints = glm::u8vec4(0);
+    glm::u8vec4 weights = glm::u8vec4(0);
+};
+
+// A small cluster of a mesh's triangles, one contiguous range of its index buffer (see MeshletBuilder).
+struct Meshlet {
+    // bounding sphere in mesh space
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // every triangle faces away from a camera with dot(normalize(coneApex - camera), coneAxis) >= coneCutoff,
+    // a cutoff above 1 means the normals spread too far to ever tell
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 2.0f;
+
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// one vertex attribute that already sits in a GL buffer in the source file's layout
+struct VertexAttribute {
+    GLuint buffer = 0; // 0 leaves the attribute disabled
+    GLint components = 0;
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    bool integer = false; // read with glVertexAttribIPointer
+    GLsizei stride = 0;
+    size_t offset = 0;
+};
+
+// Geometry uploaded by a loader straight from the file, e.g. glTF accessors, which the
+// mesh only points its VAO at. The buffers belong to the loader's owner, not to the mesh.
+struct GpuGeometry {
+    VertexAttribute attributes[5]; // same locations as Vertex: position, normal, texCoords, joints, weights
+    GLuint indexBuffer = 0;        // 0 draws the vertices in order
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;
+    unsigned int count = 0;        // indices, or vertices without an index buffer
+    BoundingBox bounds;
+};
+
+// positions read in place, out of a packed array or straight out of the vertices
+struct PositionView {
+    const unsigned char* data = nullptr;
+    size_t stride = sizeof(glm::vec3);
+
+    const glm::vec3& operator[](size_t index) const {
+        return *reinterpret_cast<const glm::vec3*>(data + index * stride);
+    }
+};
+
+// what a mesh keeps on the cpu once its geometry is on the gpu, bounds and counts always stay
+enum class CpuGeometry {
+    None,
+    Occluder, // positions and indices of meshes the occlusion culler can rasterize
+    Full      // every vertex, for tools that read the mesh back like picking
 };
 
 class Mesh {
     public: 
+        // bigger meshes are never rasterized as occluders, so they don't keep positions for it
+        static const unsigned int kMaxOccluderTriangles = 20000;
+
         bool m_isVisible = true;
+        bool m_isCulled = false; // set every frame by the renderer's frustum and occlusion culling
         std::string m_name;
-        glm::vec4 m_baseColor = glm::vec4(1.0f); // Default to white
+        BoundingBox m_bounds; // model space, filled from the vertices on construction
+
+        // node transform inside the model for formats with a node hierarchy, the bounds already include it
+        glm::mat4 m_transform = glm::mat4(1.0f);
+        bool m_hasTransform = false;
+
+        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, MaterialHandle material, const std::string& name = "Unnamed Mesh");
+        // no cpu copy, the vertex data is read in place from the given buffers
+        Mesh(const GpuGeometry& geometry, MaterialHandle material, const std::string& name = "Unnamed Mesh");
+
+        // owns its GL buffers, so it can only be moved
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+        Mesh(Mesh&& other) noexcept;
+        Mesh& operator=(Mesh&& other) noexcept;
+        void drawMesh();
+        // geometry only, for depth passes and the renderer's draw queue, which binds materials itself
+        void drawDepth() const;
+        // only the given ranges of the index buffer (byte offsets), e.g. the meshlets that survived
+        // culling, in one glMultiDrawElements
+        void drawRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount) const;
+
+        // the index buffer split into clusters at import, empty for small, skinned and gpu only meshes
+        const std::vector<Meshlet>& getMeshlets() const;
 
-        Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, glm::vec4 baseColor, const std::string& name = "Unnamed Mesh");
-        void drawMesh(Shader& shader);
+        MaterialHandle getMaterial() const;
+        void setMaterial(MaterialHandle material);
+
+        // one byte per vertex (255 fully open) read at attribute location 5, meshes without it
+        // read the constant 1 the renderer sets for that location
+        void setAmbientOcclusion(const std::vector<uint8_t>& occlusion);
+        bool hasAmbientOcclusion() const;
+
+        // frees the cpu copy the upload was made from, apart from what keep asks for
+        void releaseCpuGeometry(CpuGeometry keep);
+
+        // full cpu copy of the vertices, only with CpuGeometry::Full
+        bool hasCpuGeometry() const;
+        const std::vector<Vertex>& getVertices() const;
+        // positions and indices for the software occlusion rasterizer, a Full mesh reads its
+        // positions out of the vertices instead of keeping a second copy
+        bool hasOccluderGeometry() const;
+        PositionView getPositions() const;
+        const std::vector<unsigned int>& getIndices() const;
+        unsigned int getTriangleCount() const;
+
+        // true if any vertex is weighted to a joint, the cpu geometry is then only the bind pose
+        bool isSkinned() const;
         ~Mesh();
 
     private:
         std::vector<Vertex> m_vertices;
         std::vector<unsigned int> m_indices;
-        std::vector<Texture> m_textures;
+        std::vector<glm::vec3> m_positions; // only once m_vertices is gone
+        std::vector<Meshlet> m_meshlets;
+        MaterialHandle m_material;
 
         unsigned int m_VAO, m_VBO, m_EBO;
+        unsigned int m_occlusionBuffer = 0;
+        bool m_isSkinned = false;
+        bool m_isOccluder = false;
+
+        // what the draw call needs, the same for owned and external geometry
+        unsigned int m_drawCount = 0;
+        bool m_indexed = true;
+        GLenum m_indexType = GL_UNSIGNED_INT;
+        size_t m_indexOffset = 0;
 
         void setupMesh();
+        void draw() const;
+        void release();
 };
 
 #endif // MESH_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "scene/Mesh.h"
+
+// Splits a triangle list into meshlets at import time. Each meshlet grows from a seed
+// triangle by adding the neighbour that brings in the fewest new vertices, ties going to
+// the one whose normal is closest to the meshlet's so far, which keeps meshlets compact
+// and their normal cones narrow. The index buffer is reordered meshlet by meshlet, so the
+// renderer can draw any subset as a handful of index ranges.
+// GL 3.3 has no mesh shaders, the vertex limit only keeps the clusters spatially tight.
+class MeshletBuilder {
+public:
+    static const unsigned int kMaxVertices = 64;
+    static const unsigned int kMaxTriangles = 124;
+    // below this a mesh is one or two meshlets, the mesh level culling already covers it
+    static const unsigned int kMinTriangles = kMaxTriangles * 4;
+
+    // reorders indices (a triangle list) and returns the meshlets over it
+    static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+private:
+    // bounding sphere and normal cone of the given triangles
+    static void computeBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                              const std::vector<glm::vec3>& normals, const std::vector<uint32_t>& triangles, Meshlet& meshlet);
+};
+
+#endif // MESHLET_BUILDER_H
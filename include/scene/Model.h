@@ -8,6 +8,7 @@
 #include <iostream>
 #include <string>
 #include <cctype>
+#include <algorithm>
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp> 
 #include <glm/gtc/type_ptr.hpp>
@@ -16,44 +17,97 @@
 #include "renderer/Shaders.h"
 #include "scene/Mesh.h"
 #include "scene/TextureLoader.h"
+#include "scene/Material.h"
+#include "scene/ObjLoader.h"
+#include "scene/GltfLoader.h"
+#include "scene/Animation.h"
+#include "core/MemoryTracker.h"
+#include "core/SlotMap.h"
+
+class Scene;
+class Model;
+using ModelHandle = Handle<Model>;
 
 class Model {
 public:
     // filePath is the path to the 3D model file
-    const aiScene* m_scene;
     unsigned int m_numMeshes;
-    const Model* m_parent = nullptr; // by default its nullptr
-    std::vector<Model*> m_children; // stores children models
+    // links inside the owning scene, set through Scene::setParent. a link to a removed model is
+    // stale and resolves to nothing
+    ModelHandle m_parent;
+    std::vector<ModelHandle> m_children;
 
     glm::vec3 m_position;
     glm::vec3 m_rotation;
     glm::vec3 m_scale;
 
-    aiNode* m_rootNode;
+    // static models are drawn into the cached shadow cascades, anything that
+    // moves every frame should clear this so it is composited on top instead
+    bool m_isStatic = true;
+
     std::vector<Mesh> m_meshes;
 
-    Model(const std::string& filePath);
+    // first joint of this model in the renderer's palette buffer, set every frame before drawing
+    int m_paletteOffset = 0;
+
+    // .obj, .gltf and .glb files go through the native loaders instead of assimp while this is set
+    static bool s_useNativeLoaders;
+    // static models with cpu geometry get per vertex ambient occlusion baked on load
+    static bool s_bakeAmbientOcclusion;
+
+    // the importer's scene and the meshes' cpu copies are freed once the meshes are uploaded,
+    // cpuGeometry says what the meshes keep for features that read geometry on the cpu
+    Model(const std::string& filePath, CpuGeometry cpuGeometry = CpuGeometry::Occluder);
 
-    void draw(Shader& shader);
     std::string getName() const;
 
     glm::mat4 getModelMatrix() const;
     glm::mat4 getWorldMatrix() const;
     glm::mat4 getLocalMatrix() const;
 
-    void addChild(Model* child);
+    // the scene that owns the model and its handle there, null until it is added to one
+    const Scene* getScene() const;
+    ModelHandle getHandle() const;
+    // nullptr for roots, and if the parent was removed
+    const Model* getParent() const;
+    bool isStaticInHierarchy() const; // false if this model or any parent moves
+
+    // skinned models get an animator that plays the first clip on load
+    bool isSkinned() const;
+    Animator* getAnimator();
+    const Animator* getAnimator() const;
+    const std::vector<AnimationClip>& getClips() const;
 
     ~Model();
 
 private: 
+    friend class Scene;
+    const Scene* m_owner = nullptr;
+    ModelHandle m_handle;
+
     std::string m_filePath;
-    Assimp::Importer m_importer;
+    // only set while the constructor loads through assimp
+    const aiScene* m_scene;
+    const aiNode* m_rootNode;
     std::string m_textureDir;
     TextureLoader m_textureLoader;
+    std::vector<MaterialHandle> m_materials; // indexed like the scene's materials
+    std::vector<GLuint> m_sharedBuffers;     // GL buffers the meshes read from in place (glTF)
+
+    Skeleton m_skeleton;
+    std::vector<AnimationClip> m_clips;
+    std::unique_ptr<Animator> m_animator;
 
-    void loadModel(const std::string& path);
+    void loadModel(const std::string& path, Assimp::Importer& importer);
+    bool loadObj(const std::string& path);
+    bool loadGltf(const std::string& path);
+    void loadSkeleton();
+    void loadMaterials();
+    void loadBoneWeights(const aiMesh* mesh, std::vector<Vertex>& vertices);
+    void loadAnimations();
+    void bakeAmbientOcclusion();
     void processMeshes();
-    void drawModel(Shader& shader);
+    void trackImporterMemory(const Assimp::Importer& importer);
 };
 
 void printAllTextureTypes(aiMaterial* material);
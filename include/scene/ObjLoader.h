@@ -0,0 +1,87 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "scene/Mesh.h"
+#include "core/VirtualFileSystem.h"
+#include "core/JobSystem.h"
+
+// a material from the .mtl file, texture paths are relative to the model's directory
+struct ObjMaterial {
+    std::string name;
+    glm::vec4 diffuse = glm::vec4(1.0f);
+    std::string diffuseMap;
+    std::string specularMap;
+    std::string normalMap;
+};
+
+// one mesh per object/group and material, like assimp splits them
+struct ObjMesh {
+    std::string name;
+    int material = -1; // into ObjData::materials
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+struct ObjData {
+    std::vector<ObjMesh> meshes;
+    std::vector<ObjMaterial> materials;
+};
+
+// Native Wavefront OBJ/MTL loader for the big assets assimp is slow on.
+// The file is mapped and cut into line aligned chunks that are parsed on the job system,
+// then the faces are split into meshes and the v/vt/vn triples are deduplicated with a
+// sharded hash, so each mesh comes out as ready to upload vertices and indices.
+// Polygons are fan triangulated and the uvs are flipped like the assimp path does.
+class ObjLoader {
+public:
+    static bool load(const std::string& path, ObjData& out);
+
+private:
+    struct Corner {
+        int32_t position, texCoord, normal; // 0 based, -1 when missing
+    };
+
+    // where the object/group or material changes, empty strings keep the previous value
+    struct Segment {
+        size_t firstCorner;
+        std::string group;
+        std::string material;
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners; // three per triangle
+
+        // negative indices count back from the chunk's own vertices, they are
+        // made absolute once it is known how many vertices the earlier chunks hold
+        std::vector<uint32_t> relativePositions;
+        std::vector<uint32_t> relativeTexCoords;
+        std::vector<uint32_t> relativeNormals;
+
+        std::vector<Segment> segments;
+        std::vector<std::string> materialLibraries;
+    };
+
+    static void parseChunk(Chunk& chunk);
+    static void parseMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials);
+
+    // turns one mesh's corners into unique vertices and indices
+    static void buildMesh(const std::vector<Corner>& corners,
+                          const std::vector<glm::vec3>& positions,
+                          const std::vector<glm::vec2>& texCoords,
+                          const std::vector<glm::vec3>& normals,
+                          ObjMesh& mesh);
+};
+
+#endif // OBJ_LOADER_H
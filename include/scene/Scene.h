@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 
+#include "core/SlotMap.h"
 #include "scene/Model.h"
+#include "scene/Light.h"
 
 // should this be static or what ?? 
 class Scene {
@@ -12,17 +15,38 @@ public:
 
     Scene() = default;
 
-    // better to store them as the unique pointers
-    std::vector<std::unique_ptr<Model>>& getModels();
-    Model* getModel(int index);
-    void addModel(std::unique_ptr<Model> model);
-    void removeModel(int index);
+    // the models point back at their scene, so it stays where it was made
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
 
-    // update all models in the scene
+    // Models live in a slot map: adding and removing are O(1) and a handle keeps finding its
+    // model whatever else is added or removed, or nothing once that model is gone.
+    // getModels() is the dense array, its order changes whenever a model is removed
+    const std::vector<std::unique_ptr<Model>>& getModels() const;
+    Model* getModel(ModelHandle handle);
+    const Model* getModel(ModelHandle handle) const;
+    ModelHandle addModel(std::unique_ptr<Model> model);
+    // the children of a removed model become roots, false if the handle was stale
+    bool removeModel(ModelHandle handle);
+
+    // a null parent makes the child a root, false if either is gone or it would make a cycle
+    bool setParent(ModelHandle child, ModelHandle parent);
+
+    std::vector<Light>& getLights();
+    void addLight(const Light& light);
+    void removeLight(int index);
+
+    // bumped whenever models are added, removed or reparented
+    uint64_t getHierarchyVersion() const;
+
+    // advances the animations of all models in the scene
     void onUpdate(float deltaTime);
 
 private:
-    std::vector<std::unique_ptr<Model>> m_models;
+    SlotMap<std::unique_ptr<Model>, Model> m_models;
+    std::vector<Light> m_lights;
+    std::vector<Animator*> m_animators; // gathered every update, kept to reuse the memory
+    uint64_t m_hierarchyVersion = 0;
 };
 
 #endif // SCENE_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <assimp/material.h>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -11,6 +12,8 @@
 // in the vendor directory
 #include "stb_image.h"
 
+#include "renderer/TextureStreamer.h"
+
 struct Texture {
     unsigned int id;
     std::string type;
@@ -22,9 +25,22 @@ public:
     std::string m_directory;
 
     std::vector<Texture> loadTextures(aiMaterial* material, aiTextureType type, std::string typeName);
+    // path is relative to m_directory, for loaders that don't go through assimp
+    Texture loadTexture(const std::string& path, const std::string& typeName);
+    // drops this loader's reference to every texture it loaded, a file no model uses any
+    // more is unregistered from the streamer
+    void releaseTextures();
 private:
+    struct SharedTexture {
+        unsigned int id = 0;
+        int references = 0;
+    };
+
+    // every model sharing a file shares its streamed texture, keyed by the full path
+    static std::unordered_map<std::string, SharedTexture> s_shared;
 
     std::vector<Texture> m_texturesLoaded; // to avoid loading duplicate textures
+    std::vector<std::string> m_files;      // full paths this loader holds a reference to
     unsigned int loadTextureFromFile(const std::string& path, const std::string& directory);
 };
 
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D u_Source;
+
+void main() {
+    FragColor = texture(u_Source, TexCoords);
+}
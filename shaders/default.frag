@@ -4,64 +4,223 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 Normal; 
 in vec3 FragPos; // Note: You'll need to pass this from Vertex Shader for specular
+in float ViewDepth;
+in float AmbientOcclusion; // baked at load time, see AmbientOcclusionBaker
 
-uniform vec4 u_BaseColor;
+// per material parameters, see MaterialLibrary
+layout(std140) uniform MaterialBlock {
+    vec4 u_BaseColor;
+    uint u_MaterialFlags; // picks the variant on the cpu, the features below are compiled in
+    float u_SpecularStrength;
+};
 
-uniform bool u_HasTexture;
-uniform bool u_HasDiffuse;
-uniform bool u_HasSpecular;
-uniform bool u_HasNormalMap;  
+// HAS_DIFFUSE_MAP, HAS_SPECULAR_MAP and HAS_NORMAL_MAP are defined per variant, see ShaderVariants
 
 // Texture Samplers
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 uniform sampler2D texture_normal1; 
 
-uniform vec3 viewPos; // Camera position needed for specular highlights
+// per frame values, uploaded once a frame through the stream buffer, see Renderer
+layout(std140) uniform FrameBlock {
+    mat4 u_View;
+    mat4 u_Projection;
+    vec3 viewPos; // Camera position needed for specular highlights
+    vec3 u_LightDir; // directional light, points towards the light
+};
 
-void main() {
-   
-    vec4 color;
-    vec3 norm = normalize(Normal);
-    float specularStrength = 0.5; // default specular strength
+// cascaded shadow maps, see CascadedShadowMap
+uniform sampler2DArrayShadow u_ShadowMap;
+uniform mat4 u_LightSpace[4];
+uniform float u_CascadeSplits[4];
+
+// clustered point and spot lights, see ClusteredLighting
+uniform samplerBuffer u_LightData;
+uniform usamplerBuffer u_ClusterData;
+uniform vec4 u_ClusterParams; // viewport width, height, depth slice scale, depth slice bias
+
+// image based ambient, see ImageBasedLighting
+uniform bool u_HasEnvironment;
+uniform vec3 u_SH[9];
+uniform samplerCube u_PrefilteredEnv;
+uniform sampler2D u_BrdfLut;
+uniform float u_PrefilterLevels;
+
+const int kTilesX = 16;
+const int kTilesY = 9;
+const int kSlicesZ = 24;
+
+vec3 computeClusteredLights(vec3 norm, vec3 viewDir, vec3 albedo, float specularStrength) {
+    int tileX = clamp(int(gl_FragCoord.x / u_ClusterParams.x * kTilesX), 0, kTilesX - 1);
+    int tileY = clamp(int(gl_FragCoord.y / u_ClusterParams.y * kTilesY), 0, kTilesY - 1);
+    int slice = clamp(int(log(max(ViewDepth, 1e-4)) * u_ClusterParams.z - u_ClusterParams.w), 0, kSlicesZ - 1);
+    int cluster = (slice * kTilesY + tileY) * kTilesX + tileX;
+
+    int offset = int(texelFetch(u_ClusterData, cluster * 2).r);
+    int count = int(texelFetch(u_ClusterData, cluster * 2 + 1).r);
+
+    vec3 result = vec3(0.0);
+    for(int i = 0; i < count; i++) {
+        int light = int(texelFetch(u_ClusterData, offset + i).r);
+
+        vec4 positionRange = texelFetch(u_LightData, light * 4 + 0);
+        vec4 colorType = texelFetch(u_LightData, light * 4 + 1);
+
+        vec3 toLight = positionRange.xyz - FragPos;
+        float dist = length(toLight);
+        if(dist >= positionRange.w) continue;
 
-    if(u_HasTexture) {
-        color = texture(texture_diffuse1, TexCoords);
-    } else {
-        color = u_BaseColor;
+        vec3 L = toLight / dist;
+
+        // smooth window so the light reaches exactly zero at its range
+        float ratio = dist / positionRange.w;
+        float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (dist * dist + 1.0);
+
+        if(colorType.w > 0.5) {
+            vec4 directionOuter = texelFetch(u_LightData, light * 4 + 2);
+            float cosInner = texelFetch(u_LightData, light * 4 + 3).x;
+            float theta = dot(-L, directionOuter.xyz);
+            attenuation *= smoothstep(directionOuter.w, cosInner, theta);
+        }
+
+        float diff = max(dot(norm, L), 0.0);
+        float spec = pow(max(dot(viewDir, reflect(-L, norm)), 0.0), 32);
+        result += colorType.rgb * attenuation * (diff * albedo + specularStrength * spec);
     }
 
-    // specular related 
-    if(u_HasSpecular) {
-        specularStrength = texture(texture_specular1, TexCoords).r; // Use the map
+    return result;
+}
+
+// irradiance from the baked SH, the cosine convolution and 1/pi are already folded in
+vec3 evaluateSH(vec3 n) {
+    return max(u_SH[0] * 0.282095
+        + u_SH[1] * 0.488603 * n.y
+        + u_SH[2] * 0.488603 * n.z
+        + u_SH[3] * 0.488603 * n.x
+        + u_SH[4] * 1.092548 * n.x * n.y
+        + u_SH[5] * 1.092548 * n.y * n.z
+        + u_SH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + u_SH[7] * 1.092548 * n.x * n.z
+        + u_SH[8] * 0.546274 * (n.x * n.x - n.y * n.y), vec3(0.0));
+}
+
+vec3 computeAmbient(vec3 norm, vec3 viewDir, vec3 albedo, float specularStrength) {
+    if(!u_HasEnvironment) {
+        return 0.2 * albedo;
+    }
+
+    // split sum: prefiltered radiance at the roughness mip times the BRDF lookup
+    float roughness = clamp(1.0 - specularStrength, 0.05, 1.0);
+    float NdotV = max(dot(norm, viewDir), 0.0);
+    vec3 F0 = vec3(0.04);
+
+    vec3 R = reflect(-viewDir, norm);
+    vec3 prefiltered = textureLod(u_PrefilteredEnv, R, roughness * (u_PrefilterLevels - 1.0)).rgb;
+    vec2 brdf = texture(u_BrdfLut, vec2(NdotV, roughness)).rg;
+
+    vec3 diffuse = evaluateSH(norm) * albedo;
+    vec3 specular = prefiltered * (F0 * brdf.x + brdf.y);
+    return diffuse + specular;
+}
+
+float computeShadow(vec3 norm, vec3 lightDir) {
+    int cascade = 3;
+    for(int i = 0; i < 4; i++) {
+        if(ViewDepth < u_CascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
     }
-    else  {
-        specularStrength = 0.5; // default value
+
+    vec4 lightSpace = u_LightSpace[cascade] * vec4(FragPos, 1.0);
+    vec3 projected = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(projected.z > 1.0) {
+        return 0.0;
     }
 
-    // normal mapping related
-    if(u_HasNormalMap) {
-        // You'll need TBN logic here later, for now just normalize the input
-        norm = normalize(Normal); 
-    } else {
-        norm = normalize(Normal);
+    float bias = max(0.002 * (1.0 - dot(norm, lightDir)), 0.0005);
+    vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
+
+    // 3x3 taps on top of the hardware bilinear compare
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++) {
+        for(int y = -1; y <= 1; y++) {
+            vec2 uv = projected.xy + vec2(x, y) * texelSize;
+            lit += texture(u_ShadowMap, vec4(uv, float(cascade), projected.z - bias));
+        }
     }
 
+    return 1.0 - lit / 9.0;
+}
+
+#ifdef HAS_NORMAL_MAP
+// the vertices carry no tangents, so the tangent frame comes from the screen space derivatives
+// of the position and the uvs (a cotangent frame, Schueler 2013), mirrored uvs come out right too
+vec3 perturbNormal(vec3 n, vec3 toEye, vec2 uv) {
+    vec3 dp1 = dFdx(-toEye);
+    vec3 dp2 = dFdy(-toEye);
+    vec2 duv1 = dFdx(uv);
+    vec2 duv2 = dFdy(uv);
+    // sampled before any branch, the implicit derivatives need every pixel of the quad
+    vec3 mapped = texture(texture_normal1, uv).xyz * 2.0 - 1.0;
+
+    vec3 dp2perp = cross(dp2, n);
+    vec3 dp1perp = cross(n, dp1);
+    vec3 t = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 b = dp2perp * duv1.y + dp1perp * duv2.y;
+
+    // scaled by the longer axis so the uv scale drops out, uvs that don't change over the
+    // pixel give no frame and keep the interpolated normal
+    float scale = max(dot(t, t), dot(b, b));
+    if(scale <= 0.0) return n;
+    mat3 tbn = mat3(t * inversesqrt(scale), b * inversesqrt(scale), n);
+    return normalize(tbn * mapped);
+}
+#endif
+
+void main() {
+   
+#ifdef HAS_DIFFUSE_MAP
+    vec4 color = texture(texture_diffuse1, TexCoords);
+#else
+    vec4 color = u_BaseColor;
+#endif
+
+    // specular related 
+#ifdef HAS_SPECULAR_MAP
+    float specularStrength = texture(texture_specular1, TexCoords).r; // Use the map
+#else
+    float specularStrength = u_SpecularStrength;
+#endif
+
+    // normal mapping related
+#ifdef HAS_NORMAL_MAP
+    vec3 norm = perturbNormal(normalize(Normal), viewPos - FragPos, TexCoords);
+#else
+    vec3 norm = normalize(Normal);
+#endif
+
+    vec3 viewDir = normalize(viewPos - FragPos);
+
 // ambient lighting
-    float ambientStrength = 0.2;
-    vec3 ambient = ambientStrength * color.rgb;
+    vec3 ambient = computeAmbient(norm, viewDir, color.rgb, specularStrength) * AmbientOcclusion;
 
 // diffuse lighting
-    vec3 lightDir = normalize(vec3(0.5, 1.0, 0.5));
+    vec3 lightDir = normalize(u_LightDir);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * color.rgb;
 
     // specular lighting 
-    vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);  
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32); // 32 is shininess
     vec3 specular = specularStrength * spec * vec3(1.0); // White highlights
 
+    // shadows only take away the direct light
+    float shadow = computeShadow(norm, lightDir);
+
+    vec3 localLights = computeClusteredLights(norm, viewDir, color.rgb, specularStrength);
+
     // Final Color
-    FragColor = vec4(ambient + diffuse + specular, color.a);
+    FragColor = vec4(ambient + (1.0 - shadow) * (diffuse + specular) + localLights, color.a);
 }
\ No newline at end of file
@@ -2,20 +2,60 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uvec4 aJoints;
+layout (location = 4) in vec4 aWeights;
+layout (location = 5) in float aOcclusion; // baked per vertex, 1 where nothing was baked
 
 out vec3 Normal; 
 out vec2 TexCoords;
 out vec3 FragPos;
+out float ViewDepth; // picks the shadow cascade
+out float AmbientOcclusion;
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+
+// per frame values, uploaded once a frame through the stream buffer, see Renderer
+layout(std140) uniform FrameBlock {
+    mat4 u_View;
+    mat4 u_Projection;
+    vec3 viewPos; // Camera position needed for specular highlights
+    vec3 u_LightDir; // directional light, points towards the light
+};
+
+// skinning, see SkinningPalette, only in the SKINNED variants
+#ifdef SKINNED
+uniform int u_PaletteOffset;
+uniform samplerBuffer u_JointPalette;
+
+mat4 getJointMatrix(uint joint) {
+    int base = (u_PaletteOffset + int(joint)) * 3;
+    return transpose(mat4(texelFetch(u_JointPalette, base),
+                          texelFetch(u_JointPalette, base + 1),
+                          texelFetch(u_JointPalette, base + 2),
+                          vec4(0.0, 0.0, 0.0, 1.0)));
+}
+#endif
 
 void main() {
-    gl_Position = u_Projection * u_View * u_Model * vec4(aPos, 1.0);
+    mat4 skin = mat4(1.0);
+#ifdef SKINNED
+    if(aWeights.x > 0.0) {
+        skin = getJointMatrix(aJoints.x) * aWeights.x
+             + getJointMatrix(aJoints.y) * aWeights.y
+             + getJointMatrix(aJoints.z) * aWeights.z
+             + getJointMatrix(aJoints.w) * aWeights.w;
+    }
+#endif
+
+    vec4 localPos = skin * vec4(aPos, 1.0);
+    vec3 localNormal = mat3(skin) * aNormal;
+
+    gl_Position = u_Projection * u_View * u_Model * localPos;
     // Pass the normal to the fragment shader
-    Normal = mat3(transpose(inverse(u_Model))) * aNormal; 
+    Normal = mat3(transpose(inverse(u_Model))) * localNormal; 
 
     TexCoords = aTexCoords;
-    FragPos = vec3(u_Model * vec4(aPos, 1.0));
-}
\ No newline at end of file
+    AmbientOcclusion = aOcclusion;
+    FragPos = vec3(u_Model * localPos);
+    ViewDepth = -(u_View * vec4(FragPos, 1.0)).z;
+}
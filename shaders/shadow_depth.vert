@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in uvec4 aJoints;
+layout (location = 4) in vec4 aWeights;
+
+uniform mat4 u_LightSpace;
+uniform mat4 u_Model;
+
+// same skinning as default.vert, only in the SKINNED variant
+#ifdef SKINNED
+uniform int u_PaletteOffset;
+uniform samplerBuffer u_JointPalette;
+
+mat4 getJointMatrix(uint joint) {
+    int base = (u_PaletteOffset + int(joint)) * 3;
+    return transpose(mat4(texelFetch(u_JointPalette, base),
+                          texelFetch(u_JointPalette, base + 1),
+                          texelFetch(u_JointPalette, base + 2),
+                          vec4(0.0, 0.0, 0.0, 1.0)));
+}
+#endif
+
+void main() {
+    vec4 localPos = vec4(aPos, 1.0);
+#ifdef SKINNED
+    if(aWeights.x > 0.0) {
+        localPos = (getJointMatrix(aJoints.x) * aWeights.x
+                  + getJointMatrix(aJoints.y) * aWeights.y
+                  + getJointMatrix(aJoints.z) * aWeights.z
+                  + getJointMatrix(aJoints.w) * aWeights.w) * localPos;
+    }
+#endif
+
+    gl_Position = u_LightSpace * u_Model * localPos;
+}
@@ -1,7 +1,42 @@
 #include "core/Application.h"
+#include "core/RenderServer.h"
+#include "core/PerfCounters.h"
+
+#include <cstring>
+
+// --record <path file>                   records the camera until the window closes
+// --benchmark <path file> [--csv <file>] replays a recorded path, reports frame times and exits
+// --serve <socket path>                  headless render daemon, see RenderServer
+// --serve-output <folder>                where the daemon writes out= files, the working folder by default
+// --perf-counters                        hardware counters per engine scope from the start, benchmarks write a report next to the csv
+int main (int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--perf-counters") == 0) PerfCounters::setEnabled(true);
+    }
+
+    const char* servePath = nullptr;
+    const char* serveOutput = ".";
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--serve") == 0) servePath = argv[++i];
+        else if (std::strcmp(argv[i], "--serve-output") == 0) serveOutput = argv[++i];
+    }
+    if (servePath) {
+        RenderServer server(servePath, serveOutput);
+        server.run();
+        return 0;
+    }
 
-int main () {
     Application app("My Application");
+
+    const char* benchmarkPath = nullptr;
+    const char* csvFile = "benchmark.csv";
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--record") == 0) app.recordCameraPath(argv[++i]);
+        else if (std::strcmp(argv[i], "--benchmark") == 0) benchmarkPath = argv[++i];
+        else if (std::strcmp(argv[i], "--csv") == 0) csvFile = argv[++i];
+    }
+    if (benchmarkPath) app.runBenchmark(benchmarkPath, csvFile, true);
+
     app.run();
     return 0;
-}
\ No newline at end of file
+}
@@ -1,18 +1,79 @@
 #include "core/Application.h"
+#include "scene/GeometryRegistry.h"
+#include "core/VirtualFileSystem.h"
 
-// temporary function to draw the model hierarchy in ImGui
-static void DrawModelNode(Model* model) {
-    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth;
-    if (model->m_children.empty()) flags |= ImGuiTreeNodeFlags_Leaf;
+// live breakdown of the tracked memory, by tag and by asset
+static void DrawMemorySection() {
+    const float mb = 1024.0f * 1024.0f;
 
-    if (ImGui::TreeNodeEx((void*)model, flags, "%s", model->getName().c_str())) {
-        ImGui::DragFloat3("Position", &model->m_position.x, 0.1f);
+    ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "MEMORY");
+    ImGui::Separator();
 
-        for (auto* child : model->m_children) {
-            DrawModelNode(child);
+    ImGui::Text("Total: %.1f MB cpu, %.1f MB gpu", MemoryTracker::getTotalCpuBytes() / mb, MemoryTracker::getTotalGpuBytes() / mb);
+
+    for (int i = 0; i < static_cast<int>(MemoryTag::Count); i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        ImGui::Text("  %-10s %8.2f MB cpu %8.2f MB gpu", MemoryTracker::getTagName(tag),
+                    MemoryTracker::getCpuBytes(tag) / mb, MemoryTracker::getGpuBytes(tag) / mb);
+    }
+
+    ImGui::Text("Geometry: %zu buffers, %zu references, %.2f MB shared", GeometryRegistry::getBufferCount(),
+                GeometryRegistry::getReferenceCount(), GeometryRegistry::getSharedBytes() / mb);
+
+    ImGui::Text("Asset packs: %zu mounted, %zu files", VirtualFileSystem::getPackCount(), VirtualFileSystem::getPackedFileCount());
+
+    if (ImGui::TreeNode("By Asset")) {
+        for (const auto& asset : MemoryTracker::getAssets()) {
+            ImGui::Text("%8.2f MB cpu %8.2f MB gpu  %s", asset.cpuBytes / mb, asset.gpuBytes / mb, asset.name.c_str());
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::Button("Dump Memory Report")) {
+        std::cout << MemoryTracker::getReport() << std::endl;
+        MemoryTracker::writeReport("memory_report.txt");
+    }
+}
+
+// hardware counters per engine scope, last frame plus everything since the last reset
+static void DrawPerfCountersSection() {
+    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "PERF COUNTERS");
+    ImGui::Separator();
+
+    bool enabled = PerfCounters::isEnabled();
+    if (ImGui::Checkbox("Hardware Counters", &enabled)) {
+        PerfCounters::setEnabled(enabled);
+    }
+    std::string error = PerfCounters::getError();
+    if (!error.empty()) {
+        ImGui::TextWrapped("%s", error.c_str());
+    }
+    if (!enabled || !PerfCounters::isAvailable()) return;
+
+    ImGui::Text("%-18s %8s %6s %8s %8s %8s", "scope", "Mcycles", "IPC", "L1 MPKI", "LLC MPKI", "br MPKI");
+    for (const auto& scope : PerfCounters::getLastFrame()) {
+        ImGui::Text("%-18s %8.2f %6.2f %8.2f %8.2f %8.2f", scope.name.c_str(), scope.counters[PerfCounters::Cycles] / 1e6,
+                    scope.getIpc(), scope.getMpki(PerfCounters::L1Misses), scope.getMpki(PerfCounters::LlcMisses),
+                    scope.getMpki(PerfCounters::BranchMisses));
+    }
+
+    if (ImGui::TreeNode("Since Reset")) {
+        for (const auto& scope : PerfCounters::getTotals()) {
+            ImGui::Text("%-18s %8.1f %6.2f %8.2f %8.2f %8.2f", scope.name.c_str(), scope.counters[PerfCounters::Cycles] / 1e6,
+                        scope.getIpc(), scope.getMpki(PerfCounters::L1Misses), scope.getMpki(PerfCounters::LlcMisses),
+                        scope.getMpki(PerfCounters::BranchMisses));
         }
         ImGui::TreePop();
     }
+
+    if (ImGui::Button("Reset Counters")) {
+        PerfCounters::resetTotals();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump Perf Report")) {
+        std::cout << PerfCounters::getReport() << std::endl;
+        PerfCounters::writeReport("perf_report.txt");
+    }
 }
 
 Application::Application(const std::string& title)
@@ -29,37 +90,72 @@ Application::Application(const std::string& title)
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
+    // assets come out of the pack when the build made one, loose files are the fallback
+    if (VirtualFileSystem::exists(VirtualFileSystem::kAssetPack)) VirtualFileSystem::mount(VirtualFileSystem::kAssetPack);
+
+    JobSystem::init(); // worker threads for the parallel passes, the IBL bake in Renderer::init uses them
     Renderer::init(); // static method to initialize the renderer
+    Renderer::setViewport(0, 0, 1280, 720);
+    TextureStreamer::init(); // background decoding of texture mips
     Input::init(m_mainWindow->getNativeWindow()); // static method to initialize input system
     ImguiLayer::init(m_mainWindow->getNativeWindow()); // initialize ImGui layer
-
-    m_defaultShader = std::make_unique<Shader>("shaders/default.vert", "shaders/default.frag");
+    m_framePacer = std::make_unique<FramePacer>(); // vsync, fps cap and dynamic resolution
+    m_outliner = std::make_unique<SceneOutliner>();
+    m_benchmark = std::make_unique<Benchmark>();
 
     auto test_model = std::make_unique<Model>("models/cat/12221_Cat_v1_l3.obj");
 
     m_scenes.push_back(std::make_unique<Scene>());
     m_activeScene = m_scenes.back().get();
 
-    m_activeScene->addModel(std::move(test_model));
+    m_catModel = m_activeScene->addModel(std::move(test_model));
 
     auto bugatti2 = std::make_unique<Model>("models/bugatti/bugatti.obj");
     // bugatti2->m_position = glm::vec3(20.0f, 0.0f, 0.0f);
     // bugatti2->m_rotation = glm::vec3(0.0f, 0.0f, 0.0f);
     // bugatti2->m_scale    = glm::vec3(1.0f, 1.0f, 1.0f);
-    m_activeScene->addModel(std::move(bugatti2));
+    m_carModel = m_activeScene->addModel(std::move(bugatti2));
 
-    // Now get the raw pointers from the scene
-    Model* catModel = m_activeScene->getModel(0);      // first model added
-    Model* bugattiModel = m_activeScene->getModel(1);  // second model added
+    // the cat rides on the bugatti
+    m_activeScene->setParent(m_catModel, m_carModel);
 
-    if (bugattiModel && catModel) {
-        bugattiModel->addChild(catModel);
+    // update() spins the cat every frame, keep it out of the cached shadow cascades
+    if (Model* cat = m_activeScene->getModel(m_catModel)) {
+        cat->m_isStatic = false;
     }
 
+    // a ring of coloured point lights around the models plus a spot from above
+    for (int i = 0; i < 8; i++) {
+        float angle = glm::radians(45.0f * i);
+
+        Light light;
+        light.position = glm::vec3(std::cos(angle) * 20.0f, 4.0f, std::sin(angle) * 20.0f);
+        light.color = glm::vec3(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::sin(angle), 0.8f);
+        light.intensity = 2.0f;
+        light.range = 15.0f;
+        m_activeScene->addLight(light);
+    }
+
+    Light spot;
+    spot.type = LightType::Spot;
+    spot.position = glm::vec3(0.0f, 25.0f, 0.0f);
+    spot.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    spot.intensity = 3.0f;
+    spot.range = 40.0f;
+    m_activeScene->addLight(spot);
+
     m_projectionMatrix = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
 }
 
-Application::~Application() {}
+Application::~Application() {
+    // everything that owns GL objects goes while the window's context is still alive, models
+    // first since they hand their materials and geometry back to the renderer's libraries
+    m_activeScene = nullptr;
+    m_scenes.clear();
+    TextureStreamer::shutdown();
+    Renderer::shutdown();
+    JobSystem::shutdown();
+}
 
 void Application::run() {
     m_isRunning = true;
@@ -67,7 +163,11 @@ void Application::run() {
     float lastFrame = 0.0f;
 
     while (m_isRunning && !m_mainWindow->shouldClose()) {
+        PerfCounters::endFrame(); // what the last iteration counted becomes the last frame
+        PerfCounters::Scope frameScope("Frame");
+
         float currentFrame = static_cast<float>(glfwGetTime());
+        m_framePacer->beginFrame();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // all the camera movement handling
@@ -106,11 +206,24 @@ void Application::run() {
             m_camera->processMouseMovement(xoffset, yoffset);
         }
 
-        update(deltaTime);
+        if (m_isRecordingPath) {
+            m_recordedPath.addKey(static_cast<float>(glfwGetTime() - m_recordingStart), *m_camera);
+        }
+
+        // a benchmark replay overrides the camera and steps the scene at a fixed rate
+        float simulationStep = deltaTime;
+        if (m_benchmark->isRunning()) {
+            simulationStep = m_benchmark->beginFrame(*m_camera);
+        }
+
+        update(simulationStep);
 
         // 3d rendering 
         render();
 
+        // the footprints from this frame decide which mips get streamed in or dropped
+        TextureStreamer::update();
+
         ImguiLayer::begin();
 
         ImGui::Begin("Engine Control Center");
@@ -122,7 +235,97 @@ void Application::run() {
         // Using a ternary check to prevent division by zero on frame 1
         float fps = (deltaTime > 0.0f) ? 1.0f / deltaTime : 0.0f;
         ImGui::Text("FPS: %.1f", fps);
-        ImGui::Text("Frame Time: %.3f ms", deltaTime * 1000.0f);
+        ImGui::Text("Frame Time: %.3f ms (cpu %.2f ms, gpu scene %.2f ms)", deltaTime * 1000.0f,
+                    m_framePacer->getCpuFrameTime(), m_framePacer->getGpuSceneTime());
+        ImGui::Text("Input Latency: %.1f ms", m_framePacer->getLatency());
+
+        const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+        int vsync = static_cast<int>(m_framePacer->getVSync());
+        if (ImGui::Combo("VSync", &vsync, vsyncModes, 3)) {
+            m_framePacer->setVSync(static_cast<VSyncMode>(vsync));
+        }
+
+        float fpsCap = m_framePacer->getFpsCap();
+        if (ImGui::SliderFloat("FPS Cap (0 = off)", &fpsCap, 0.0f, 240.0f, "%.0f")) {
+            m_framePacer->setFpsCap(fpsCap);
+        }
+
+        bool dynamicResolution = m_framePacer->isDynamicResolutionEnabled();
+        if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolution)) {
+            m_framePacer->setDynamicResolution(dynamicResolution);
+        }
+        float targetFrameTime = m_framePacer->getTargetFrameTime();
+        if (ImGui::SliderFloat("Target Frame Time (ms)", &targetFrameTime, 4.0f, 50.0f, "%.1f")) {
+            m_framePacer->setTargetFrameTime(targetFrameTime);
+        }
+        ImGui::Text("Resolution Scale: %.0f%%", m_framePacer->getResolutionScale() * 100.0f);
+
+        float residentMB = TextureStreamer::getResidentBytes() / (1024.0f * 1024.0f);
+        float budgetMB = TextureStreamer::getBudget() / (1024.0f * 1024.0f);
+        ImGui::Text("Texture Memory: %.1f / %.1f MB (%zu textures, %zu streaming)", residentMB, budgetMB,
+                    TextureStreamer::getTextureCount(), TextureStreamer::getPendingJobs());
+
+        if (const CascadedShadowMap* shadows = Renderer::getShadowMap()) {
+            ImGui::Text("Shadow Casters: %d draws, %d cached cascades redrawn",
+                        shadows->getCasterDraws(), shadows->getStaticRedraws());
+        }
+
+        if (const ClusteredLighting* lighting = Renderer::getClusteredLighting()) {
+            ImGui::Text("Clustered Lights: %d lights, %d froxel entries", lighting->getLightCount(), lighting->getAssignedIndices());
+        }
+
+        if (const SkinningPalette* skinning = Renderer::getSkinningPalette()) {
+            ImGui::Text("Skinning: %d animated models, %d joints", skinning->getSkinnedModelCount(), skinning->getJointCount());
+        }
+
+        if (const StreamBuffer* stream = Renderer::getStreamBuffer()) {
+            ImGui::Text("Stream Buffer: %.1f / %.0f KB per frame (%s, %d stalls)", stream->getFrameBytes() / 1024.0f,
+                        stream->getRegionSize() / 1024.0f, stream->isPersistent() ? "persistent" : "mapped per upload",
+                        stream->getStalls());
+        }
+        if (const RenderGraph* graph = Renderer::getRenderGraph()) {
+            ImGui::Text("Render Graph: %d passes, %d culled, %d transients in %d textures (%.1f MB)",
+                        graph->getPassCount(), graph->getCulledPassCount(), graph->getTransientCount(),
+                        graph->getPhysicalTextureCount(), graph->getPoolBytes() / (1024.0f * 1024.0f));
+        }
+        if (const ShaderVariants* litShader = Renderer::getLitShader()) {
+            ImGui::Text("Draw Queue: %d draws, %d program switches, %zu shader variants",
+                        Renderer::getQueuedDrawCount(), Renderer::getProgramSwitchCount(), litShader->getCompiledCount());
+        }
+        ImGui::Text("GL State: %llu calls issued, %llu redundant skipped",
+                    static_cast<unsigned long long>(GLState::getLastFrameIssued()),
+                    static_cast<unsigned long long>(GLState::getLastFrameSkipped()));
+
+        bool occlusionCulling = Renderer::isOcclusionCullingEnabled();
+        if (ImGui::Checkbox("Occlusion Culling", &occlusionCulling)) {
+            Renderer::setOcclusionCulling(occlusionCulling);
+        }
+        if (const OcclusionCuller* culler = Renderer::getOcclusionCuller()) {
+            ImGui::Text("Culled: %d frustum, %d occluded (%d occluders, %d triangles)",
+                        Renderer::getFrustumCulledCount(), Renderer::getOccludedCount(),
+                        culler->getOccluderCount(), culler->getOccluderTriangles());
+        }
+        bool backfaceCulling = Renderer::isBackfaceCullingEnabled();
+        if (ImGui::Checkbox("Back-face Culling", &backfaceCulling)) {
+            Renderer::setBackfaceCulling(backfaceCulling);
+        }
+        ImGui::Text("Meshlets: %d tested, %d outside the frustum, %d back-facing",
+                    Renderer::getTestedMeshletCount(), Renderer::getOutsideMeshletCount(), Renderer::getBackfacingMeshletCount());
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+
+        drawBenchmarkSection();
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+
+        DrawPerfCountersSection();
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+
+        DrawMemorySection();
 
         ImGui::Spacing();
         ImGui::Spacing();
@@ -131,19 +334,7 @@ void Application::run() {
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 1.0f, 1.0f), "SCENE OUTLINER");
         ImGui::Separator();
 
-        auto& models = m_activeScene->getModels();
-
-        if (models.empty()) {
-            ImGui::Text("Scene is empty. Load a model to begin.");
-        } else {
-            for (size_t i = 0; i < models.size(); i++) {
-                Model* model = models[i].get();
-                // Only draw root models (those without a parent)
-                if (!model->m_parent) {
-                    DrawModelNode(model);
-                }
-            }
-        }
+        m_outliner->draw(*m_activeScene);
 
         ImGui::End();
 
@@ -154,34 +345,103 @@ void Application::run() {
         lastFrame = currentFrame;
 
         m_mainWindow->swapBuffers();
+        m_framePacer->endFrame(); // the fps cap sleeps here, before the next input poll
+        if (m_benchmark->isRunning() && m_benchmark->endFrame() && m_exitAfterBenchmark) {
+            stop();
+        }
         m_mainWindow->pollEvents();
+        m_framePacer->markInputSampled();
+    }
+
+    if (m_isRecordingPath) {
+        stopRecordingPath();
+    }
+}
+
+void Application::recordCameraPath(const std::string& pathFile) {
+    m_recordedPath.clear();
+    m_recordingFile = pathFile;
+    m_recordingStart = glfwGetTime();
+    m_isRecordingPath = true;
+}
+
+void Application::stopRecordingPath() {
+    m_isRecordingPath = false;
+    m_recordedPath.save(m_recordingFile);
+}
+
+void Application::runBenchmark(const std::string& pathFile, const std::string& csvFile, bool exitWhenDone) {
+    if (m_isRecordingPath) {
+        stopRecordingPath();
+    }
+
+    bool started = m_benchmark->start(pathFile, csvFile, *m_framePacer);
+    m_exitAfterBenchmark = exitWhenDone;
+
+    // a scripted run that can't start shouldn't leave the window open forever
+    if (!started && exitWhenDone) {
+        stop();
+    }
+}
+
+void Application::drawBenchmarkSection() {
+    static const char* kPathFile = "camera_path.txt";
+    static const char* kCsvFile = "benchmark.csv";
+
+    ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "BENCHMARK");
+    ImGui::Separator();
+
+    if (m_benchmark->isRunning()) {
+        ImGui::ProgressBar(m_benchmark->getProgress(), ImVec2(-1.0f, 0.0f), "Replaying");
+        return;
+    }
+
+    if (m_isRecordingPath) {
+        if (ImGui::Button("Stop Recording")) {
+            stopRecordingPath();
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu keys, %.1f s", m_recordedPath.getKeyCount(), m_recordedPath.getDuration());
+    } else {
+        if (ImGui::Button("Record Camera Path")) {
+            recordCameraPath(kPathFile);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Run Benchmark")) {
+            runBenchmark(kPathFile, kCsvFile, false);
+        }
     }
 }
 
 void Application::render() {
-    Renderer::clear(0.1f, 0.1f, 0.1f, 1.0f);
+    int outputWidth, outputHeight;
+    glfwGetFramebufferSize(m_mainWindow->getNativeWindow(), &outputWidth, &outputHeight);
+
+    m_framePacer->beginGpuScene();
+    Renderer::beginFrame(outputWidth, outputHeight, m_framePacer->getResolutionScale());
 
     glm::mat4 view = m_camera->getViewMatrix(); 
     glm::mat4 projection = m_camera->getProjectionMatrix(1280.0f / 720.0f);
 
-    Renderer::drawViewportGizmo(view, projection);
-    Renderer::beginScene(view, projection); // this is where the skybox and stuff is 
+    Renderer::renderScene(m_activeScene->getModels(), m_activeScene->getLights(), view, projection);
 
-    auto& models = m_activeScene->getModels();
-    for (auto& model : models)
-        Renderer::submit(*m_defaultShader, *model, view, projection);
+    Renderer::endFrame();
+    m_framePacer->endGpuScene();
 }
 
 void Application::update(float deltaTime) {
-    Model* car = m_activeScene->getModel(0); // this is bugatti
-    Model* cat = m_activeScene->getModel(1); // this is cat 
+    m_activeScene->onUpdate(deltaTime);
+
+    // null once a model is removed
+    Model* cat = m_activeScene->getModel(m_catModel);
+    Model* car = m_activeScene->getModel(m_carModel);
 
-    if (car) {
-        car->m_rotation.y += 20.0f * deltaTime; // rotate
+    if (cat) {
+        cat->m_rotation.y += 20.0f * deltaTime; // rotate
     }
 
-    if(cat) {
-        cat->m_position = glm::vec3(25.0f, 0.0f,0.0f );
+    if(car) {
+        car->m_position = glm::vec3(25.0f, 0.0f,0.0f );
     }
 }
 
@@ -0,0 +1,170 @@
+#include "core/Benchmark.h"
+#include "core/PerfCounters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+static const int kWarmupFrames = 60;
+// a little more than the pacer's query ring
+static const int kDrainFrames = 8;
+
+struct FrameStats {
+    float min = 0.0f, avg = 0.0f, p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f;
+};
+
+// nearest rank percentiles
+static FrameStats computeStats(std::vector<float> values) {
+    FrameStats stats;
+    if(values.empty()) return stats;
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](float p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for(float value : values) sum += value;
+
+    stats.min = values.front();
+    stats.avg = static_cast<float>(sum / values.size());
+    stats.p50 = percentile(0.50f);
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+    stats.max = values.back();
+    return stats;
+}
+
+static void printStats(const char* label, const FrameStats& stats) {
+    std::printf("  %-8s %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f\n", label,
+                stats.min, stats.avg, stats.p50, stats.p95, stats.p99, stats.max);
+}
+
+bool Benchmark::start(const std::string& pathFile, const std::string& csvFile, FramePacer& pacer) {
+    if(isRunning()) return false;
+    if(!m_path.load(pathFile)) return false;
+
+    m_csvFile = csvFile;
+    m_pacer = &pacer;
+    m_phase = Phase::Warmup;
+    m_phaseFrames = 0;
+    m_replayFrameCount = static_cast<int>(m_path.getDuration() / kTimestep) + 1;
+    m_firstFrame = UINT64_MAX;
+    m_samples.clear();
+    m_samples.reserve(m_replayFrameCount);
+
+    // measure what the frames cost, not how long they wait
+    m_savedVSync = pacer.getVSync();
+    m_savedFpsCap = pacer.getFpsCap();
+    m_savedDynamicResolution = pacer.isDynamicResolutionEnabled();
+    pacer.setVSync(VSyncMode::Off);
+    pacer.setFpsCap(0.0f);
+    pacer.setDynamicResolution(false);
+
+    pacer.setGpuTimeListener([this](uint64_t frame, float ms) {
+        if(frame >= m_firstFrame && frame - m_firstFrame < m_samples.size()) {
+            m_samples[frame - m_firstFrame].gpuMs = ms;
+        }
+    });
+
+    std::cout << "[Debug] Benchmark started: " << pathFile << ", " << m_replayFrameCount << " frames" << std::endl;
+    return true;
+}
+
+bool Benchmark::isRunning() const {
+    return m_phase != Phase::Idle;
+}
+
+float Benchmark::beginFrame(Camera& camera) {
+    switch(m_phase) {
+        case Phase::Idle:
+            break;
+        case Phase::Warmup:
+            m_path.apply(0.0f, camera);
+            break;
+        case Phase::Replay:
+            if(m_samples.empty()) m_firstFrame = m_pacer->getFrameNumber();
+            m_path.apply(m_samples.size() * kTimestep, camera);
+            break;
+        case Phase::Drain:
+            m_path.apply(m_path.getDuration(), camera);
+            break;
+    }
+    return kTimestep;
+}
+
+bool Benchmark::endFrame() {
+    switch(m_phase) {
+        case Phase::Idle:
+            return false;
+        case Phase::Warmup:
+            if(++m_phaseFrames >= kWarmupFrames) {
+                m_phase = Phase::Replay;
+                m_phaseFrames = 0;
+                PerfCounters::resetTotals(); // the report covers the recorded frames only
+            }
+            return false;
+        case Phase::Replay:
+            m_samples.push_back({ m_pacer->getCpuFrameTime(), -1.0f });
+            if(static_cast<int>(m_samples.size()) >= m_replayFrameCount) m_phase = Phase::Drain;
+            return false;
+        case Phase::Drain:
+            if(++m_phaseFrames < kDrainFrames) return false;
+            finish();
+            return true;
+    }
+    return false;
+}
+
+float Benchmark::getProgress() const {
+    return m_replayFrameCount > 0 ? static_cast<float>(m_samples.size()) / m_replayFrameCount : 0.0f;
+}
+
+void Benchmark::finish() {
+    m_pacer->setGpuTimeListener(nullptr);
+    m_pacer->setVSync(m_savedVSync);
+    m_pacer->setFpsCap(m_savedFpsCap);
+    m_pacer->setDynamicResolution(m_savedDynamicResolution);
+    m_phase = Phase::Idle;
+
+    std::vector<float> cpu, gpu;
+    cpu.reserve(m_samples.size());
+    gpu.reserve(m_samples.size());
+    for(const FrameSample& sample : m_samples) {
+        cpu.push_back(sample.cpuMs);
+        if(sample.gpuMs >= 0.0f) gpu.push_back(sample.gpuMs);
+    }
+
+    // frames where the gpu was too far behind to time don't have a gpu sample
+    std::printf("[Debug] Benchmark: %zu frames, %zu with gpu times\n", m_samples.size(), gpu.size());
+    std::printf("  %-8s %8s %8s %8s %8s %8s %8s\n", "ms", "min", "avg", "p50", "p95", "p99", "max");
+    printStats("cpu", computeStats(cpu));
+    printStats("gpu", computeStats(gpu));
+    std::fflush(stdout);
+
+    writeCsv();
+    if(PerfCounters::isEnabled() && PerfCounters::isAvailable()) {
+        PerfCounters::writeReport(m_csvFile + ".perf.txt");
+    }
+}
+
+bool Benchmark::writeCsv() const {
+    std::ofstream file(m_csvFile);
+    if(!file) {
+        std::cerr << "ERROR::BENCHMARK:: could not write " << m_csvFile << std::endl;
+        return false;
+    }
+
+    file << "frame,time_s,cpu_ms,gpu_ms\n";
+    for(size_t i = 0; i < m_samples.size(); i++) {
+        file << i << "," << i * kTimestep << "," << m_samples[i].cpuMs << ",";
+        if(m_samples[i].gpuMs >= 0.0f) file << m_samples[i].gpuMs;
+        file << "\n";
+    }
+
+    std::cout << "[Debug] Benchmark frames written to " << m_csvFile << std::endl;
+    return true;
+}
@@ -0,0 +1,212 @@
+#include "core/FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+// the scene pass aims for this fraction of the target, the rest is ui and present
+static const float kGpuBudgetFraction = 0.85f;
+// frames to wait after a resolution change, the queries lag behind by a few frames
+static const int kScaleCooldownFrames = 6;
+// sleep until this close to the deadline, then yield the rest, sleep_for overshoots
+static const double kSpinMargin = 0.002;
+
+FramePacer::FramePacer() {
+    for(auto& frame : m_frames) {
+        glGenQueries(1, &frame.sceneTime);
+        glGenQueries(1, &frame.presentTimestamp);
+    }
+
+    setVSync(m_vsync);
+    m_frameStart = glfwGetTime();
+    m_inputTime = m_frameStart;
+}
+
+FramePacer::~FramePacer() {
+    for(auto& frame : m_frames) {
+        glDeleteQueries(1, &frame.sceneTime);
+        glDeleteQueries(1, &frame.presentTimestamp);
+    }
+}
+
+void FramePacer::setVSync(VSyncMode mode) {
+    m_vsync = mode;
+
+    int interval = mode == VSyncMode::Off ? 0 : 1;
+    if(mode == VSyncMode::Adaptive) {
+        if(glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            interval = -1;
+        }
+        else {
+            std::cout << "[Debug] Adaptive vsync not supported, using regular vsync" << std::endl;
+        }
+    }
+
+    glfwSwapInterval(interval);
+}
+
+VSyncMode FramePacer::getVSync() const {
+    return m_vsync;
+}
+
+void FramePacer::setFpsCap(float fps) {
+    m_fpsCap = std::max(fps, 0.0f);
+}
+
+float FramePacer::getFpsCap() const {
+    return m_fpsCap;
+}
+
+void FramePacer::setTargetFrameTime(float ms) {
+    m_targetFrameTime = std::max(ms, 1.0f);
+}
+
+float FramePacer::getTargetFrameTime() const {
+    return m_targetFrameTime;
+}
+
+void FramePacer::setDynamicResolution(bool enabled) {
+    m_dynamicResolution = enabled;
+    if(!enabled) m_resolutionScale = 1.0f;
+}
+
+bool FramePacer::isDynamicResolutionEnabled() const {
+    return m_dynamicResolution;
+}
+
+void FramePacer::beginFrame() {
+    m_frameStart = glfwGetTime();
+    m_frameNumber++;
+
+    // map gpu timestamps onto the cpu clock, redone every frame since the two drift
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    m_gpuToCpuOffset = glfwGetTime() - gpuNow * 1e-9;
+
+    collectQueries();
+    updateResolutionScale();
+
+    // if the gpu is so far behind that this slot is still in flight, skip timing this frame
+    m_timingThisFrame = !m_frames[m_frameIndex].pending;
+    m_frames[m_frameIndex].sceneIssued = false;
+    m_frames[m_frameIndex].frameNumber = m_frameNumber;
+}
+
+void FramePacer::markInputSampled() {
+    m_inputTime = glfwGetTime();
+}
+
+void FramePacer::beginGpuScene() {
+    if(!m_timingThisFrame) return;
+    glBeginQuery(GL_TIME_ELAPSED, m_frames[m_frameIndex].sceneTime);
+}
+
+void FramePacer::endGpuScene() {
+    if(!m_timingThisFrame) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_frames[m_frameIndex].sceneIssued = true;
+}
+
+void FramePacer::endFrame() {
+    if(m_timingThisFrame) {
+        // completes once everything up to and including the swap has executed
+        FrameQueries& frame = m_frames[m_frameIndex];
+        glQueryCounter(frame.presentTimestamp, GL_TIMESTAMP);
+        frame.inputTime = m_inputTime;
+        frame.pending = true;
+    }
+    m_frameIndex = (m_frameIndex + 1) % kQueryFrames;
+
+    double now = glfwGetTime();
+    m_cpuFrameTime = static_cast<float>((now - m_frameStart) * 1000.0);
+
+    if(m_fpsCap <= 0.0f) return;
+
+    // sleep before the next input poll rather than after it, so the cap doesn't add latency
+    double deadline = m_frameStart + 1.0 / m_fpsCap;
+    if(deadline - now > kSpinMargin) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(deadline - now - kSpinMargin));
+    }
+    while(glfwGetTime() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::collectQueries() {
+    for(auto& frame : m_frames) {
+        if(!frame.pending) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame.presentTimestamp, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) continue;
+
+        GLuint64 timestamp = 0;
+        glGetQueryObjectui64v(frame.presentTimestamp, GL_QUERY_RESULT, &timestamp);
+        double presentTime = timestamp * 1e-9 + m_gpuToCpuOffset;
+        m_latency = static_cast<float>(std::max(0.0, presentTime - frame.inputTime) * 1000.0);
+
+        // the scene query finished before the timestamp, so it is available too
+        if(frame.sceneIssued) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame.sceneTime, GL_QUERY_RESULT, &elapsed);
+            m_gpuSceneTime = static_cast<float>(elapsed * 1e-6);
+            m_smoothedGpuTime = m_smoothedGpuTime > 0.0f ? m_smoothedGpuTime + (m_gpuSceneTime - m_smoothedGpuTime) * 0.2f : m_gpuSceneTime;
+            if(m_gpuTimeListener) m_gpuTimeListener(frame.frameNumber, m_gpuSceneTime);
+        }
+
+        frame.pending = false;
+    }
+}
+
+void FramePacer::updateResolutionScale() {
+    if(!m_dynamicResolution || m_smoothedGpuTime <= 0.0f) return;
+
+    if(m_scaleCooldown > 0) {
+        m_scaleCooldown--;
+        return;
+    }
+
+    // gpu time goes roughly with the pixel count, so with the square of the scale
+    float budget = m_targetFrameTime * kGpuBudgetFraction;
+    float ratio = std::sqrt(budget / m_smoothedGpuTime);
+
+    float desired = m_resolutionScale;
+    if(m_smoothedGpuTime > budget) {
+        desired = m_resolutionScale * ratio; // drop straight to where it fits
+    }
+    else if(m_smoothedGpuTime < budget * 0.75f) {
+        desired = m_resolutionScale * std::min(ratio, 1.05f); // creep back up
+    }
+
+    desired = std::clamp(desired, kMinResolutionScale, 1.0f);
+    if(std::abs(desired - m_resolutionScale) < 0.02f) return;
+
+    m_resolutionScale = desired;
+    m_scaleCooldown = kScaleCooldownFrames;
+}
+
+float FramePacer::getResolutionScale() const {
+    return m_resolutionScale;
+}
+
+float FramePacer::getGpuSceneTime() const {
+    return m_gpuSceneTime;
+}
+
+float FramePacer::getLatency() const {
+    return m_latency;
+}
+
+float FramePacer::getCpuFrameTime() const {
+    return m_cpuFrameTime;
+}
+
+uint64_t FramePacer::getFrameNumber() const {
+    return m_frameNumber;
+}
+
+void FramePacer::setGpuTimeListener(std::function<void(uint64_t frame, float ms)> listener) {
+    m_gpuTimeListener = std::move(listener);
+}
@@ -0,0 +1,117 @@
+#include "core/JobSystem.h"
+
+#include <algorithm>
+
+// static member definitions
+std::vector<std::thread> JobSystem::s_workers;
+std::deque<JobSystem::Task> JobSystem::s_tasks;
+std::mutex JobSystem::s_mutex;
+std::condition_variable JobSystem::s_condition;
+bool JobSystem::s_running = false;
+
+void JobSystem::init(unsigned int workerCount) {
+    if(workerCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    s_running = true;
+    for(unsigned int i = 0; i < workerCount; i++) {
+        s_workers.emplace_back(&JobSystem::workerLoop);
+    }
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_running = false;
+    }
+    s_condition.notify_all();
+
+    for(auto& worker : s_workers) {
+        if(worker.joinable()) worker.join();
+    }
+    s_workers.clear();
+    s_tasks.clear();
+}
+
+void JobSystem::parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn) {
+    if(count == 0) return;
+
+    minChunk = std::max<size_t>(minChunk, 1);
+    size_t threads = getThreadCount();
+
+    // a few chunks per thread so an uneven chunk doesn't leave everyone waiting on it
+    size_t chunk = std::max(minChunk, (count + threads * 4 - 1) / (threads * 4));
+    size_t chunks = (count + chunk - 1) / chunk;
+
+    if(s_workers.empty() || chunks == 1) {
+        fn(0, count);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->remaining = chunks;
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for(size_t c = 0; c < chunks; c++) {
+            size_t begin = c * chunk;
+            size_t end = std::min(count, begin + chunk);
+
+            Task task;
+            task.work = [&fn, begin, end]() { fn(begin, end); };
+            task.batch = batch;
+            s_tasks.push_back(std::move(task));
+        }
+    }
+    s_condition.notify_all();
+
+    // help out instead of sleeping, this also keeps nested parallelFor calls from deadlocking
+    while(batch->remaining.load() > 0) {
+        if(!runOneTask()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::runOneTask() {
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if(s_tasks.empty()) return false;
+
+        task = std::move(s_tasks.front());
+        s_tasks.pop_front();
+    }
+
+    task.work();
+    task.batch->remaining.fetch_sub(1);
+    return true;
+}
+
+void JobSystem::workerLoop() {
+    while(true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            s_condition.wait(lock, [] { return !s_running || !s_tasks.empty(); });
+
+            if(!s_running && s_tasks.empty()) return;
+
+            task = std::move(s_tasks.front());
+            s_tasks.pop_front();
+        }
+
+        task.work();
+        task.batch->remaining.fetch_sub(1);
+    }
+}
+
+unsigned int JobSystem::getWorkerCount() {
+    return static_cast<unsigned int>(s_workers.size());
+}
+
+unsigned int JobSystem::getThreadCount() {
+    return static_cast<unsigned int>(s_workers.size()) + 1;
+}
@@ -0,0 +1,294 @@
+#include "core/Json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const JsonValue s_null;
+static const std::string s_emptyString;
+
+class JsonValue::Parser {
+public:
+    Parser(const char* data, size_t size)
+        : m_begin(data), m_p(data), m_end(data + size) {}
+
+    bool parseDocument(JsonValue& out, std::string& error) {
+        skipWhitespace();
+        bool ok = parseValue(out, 0) && (skipWhitespace(), m_p == m_end);
+        if(!ok) {
+            error = (m_error.empty() ? std::string("trailing characters") : m_error)
+                + " at byte " + std::to_string(m_p - m_begin);
+        }
+        return ok;
+    }
+
+private:
+    // deep enough for any real asset, shallow enough to never blow the stack
+    static const int kMaxDepth = 256;
+
+    const char* m_begin;
+    const char* m_p;
+    const char* m_end;
+    std::string m_error;
+
+    bool fail(const char* reason) {
+        if(m_error.empty()) m_error = reason;
+        return false;
+    }
+
+    void skipWhitespace() {
+        while(m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r')) m_p++;
+    }
+
+    bool consume(const char* literal) {
+        size_t length = std::strlen(literal);
+        if(static_cast<size_t>(m_end - m_p) < length || std::memcmp(m_p, literal, length) != 0) return false;
+        m_p += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& out, int depth) {
+        if(depth > kMaxDepth) return fail("nested too deep");
+        if(m_p >= m_end) return fail("unexpected end");
+
+        switch(*m_p) {
+            case '{': return parseObject(out, depth);
+            case '[': return parseArray(out, depth);
+            case '"':
+                out.m_type = Type::String;
+                return parseString(out.m_string);
+            case 't':
+            case 'f':
+                out.m_type = Type::Bool;
+                out.m_bool = *m_p == 't';
+                return consume(out.m_bool ? "true" : "false") || fail("bad literal");
+            case 'n':
+                out.m_type = Type::Null;
+                return consume("null") || fail("bad literal");
+            default:
+                return parseNumber(out);
+        }
+    }
+
+    bool parseNumber(JsonValue& out) {
+        // strtod would run past the end of a mapped buffer, so copy the token first
+        const char* start = m_p;
+        while(m_p < m_end && ((*m_p && std::strchr("+-.eE", *m_p)) || (*m_p >= '0' && *m_p <= '9'))) m_p++;
+        if(m_p == start) return fail("unexpected character");
+
+        std::string token(start, m_p);
+        char* parsedEnd = nullptr;
+        out.m_type = Type::Number;
+        out.m_number = std::strtod(token.c_str(), &parsedEnd);
+        return parsedEnd == token.c_str() + token.size() || fail("bad number");
+    }
+
+    static void appendUtf8(std::string& out, unsigned int codepoint) {
+        if(codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        } else if(codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if(codepoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned int& out) {
+        if(m_end - m_p < 4) return fail("bad escape");
+        out = 0;
+        for(int i = 0; i < 4; i++) {
+            char c = *m_p++;
+            out <<= 4;
+            if(c >= '0' && c <= '9') out |= c - '0';
+            else if(c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return fail("bad escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        m_p++; // opening quote
+        out.clear();
+
+        while(m_p < m_end) {
+            // copy plain runs in one go
+            const char* run = m_p;
+            while(m_p < m_end && *m_p != '"' && *m_p != '\\') m_p++;
+            out.append(run, m_p);
+            if(m_p >= m_end) break;
+
+            if(*m_p == '"') {
+                m_p++;
+                return true;
+            }
+
+            m_p++; // backslash
+            if(m_p >= m_end) break;
+            char escape = *m_p++;
+            switch(escape) {
+                case '"':  out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/'; break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    unsigned int codepoint;
+                    if(!parseHex4(codepoint)) return false;
+                    // surrogate pair
+                    if(codepoint >= 0xD800 && codepoint < 0xDC00 && consume("\\u")) {
+                        unsigned int low;
+                        if(!parseHex4(low)) return false;
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, codepoint);
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+
+        return fail("unterminated string");
+    }
+
+    bool parseArray(JsonValue& out, int depth) {
+        out.m_type = Type::Array;
+        m_p++;
+        skipWhitespace();
+        if(m_p < m_end && *m_p == ']') {
+            m_p++;
+            return true;
+        }
+
+        while(true) {
+            out.m_values.emplace_back();
+            skipWhitespace();
+            if(!parseValue(out.m_values.back(), depth + 1)) return false;
+            skipWhitespace();
+
+            if(m_p < m_end && *m_p == ',') {
+                m_p++;
+            } else if(m_p < m_end && *m_p == ']') {
+                m_p++;
+                return true;
+            } else {
+                return fail("expected , or ]");
+            }
+        }
+    }
+
+    bool parseObject(JsonValue& out, int depth) {
+        out.m_type = Type::Object;
+        m_p++;
+        skipWhitespace();
+        if(m_p < m_end && *m_p == '}') {
+            m_p++;
+            return true;
+        }
+
+        while(true) {
+            skipWhitespace();
+            if(m_p >= m_end || *m_p != '"') return fail("expected key");
+
+            out.m_keys.emplace_back();
+            if(!parseString(out.m_keys.back())) return false;
+
+            skipWhitespace();
+            if(m_p >= m_end || *m_p != ':') return fail("expected :");
+            m_p++;
+            skipWhitespace();
+
+            out.m_values.emplace_back();
+            if(!parseValue(out.m_values.back(), depth + 1)) return false;
+            skipWhitespace();
+
+            if(m_p < m_end && *m_p == ',') {
+                m_p++;
+            } else if(m_p < m_end && *m_p == '}') {
+                m_p++;
+                return true;
+            } else {
+                return fail("expected , or }");
+            }
+        }
+    }
+};
+
+bool JsonValue::parse(const char* data, size_t size, JsonValue& out, std::string& error) {
+    out = JsonValue();
+    Parser parser(data, size);
+    return parser.parseDocument(out, error);
+}
+
+JsonValue::Type JsonValue::getType() const {
+    return m_type;
+}
+
+bool JsonValue::isNull() const {
+    return m_type == Type::Null;
+}
+
+bool JsonValue::isArray() const {
+    return m_type == Type::Array;
+}
+
+bool JsonValue::isObject() const {
+    return m_type == Type::Object;
+}
+
+bool JsonValue::asBool(bool fallback) const {
+    return m_type == Type::Bool ? m_bool : fallback;
+}
+
+double JsonValue::asNumber(double fallback) const {
+    return m_type == Type::Number ? m_number : fallback;
+}
+
+int JsonValue::asInt(int fallback) const {
+    return m_type == Type::Number ? static_cast<int>(m_number) : fallback;
+}
+
+const std::string& JsonValue::asString() const {
+    return m_type == Type::String ? m_string : s_emptyString;
+}
+
+size_t JsonValue::size() const {
+    return (m_type == Type::Array || m_type == Type::Object) ? m_values.size() : 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    return index < size() ? m_values[index] : s_null;
+}
+
+const JsonValue& JsonValue::operator[](int index) const {
+    return index >= 0 ? (*this)[static_cast<size_t>(index)] : s_null;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+    if(m_type != Type::Object) return s_null;
+
+    // glTF objects have a handful of members, a linear scan beats hashing them
+    for(size_t i = 0; i < m_keys.size(); i++) {
+        if(m_keys[i] == key) return m_values[i];
+    }
+    return s_null;
+}
+
+bool JsonValue::has(const char* key) const {
+    return !(*this)[key].isNull();
+}
+
+const std::string& JsonValue::getKey(size_t index) const {
+    return (m_type == Type::Object && index < m_keys.size()) ? m_keys[index] : s_emptyString;
+}
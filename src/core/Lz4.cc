@@ -0,0 +1,161 @@
+#include "core/Lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// limits from the format: a match is at least 4 bytes, the last 5 bytes are always
+// literals and the last match starts at least 12 bytes before the end
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const size_t kMatchSafeDistance = 12;
+static const size_t kMaxOffset = 65535;
+static const int kHashLog = 16;
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+// 15 in the token nibble, then 255s, then the rest
+static bool writeLength(unsigned char*& out, const unsigned char* end, size_t length) {
+    while(length >= 255) {
+        if(out >= end) return false;
+        *out++ = 255;
+        length -= 255;
+    }
+    if(out >= end) return false;
+    *out++ = static_cast<unsigned char>(length);
+    return true;
+}
+
+static bool readLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+    do {
+        if(in >= end) return false;
+        byte = *in++;
+        length += byte;
+    } while(byte == 255);
+    return true;
+}
+
+size_t Lz4::getMaxCompressedSize(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t Lz4::compress(const char* src, size_t size, char* dst, size_t capacity) {
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(src);
+    unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* outEnd = out + capacity;
+
+    auto emit = [&](const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+        unsigned char* token = out++;
+        if(token >= outEnd) return false;
+
+        size_t literalNibble = literalCount < 15 ? literalCount : 15;
+        size_t matchNibble = 0;
+        if(matchLength > 0) {
+            matchNibble = matchLength - kMinMatch < 15 ? matchLength - kMinMatch : 15;
+        }
+        *token = static_cast<unsigned char>((literalNibble << 4) | matchNibble);
+
+        if(literalCount >= 15 && !writeLength(out, outEnd, literalCount - 15)) return false;
+        if(static_cast<size_t>(outEnd - out) < literalCount) return false;
+        std::memcpy(out, literals, literalCount);
+        out += literalCount;
+
+        // the last sequence is literals only
+        if(matchLength == 0) return true;
+
+        if(outEnd - out < 2) return false;
+        *out++ = static_cast<unsigned char>(offset & 0xFF);
+        *out++ = static_cast<unsigned char>(offset >> 8);
+        if(matchLength - kMinMatch >= 15 && !writeLength(out, outEnd, matchLength - kMinMatch - 15)) return false;
+        return true;
+    };
+
+    size_t anchor = 0;
+    if(size > kMatchSafeDistance) {
+        std::vector<uint32_t> table(size_t(1) << kHashLog, UINT32_MAX);
+        size_t matchLimit = size - kLastLiterals;
+        size_t position = 0;
+
+        while(position + kMatchSafeDistance < size) {
+            uint32_t sequence = read32(input + position);
+            uint32_t& slot = table[hashSequence(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position);
+
+            if(candidate == UINT32_MAX || position - candidate > kMaxOffset || read32(input + candidate) != sequence) {
+                position++;
+                continue;
+            }
+
+            // extend backwards over literals that match too, then forwards
+            while(position > anchor && candidate > 0 && input[position - 1] == input[candidate - 1]) {
+                position--;
+                candidate--;
+            }
+            size_t length = kMinMatch;
+            while(position + length < matchLimit && input[position + length] == input[candidate + length]) {
+                length++;
+            }
+
+            if(!emit(input + anchor, position - anchor, position - candidate, length)) return 0;
+            position += length;
+            anchor = position;
+        }
+    }
+
+    if(!emit(input + anchor, size - anchor, 0, 0)) return 0;
+    return static_cast<size_t>(out - reinterpret_cast<unsigned char*>(dst));
+}
+
+bool Lz4::decompress(const char* src, size_t compressedSize, char* dst, size_t size) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* inEnd = in + compressedSize;
+    unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* outStart = out;
+    unsigned char* outEnd = out + size;
+
+    while(in < inEnd) {
+        unsigned char token = *in++;
+
+        size_t literalCount = token >> 4;
+        if(literalCount == 15 && !readLength(in, inEnd, literalCount)) return false;
+        if(static_cast<size_t>(inEnd - in) < literalCount || static_cast<size_t>(outEnd - out) < literalCount) return false;
+        std::memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+
+        // the block ends after the literals of the last sequence
+        if(in == inEnd) break;
+
+        if(inEnd - in < 2) return false;
+        size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        if(offset == 0 || offset > static_cast<size_t>(out - outStart)) return false;
+
+        size_t matchLength = token & 15;
+        if(matchLength == 15 && !readLength(in, inEnd, matchLength)) return false;
+        matchLength += kMinMatch;
+        if(static_cast<size_t>(outEnd - out) < matchLength) return false;
+
+        // the match can overlap what it writes, short offsets repeat a pattern
+        const unsigned char* match = out - offset;
+        if(offset >= matchLength) {
+            std::memcpy(out, match, matchLength);
+            out += matchLength;
+        }
+        else {
+            for(size_t i = 0; i < matchLength; i++) *out++ = *match++;
+        }
+    }
+
+    return out == outEnd;
+}
@@ -0,0 +1,237 @@
+#include "core/MemoryTracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+
+#include "imgui.h"
+
+std::mutex MemoryTracker::s_mutex;
+std::unordered_map<uint64_t, MemoryTracker::Record> MemoryTracker::s_records;
+size_t MemoryTracker::s_cpuBytes[static_cast<int>(MemoryTag::Count)] = {};
+size_t MemoryTracker::s_gpuBytes[static_cast<int>(MemoryTag::Count)] = {};
+std::atomic<size_t> MemoryTracker::s_uiBytes{ 0 };
+thread_local std::string MemoryTracker::s_currentAsset;
+
+// every imgui block carries its size in front, 16 bytes keeps the alignment malloc gives
+static const size_t kAllocHeader = 16;
+
+uint64_t MemoryTracker::makeKey(MemoryDomain domain, uintptr_t handle) {
+    // user space pointers and GL names never reach the top two bits
+    return (static_cast<uint64_t>(domain) << 62) | static_cast<uint64_t>(handle);
+}
+
+void MemoryTracker::track(MemoryDomain domain, uintptr_t handle, MemoryTag tag, size_t bytes) {
+    if(handle == 0) return;
+
+    bool gpu = domain != MemoryDomain::Cpu;
+    size_t* totals = gpu ? s_gpuBytes : s_cpuBytes;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_records.find(makeKey(domain, handle));
+    if(it != s_records.end()) {
+        // resized, keeps its original tag and asset
+        size_t* previousTotals = it->second.gpu ? s_gpuBytes : s_cpuBytes;
+        previousTotals[static_cast<int>(it->second.tag)] -= it->second.bytes;
+        it->second.bytes = bytes;
+        previousTotals[static_cast<int>(it->second.tag)] += bytes;
+        return;
+    }
+
+    s_records.emplace(makeKey(domain, handle), Record{ tag, bytes, gpu, s_currentAsset });
+    totals[static_cast<int>(tag)] += bytes;
+}
+
+void MemoryTracker::untrack(MemoryDomain domain, uintptr_t handle) {
+    if(handle == 0) return;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_records.find(makeKey(domain, handle));
+    if(it == s_records.end()) return;
+
+    size_t* totals = it->second.gpu ? s_gpuBytes : s_cpuBytes;
+    totals[static_cast<int>(it->second.tag)] -= it->second.bytes;
+    s_records.erase(it);
+}
+
+void MemoryTracker::trackCpu(const void* owner, MemoryTag tag, size_t bytes) {
+    track(MemoryDomain::Cpu, reinterpret_cast<uintptr_t>(owner), tag, bytes);
+}
+
+void MemoryTracker::untrackCpu(const void* owner) {
+    untrack(MemoryDomain::Cpu, reinterpret_cast<uintptr_t>(owner));
+}
+
+void MemoryTracker::trackBuffer(GLuint buffer, MemoryTag tag, size_t bytes) {
+    track(MemoryDomain::GpuBuffer, buffer, tag, bytes);
+}
+
+void MemoryTracker::untrackBuffer(GLuint buffer) {
+    untrack(MemoryDomain::GpuBuffer, buffer);
+}
+
+void MemoryTracker::trackTexture(GLuint texture, MemoryTag tag, size_t bytes) {
+    track(MemoryDomain::GpuTexture, texture, tag, bytes);
+}
+
+void MemoryTracker::untrackTexture(GLuint texture) {
+    untrack(MemoryDomain::GpuTexture, texture);
+}
+
+void MemoryTracker::trackRenderbuffer(GLuint renderbuffer, MemoryTag tag, size_t bytes) {
+    track(MemoryDomain::GpuRenderbuffer, renderbuffer, tag, bytes);
+}
+
+void MemoryTracker::untrackRenderbuffer(GLuint renderbuffer) {
+    untrack(MemoryDomain::GpuRenderbuffer, renderbuffer);
+}
+
+MemoryTracker::AssetScope::AssetScope(const std::string& asset)
+    : m_previous(s_currentAsset)
+{
+    s_currentAsset = asset;
+}
+
+MemoryTracker::AssetScope::~AssetScope() {
+    s_currentAsset = m_previous;
+}
+
+void* MemoryTracker::imguiAlloc(size_t size, void*) {
+    char* block = static_cast<char*>(std::malloc(size + kAllocHeader));
+    if(!block) return nullptr;
+
+    *reinterpret_cast<size_t*>(block) = size;
+    s_uiBytes += size;
+    return block + kAllocHeader;
+}
+
+void MemoryTracker::imguiFree(void* pointer, void*) {
+    if(!pointer) return;
+
+    char* block = static_cast<char*>(pointer) - kAllocHeader;
+    s_uiBytes -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+
+void MemoryTracker::installImguiAllocator() {
+    ImGui::SetAllocatorFunctions(imguiAlloc, imguiFree, nullptr);
+}
+
+size_t MemoryTracker::getCpuBytes(MemoryTag tag) {
+    if(tag == MemoryTag::UI) return s_uiBytes;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_cpuBytes[static_cast<int>(tag)];
+}
+
+size_t MemoryTracker::getGpuBytes(MemoryTag tag) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_gpuBytes[static_cast<int>(tag)];
+}
+
+size_t MemoryTracker::getTotalCpuBytes() {
+    size_t total = 0;
+    for(int i = 0; i < static_cast<int>(MemoryTag::Count); i++) {
+        total += getCpuBytes(static_cast<MemoryTag>(i));
+    }
+    return total;
+}
+
+size_t MemoryTracker::getTotalGpuBytes() {
+    size_t total = 0;
+    for(int i = 0; i < static_cast<int>(MemoryTag::Count); i++) {
+        total += getGpuBytes(static_cast<MemoryTag>(i));
+    }
+    return total;
+}
+
+const char* MemoryTracker::getTagName(MemoryTag tag) {
+    switch(tag) {
+        case MemoryTag::Meshes: return "Meshes";
+        case MemoryTag::Textures: return "Textures";
+        case MemoryTag::Importer: return "Importer";
+        case MemoryTag::Animation: return "Animation";
+        case MemoryTag::Renderer: return "Renderer";
+        case MemoryTag::UI: return "UI";
+        default: return "Unknown";
+    }
+}
+
+std::vector<MemoryTracker::AssetUsage> MemoryTracker::getAssets() {
+    std::map<std::string, AssetUsage> byName;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for(const auto& entry : s_records) {
+            const Record& record = entry.second;
+            AssetUsage& usage = byName[record.asset.empty() ? "(engine)" : record.asset];
+            (record.gpu ? usage.gpuBytes : usage.cpuBytes) += record.bytes;
+        }
+    }
+
+    std::vector<AssetUsage> assets;
+    for(auto& entry : byName) {
+        entry.second.name = entry.first;
+        assets.push_back(entry.second);
+    }
+
+    std::sort(assets.begin(), assets.end(), [](const AssetUsage& a, const AssetUsage& b) {
+        return a.cpuBytes + a.gpuBytes > b.cpuBytes + b.gpuBytes;
+    });
+    return assets;
+}
+
+std::string MemoryTracker::getReport() {
+    auto megabytes = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << "memory report\n";
+    report << "total: " << megabytes(getTotalCpuBytes()) << " MB cpu, " << megabytes(getTotalGpuBytes()) << " MB gpu\n\n";
+
+    report << "by tag (cpu MB / gpu MB)\n";
+    for(int i = 0; i < static_cast<int>(MemoryTag::Count); i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        report << "  " << std::left << std::setw(12) << getTagName(tag) << std::right
+               << std::setw(10) << megabytes(getCpuBytes(tag)) << std::setw(10) << megabytes(getGpuBytes(tag)) << "\n";
+    }
+
+    report << "\nby asset (cpu MB / gpu MB)\n";
+    for(const auto& asset : getAssets()) {
+        report << "  " << std::setw(10) << megabytes(asset.cpuBytes) << std::setw(10) << megabytes(asset.gpuBytes)
+               << "  " << asset.name << "\n";
+    }
+
+    return report.str();
+}
+
+bool MemoryTracker::writeReport(const std::string& path) {
+    std::ofstream file(path);
+    if(!file) {
+        std::cerr << "ERROR::MEMORY:: could not write " << path << std::endl;
+        return false;
+    }
+
+    file << getReport();
+    std::cout << "[Debug] Memory report written to " << path << std::endl;
+    return true;
+}
+
+size_t MemoryTracker::getTextureBytes(GLenum internalFormat, int width, int height, int depth) {
+    size_t bytesPerTexel = 4;
+    switch(internalFormat) {
+        case GL_RED: case GL_R8: bytesPerTexel = 1; break;
+        case GL_RG: case GL_RG8: bytesPerTexel = 2; break;
+        case GL_RGB: case GL_RGB8: case GL_RGBA: case GL_RGBA8: bytesPerTexel = 4; break; // rgb is padded to 4
+        case GL_RG16F: bytesPerTexel = 4; break;
+        case GL_RGB16F: bytesPerTexel = 8; break;
+        case GL_RGBA16F: bytesPerTexel = 8; break;
+        case GL_RGBA32F: bytesPerTexel = 16; break;
+        case GL_DEPTH_COMPONENT24: case GL_DEPTH24_STENCIL8: bytesPerTexel = 4; break;
+        default: break;
+    }
+    return static_cast<size_t>(width) * height * depth * bytesPerTexel;
+}
@@ -0,0 +1,276 @@
+#include "core/PerfCounters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> PerfCounters::s_enabled{ false };
+std::atomic<bool> PerfCounters::s_failed{ false };
+std::mutex PerfCounters::s_mutex;
+std::string PerfCounters::s_error;
+std::map<std::string, PerfCounters::Sample> PerfCounters::s_frame;
+std::map<std::string, PerfCounters::Sample> PerfCounters::s_lastFrame;
+std::map<std::string, PerfCounters::Sample> PerfCounters::s_totals;
+
+static const char* kCounterNames[PerfCounters::kCounterCount] = {
+    "cycles", "instructions", "L1 misses", "LLC misses", "branch misses"
+};
+
+#if defined(__linux__)
+
+struct CounterConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+// same order as PerfCounters::Counter, cycles leads the group
+static const CounterConfig kCounterConfigs[PerfCounters::kCounterCount] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+// the counters of one thread, opened the first time it enters a scope
+struct ThreadCounters {
+    int fds[PerfCounters::kCounterCount];
+    int slots[PerfCounters::kCounterCount]; // position in the group read, -1 if the cpu doesn't have it
+    int opened = 0;
+    bool tried = false;
+
+    ThreadCounters() {
+        for(int i = 0; i < PerfCounters::kCounterCount; i++) {
+            fds[i] = -1;
+            slots[i] = -1;
+        }
+    }
+
+    ~ThreadCounters() {
+        for(int fd : fds) {
+            if(fd >= 0) close(fd);
+        }
+    }
+};
+
+static thread_local ThreadCounters t_counters;
+
+static int openCounter(const CounterConfig& counter, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter.type;
+    attr.config = counter.config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // user space only, which is all the default paranoid level lets a normal user count
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // this thread on whatever cpu it runs on
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+#endif
+
+double PerfCounters::ScopeStats::getIpc() const {
+    return counters[Cycles] > 0 ? static_cast<double>(counters[Instructions]) / counters[Cycles] : 0.0;
+}
+
+double PerfCounters::ScopeStats::getMpki(Counter counter) const {
+    return counters[Instructions] > 0 ? counters[counter] * 1000.0 / counters[Instructions] : 0.0;
+}
+
+PerfCounters::Scope::Scope(const char* name)
+    : m_name(name)
+{
+    if(!s_enabled.load(std::memory_order_relaxed)) return;
+    m_active = readThreadCounters(m_start);
+}
+
+PerfCounters::Scope::~Scope() {
+    if(!m_active) return;
+
+    uint64_t end[kCounterCount];
+    if(readThreadCounters(end)) {
+        record(m_name, m_start, end);
+    }
+}
+
+void PerfCounters::setEnabled(bool enabled) {
+    s_enabled = enabled;
+}
+
+bool PerfCounters::isEnabled() {
+    return s_enabled;
+}
+
+bool PerfCounters::isAvailable() {
+    return !s_failed;
+}
+
+std::string PerfCounters::getError() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_error;
+}
+
+const char* PerfCounters::getCounterName(Counter counter) {
+    return kCounterNames[counter];
+}
+
+bool PerfCounters::readThreadCounters(uint64_t values[kCounterCount]) {
+#if defined(__linux__)
+    ThreadCounters& thread = t_counters;
+
+    if(!thread.tried) {
+        thread.tried = true;
+
+        thread.fds[Cycles] = openCounter(kCounterConfigs[Cycles], -1);
+        if(thread.fds[Cycles] < 0) {
+            int error = errno;
+            std::lock_guard<std::mutex> lock(s_mutex);
+            if(!s_failed) {
+                s_error = std::string("perf_event_open failed: ") + std::strerror(error);
+                if(error == EACCES || error == EPERM) s_error += " (check /proc/sys/kernel/perf_event_paranoid)";
+                std::cerr << "ERROR::PERF:: " << s_error << std::endl;
+            }
+            s_failed = true;
+            return false;
+        }
+        thread.slots[Cycles] = thread.opened++;
+
+        // a counter the cpu (or the vm) doesn't have stays at zero instead of losing the whole group
+        for(int i = Cycles + 1; i < kCounterCount; i++) {
+            thread.fds[i] = openCounter(kCounterConfigs[i], thread.fds[Cycles]);
+            if(thread.fds[i] < 0) {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                if(s_error.find(kCounterNames[i]) == std::string::npos) {
+                    if(!s_error.empty()) s_error += ", ";
+                    s_error += std::string("no ") + kCounterNames[i] + " counter";
+                    std::cout << "[Debug] perf counters: " << kCounterNames[i] << " not supported here" << std::endl;
+                }
+                continue;
+            }
+            thread.slots[i] = thread.opened++;
+        }
+    }
+    if(thread.fds[Cycles] < 0) return false;
+
+    // nr, time enabled, time running, then one value per opened counter
+    uint64_t buffer[3 + kCounterCount];
+    ssize_t expected = static_cast<ssize_t>((3 + thread.opened) * sizeof(uint64_t));
+    if(read(thread.fds[Cycles], buffer, sizeof(buffer)) < expected) return false;
+
+    // scaled up if the kernel had to multiplex the group with someone else's counters
+    double scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / buffer[2] : 1.0;
+    for(int i = 0; i < kCounterCount; i++) {
+        values[i] = thread.slots[i] >= 0 ? static_cast<uint64_t>(buffer[3 + thread.slots[i]] * scale) : 0;
+    }
+    return true;
+#else
+    (void)values;
+    if(!s_failed.exchange(true)) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_error = "perf counters need Linux";
+    }
+    return false;
+#endif
+}
+
+void PerfCounters::record(const char* name, const uint64_t start[kCounterCount], const uint64_t end[kCounterCount]) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    Sample& frame = s_frame[name];
+    Sample& total = s_totals[name];
+    frame.calls++;
+    total.calls++;
+    for(int i = 0; i < kCounterCount; i++) {
+        // a multiplexed estimate can step back a little
+        uint64_t delta = end[i] > start[i] ? end[i] - start[i] : 0;
+        frame.counters[i] += delta;
+        total.counters[i] += delta;
+    }
+}
+
+void PerfCounters::endFrame() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_lastFrame.swap(s_frame);
+    s_frame.clear();
+}
+
+std::vector<PerfCounters::ScopeStats> PerfCounters::getLastFrame() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return toStats(s_lastFrame);
+}
+
+std::vector<PerfCounters::ScopeStats> PerfCounters::getTotals() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return toStats(s_totals);
+}
+
+void PerfCounters::resetTotals() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_totals.clear();
+}
+
+// most cycles first
+std::vector<PerfCounters::ScopeStats> PerfCounters::toStats(const std::map<std::string, Sample>& samples) {
+    std::vector<ScopeStats> stats;
+    stats.reserve(samples.size());
+    for(const auto& entry : samples) {
+        ScopeStats scope;
+        scope.name = entry.first;
+        scope.calls = entry.second.calls;
+        std::copy(entry.second.counters, entry.second.counters + kCounterCount, scope.counters);
+        stats.push_back(std::move(scope));
+    }
+    std::sort(stats.begin(), stats.end(), [](const ScopeStats& a, const ScopeStats& b) {
+        return a.counters[Cycles] > b.counters[Cycles];
+    });
+    return stats;
+}
+
+std::string PerfCounters::getReport() {
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << "perf counter report\n";
+    std::string error = getError();
+    if(!error.empty()) report << "note: " << error << "\n";
+
+    report << "\n" << std::left << std::setw(24) << "scope" << std::right
+           << std::setw(10) << "calls" << std::setw(14) << "Mcycles" << std::setw(14) << "Minstr"
+           << std::setw(8) << "IPC" << std::setw(10) << "L1 MPKI" << std::setw(10) << "LLC MPKI" << std::setw(10) << "br MPKI" << "\n";
+
+    for(const ScopeStats& scope : getTotals()) {
+        report << std::left << std::setw(24) << scope.name << std::right
+               << std::setw(10) << scope.calls
+               << std::setw(14) << scope.counters[Cycles] / 1e6
+               << std::setw(14) << scope.counters[Instructions] / 1e6
+               << std::setw(8) << scope.getIpc()
+               << std::setw(10) << scope.getMpki(L1Misses)
+               << std::setw(10) << scope.getMpki(LlcMisses)
+               << std::setw(10) << scope.getMpki(BranchMisses) << "\n";
+    }
+
+    return report.str();
+}
+
+bool PerfCounters::writeReport(const std::string& path) {
+    std::ofstream file(path);
+    if(!file) {
+        std::cerr << "ERROR::PERF:: could not write " << path << std::endl;
+        return false;
+    }
+
+    file << getReport();
+    std::cout << "[Debug] Perf counter report written to " << path << std::endl;
+    return true;
+}
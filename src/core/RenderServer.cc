@@ -0,0 +1,580 @@
+#include "core/RenderServer.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "stb_image_write.h"
+
+#include "core/JobSystem.h"
+#include "core/VirtualFileSystem.h"
+#include "renderer/GLState.h"
+#include "renderer/Renderer.h"
+#include "renderer/TextureStreamer.h"
+#include "scene/Camera.h"
+
+// scenes kept loaded at once, the least recently rendered one goes first
+static const size_t kMaxCachedScenes = 8;
+static const int kMaxImageSize = 8192;
+// a freshly loaded scene is redrawn until its textures have streamed in, or this long
+static const double kStreamInTimeout = 2.0;
+// a client that sends this much without a newline is cut off instead of buffered forever
+static const size_t kMaxRequestLine = 64 * 1024;
+
+// only ever removes a socket, a mistyped path mustn't take someone's file with it.
+// false if something else is in the way
+static bool removeStaleSocket(const std::string& path) {
+    struct stat info;
+    if(lstat(path.c_str(), &info) < 0) return errno == ENOENT;
+    if(!S_ISSOCK(info.st_mode)) return false;
+    return unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+// out= stays inside the output folder: relative, and no .. anywhere
+static bool isSafeOutputPath(const std::string& path) {
+    std::filesystem::path output(path);
+    if(output.empty() || output.is_absolute() || output.has_root_name() || output.has_root_directory()) return false;
+    for(const auto& part : output) {
+        if(part == "..") return false;
+    }
+    return true;
+}
+
+RenderServer::Connection::~Connection() {
+    if(fd >= 0) close(fd);
+}
+
+bool RenderServer::Connection::send(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while(size > 0) {
+        // no SIGPIPE when the client has gone away, the write just fails
+        ssize_t written = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool RenderServer::Connection::sendLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return send(line.data(), line.size());
+}
+
+RenderServer::RenderServer(const std::string& socketPath, const std::string& outputDir)
+    : m_socketPath(socketPath)
+    , m_outputDir(outputDir)
+{
+    m_window = std::make_unique<Window>(64, 64, "Render Server", false);
+    glfwMakeContextCurrent(m_window->getNativeWindow());
+
+    if(!gladLoadGL(glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+    }
+
+    // the same startup Application does, paid once for the daemon's whole life
+    if(VirtualFileSystem::exists(VirtualFileSystem::kAssetPack)) VirtualFileSystem::mount(VirtualFileSystem::kAssetPack);
+    JobSystem::init();
+    Renderer::init();
+    TextureStreamer::init();
+}
+
+RenderServer::~RenderServer() {
+    stop();
+
+    for(auto& readback : m_readbacks) {
+        if(!readback.fence) continue;
+        glDeleteSync(readback.fence);
+        m_freePbos.push_back(readback.pbo);
+    }
+    m_readbacks.clear();
+    if(!m_freePbos.empty()) {
+        glDeleteBuffers(static_cast<GLsizei>(m_freePbos.size()), m_freePbos.data());
+    }
+
+    m_scenes.clear();
+    TextureStreamer::shutdown();
+    Renderer::shutdown();
+    JobSystem::shutdown();
+}
+
+bool RenderServer::listen() {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(m_socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ERROR::RENDER_SERVER:: socket path too long: " << m_socketPath << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, m_socketPath.c_str());
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_listenFd < 0) {
+        std::cerr << "ERROR::RENDER_SERVER:: socket failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // a stale socket file from a daemon that didn't shut down cleanly
+    if(!removeStaleSocket(m_socketPath)) {
+        std::cerr << "ERROR::RENDER_SERVER:: " << m_socketPath << " exists and is not a socket, not replacing it" << std::endl;
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    if(bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || ::listen(m_listenFd, 16) < 0) {
+        std::cerr << "ERROR::RENDER_SERVER:: could not listen on " << m_socketPath << ": " << std::strerror(errno) << std::endl;
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    std::cout << "[Debug] Render server listening on " << m_socketPath << std::endl;
+    return true;
+}
+
+void RenderServer::run() {
+    if(!listen()) return;
+
+    m_running = true;
+    m_encoding = true;
+    m_acceptThread = std::thread(&RenderServer::acceptLoop, this);
+    m_encodeThread = std::thread(&RenderServer::encodeLoop, this);
+
+    while(m_running) {
+        Request request;
+        bool haveRequest = false;
+        {
+            // with nothing in flight there is nothing to do until a request comes in
+            std::unique_lock<std::mutex> lock(m_requestMutex);
+            auto timeout = m_readbacks.empty() ? std::chrono::milliseconds(100) : std::chrono::milliseconds(0);
+            m_requestCondition.wait_for(lock, timeout, [this] { return !m_requests.empty() || !m_running; });
+            if(!m_requests.empty()) {
+                request = std::move(m_requests.front());
+                m_requests.pop_front();
+                haveRequest = true;
+            }
+        }
+
+        if(haveRequest) {
+            render(request);
+        }
+
+        // the previous request's pixels are usually ready by the time the next one is drawn,
+        // only wait on them when there is no other work
+        collectReadbacks(!haveRequest);
+        glfwPollEvents();
+    }
+
+    collectReadbacks(true);
+    stop();
+}
+
+void RenderServer::stop() {
+    m_running = false;
+
+    if(m_listenFd >= 0) {
+        // wakes accept() up
+        shutdown(m_listenFd, SHUT_RDWR);
+        close(m_listenFd);
+        m_listenFd = -1;
+        removeStaleSocket(m_socketPath);
+    }
+    if(m_acceptThread.joinable()) m_acceptThread.join();
+
+    {
+        // unblocks the clients' recv(), replies can still go out
+        std::unique_lock<std::mutex> lock(m_clientMutex);
+        for(auto& weak : m_connections) {
+            if(auto connection = weak.lock()) shutdown(connection->fd, SHUT_RD);
+        }
+        m_clientsDone.wait(lock, [this] { return m_activeClients == 0; });
+        m_connections.clear();
+    }
+
+    {
+        // nothing reads requests any more, whatever didn't get rendered is still answered, after
+        // the replies already on their way to the encoder
+        std::lock_guard<std::mutex> requestLock(m_requestMutex);
+        std::lock_guard<std::mutex> encodeLock(m_encodeMutex);
+        for(Request& request : m_requests) {
+            EncodeJob job;
+            job.request = std::move(request);
+            if(job.request.error.empty()) job.request.error = "shutting down";
+            m_encodeJobs.push_back(std::move(job));
+        }
+        m_requests.clear();
+
+        // only now, the encoder finishes every readback the last collectReadbacks handed it
+        m_encoding = false;
+    }
+    m_encodeCondition.notify_all();
+    if(m_encodeThread.joinable()) m_encodeThread.join();
+}
+
+void RenderServer::acceptLoop() {
+    while(m_running) {
+        int fd = accept(m_listenFd, nullptr, nullptr);
+        if(fd < 0) {
+            if(errno == EINTR) continue;
+            break; // listening socket closed
+        }
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+
+        std::lock_guard<std::mutex> lock(m_clientMutex);
+        m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(),
+            [](const std::weak_ptr<Connection>& weak) { return weak.expired(); }), m_connections.end());
+        m_connections.push_back(connection);
+        m_activeClients++;
+        std::thread(&RenderServer::clientLoop, this, std::move(connection)).detach();
+    }
+}
+
+void RenderServer::clientLoop(std::shared_ptr<Connection> connection) {
+    readRequests(connection);
+    connection.reset();
+
+    // the last thing this thread does with the server
+    std::lock_guard<std::mutex> lock(m_clientMutex);
+    m_activeClients--;
+    m_clientsDone.notify_all();
+}
+
+void RenderServer::readRequests(const std::shared_ptr<Connection>& connection) {
+    std::string buffer;
+    char chunk[4096];
+
+    while(m_running) {
+        ssize_t received = recv(connection->fd, chunk, sizeof(chunk), 0);
+        if(received < 0 && errno == EINTR) continue;
+        if(received <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(received));
+
+        // requests are queued as soon as their line is complete, the client doesn't wait for replies
+        size_t lineStart = 0;
+        size_t lineEnd;
+        while((lineEnd = buffer.find('\n', lineStart)) != std::string::npos) {
+            std::string line = buffer.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+            if(!line.empty() && line.back() == '\r') line.pop_back();
+            if(line.empty()) continue;
+
+            if(line == "shutdown") {
+                m_running = false;
+                m_requestCondition.notify_all();
+                connection->sendLine("ok shutdown\n");
+                return;
+            }
+
+            // bad requests still take their turn so the replies stay in order
+            Request request;
+            request.client = connection;
+            if(!parseRequest(line, request, request.error) && request.id.empty()) {
+                request.id = "-";
+            }
+            pushRequest(std::move(request));
+        }
+        buffer.erase(0, lineStart);
+
+        // queued like any other bad request so the replies before it still come first
+        if(buffer.size() > kMaxRequestLine) {
+            Request request;
+            request.client = connection;
+            request.id = "-";
+            request.error = "request line too long";
+            pushRequest(std::move(request));
+            return;
+        }
+    }
+}
+
+bool RenderServer::parseRequest(const std::string& line, Request& request, std::string& error) {
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+
+    std::string token;
+    while(tokens >> token) {
+        size_t equals = token.find('=');
+        if(equals == std::string::npos) {
+            error = "expected key=value, got " + token;
+            return false;
+        }
+        std::string key = token.substr(0, equals);
+        std::string value = token.substr(equals + 1);
+
+        if(key == "id") {
+            request.id = value;
+        } else if(key == "scene") {
+            request.scene = value;
+        } else if(key == "camera") {
+            glm::vec3& p = request.position;
+            if(std::sscanf(value.c_str(), "%f,%f,%f,%f,%f,%f", &p.x, &p.y, &p.z, &request.yaw, &request.pitch, &request.zoom) < 3) {
+                error = "bad camera " + value;
+                return false;
+            }
+        } else if(key == "size") {
+            if(std::sscanf(value.c_str(), "%dx%d", &request.width, &request.height) != 2
+                || request.width <= 0 || request.height <= 0 || request.width > kMaxImageSize || request.height > kMaxImageSize) {
+                error = "bad size " + value;
+                return false;
+            }
+        } else if(key == "format") {
+            if(value == "png") request.format = ImageFormat::Png;
+            else if(value == "raw") request.format = ImageFormat::Raw;
+            else {
+                error = "unknown format " + value;
+                return false;
+            }
+        } else if(key == "out") {
+            if(!isSafeOutputPath(value)) {
+                error = "out must be a relative path without .., got " + value;
+                return false;
+            }
+            request.output = value;
+        } else {
+            error = "unknown key " + key;
+            return false;
+        }
+    }
+
+    if(command != "render") {
+        error = "unknown command " + command;
+        return false;
+    }
+    if(request.scene.empty()) {
+        error = "missing scene";
+        return false;
+    }
+    if(request.id.empty()) request.id = "-";
+    return true;
+}
+
+void RenderServer::pushRequest(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requests.push_back(std::move(request));
+    }
+    m_requestCondition.notify_one();
+}
+
+Scene* RenderServer::getScene(const std::string& spec, const Request& request) {
+    auto cached = m_scenes.find(spec);
+    if(cached != m_scenes.end()) {
+        cached->second.lastUsed = m_renderCount;
+        return cached->second.scene.get();
+    }
+
+    if(m_scenes.size() >= kMaxCachedScenes) {
+        auto oldest = m_scenes.begin();
+        for(auto it = m_scenes.begin(); it != m_scenes.end(); ++it) {
+            if(it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        // the models give their textures back to the streamer as they go, a file another
+        // cached scene still uses stays resident
+        std::string evicted = oldest->first;
+        m_scenes.erase(oldest);
+        std::cout << "[Debug] Evicted scene " << evicted << ", " << TextureStreamer::getTextureCount() << " textures and "
+                  << TextureStreamer::getResidentBytes() / 1024 << " KiB still streamed" << std::endl;
+    }
+
+    auto scene = std::make_unique<Scene>();
+    std::stringstream paths(spec);
+    std::string path;
+    while(std::getline(paths, path, ',')) {
+        if(path.empty()) continue;
+        auto model = std::make_unique<Model>(path);
+        if(model->m_meshes.empty()) return nullptr;
+        scene->addModel(std::move(model));
+    }
+
+    // draw it until the streamer has brought the textures in, so the first image isn't blurry
+    double start = glfwGetTime();
+    do {
+        drawScene(*scene, request);
+        TextureStreamer::update();
+        glFinish();
+    } while(TextureStreamer::getPendingJobs() > 0 && glfwGetTime() - start < kStreamInTimeout);
+
+    CachedScene& entry = m_scenes[spec];
+    entry.scene = std::move(scene);
+    entry.lastUsed = m_renderCount;
+    std::cout << "[Debug] Render server loaded scene " << spec << " in " << (glfwGetTime() - start) << " s" << std::endl;
+    return entry.scene.get();
+}
+
+void RenderServer::drawScene(Scene& scene, const Request& request) {
+    Camera camera(request.position, glm::vec3(0.0f, 1.0f, 0.0f), request.yaw, request.pitch);
+    camera.m_zoom = request.zoom;
+
+    glm::mat4 view = camera.getViewMatrix();
+    glm::mat4 projection = camera.getProjectionMatrix(static_cast<float>(request.width) / request.height);
+
+    Renderer::beginFrame(request.width, request.height, 1.0f);
+    Renderer::renderScene(scene.getModels(), scene.getLights(), view, projection, false);
+}
+
+void RenderServer::render(const Request& request) {
+    m_renderCount++;
+
+    Scene* scene = request.error.empty() ? getScene(request.scene, request) : nullptr;
+    if(!scene) {
+        Readback failed;
+        failed.request = request;
+        if(failed.request.error.empty()) failed.request.error = "could not load " + request.scene;
+        m_readbacks.push_back(std::move(failed));
+        return;
+    }
+
+    drawScene(*scene, request);
+    TextureStreamer::update();
+
+    // the frame stays in the scene target, read it into a pixel buffer without waiting
+    GLuint pbo;
+    if(m_freePbos.empty()) {
+        glGenBuffers(1, &pbo);
+    } else {
+        pbo = m_freePbos.back();
+        m_freePbos.pop_back();
+    }
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(request.width) * request.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+
+    GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, Renderer::getSceneTarget()->getFramebuffer());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    m_readbacks.push_back({ request, pbo, fence });
+}
+
+void RenderServer::collectReadbacks(bool wait) {
+    while(!m_readbacks.empty()) {
+        Readback& readback = m_readbacks.front();
+        EncodeJob job;
+
+        if(readback.fence) {
+            GLuint64 timeout = wait ? 1000000000ull : 0;
+            GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                if(!wait) return;
+                continue; // a timeout, keep waiting
+            }
+
+            size_t size = static_cast<size_t>(readback.request.width) * readback.request.height * 4;
+            job.pixels.resize(size);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+            if(void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT)) {
+                std::memcpy(job.pixels.data(), mapped, size);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            } else {
+                // replying ok with whatever the vector holds would pass garbage off as the image
+                readback.request.error = "readback failed";
+                job.pixels.clear();
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            glDeleteSync(readback.fence);
+            m_freePbos.push_back(readback.pbo);
+        }
+
+        job.request = std::move(readback.request);
+        m_readbacks.pop_front();
+
+        {
+            std::lock_guard<std::mutex> lock(m_encodeMutex);
+            m_encodeJobs.push_back(std::move(job));
+        }
+        m_encodeCondition.notify_one();
+    }
+}
+
+void RenderServer::encodeLoop() {
+    while(true) {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_encodeMutex);
+            m_encodeCondition.wait(lock, [this] { return !m_encodeJobs.empty() || !m_encoding; });
+            if(m_encodeJobs.empty()) return; // stopped and drained
+            job = std::move(m_encodeJobs.front());
+            m_encodeJobs.pop_front();
+        }
+        finishJob(job);
+    }
+}
+
+static void appendToVector(void* context, void* data, int size) {
+    auto* out = static_cast<std::vector<unsigned char>*>(context);
+    auto* bytes = static_cast<unsigned char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+void RenderServer::finishJob(EncodeJob& job) {
+    const Request& request = job.request;
+    if(!request.error.empty()) {
+        request.client->sendLine("error " + request.id + " " + request.error + "\n");
+        return;
+    }
+
+    int width = request.width;
+    int height = request.height;
+    size_t stride = static_cast<size_t>(width) * 4;
+
+    // GL rows start at the bottom, images at the top
+    std::vector<unsigned char> row(stride);
+    for(int y = 0; y < height / 2; y++) {
+        unsigned char* top = job.pixels.data() + y * stride;
+        unsigned char* bottom = job.pixels.data() + (height - 1 - y) * stride;
+        std::memcpy(row.data(), top, stride);
+        std::memcpy(top, bottom, stride);
+        std::memcpy(bottom, row.data(), stride);
+    }
+
+    std::vector<unsigned char> encoded;
+    const std::vector<unsigned char>* payload = &job.pixels;
+    if(request.format == ImageFormat::Png) {
+        encoded.reserve(job.pixels.size() / 2);
+        if(!stbi_write_png_to_func(appendToVector, &encoded, width, height, 4, job.pixels.data(), static_cast<int>(stride))) {
+            request.client->sendLine("error " + request.id + " png encoding failed\n");
+            return;
+        }
+        payload = &encoded;
+    }
+
+    if(!request.output.empty()) {
+        std::filesystem::path outputPath = std::filesystem::path(m_outputDir) / request.output;
+        std::error_code error;
+        if(outputPath.has_parent_path()) std::filesystem::create_directories(outputPath.parent_path(), error);
+        std::ofstream file(outputPath, std::ios::binary);
+        if(!file.write(reinterpret_cast<const char*>(payload->data()), static_cast<std::streamsize>(payload->size()))) {
+            request.client->sendLine("error " + request.id + " could not write " + request.output + "\n");
+            return;
+        }
+        request.client->sendLine("ok " + request.id + " " + request.output + "\n");
+        return;
+    }
+
+    // header and payload under one lock so pipelined replies never interleave
+    std::string header = "ok " + request.id + " " + (request.format == ImageFormat::Png ? "png " : "raw ")
+        + std::to_string(width) + " " + std::to_string(height) + " " + std::to_string(payload->size()) + "\n";
+    std::lock_guard<std::mutex> lock(request.client->writeMutex);
+    request.client->send(header.data(), header.size()) && request.client->send(payload->data(), payload->size());
+}
@@ -0,0 +1,213 @@
+#include "core/VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "core/Lz4.h"
+
+std::vector<std::unique_ptr<VirtualFileSystem::Pack>> VirtualFileSystem::s_packs;
+
+FileData::FileData(FileData&& other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_loose(std::move(other.m_loose))
+    , m_decoded(std::move(other.m_decoded))
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+FileData& FileData::operator=(FileData&& other) noexcept {
+    if(this == &other) return *this;
+
+    // a moved vector keeps its buffer and a moved mapping its address, so m_data stays valid
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_loose = std::move(other.m_loose);
+    m_decoded = std::move(other.m_decoded);
+    other.m_data = nullptr;
+    other.m_size = 0;
+    return *this;
+}
+
+bool FileData::isValid() const {
+    return m_data != nullptr;
+}
+
+const char* FileData::data() const {
+    return m_data;
+}
+
+size_t FileData::size() const {
+    return m_size;
+}
+
+void FileData::adviseSequential() const {
+    // packed entries are a slice of the pack, decoded ones are already in memory
+    m_loose.adviseSequential();
+}
+
+FileReader::FileReader(const FileData& file)
+    : m_cursor(file.data())
+    , m_end(file.data() + file.size())
+    , m_failed(!file.isValid())
+{
+}
+
+bool FileReader::read(void* dst, size_t size) {
+    if(m_failed || size > static_cast<size_t>(m_end - m_cursor)) {
+        m_failed = true;
+        return false;
+    }
+    if(size > 0) std::memcpy(dst, m_cursor, size);
+    m_cursor += size;
+    return true;
+}
+
+FileReader::operator bool() const {
+    return !m_failed;
+}
+
+bool VirtualFileSystem::mount(const std::string& packPath) {
+    auto pack = std::make_unique<Pack>();
+    pack->path = packPath;
+    if(!pack->file.open(packPath)) return false;
+
+    const char* base = pack->file.data();
+    size_t size = pack->file.size();
+
+    if(size < sizeof(PackHeader)) {
+        std::cerr << "ERROR::VFS:: " << packPath << " is too small to be a pack" << std::endl;
+        return false;
+    }
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(base);
+    if(std::memcmp(header->magic, kPackMagic, sizeof(kPackMagic)) != 0 || header->version != kPackVersion) {
+        std::cerr << "ERROR::VFS:: " << packPath << " is not a version " << kPackVersion << " pack" << std::endl;
+        return false;
+    }
+
+    uint64_t entriesSize = static_cast<uint64_t>(header->entryCount) * sizeof(PackEntry);
+    if(header->entriesOffset % alignof(PackEntry) != 0 || header->entriesOffset > size || entriesSize > size - header->entriesOffset ||
+       header->namesOffset > size || header->namesSize > size - header->namesOffset) {
+        std::cerr << "ERROR::VFS:: " << packPath << " has a directory outside the file" << std::endl;
+        return false;
+    }
+
+    pack->entries = reinterpret_cast<const PackEntry*>(base + header->entriesOffset);
+    pack->entryCount = header->entryCount;
+    pack->names = base + header->namesOffset;
+    pack->namesSize = static_cast<size_t>(header->namesSize);
+
+    // checked once here so a read only has to trust the directory
+    for(uint32_t i = 0; i < pack->entryCount; i++) {
+        const PackEntry& entry = pack->entries[i];
+        bool compressed = (entry.flags & kPackCompressed) != 0;
+        if(entry.offset > size || entry.storedSize > size - entry.offset || entry.nameOffset >= pack->namesSize ||
+           (!compressed && entry.storedSize != entry.size) ||
+           std::memchr(pack->names + entry.nameOffset, '\0', pack->namesSize - entry.nameOffset) == nullptr ||
+           (i > 0 && pack->entries[i - 1].pathHash > entry.pathHash)) {
+            std::cerr << "ERROR::VFS:: " << packPath << " has a broken entry " << i << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "[Debug] Mounted " << packPath << " (" << pack->entryCount << " files, "
+              << size / (1024 * 1024) << " MiB)" << std::endl;
+    s_packs.push_back(std::move(pack));
+    return true;
+}
+
+void VirtualFileSystem::unmountAll() {
+    s_packs.clear();
+}
+
+const PackEntry* VirtualFileSystem::find(const std::string& path, const Pack** pack) {
+    if(s_packs.empty()) return nullptr;
+
+    std::string normalized = normalizePackPath(path);
+    uint64_t hash = hashPackBytes(normalized.data(), normalized.size());
+
+    // the last mount wins, so a patch pack can override files of the base one
+    for(auto it = s_packs.rbegin(); it != s_packs.rend(); ++it) {
+        const Pack& candidate = **it;
+        const PackEntry* end = candidate.entries + candidate.entryCount;
+        const PackEntry* entry = std::lower_bound(candidate.entries, end, hash, [](const PackEntry& e, uint64_t h) {
+            return e.pathHash < h;
+        });
+        // the packer refuses colliding paths, the name check is for paths that aren't packed at all
+        if(entry != end && entry->pathHash == hash && normalized == candidate.names + entry->nameOffset) {
+            *pack = &candidate;
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+FileData VirtualFileSystem::read(const std::string& path) {
+    FileData file;
+
+    const Pack* pack = nullptr;
+    if(const PackEntry* entry = find(path, &pack)) {
+        const char* stored = pack->file.data() + entry->offset;
+        if(!(entry->flags & kPackCompressed)) {
+            file.m_data = stored;
+            file.m_size = static_cast<size_t>(entry->size);
+            return file;
+        }
+
+        file.m_decoded.resize(static_cast<size_t>(entry->size));
+        if(!Lz4::decompress(stored, static_cast<size_t>(entry->storedSize), file.m_decoded.data(), file.m_decoded.size())) {
+            std::cerr << "ERROR::VFS:: " << path << " is corrupt in " << pack->path << std::endl;
+            return FileData();
+        }
+        file.m_data = file.m_decoded.data();
+        file.m_size = file.m_decoded.size();
+        return file;
+    }
+
+    // not packed, the loose file if there is one
+    std::error_code error;
+    if(!std::filesystem::is_regular_file(path, error)) {
+        std::cerr << "ERROR::VFS:: " << path << " not found" << std::endl;
+        return file;
+    }
+    if(!file.m_loose.open(path)) return file;
+    file.m_data = file.m_loose.data();
+    file.m_size = file.m_loose.size();
+    return file;
+}
+
+bool VirtualFileSystem::exists(const std::string& path) {
+    const Pack* pack = nullptr;
+    if(find(path, &pack)) return true;
+
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+uint64_t VirtualFileSystem::getFileStamp(const std::string& path) {
+    const Pack* pack = nullptr;
+    if(const PackEntry* entry = find(path, &pack)) return entry->contentHash;
+
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if(error) return 0;
+    auto time = std::filesystem::last_write_time(path, error);
+    if(error) return 0;
+
+    uint64_t stamp = hashPackBytes(&size, sizeof(size));
+    auto ticks = time.time_since_epoch().count();
+    return hashPackBytes(&ticks, sizeof(ticks), stamp);
+}
+
+size_t VirtualFileSystem::getPackCount() {
+    return s_packs.size();
+}
+
+size_t VirtualFileSystem::getPackedFileCount() {
+    size_t count = 0;
+    for(const auto& pack : s_packs) count += pack->entryCount;
+    return count;
+}
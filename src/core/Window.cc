@@ -1,11 +1,12 @@
 #include "core/Window.h"
 
-Window::Window(int width, int height, const std::string& title) {
+Window::Window(int width, int height, const std::string& title, bool visible) {
     if(!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return;
     }
 
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
     m_window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
     if(!m_window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
@@ -2,6 +2,7 @@
 
 void ImguiLayer::init(GLFWwindow* window) {
     IMGUI_CHECKVERSION();
+    MemoryTracker::installImguiAllocator(); // counts imgui's heap under the UI tag
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
 
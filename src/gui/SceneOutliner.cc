@@ -0,0 +1,240 @@
+#include "gui/SceneOutliner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+static std::string toLower(const std::string& text) {
+    std::string lower = text;
+    for(auto& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return lower;
+}
+
+static inline uint32_t getTrigram(const std::string& text, size_t at) {
+    return static_cast<uint8_t>(text[at])
+        | (static_cast<uint32_t>(static_cast<uint8_t>(text[at + 1])) << 8)
+        | (static_cast<uint32_t>(static_cast<uint8_t>(text[at + 2])) << 16);
+}
+
+void SceneOutliner::draw(Scene& scene) {
+    if(scene.getHierarchyVersion() != m_sceneVersion) {
+        rebuild(scene);
+    }
+
+    if(m_nodes.empty()) {
+        ImGui::Text("Scene is empty. Load a model to begin.");
+        return;
+    }
+
+    if(ImGui::InputTextWithHint("##OutlinerSearch", "Search...", m_filterText, sizeof(m_filterText))) {
+        updateFilter(toLower(m_filterText));
+    }
+
+    if(m_rowsDirty) {
+        rebuildRows();
+    }
+    ImGui::Text("%zu objects, %zu listed", m_nodes.size(), m_rows.size());
+
+    // a removed model's handle resolves to nothing
+    if(Model* selected = scene.getModel(m_selected)) {
+        ImGui::Text("Selected: %s", m_selectedName.c_str());
+        ImGui::DragFloat3("Position", &selected->m_position.x, 0.1f);
+    }
+
+    // every row is one frame high, so the clipper can work out what is on screen
+    ImGui::BeginChild("OutlinerRows", ImVec2(0.0f, 300.0f), true);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(m_rows.size()), ImGui::GetFrameHeightWithSpacing());
+    while(clipper.Step()) {
+        for(int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            drawRow(m_rows[row]);
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+}
+
+void SceneOutliner::drawRow(int nodeIndex) {
+    const Node& node = m_nodes[nodeIndex];
+
+    ImGui::PushID(nodeIndex);
+    float indent = node.depth * ImGui::GetTreeNodeToLabelSpacing();
+    if(indent > 0.0f) ImGui::Indent(indent);
+
+    if(node.mesh < 0) {
+        bool filtering = !m_filter.empty();
+
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth
+            | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_FramePadding;
+        if(node.subtreeEnd == nodeIndex + 1) flags |= ImGuiTreeNodeFlags_Leaf;
+        if(node.model->getHandle() == m_selected) flags |= ImGuiTreeNodeFlags_Selected;
+
+        // search results are always listed fully expanded
+        ImGui::SetNextItemOpen(filtering || m_expanded[nodeIndex] != 0);
+        bool open = ImGui::TreeNodeEx(node.model, flags, "%s", node.name.c_str());
+
+        if(ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen()) {
+            m_selected = node.model->getHandle();
+            m_selectedName = node.name;
+        }
+        if(!filtering && open != (m_expanded[nodeIndex] != 0)) {
+            m_expanded[nodeIndex] = open;
+            m_rowsDirty = true;
+        }
+    } else {
+        ImGui::Checkbox(node.name.c_str(), &node.model->m_meshes[node.mesh].m_isVisible);
+    }
+
+    if(indent > 0.0f) ImGui::Unindent(indent);
+    ImGui::PopID();
+}
+
+void SceneOutliner::rebuild(Scene& scene) {
+    m_sceneVersion = scene.getHierarchyVersion();
+
+    // expansion follows the models across rebuilds
+    std::unordered_set<const Model*> expanded;
+    for(size_t i = 0; i < m_nodes.size(); i++) {
+        if(m_nodes[i].mesh < 0 && m_expanded[i]) expanded.insert(m_nodes[i].model);
+    }
+
+    m_nodes.clear();
+    m_trigrams.clear();
+
+    struct Pending {
+        Model* model;
+        int mesh;
+        int parent;
+        int depth;
+    };
+
+    auto& models = scene.getModels();
+    std::vector<Pending> stack;
+    for(size_t i = models.size(); i-- > 0;) {
+        if(!models[i]->getParent()) stack.push_back({ models[i].get(), -1, -1, 0 });
+    }
+
+    // pre-order walk, subtree ends are filled in as the walk leaves each node
+    std::unordered_set<const Model*> visited;
+    std::vector<int> open;
+    while(!stack.empty()) {
+        Pending pending = stack.back();
+        stack.pop_back();
+        if(pending.mesh < 0 && !visited.insert(pending.model).second) continue;
+
+        int index = static_cast<int>(m_nodes.size());
+        while(!open.empty() && m_nodes[open.back()].depth >= pending.depth) {
+            m_nodes[open.back()].subtreeEnd = index;
+            open.pop_back();
+        }
+
+        Node node;
+        node.model = pending.model;
+        node.mesh = pending.mesh;
+        node.parent = pending.parent;
+        node.depth = pending.depth;
+        node.subtreeEnd = index + 1;
+        node.name = pending.mesh < 0 ? pending.model->getName() : pending.model->m_meshes[pending.mesh].m_name;
+        node.lowerName = toLower(node.name);
+        m_nodes.push_back(node);
+        open.push_back(index);
+
+        if(pending.mesh < 0) {
+            // child models list before the model's own meshes
+            const auto& meshes = pending.model->m_meshes;
+            for(size_t m = meshes.size(); m-- > 0;) {
+                stack.push_back({ pending.model, static_cast<int>(m), index, pending.depth + 1 });
+            }
+            const auto& children = pending.model->m_children;
+            for(size_t c = children.size(); c-- > 0;) {
+                if(Model* child = scene.getModel(children[c])) stack.push_back({ child, -1, index, pending.depth + 1 });
+            }
+        }
+    }
+    for(int index : open) {
+        m_nodes[index].subtreeEnd = static_cast<int>(m_nodes.size());
+    }
+
+    m_expanded.assign(m_nodes.size(), 0);
+    for(size_t i = 0; i < m_nodes.size(); i++) {
+        const Node& node = m_nodes[i];
+        if(node.mesh < 0) {
+            m_expanded[i] = expanded.count(node.model) ? 1 : 0;
+        }
+
+        for(size_t at = 0; at + 3 <= node.lowerName.size(); at++) {
+            std::vector<int>& postings = m_trigrams[getTrigram(node.lowerName, at)];
+            if(postings.empty() || postings.back() != static_cast<int>(i)) {
+                postings.push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    // the old matches point at the old nodes
+    m_filter.clear();
+    m_matches.clear();
+    updateFilter(toLower(m_filterText));
+    m_rowsDirty = true;
+}
+
+void SceneOutliner::updateFilter(const std::string& filter) {
+    if(filter == m_filter) return;
+
+    // typing more characters can only remove matches
+    bool narrowing = !m_filter.empty() && filter.compare(0, m_filter.size(), m_filter) == 0;
+    std::vector<int> candidates;
+
+    if(filter.size() >= 3) {
+        // every match contains every trigram of the query, so the rarest one bounds the candidates
+        static const std::vector<int> kNone;
+        const std::vector<int>* rarest = nullptr;
+        for(size_t at = 0; at + 3 <= filter.size(); at++) {
+            auto found = m_trigrams.find(getTrigram(filter, at));
+            if(found == m_trigrams.end()) {
+                rarest = &kNone;
+                break;
+            }
+            if(!rarest || found->second.size() < rarest->size()) rarest = &found->second;
+        }
+        candidates = (narrowing && m_matches.size() < rarest->size()) ? m_matches : *rarest;
+    } else if(narrowing) {
+        candidates = m_matches;
+    } else if(!filter.empty()) {
+        candidates.resize(m_nodes.size());
+        for(size_t i = 0; i < m_nodes.size(); i++) candidates[i] = static_cast<int>(i);
+    }
+
+    m_matches.clear();
+    for(int node : candidates) {
+        if(m_nodes[node].lowerName.find(filter) != std::string::npos) m_matches.push_back(node);
+    }
+
+    // matches keep their ancestors listed so the results still read as a tree
+    m_filterShown.assign(m_nodes.size(), 0);
+    for(int node : m_matches) {
+        for(int n = node; n >= 0 && !m_filterShown[n]; n = m_nodes[n].parent) {
+            m_filterShown[n] = 1;
+        }
+    }
+
+    m_filter = filter;
+    m_rowsDirty = true;
+}
+
+void SceneOutliner::rebuildRows() {
+    m_rows.clear();
+
+    if(!m_filter.empty()) {
+        for(size_t i = 0; i < m_nodes.size(); i++) {
+            if(m_filterShown[i]) m_rows.push_back(static_cast<int>(i));
+        }
+    } else {
+        // collapsed models skip their whole subtree
+        for(int i = 0; i < static_cast<int>(m_nodes.size());) {
+            m_rows.push_back(i);
+            i = (m_nodes[i].mesh < 0 && m_expanded[i]) ? i + 1 : m_nodes[i].subtreeEnd;
+        }
+    }
+
+    m_rowsDirty = false;
+}
@@ -0,0 +1,264 @@
+#include "renderer/ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/JobSystem.h"
+#include "renderer/GLState.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const int kTilesPerSlice = ClusteredLighting::kTilesX * ClusteredLighting::kTilesY;
+
+ClusteredLighting::ClusteredLighting()
+    : m_slices(kSlicesZ)
+    , m_clusterLights(kNumClusters)
+{
+    glGenBuffers(1, &m_lightBuffer);
+    glGenBuffers(1, &m_clusterBuffer);
+    glGenTextures(1, &m_lightTexture);
+    glGenTextures(1, &m_clusterTexture);
+
+    // give both buffers storage before attaching them, an empty buffer texture is undefined
+    glm::vec4 emptyLight(0.0f);
+    uint32_t emptyCluster[2] = { 0, 0 };
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyLight), &emptyLight, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_clusterBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyCluster), emptyCluster, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, m_lightTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightBuffer);
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, m_clusterTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_clusterBuffer);
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, 0);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    GLState::forgetTexture(m_lightTexture);
+    GLState::forgetTexture(m_clusterTexture);
+    glDeleteTextures(1, &m_lightTexture);
+    glDeleteTextures(1, &m_clusterTexture);
+    MemoryTracker::untrackBuffer(m_lightBuffer);
+    MemoryTracker::untrackBuffer(m_clusterBuffer);
+    glDeleteBuffers(1, &m_lightBuffer);
+    glDeleteBuffers(1, &m_clusterBuffer);
+}
+
+void ClusteredLighting::update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection) {
+    if(projection != m_cachedProjection) {
+        buildSlices(projection);
+        m_cachedProjection = projection;
+    }
+
+    packLights(lights, view);
+
+    for(auto& list : m_clusterLights) {
+        list.clear();
+    }
+
+    // every slice owns its own froxels, so the slices can be filled in parallel without locks
+    if(!m_spheres.empty()) {
+        JobSystem::parallelFor(kSlicesZ, 1, [this](size_t begin, size_t end) {
+            for(size_t slice = begin; slice < end; slice++) {
+                assignSlice(static_cast<int>(slice));
+            }
+        });
+    }
+
+    upload();
+}
+
+void ClusteredLighting::buildSlices(const glm::mat4& projection) {
+    m_nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    m_farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+    float tanHalfX = 1.0f / projection[0][0];
+    float tanHalfY = 1.0f / projection[1][1];
+
+    for(int slice = 0; slice < kSlicesZ; slice++) {
+        SliceBounds& bounds = m_slices[slice];
+
+        // exponential slices keep the froxels roughly cube shaped
+        bounds.nearDepth = m_nearPlane * std::pow(m_farPlane / m_nearPlane, static_cast<float>(slice) / kSlicesZ);
+        bounds.farDepth = m_nearPlane * std::pow(m_farPlane / m_nearPlane, static_cast<float>(slice + 1) / kSlicesZ);
+
+        for(int ty = 0; ty < kTilesY; ty++) {
+            for(int tx = 0; tx < kTilesX; tx++) {
+                float ndcX[2] = { -1.0f + 2.0f * tx / kTilesX, -1.0f + 2.0f * (tx + 1) / kTilesX };
+                float ndcY[2] = { -1.0f + 2.0f * ty / kTilesY, -1.0f + 2.0f * (ty + 1) / kTilesY };
+
+                glm::vec3 tileMin(1e30f), tileMax(-1e30f);
+                for(float depth : { bounds.nearDepth, bounds.farDepth }) {
+                    for(float x : ndcX) {
+                        for(float y : ndcY) {
+                            glm::vec3 corner(x * depth * tanHalfX, y * depth * tanHalfY, -depth);
+                            tileMin = glm::min(tileMin, corner);
+                            tileMax = glm::max(tileMax, corner);
+                        }
+                    }
+                }
+
+                int tile = ty * kTilesX + tx;
+                bounds.minX[tile] = tileMin.x;
+                bounds.minY[tile] = tileMin.y;
+                bounds.minZ[tile] = tileMin.z;
+                bounds.maxX[tile] = tileMax.x;
+                bounds.maxY[tile] = tileMax.y;
+                bounds.maxZ[tile] = tileMax.z;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::packLights(const std::vector<Light>& lights, const glm::mat4& view) {
+    m_lightData.clear();
+    m_spheres.clear();
+
+    for(const auto& light : lights) {
+        if(!light.enabled || light.range <= 0.0f) continue;
+
+        glm::vec3 direction = glm::normalize(light.direction);
+        float cosInner = std::cos(glm::radians(light.innerAngle));
+        float cosOuter = std::cos(glm::radians(light.outerAngle));
+
+        // texel 0: world position + range, 1: color + type, 2: spot direction + cos outer, 3: cos inner
+        m_lightData.push_back(glm::vec4(light.position, light.range));
+        m_lightData.push_back(glm::vec4(light.color * light.intensity, light.type == LightType::Spot ? 1.0f : 0.0f));
+        m_lightData.push_back(glm::vec4(direction, cosOuter));
+        m_lightData.push_back(glm::vec4(cosInner, 0.0f, 0.0f, 0.0f));
+
+        // bounding sphere in view space, spot lights get the tighter sphere around their cone
+        LightSphere sphere;
+        sphere.center = light.position;
+        sphere.radius = light.range;
+
+        if(light.type == LightType::Spot) {
+            float angle = glm::radians(light.outerAngle);
+            if(angle <= glm::radians(45.0f)) {
+                sphere.radius = light.range / (2.0f * std::cos(angle));
+                sphere.center = light.position + direction * sphere.radius;
+            } else {
+                sphere.center = light.position + direction * (light.range * std::cos(angle));
+                sphere.radius = light.range * std::sin(angle);
+            }
+        }
+
+        sphere.center = glm::vec3(view * glm::vec4(sphere.center, 1.0f));
+        m_spheres.push_back(sphere);
+    }
+}
+
+void ClusteredLighting::assignSlice(int slice) {
+    const SliceBounds& bounds = m_slices[slice];
+    int firstCluster = slice * kTilesPerSlice;
+
+    for(size_t i = 0; i < m_spheres.size(); i++) {
+        const LightSphere& sphere = m_spheres[i];
+
+        // cheap reject on the slice depth range before touching the froxels
+        float depth = -sphere.center.z;
+        if(depth + sphere.radius < bounds.nearDepth || depth - sphere.radius > bounds.farDepth) continue;
+
+        uint32_t lightIndex = static_cast<uint32_t>(i);
+
+#if defined(__SSE2__)
+        // sphere vs aabb on four froxels at a time: squared distance from the center to the box
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 cx = _mm_set1_ps(sphere.center.x);
+        const __m128 cy = _mm_set1_ps(sphere.center.y);
+        const __m128 cz = _mm_set1_ps(sphere.center.z);
+        const __m128 radiusSq = _mm_set1_ps(sphere.radius * sphere.radius);
+
+        for(int tile = 0; tile < kTilesPerSlice; tile += 4) {
+            __m128 dx = _mm_add_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_loadu_ps(bounds.minX + tile), cx)),
+                                   _mm_max_ps(zero, _mm_sub_ps(cx, _mm_loadu_ps(bounds.maxX + tile))));
+            __m128 dy = _mm_add_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_loadu_ps(bounds.minY + tile), cy)),
+                                   _mm_max_ps(zero, _mm_sub_ps(cy, _mm_loadu_ps(bounds.maxY + tile))));
+            __m128 dz = _mm_add_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_loadu_ps(bounds.minZ + tile), cz)),
+                                   _mm_max_ps(zero, _mm_sub_ps(cz, _mm_loadu_ps(bounds.maxZ + tile))));
+
+            __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(distSq, radiusSq));
+
+            while(mask) {
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+
+                auto& list = m_clusterLights[firstCluster + tile + lane];
+                if(list.size() < kMaxLightsPerCluster) list.push_back(lightIndex);
+            }
+        }
+#else
+        for(int tile = 0; tile < kTilesPerSlice; tile++) {
+            float dx = std::max(0.0f, bounds.minX[tile] - sphere.center.x) + std::max(0.0f, sphere.center.x - bounds.maxX[tile]);
+            float dy = std::max(0.0f, bounds.minY[tile] - sphere.center.y) + std::max(0.0f, sphere.center.y - bounds.maxY[tile]);
+            float dz = std::max(0.0f, bounds.minZ[tile] - sphere.center.z) + std::max(0.0f, sphere.center.z - bounds.maxZ[tile]);
+
+            if(dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius) {
+                auto& list = m_clusterLights[firstCluster + tile];
+                if(list.size() < kMaxLightsPerCluster) list.push_back(lightIndex);
+            }
+        }
+#endif
+    }
+}
+
+void ClusteredLighting::upload() {
+    // grid of (offset, count) first, the offsets point past the grid into the index lists
+    m_clusterData.assign(kNumClusters * 2, 0);
+
+    uint32_t offset = kNumClusters * 2;
+    for(int cluster = 0; cluster < kNumClusters; cluster++) {
+        const auto& list = m_clusterLights[cluster];
+        m_clusterData[cluster * 2 + 0] = offset;
+        m_clusterData[cluster * 2 + 1] = static_cast<uint32_t>(list.size());
+        offset += static_cast<uint32_t>(list.size());
+    }
+
+    m_assignedIndices = static_cast<int>(offset) - kNumClusters * 2;
+
+    m_clusterData.reserve(offset);
+    for(const auto& list : m_clusterLights) {
+        m_clusterData.insert(m_clusterData.end(), list.begin(), list.end());
+    }
+
+    if(m_lightData.empty()) {
+        m_lightData.push_back(glm::vec4(0.0f));
+    }
+
+    // re-specifying the whole store each frame lets the driver orphan the old one
+    glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, m_lightData.size() * sizeof(glm::vec4), m_lightData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_clusterBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, m_clusterData.size() * sizeof(uint32_t), m_clusterData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    MemoryTracker::trackBuffer(m_lightBuffer, MemoryTag::Renderer, m_lightData.size() * sizeof(glm::vec4));
+    MemoryTracker::trackBuffer(m_clusterBuffer, MemoryTag::Renderer, m_clusterData.size() * sizeof(uint32_t));
+}
+
+void ClusteredLighting::bind(Shader& shader, int lightUnit, int clusterUnit, int viewportWidth, int viewportHeight) const {
+    GLState::bindTexture(lightUnit, GL_TEXTURE_BUFFER, m_lightTexture);
+    GLState::bindTexture(clusterUnit, GL_TEXTURE_BUFFER, m_clusterTexture);
+
+    shader.setInt("u_LightData", lightUnit);
+    shader.setInt("u_ClusterData", clusterUnit);
+
+    // slice = log(depth) * scale - bias, the inverse of the exponential split in buildSlices
+    float logRatio = std::log(m_farPlane / m_nearPlane);
+    float scale = kSlicesZ / logRatio;
+    float bias = kSlicesZ * std::log(m_nearPlane) / logRatio;
+    shader.setVec4("u_ClusterParams", static_cast<float>(viewportWidth), static_cast<float>(viewportHeight), scale, bias);
+}
+
+int ClusteredLighting::getLightCount() const {
+    return static_cast<int>(m_spheres.size());
+}
+
+int ClusteredLighting::getAssignedIndices() const {
+    return m_assignedIndices;
+}
@@ -0,0 +1,235 @@
+#include "renderer/GLState.h"
+
+// never a real name or enum, marks state that has to be sent next time
+static const GLuint kUnknown = 0xFFFFFFFFu;
+
+GLuint GLState::s_program = kUnknown;
+GLuint GLState::s_vertexArray = kUnknown;
+int GLState::s_activeUnit = -1;
+GLuint GLState::s_textures[GLState::kTextureUnits][GLState::kTextureTargets] = {}; // a new context has nothing bound
+GLuint GLState::s_drawFramebuffer = kUnknown;
+GLuint GLState::s_readFramebuffer = kUnknown;
+int GLState::s_viewport[4] = { 0, 0, 0, 0 };
+bool GLState::s_viewportKnown = false;
+int8_t GLState::s_capabilities[GLState::kCapabilities] = { -1, -1, -1, -1, -1 };
+GLenum GLState::s_blendSource = kUnknown;
+GLenum GLState::s_blendDestination = kUnknown;
+GLenum GLState::s_depthFunc = kUnknown;
+int8_t GLState::s_depthMask = -1;
+
+uint64_t GLState::s_issued = 0;
+uint64_t GLState::s_skipped = 0;
+uint64_t GLState::s_lastFrameIssued = 0;
+uint64_t GLState::s_lastFrameSkipped = 0;
+
+static int getTargetIndex(GLenum target) {
+    switch(target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        default: return -1;
+    }
+}
+
+static int getCapabilityIndex(GLenum capability) {
+    switch(capability) {
+        case GL_BLEND: return 0;
+        case GL_DEPTH_TEST: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_POLYGON_OFFSET_FILL: return 3;
+        case GL_SCISSOR_TEST: return 4;
+        default: return -1;
+    }
+}
+
+void GLState::invalidate() {
+    s_program = kUnknown;
+    s_vertexArray = kUnknown;
+    s_activeUnit = -1;
+    for(auto& unit : s_textures) {
+        for(GLuint& texture : unit) texture = kUnknown;
+    }
+    s_drawFramebuffer = kUnknown;
+    s_readFramebuffer = kUnknown;
+    s_viewportKnown = false;
+    for(int8_t& capability : s_capabilities) capability = -1;
+    s_blendSource = kUnknown;
+    s_blendDestination = kUnknown;
+    s_depthFunc = kUnknown;
+    s_depthMask = -1;
+}
+
+void GLState::useProgram(GLuint program) {
+    if(program == s_program) {
+        s_skipped++;
+        return;
+    }
+    glUseProgram(program);
+    s_program = program;
+    s_issued++;
+}
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+    if(vertexArray == s_vertexArray) {
+        s_skipped++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    s_vertexArray = vertexArray;
+    s_issued++;
+}
+
+void GLState::setActiveUnit(int unit) {
+    if(unit == s_activeUnit) return;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    s_activeUnit = unit;
+    s_issued++;
+}
+
+void GLState::bindTexture(int unit, GLenum target, GLuint texture) {
+    int targetIndex = getTargetIndex(target);
+    bool tracked = targetIndex >= 0 && unit >= 0 && unit < kTextureUnits;
+
+    if(tracked && s_textures[unit][targetIndex] == texture) {
+        s_skipped++;
+        return;
+    }
+
+    setActiveUnit(unit);
+    glBindTexture(target, texture);
+    s_issued++;
+    if(tracked) s_textures[unit][targetIndex] = texture;
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer) {
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if((!draw || s_drawFramebuffer == framebuffer) && (!read || s_readFramebuffer == framebuffer)) {
+        s_skipped++;
+        return;
+    }
+
+    glBindFramebuffer(target, framebuffer);
+    if(draw) s_drawFramebuffer = framebuffer;
+    if(read) s_readFramebuffer = framebuffer;
+    s_issued++;
+}
+
+GLuint GLState::getDrawFramebuffer() {
+    if(s_drawFramebuffer == kUnknown) {
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        s_drawFramebuffer = static_cast<GLuint>(framebuffer);
+        s_issued++;
+    }
+    return s_drawFramebuffer;
+}
+
+void GLState::setViewport(int x, int y, int width, int height) {
+    if(s_viewportKnown && s_viewport[0] == x && s_viewport[1] == y && s_viewport[2] == width && s_viewport[3] == height) {
+        s_skipped++;
+        return;
+    }
+    glViewport(x, y, width, height);
+    s_viewport[0] = x;
+    s_viewport[1] = y;
+    s_viewport[2] = width;
+    s_viewport[3] = height;
+    s_viewportKnown = true;
+    s_issued++;
+}
+
+void GLState::getViewport(int viewport[4]) {
+    if(!s_viewportKnown) {
+        glGetIntegerv(GL_VIEWPORT, s_viewport);
+        s_viewportKnown = true;
+        s_issued++;
+    }
+    for(int i = 0; i < 4; i++) viewport[i] = s_viewport[i];
+}
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+    int index = getCapabilityIndex(capability);
+    if(index >= 0 && s_capabilities[index] == (enabled ? 1 : 0)) {
+        s_skipped++;
+        return;
+    }
+
+    if(enabled) glEnable(capability);
+    else glDisable(capability);
+    if(index >= 0) s_capabilities[index] = enabled ? 1 : 0;
+    s_issued++;
+}
+
+void GLState::setBlendFunc(GLenum source, GLenum destination) {
+    if(source == s_blendSource && destination == s_blendDestination) {
+        s_skipped++;
+        return;
+    }
+    glBlendFunc(source, destination);
+    s_blendSource = source;
+    s_blendDestination = destination;
+    s_issued++;
+}
+
+void GLState::setDepthFunc(GLenum func) {
+    if(func == s_depthFunc) {
+        s_skipped++;
+        return;
+    }
+    glDepthFunc(func);
+    s_depthFunc = func;
+    s_issued++;
+}
+
+void GLState::setDepthMask(bool write) {
+    if(s_depthMask == (write ? 1 : 0)) {
+        s_skipped++;
+        return;
+    }
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+    s_depthMask = write ? 1 : 0;
+    s_issued++;
+}
+
+// GL unbinds a deleted object everywhere in the context, and the name can come back for a new one
+void GLState::forgetTexture(GLuint texture) {
+    for(auto& unit : s_textures) {
+        for(GLuint& bound : unit) {
+            if(bound == texture) bound = 0;
+        }
+    }
+}
+
+void GLState::forgetVertexArray(GLuint vertexArray) {
+    if(s_vertexArray == vertexArray) s_vertexArray = 0;
+}
+
+void GLState::forgetFramebuffer(GLuint framebuffer) {
+    if(s_drawFramebuffer == framebuffer) s_drawFramebuffer = 0;
+    if(s_readFramebuffer == framebuffer) s_readFramebuffer = 0;
+}
+
+uint64_t GLState::getIssuedCalls() {
+    return s_issued;
+}
+
+uint64_t GLState::getSkippedCalls() {
+    return s_skipped;
+}
+
+void GLState::resetStats() {
+    s_lastFrameIssued = s_issued;
+    s_lastFrameSkipped = s_skipped;
+    s_issued = 0;
+    s_skipped = 0;
+}
+
+uint64_t GLState::getLastFrameIssued() {
+    return s_lastFrameIssued;
+}
+
+uint64_t GLState::getLastFrameSkipped() {
+    return s_lastFrameSkipped;
+}
@@ -0,0 +1,593 @@
+#include "renderer/ImageBasedLighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <GLFW/glfw3.h>
+
+#include "core/JobSystem.h"
+#include "core/VirtualFileSystem.h"
+#include "renderer/GLState.h"
+
+// bake parameters, any change here has to bump kCacheVersion
+static const uint32_t kCacheVersion = 1;
+static const int kSourceFaceSize = 256;
+static const int kSpecularFaceSize = 128;
+static const int kSpecularLevels = 6;
+static const int kSpecularSamples = 64;
+static const int kBrdfSize = 64;
+static const int kBrdfSamples = 256;
+
+static const float kPi = 3.14159265358979f;
+
+// direction through the center of a texel, u and v in [-1, 1], GL cubemap conventions
+static glm::vec3 faceToDirection(int face, float u, float v) {
+    glm::vec3 dir;
+    switch(face) {
+        case 0: dir = glm::vec3( 1.0f,   -v,   -u); break;
+        case 1: dir = glm::vec3(-1.0f,   -v,    u); break;
+        case 2: dir = glm::vec3(    u, 1.0f,    v); break;
+        case 3: dir = glm::vec3(    u,-1.0f,   -v); break;
+        case 4: dir = glm::vec3(    u,   -v, 1.0f); break;
+        default: dir = glm::vec3(  -u,   -v,-1.0f); break;
+    }
+    return glm::normalize(dir);
+}
+
+// inverse of faceToDirection, u and v come back in [0, 1]
+static void directionToFace(const glm::vec3& dir, int& face, float& u, float& v) {
+    glm::vec3 a = glm::abs(dir);
+    float sc, tc, ma;
+
+    if(a.x >= a.y && a.x >= a.z) {
+        face = dir.x > 0.0f ? 0 : 1;
+        ma = a.x;
+        sc = dir.x > 0.0f ? -dir.z : dir.z;
+        tc = -dir.y;
+    }
+    else if(a.y >= a.z) {
+        face = dir.y > 0.0f ? 2 : 3;
+        ma = a.y;
+        sc = dir.x;
+        tc = dir.y > 0.0f ? dir.z : -dir.z;
+    }
+    else {
+        face = dir.z > 0.0f ? 4 : 5;
+        ma = a.z;
+        sc = dir.z > 0.0f ? dir.x : -dir.x;
+        tc = -dir.y;
+    }
+
+    u = (sc / ma + 1.0f) * 0.5f;
+    v = (tc / ma + 1.0f) * 0.5f;
+}
+
+static glm::vec3 sampleFace(const std::vector<glm::vec3>& face, int size, float u, float v) {
+    // bilinear, clamped to the face
+    float x = std::clamp(u * size - 0.5f, 0.0f, size - 1.0f);
+    float y = std::clamp(v * size - 0.5f, 0.0f, size - 1.0f);
+    int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+    int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+    float fx = x - x0, fy = y - y0;
+
+    glm::vec3 top = glm::mix(face[y0 * size + x0], face[y0 * size + x1], fx);
+    glm::vec3 bottom = glm::mix(face[y1 * size + x0], face[y1 * size + x1], fx);
+    return glm::mix(top, bottom, fy);
+}
+
+static float texelSolidAngle(float u, float v, int size) {
+    // u and v in [-1, 1]
+    float d = 1.0f + u * u + v * v;
+    return 4.0f / (size * size * d * std::sqrt(d));
+}
+
+static glm::vec2 hammersley(uint32_t i, uint32_t count) {
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2(static_cast<float>(i) / count, bits * 2.3283064365386963e-10f);
+}
+
+static glm::vec3 importanceSampleGGX(const glm::vec2& xi, const glm::vec3& n, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0f * kPi * xi.x;
+    float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+    glm::vec3 h(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+
+    glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+    glm::vec3 bitangent = glm::cross(n, tangent);
+
+    return glm::normalize(tangent * h.x + bitangent * h.y + n * h.z);
+}
+
+ImageBasedLighting::ImageBasedLighting() {
+    for(auto& coefficient : m_sh) coefficient = glm::vec3(0.0f);
+}
+
+ImageBasedLighting::~ImageBasedLighting() {
+    MemoryTracker::untrackTexture(m_specularCubemap);
+    MemoryTracker::untrackTexture(m_brdfLut);
+    GLState::forgetTexture(m_specularCubemap);
+    GLState::forgetTexture(m_brdfLut);
+    if(m_specularCubemap) glDeleteTextures(1, &m_specularCubemap);
+    if(m_brdfLut) glDeleteTextures(1, &m_brdfLut);
+}
+
+bool ImageBasedLighting::load(const std::string& path) {
+    std::string cachePath = getCachePath(path);
+    uint64_t key = getSourceKey(path);
+    if(key == 0) {
+        std::cerr << "ERROR::IBL:: environment not found: " << path << std::endl;
+        return false;
+    }
+
+    BakedData data;
+    if(readCache(cachePath, key, data)) {
+        std::cout << "[Debug] IBL loaded from cache: " << cachePath << std::endl;
+        upload(data);
+        return true;
+    }
+
+    std::cout << "[Debug] Baking IBL for " << path << " on " << JobSystem::getThreadCount() << " threads" << std::endl;
+    double start = glfwGetTime();
+
+    CubeImage source;
+    if(!loadSourceCube(path, kSourceFaceSize, source)) {
+        return false;
+    }
+
+    std::vector<CubeImage> chain = buildMipChain(source);
+    computeSH(source, data.sh);
+    prefilterSpecular(chain, data);
+    integrateBRDF(data);
+
+    std::cout << "[Debug] IBL bake took " << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+
+    writeCache(cachePath, key, data);
+    upload(data);
+    return true;
+}
+
+bool ImageBasedLighting::isLoaded() const {
+    return m_loaded;
+}
+
+std::string ImageBasedLighting::getCachePath(const std::string& path) {
+    return path + ".iblcache";
+}
+
+uint64_t ImageBasedLighting::getSourceKey(const std::string& path) {
+    uint64_t stamp = VirtualFileSystem::getFileStamp(path);
+    if(stamp == 0) return 0;
+
+    // FNV-1a over everything that changes the baked result
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](uint64_t value) {
+        for(int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(stamp);
+    mix(kCacheVersion);
+    mix(kSourceFaceSize);
+    mix(kSpecularFaceSize);
+    mix(kSpecularLevels);
+    mix(kSpecularSamples);
+    mix(kBrdfSize);
+    return hash;
+}
+
+bool ImageBasedLighting::readCache(const std::string& cachePath, uint64_t key, BakedData& data) {
+    if(!VirtualFileSystem::exists(cachePath)) return false;
+    FileData cache = VirtualFileSystem::read(cachePath);
+    FileReader file(cache);
+    if(!file) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+
+    if(!file || std::memcmp(magic, "IBLC", 4) != 0 || version != kCacheVersion || storedKey != key) {
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(data.sh), sizeof(data.sh));
+    file.read(reinterpret_cast<char*>(&data.specularSize), sizeof(int));
+    file.read(reinterpret_cast<char*>(&data.specularLevels), sizeof(int));
+
+    data.specular.resize(data.specularLevels * 6);
+    for(int level = 0; level < data.specularLevels; level++) {
+        int size = std::max(1, data.specularSize >> level);
+        for(int face = 0; face < 6; face++) {
+            auto& pixels = data.specular[level * 6 + face];
+            pixels.resize(static_cast<size_t>(size) * size);
+            file.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(glm::vec3));
+        }
+    }
+
+    file.read(reinterpret_cast<char*>(&data.brdfSize), sizeof(int));
+    data.brdf.resize(static_cast<size_t>(data.brdfSize) * data.brdfSize);
+    file.read(reinterpret_cast<char*>(data.brdf.data()), data.brdf.size() * sizeof(glm::vec2));
+
+    return static_cast<bool>(file);
+}
+
+void ImageBasedLighting::writeCache(const std::string& cachePath, uint64_t key, const BakedData& data) {
+    // with the assets packed the folder the environment came from may not exist on disk
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(cachePath).parent_path();
+    if(!parent.empty()) std::filesystem::create_directories(parent, error);
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if(!file) {
+        std::cerr << "ERROR::IBL:: could not write cache " << cachePath << std::endl;
+        return;
+    }
+
+    file.write("IBLC", 4);
+    file.write(reinterpret_cast<const char*>(&kCacheVersion), sizeof(kCacheVersion));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(data.sh), sizeof(data.sh));
+    file.write(reinterpret_cast<const char*>(&data.specularSize), sizeof(int));
+    file.write(reinterpret_cast<const char*>(&data.specularLevels), sizeof(int));
+
+    for(const auto& pixels : data.specular) {
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size() * sizeof(glm::vec3));
+    }
+
+    file.write(reinterpret_cast<const char*>(&data.brdfSize), sizeof(int));
+    file.write(reinterpret_cast<const char*>(data.brdf.data()), data.brdf.size() * sizeof(glm::vec2));
+}
+
+bool ImageBasedLighting::loadSourceCube(const std::string& path, int faceSize, CubeImage& cube) {
+    // stb picks the decoder from the content, not the extension, so a png saved as .exr works too;
+    // ldr sources are 8 bit to keep the 6 faces at full size from taking hundreds of MB as floats
+    FileData file = VirtualFileSystem::read(path);
+    if(!file.isValid()) return false;
+    const stbi_uc* encoded = reinterpret_cast<const stbi_uc*>(file.data());
+    int encodedSize = static_cast<int>(file.size());
+
+    int width, height, channels;
+    bool hdr = stbi_is_hdr_from_memory(encoded, encodedSize) != 0;
+
+    float* hdrPixels = nullptr;
+    unsigned char* ldrPixels = nullptr;
+    if(hdr) hdrPixels = stbi_loadf_from_memory(encoded, encodedSize, &width, &height, &channels, 3);
+    else ldrPixels = stbi_load_from_memory(encoded, encodedSize, &width, &height, &channels, 3);
+
+    if(!hdrPixels && !ldrPixels) {
+        std::cerr << "ERROR::IBL:: failed to decode " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    float srgbToLinear[256];
+    for(int i = 0; i < 256; i++) {
+        srgbToLinear[i] = std::pow(i / 255.0f, 2.2f);
+    }
+
+    auto pixel = [&](int x, int y) {
+        size_t index = (static_cast<size_t>(y) * width + x) * 3;
+        if(hdr) return glm::vec3(hdrPixels[index], hdrPixels[index + 1], hdrPixels[index + 2]);
+        return glm::vec3(srgbToLinear[ldrPixels[index]], srgbToLinear[ldrPixels[index + 1]], srgbToLinear[ldrPixels[index + 2]]);
+    };
+
+    bool strip = width == height * 6;
+    bool equirect = width == height * 2;
+
+    if(!strip && !equirect) {
+        std::cerr << "ERROR::IBL:: " << path << " is neither a 6:1 cube strip nor a 2:1 equirectangular image" << std::endl;
+        if(hdrPixels) stbi_image_free(hdrPixels);
+        if(ldrPixels) stbi_image_free(ldrPixels);
+        return false;
+    }
+
+    cube.size = faceSize;
+    for(auto& face : cube.faces) {
+        face.assign(static_cast<size_t>(faceSize) * faceSize, glm::vec3(0.0f));
+    }
+
+    // one job per output row, box filter from the strip or 2x2 supersampling of the equirect
+    JobSystem::parallelFor(6 * faceSize, 8, [&](size_t begin, size_t end) {
+        for(size_t row = begin; row < end; row++) {
+            int face = static_cast<int>(row) / faceSize;
+            int y = static_cast<int>(row) % faceSize;
+
+            for(int x = 0; x < faceSize; x++) {
+                glm::vec3 sum(0.0f);
+
+                if(strip) {
+                    int sourceFace = height;
+                    int scale = std::max(1, sourceFace / faceSize);
+                    int sx0 = x * sourceFace / faceSize;
+                    int sy0 = y * sourceFace / faceSize;
+                    for(int sy = sy0; sy < sy0 + scale; sy++) {
+                        for(int sx = sx0; sx < sx0 + scale; sx++) {
+                            sum += pixel(face * sourceFace + sx, sy);
+                        }
+                    }
+                    sum /= static_cast<float>(scale * scale);
+                }
+                else {
+                    for(int s = 0; s < 4; s++) {
+                        float u = 2.0f * (x + 0.25f + 0.5f * (s & 1)) / faceSize - 1.0f;
+                        float v = 2.0f * (y + 0.25f + 0.5f * (s >> 1)) / faceSize - 1.0f;
+                        glm::vec3 dir = faceToDirection(face, u, v);
+
+                        float lon = std::atan2(dir.z, dir.x) / (2.0f * kPi) + 0.5f;
+                        float lat = std::acos(std::clamp(dir.y, -1.0f, 1.0f)) / kPi;
+                        int sx = std::min(width - 1, static_cast<int>(lon * width));
+                        int sy = std::min(height - 1, static_cast<int>(lat * height));
+                        sum += pixel(sx, sy);
+                    }
+                    sum *= 0.25f;
+                }
+
+                cube.faces[face][y * faceSize + x] = sum;
+            }
+        }
+    });
+
+    if(hdrPixels) stbi_image_free(hdrPixels);
+    if(ldrPixels) stbi_image_free(ldrPixels);
+    return true;
+}
+
+std::vector<ImageBasedLighting::CubeImage> ImageBasedLighting::buildMipChain(const CubeImage& base) {
+    std::vector<CubeImage> chain;
+    chain.push_back(base);
+
+    while(chain.back().size > 1) {
+        const CubeImage& src = chain.back();
+        CubeImage dst;
+        dst.size = src.size / 2;
+
+        for(int face = 0; face < 6; face++) {
+            dst.faces[face].resize(static_cast<size_t>(dst.size) * dst.size);
+            for(int y = 0; y < dst.size; y++) {
+                for(int x = 0; x < dst.size; x++) {
+                    const auto& s = src.faces[face];
+                    dst.faces[face][y * dst.size + x] = 0.25f * (
+                        s[(y * 2) * src.size + x * 2] + s[(y * 2) * src.size + x * 2 + 1] +
+                        s[(y * 2 + 1) * src.size + x * 2] + s[(y * 2 + 1) * src.size + x * 2 + 1]);
+                }
+            }
+        }
+
+        chain.push_back(std::move(dst));
+    }
+
+    return chain;
+}
+
+void ImageBasedLighting::computeSH(const CubeImage& cube, glm::vec3 sh[9]) {
+    // project the radiance onto the first 9 real SH bands, one partial sum per face
+    glm::vec3 partial[6][9];
+
+    JobSystem::parallelFor(6, 1, [&](size_t begin, size_t end) {
+        for(size_t face = begin; face < end; face++) {
+            glm::vec3* coefficients = partial[face];
+            for(int i = 0; i < 9; i++) coefficients[i] = glm::vec3(0.0f);
+
+            for(int y = 0; y < cube.size; y++) {
+                for(int x = 0; x < cube.size; x++) {
+                    float u = 2.0f * (x + 0.5f) / cube.size - 1.0f;
+                    float v = 2.0f * (y + 0.5f) / cube.size - 1.0f;
+                    glm::vec3 d = faceToDirection(static_cast<int>(face), u, v);
+                    glm::vec3 radiance = cube.faces[face][y * cube.size + x] * texelSolidAngle(u, v, cube.size);
+
+                    coefficients[0] += radiance * 0.282095f;
+                    coefficients[1] += radiance * (0.488603f * d.y);
+                    coefficients[2] += radiance * (0.488603f * d.z);
+                    coefficients[3] += radiance * (0.488603f * d.x);
+                    coefficients[4] += radiance * (1.092548f * d.x * d.y);
+                    coefficients[5] += radiance * (1.092548f * d.y * d.z);
+                    coefficients[6] += radiance * (0.315392f * (3.0f * d.z * d.z - 1.0f));
+                    coefficients[7] += radiance * (1.092548f * d.x * d.z);
+                    coefficients[8] += radiance * (0.546274f * (d.x * d.x - d.y * d.y));
+                }
+            }
+        }
+    });
+
+    // convolve with the clamped cosine and divide by pi, the shader multiplies by albedo directly
+    const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    for(int i = 0; i < 9; i++) {
+        sh[i] = glm::vec3(0.0f);
+        for(int face = 0; face < 6; face++) sh[i] += partial[face][i];
+        sh[i] *= band[i];
+    }
+}
+
+void ImageBasedLighting::prefilterSpecular(const std::vector<CubeImage>& chain, BakedData& data) {
+    data.specularSize = kSpecularFaceSize;
+    data.specularLevels = kSpecularLevels;
+    data.specular.resize(kSpecularLevels * 6);
+
+    const CubeImage& source = chain[0];
+    float sourceTexelSolidAngle = 4.0f * kPi / (6.0f * source.size * source.size);
+    int maxSourceMip = static_cast<int>(chain.size()) - 1;
+
+    for(int level = 0; level < kSpecularLevels; level++) {
+        int size = std::max(1, kSpecularFaceSize >> level);
+        float roughness = static_cast<float>(level) / (kSpecularLevels - 1);
+
+        for(int face = 0; face < 6; face++) {
+            data.specular[level * 6 + face].resize(static_cast<size_t>(size) * size);
+        }
+
+        JobSystem::parallelFor(6 * size, 4, [&](size_t begin, size_t end) {
+            for(size_t row = begin; row < end; row++) {
+                int face = static_cast<int>(row) / size;
+                int y = static_cast<int>(row) % size;
+                auto& out = data.specular[level * 6 + face];
+
+                for(int x = 0; x < size; x++) {
+                    float u = 2.0f * (x + 0.5f) / size - 1.0f;
+                    float v = 2.0f * (y + 0.5f) / size - 1.0f;
+                    glm::vec3 n = faceToDirection(face, u, v);
+
+                    // the mirror level is just the environment at this resolution
+                    if(level == 0) {
+                        int sampleFaceIndex;
+                        float su, sv;
+                        directionToFace(n, sampleFaceIndex, su, sv);
+                        const CubeImage& mip = chain[std::min(1, maxSourceMip)];
+                        out[y * size + x] = sampleFace(mip.faces[sampleFaceIndex], mip.size, su, sv);
+                        continue;
+                    }
+
+                    // importance sampled GGX with n = v = r, reading a blurrier source mip
+                    // for samples that cover more solid angle (filtered importance sampling)
+                    glm::vec3 color(0.0f);
+                    float weight = 0.0f;
+
+                    for(int i = 0; i < kSpecularSamples; i++) {
+                        glm::vec3 h = importanceSampleGGX(hammersley(i, kSpecularSamples), n, roughness);
+                        glm::vec3 l = glm::normalize(2.0f * glm::dot(n, h) * h - n);
+
+                        float nDotL = glm::dot(n, l);
+                        if(nDotL <= 0.0f) continue;
+
+                        float nDotH = std::max(glm::dot(n, h), 0.0f);
+                        float a = roughness * roughness;
+                        float denom = nDotH * nDotH * (a * a - 1.0f) + 1.0f;
+                        float distribution = (a * a) / (kPi * denom * denom);
+                        float pdf = distribution / 4.0f + 1e-4f;
+
+                        float sampleSolidAngle = 1.0f / (kSpecularSamples * pdf);
+                        float mipLevel = 0.5f * std::log2(sampleSolidAngle / sourceTexelSolidAngle) + 1.0f;
+                        int mip = std::clamp(static_cast<int>(std::round(mipLevel)), 0, maxSourceMip);
+
+                        int sampleFaceIndex;
+                        float su, sv;
+                        directionToFace(l, sampleFaceIndex, su, sv);
+                        const CubeImage& sourceMip = chain[mip];
+
+                        color += sampleFace(sourceMip.faces[sampleFaceIndex], sourceMip.size, su, sv) * nDotL;
+                        weight += nDotL;
+                    }
+
+                    out[y * size + x] = weight > 0.0f ? color / weight : glm::vec3(0.0f);
+                }
+            }
+        });
+    }
+}
+
+void ImageBasedLighting::integrateBRDF(BakedData& data) {
+    data.brdfSize = kBrdfSize;
+    data.brdf.resize(kBrdfSize * kBrdfSize);
+
+    // x is n.v, y is roughness, output is the scale and bias applied to F0
+    JobSystem::parallelFor(kBrdfSize, 4, [&](size_t begin, size_t end) {
+        for(size_t row = begin; row < end; row++) {
+            float roughness = (row + 0.5f) / kBrdfSize;
+            float k = roughness * roughness / 2.0f;
+
+            for(int col = 0; col < kBrdfSize; col++) {
+                float nDotV = (col + 0.5f) / kBrdfSize;
+                glm::vec3 v(std::sqrt(1.0f - nDotV * nDotV), 0.0f, nDotV);
+                glm::vec3 n(0.0f, 0.0f, 1.0f);
+
+                float scale = 0.0f, bias = 0.0f;
+                for(int i = 0; i < kBrdfSamples; i++) {
+                    glm::vec3 h = importanceSampleGGX(hammersley(i, kBrdfSamples), n, roughness);
+                    glm::vec3 l = glm::normalize(2.0f * glm::dot(v, h) * h - v);
+
+                    float nDotL = std::max(l.z, 0.0f);
+                    float nDotH = std::max(h.z, 0.0f);
+                    float vDotH = std::max(glm::dot(v, h), 0.0f);
+                    if(nDotL <= 0.0f) continue;
+
+                    float geometryV = nDotV / (nDotV * (1.0f - k) + k);
+                    float geometryL = nDotL / (nDotL * (1.0f - k) + k);
+                    float visibility = geometryV * geometryL * vDotH / (nDotH * nDotV);
+                    float fresnel = std::pow(1.0f - vDotH, 5.0f);
+
+                    scale += (1.0f - fresnel) * visibility;
+                    bias += fresnel * visibility;
+                }
+
+                data.brdf[row * kBrdfSize + col] = glm::vec2(scale, bias) / static_cast<float>(kBrdfSamples);
+            }
+        }
+    });
+}
+
+void ImageBasedLighting::upload(const BakedData& data) {
+    for(int i = 0; i < 9; i++) m_sh[i] = data.sh[i];
+    m_specularLevels = data.specularLevels;
+
+    glGenTextures(1, &m_specularCubemap);
+    GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, m_specularCubemap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t cubemapBytes = 0;
+    for(int level = 0; level < data.specularLevels; level++) {
+        int size = std::max(1, data.specularSize >> level);
+        cubemapBytes += 6 * MemoryTracker::getTextureBytes(GL_RGB16F, size, size);
+        for(int face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB16F, size, size, 0,
+                         GL_RGB, GL_FLOAT, data.specular[level * 6 + face].data());
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, data.specularLevels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &m_brdfLut);
+    GLState::bindTexture(0, GL_TEXTURE_2D, m_brdfLut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, data.brdfSize, data.brdfSize, 0, GL_RG, GL_FLOAT, data.brdf.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+    GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
+
+    MemoryTracker::trackTexture(m_specularCubemap, MemoryTag::Renderer, cubemapBytes);
+    MemoryTracker::trackTexture(m_brdfLut, MemoryTag::Renderer, MemoryTracker::getTextureBytes(GL_RG16F, data.brdfSize, data.brdfSize));
+
+    // filter across cube face edges on the rough mips
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    m_loaded = true;
+}
+
+void ImageBasedLighting::bind(Shader& shader, int specularUnit, int brdfUnit) const {
+    // the sampler units are set even without an environment, two sampler types
+    // left on the same default unit would make the draw fail
+    GLState::bindTexture(specularUnit, GL_TEXTURE_CUBE_MAP, m_specularCubemap);
+    GLState::bindTexture(brdfUnit, GL_TEXTURE_2D, m_brdfLut);
+
+    shader.setInt("u_PrefilteredEnv", specularUnit);
+    shader.setInt("u_BrdfLut", brdfUnit);
+    shader.setBool("u_HasEnvironment", m_loaded);
+
+    if(!m_loaded) return;
+
+    shader.setFloat("u_PrefilterLevels", static_cast<float>(m_specularLevels));
+    for(int i = 0; i < 9; i++) {
+        shader.setVec3("u_SH[" + std::to_string(i) + "]", m_sh[i]);
+    }
+}
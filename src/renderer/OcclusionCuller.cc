@@ -0,0 +1,315 @@
+#include "renderer/OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/JobSystem.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// occluder selection limits, the raster cost grows with the triangle count
+static const int kMaxOccluders = 32;
+static const int kMaxOccluderTriangles = 65536;
+// fraction of the screen height a mesh has to cover before it is worth rasterizing
+static const float kMinOccluderScreenSize = 0.1f;
+static const int kBandHeight = 16;
+
+OcclusionCuller::OcclusionCuller()
+    : m_depth(kWidth * kHeight, 1.0f)
+{
+    int w = kWidth, h = kHeight;
+    while(true) {
+        m_pyramidSizes.push_back(glm::ivec2(w, h));
+        m_pyramid.push_back(std::vector<float>(static_cast<size_t>(w) * h, 1.0f));
+        if(w == 1 && h == 1) break;
+        w = std::max(1, (w + 1) / 2);
+        h = std::max(1, (h + 1) / 2);
+    }
+
+    size_t bytes = m_depth.size() * sizeof(float);
+    for(const auto& level : m_pyramid) {
+        bytes += level.size() * sizeof(float);
+    }
+    MemoryTracker::trackCpu(this, MemoryTag::Renderer, bytes);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    MemoryTracker::untrackCpu(this);
+}
+
+void OcclusionCuller::render(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection) {
+    m_viewProjection = projection * view;
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+
+    selectOccluders(models, view, projection);
+
+    // transform and set up the occluder triangles, one occluder per job
+    m_perOccluderTriangles.resize(m_occluders.size());
+    JobSystem::parallelFor(m_occluders.size(), 1, [this](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            m_perOccluderTriangles[i].clear();
+            setupTriangles(m_occluders[i], m_perOccluderTriangles[i]);
+        }
+    });
+
+    m_triangles.clear();
+    for(const auto& triangles : m_perOccluderTriangles) {
+        m_triangles.insert(m_triangles.end(), triangles.begin(), triangles.end());
+    }
+
+    // every band owns its rows of the depth buffer, so no two jobs write the same pixel
+    int bands = (kHeight + kBandHeight - 1) / kBandHeight;
+    JobSystem::parallelFor(bands, 1, [this](size_t begin, size_t end) {
+        for(size_t band = begin; band < end; band++) {
+            int y0 = static_cast<int>(band) * kBandHeight;
+            rasterizeBand(y0, std::min(kHeight, y0 + kBandHeight));
+        }
+    });
+
+    buildPyramid();
+}
+
+void OcclusionCuller::selectOccluders(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection) {
+    m_occluders.clear();
+    Frustum frustum = Frustum::fromMatrix(m_viewProjection);
+
+    for(const auto& model : models) {
+        glm::mat4 world = model->getWorldMatrix();
+
+        for(const auto& mesh : model->m_meshes) {
+            // only meshes that kept their positions after upload, Mesh::releaseCpuGeometry
+            // already left out skinned ones and anything over Mesh::kMaxOccluderTriangles
+            if(!mesh.m_isVisible || !mesh.m_bounds.isValid() || !mesh.hasOccluderGeometry()) continue;
+
+            BoundingSphere sphere = getWorldSphere(mesh.m_bounds, world);
+            if(!frustum.intersectsSphere(sphere)) continue;
+
+            // projected radius as a fraction of the screen height, the camera inside counts as huge
+            float depth = -(view * glm::vec4(sphere.center, 1.0f)).z;
+            float screenSize = depth > sphere.radius ? sphere.radius * projection[1][1] / depth : 1e9f;
+            if(screenSize < kMinOccluderScreenSize) continue;
+
+            m_occluders.push_back({ &mesh, m_viewProjection * world, screenSize });
+        }
+    }
+
+    std::sort(m_occluders.begin(), m_occluders.end(), [](const Occluder& a, const Occluder& b) {
+        return a.screenSize > b.screenSize;
+    });
+
+    int total = 0;
+    size_t keep = 0;
+    while(keep < m_occluders.size() && keep < kMaxOccluders) {
+        int triangles = static_cast<int>(m_occluders[keep].mesh->getIndices().size() / 3);
+        if(total + triangles > kMaxOccluderTriangles) break;
+        total += triangles;
+        keep++;
+    }
+    m_occluders.resize(keep);
+}
+
+void OcclusionCuller::setupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& out) const {
+    PositionView positions = occluder.mesh->getPositions();
+    const auto& indices = occluder.mesh->getIndices();
+
+    for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+        ScreenTriangle triangle;
+        bool clipped = false;
+
+        for(int k = 0; k < 3; k++) {
+            glm::vec4 clip = occluder.mvp * glm::vec4(positions[indices[i + k]], 1.0f);
+
+            // dropping a triangle that crosses the near plane only makes the culling more conservative
+            if(clip.w <= 1e-4f) {
+                clipped = true;
+                break;
+            }
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            triangle.v[k] = glm::vec3(
+                (ndc.x * 0.5f + 0.5f) * kWidth,
+                (ndc.y * 0.5f + 0.5f) * kHeight,
+                ndc.z * 0.5f + 0.5f
+            );
+        }
+        if(clipped) continue;
+
+        // counter clockwise is front facing, back faces and slivers are skipped
+        const glm::vec3& a = triangle.v[0];
+        const glm::vec3& b = triangle.v[1];
+        const glm::vec3& c = triangle.v[2];
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if(area <= 0.0f) continue;
+
+        triangle.minY = std::min(a.y, std::min(b.y, c.y));
+        triangle.maxY = std::max(a.y, std::max(b.y, c.y));
+
+        float minX = std::min(a.x, std::min(b.x, c.x));
+        float maxX = std::max(a.x, std::max(b.x, c.x));
+        if(maxX < 0.0f || minX >= kWidth || triangle.maxY < 0.0f || triangle.minY >= kHeight) continue;
+
+        out.push_back(triangle);
+    }
+}
+
+void OcclusionCuller::rasterizeBand(int y0, int y1) {
+    for(const auto& triangle : m_triangles) {
+        if(triangle.maxY < y0 || triangle.minY >= y1) continue;
+
+        const glm::vec3& a = triangle.v[0];
+        const glm::vec3& b = triangle.v[1];
+        const glm::vec3& c = triangle.v[2];
+
+        // edge functions as A * x + B * y + C, all three are positive inside a ccw triangle
+        float A0 = b.y - c.y, B0 = c.x - b.x, C0 = b.x * c.y - b.y * c.x; // opposite a
+        float A1 = c.y - a.y, B1 = a.x - c.x, C1 = c.x * a.y - c.y * a.x; // opposite b
+        float A2 = a.y - b.y, B2 = b.x - a.x, C2 = a.x * b.y - a.y * b.x; // opposite c
+
+        // the three edges always sum to the doubled area, evaluated at the origin that's the C terms
+        float invArea = 1.0f / (C0 + C1 + C2);
+
+        // depth as a plane over the screen: z = zA * x + zB * y + zC
+        float zA = (A0 * a.z + A1 * b.z + A2 * c.z) * invArea;
+        float zB = (B0 * a.z + B1 * b.z + B2 * c.z) * invArea;
+        float zC = (C0 * a.z + C1 * b.z + C2 * c.z) * invArea;
+
+        float minX = std::min(a.x, std::min(b.x, c.x));
+        float maxX = std::max(a.x, std::max(b.x, c.x));
+
+        int startX = std::max(0, static_cast<int>(std::floor(minX))) & ~3; // 4 pixel aligned
+        int endX = std::min(kWidth - 1, static_cast<int>(std::ceil(maxX)));
+        int startY = std::max(y0, static_cast<int>(std::floor(triangle.minY)));
+        int endY = std::min(y1 - 1, static_cast<int>(std::ceil(triangle.maxY)));
+
+        for(int y = startY; y <= endY; y++) {
+            float py = y + 0.5f;
+            float* row = &m_depth[static_cast<size_t>(y) * kWidth];
+
+#if defined(__SSE2__)
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 rowE0 = _mm_set1_ps(B0 * py + C0);
+            const __m128 rowE1 = _mm_set1_ps(B1 * py + C1);
+            const __m128 rowE2 = _mm_set1_ps(B2 * py + C2);
+            const __m128 rowZ = _mm_set1_ps(zB * py + zC);
+
+            for(int x = startX; x <= endX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A0), px), rowE0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A1), px), rowE1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A2), px), rowE2);
+
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if(_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), rowZ);
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(depth, z);
+
+                // keep the old depth outside the triangle
+                __m128 result = _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth));
+                _mm_storeu_ps(row + x, result);
+            }
+#else
+            for(int x = startX; x <= endX; x++) {
+                float px = x + 0.5f;
+                float e0 = A0 * px + B0 * py + C0;
+                float e1 = A1 * px + B1 * py + C1;
+                float e2 = A2 * px + B2 * py + C2;
+                if(e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+
+                float z = zA * px + zB * py + zC;
+                row[x] = std::min(row[x], z);
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    m_pyramid[0] = m_depth;
+
+    // every texel keeps the farthest depth below it, so a box nearer than that is visible
+    for(size_t level = 1; level < m_pyramid.size(); level++) {
+        const auto& src = m_pyramid[level - 1];
+        glm::ivec2 srcSize = m_pyramidSizes[level - 1];
+        glm::ivec2 size = m_pyramidSizes[level];
+        auto& dst = m_pyramid[level];
+
+        for(int y = 0; y < size.y; y++) {
+            int sy0 = std::min(y * 2, srcSize.y - 1);
+            int sy1 = std::min(y * 2 + 1, srcSize.y - 1);
+            for(int x = 0; x < size.x; x++) {
+                int sx0 = std::min(x * 2, srcSize.x - 1);
+                int sx1 = std::min(x * 2 + 1, srcSize.x - 1);
+                dst[y * size.x + x] = std::max(
+                    std::max(src[sy0 * srcSize.x + sx0], src[sy0 * srcSize.x + sx1]),
+                    std::max(src[sy1 * srcSize.x + sx0], src[sy1 * srcSize.x + sx1])
+                );
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox& worldBox) const {
+    glm::vec2 screenMin(1e30f), screenMax(-1e30f);
+    float nearestDepth = 1.0f;
+
+    for(int i = 0; i < 8; i++) {
+        glm::vec3 corner(
+            (i & 1) ? worldBox.max.x : worldBox.min.x,
+            (i & 2) ? worldBox.max.y : worldBox.min.y,
+            (i & 4) ? worldBox.max.z : worldBox.min.z
+        );
+
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+        // box reaches behind the camera, can't say anything about it
+        if(clip.w <= 1e-4f) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        screenMin = glm::min(screenMin, glm::vec2((ndc.x * 0.5f + 0.5f) * kWidth, (ndc.y * 0.5f + 0.5f) * kHeight));
+        screenMax = glm::max(screenMax, glm::vec2((ndc.x * 0.5f + 0.5f) * kWidth, (ndc.y * 0.5f + 0.5f) * kHeight));
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    int x0 = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+    int y0 = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+    int x1 = std::min(kWidth - 1, static_cast<int>(std::floor(screenMax.x)));
+    int y1 = std::min(kHeight - 1, static_cast<int>(std::floor(screenMax.y)));
+
+    // entirely off screen
+    if(x0 > x1 || y0 > y1) return false;
+
+    // pick the level where the rectangle spans only a few texels
+    int span = std::max(x1 - x0, y1 - y0) + 1;
+    int level = 0;
+    while(span > 4 && level + 1 < static_cast<int>(m_pyramid.size())) {
+        span = (span + 1) / 2;
+        level++;
+    }
+
+    const auto& depth = m_pyramid[level];
+    glm::ivec2 size = m_pyramidSizes[level];
+
+    for(int y = y0 >> level; y <= (y1 >> level) && y < size.y; y++) {
+        for(int x = x0 >> level; x <= (x1 >> level) && x < size.x; x++) {
+            if(nearestDepth <= depth[y * size.x + x]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int OcclusionCuller::getOccluderCount() const {
+    return static_cast<int>(m_occluders.size());
+}
+
+int OcclusionCuller::getOccluderTriangles() const {
+    return static_cast<int>(m_triangles.size());
+}
@@ -0,0 +1,436 @@
+#include "renderer/RenderGraph.h"
+#include "renderer/GLState.h"
+
+#include <iostream>
+#include <utility>
+
+#include "core/MemoryTracker.h"
+#include "core/PerfCounters.h"
+
+static bool isDepthFormat(GLenum format) {
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8;
+}
+
+// the pixel format glTexImage2D wants next to an internal format, nothing is uploaded
+static void getUploadFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+    switch(internalFormat) {
+        case GL_DEPTH24_STENCIL8: format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; break;
+        case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+        case GL_R8: format = GL_RED; type = GL_UNSIGNED_BYTE; break;
+        case GL_RG16F: format = GL_RG; type = GL_FLOAT; break;
+        case GL_RGB16F: format = GL_RGB; type = GL_FLOAT; break;
+        case GL_RGBA16F: case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; break;
+        default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+    }
+}
+
+RenderGraph::~RenderGraph() {
+    for(auto& entry : m_framebuffers) {
+        GLState::forgetFramebuffer(entry.second);
+        glDeleteFramebuffers(1, &entry.second);
+    }
+    for(PooledTexture& pooled : m_pool) {
+        MemoryTracker::untrackTexture(pooled.texture);
+        GLState::forgetTexture(pooled.texture);
+        glDeleteTextures(1, &pooled.texture);
+    }
+}
+
+void RenderGraph::reset() {
+    m_resources.clear();
+    m_passes.clear();
+    m_compiled = false;
+    m_culledPasses = 0;
+    m_transients = 0;
+    m_physicalTextures = 0;
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const std::string& name, const TextureDesc& desc) {
+    ResourceNode resource;
+    resource.name = name;
+    resource.type = ResourceType::Transient;
+    resource.desc = desc;
+    m_resources.push_back(std::move(resource));
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importFramebuffer(const std::string& name, GLuint framebuffer, int width, int height, bool output) {
+    ResourceNode resource;
+    resource.name = name;
+    resource.type = ResourceType::Framebuffer;
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.framebuffer = framebuffer;
+    resource.output = output;
+    m_resources.push_back(std::move(resource));
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importExternal(const std::string& name, bool output) {
+    ResourceNode resource;
+    resource.name = name;
+    resource.type = ResourceType::External;
+    resource.output = output;
+    m_resources.push_back(std::move(resource));
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+void RenderGraph::setClearColor(Resource resource, const glm::vec4& color) {
+    if(isValid(resource)) m_resources[resource].clearColor = color;
+}
+
+RenderGraph::Pass RenderGraph::addPass(const std::string& name, std::function<void()> execute) {
+    PassNode pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_passes.push_back(std::move(pass));
+    m_compiled = false;
+    return static_cast<Pass>(m_passes.size() - 1);
+}
+
+void RenderGraph::read(Pass pass, Resource resource) {
+    if(pass < 0 || pass >= static_cast<Pass>(m_passes.size()) || !isValid(resource)) return;
+
+    PassNode& node = m_passes[pass];
+    for(Resource existing : node.reads) {
+        if(existing == resource) return;
+    }
+    node.reads.push_back(resource);
+    m_resources[resource].readers++;
+    m_compiled = false;
+}
+
+void RenderGraph::write(Pass pass, Resource resource, Load load) {
+    if(pass < 0 || pass >= static_cast<Pass>(m_passes.size()) || !isValid(resource)) return;
+
+    PassNode& node = m_passes[pass];
+    for(Write& existing : node.writes) {
+        if(existing.resource == resource) {
+            if(load == Load::Clear) existing.load = load;
+            return;
+        }
+    }
+    node.writes.push_back({ resource, load });
+    m_resources[resource].writers.push_back(pass);
+    m_compiled = false;
+}
+
+bool RenderGraph::compile() {
+    m_culledPasses = 0;
+    m_transients = 0;
+    m_physicalTextures = 0;
+    bool valid = true;
+
+    for(ResourceNode& resource : m_resources) {
+        if(resource.type == ResourceType::Transient && resource.readers > 0 && resource.writers.empty()) {
+            std::cerr << "ERROR::RENDER_GRAPH:: " << resource.name << " is read but never written" << std::endl;
+            valid = false;
+        }
+        if(resource.type == ResourceType::Transient && (resource.desc.width <= 0 || resource.desc.height <= 0)) {
+            std::cerr << "ERROR::RENDER_GRAPH:: " << resource.name << " has no size" << std::endl;
+            valid = false;
+        }
+        resource.references = resource.readers + (resource.output ? 1 : 0);
+        resource.firstUse = -1;
+        resource.lastUse = -1;
+        resource.physical = -1;
+    }
+
+    for(PassNode& pass : m_passes) {
+        int framebuffers = 0;
+        int transients = 0;
+        for(const Write& write : pass.writes) {
+            ResourceType type = m_resources[write.resource].type;
+            if(type == ResourceType::Framebuffer) framebuffers++;
+            if(type == ResourceType::Transient) transients++;
+        }
+        if(framebuffers > 1 || (framebuffers > 0 && transients > 0)) {
+            std::cerr << "ERROR::RENDER_GRAPH:: " << pass.name << " draws into more than one framebuffer" << std::endl;
+            valid = false;
+        }
+        pass.references = static_cast<int>(pass.writes.size());
+        pass.culled = false;
+    }
+
+    if(!valid) {
+        m_compiled = false;
+        return false;
+    }
+
+    // a pass whose writes nobody reads is dropped, which can leave its inputs unread in turn.
+    // passes that write nothing are left alone, they are there for their side effects
+    std::vector<Resource> unreferenced;
+    for(Resource i = 0; i < static_cast<Resource>(m_resources.size()); i++) {
+        if(m_resources[i].references == 0) unreferenced.push_back(i);
+    }
+    while(!unreferenced.empty()) {
+        Resource resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for(Pass writer : m_resources[resource].writers) {
+            PassNode& pass = m_passes[writer];
+            if(pass.references == 0 || --pass.references > 0) continue;
+
+            pass.culled = true;
+            m_culledPasses++;
+            for(Resource input : pass.reads) {
+                if(--m_resources[input].references == 0) unreferenced.push_back(input);
+            }
+        }
+    }
+
+    // lifetimes over the passes that are left
+    for(Pass p = 0; p < static_cast<Pass>(m_passes.size()); p++) {
+        const PassNode& pass = m_passes[p];
+        if(pass.culled) continue;
+
+        auto use = [&](Resource index) {
+            ResourceNode& resource = m_resources[index];
+            if(resource.type != ResourceType::Transient) return;
+            if(resource.firstUse < 0) resource.firstUse = p;
+            resource.lastUse = p;
+        };
+        for(Resource input : pass.reads) use(input);
+        for(const Write& write : pass.writes) use(write.resource);
+    }
+
+    // place the transients, a texture is free again once the pass that last used it is done
+    trimPool();
+    for(PooledTexture& pooled : m_pool) pooled.inUse = false;
+    std::vector<bool> touched;
+
+    for(Pass p = 0; p < static_cast<Pass>(m_passes.size()); p++) {
+        if(m_passes[p].culled) continue;
+
+        for(ResourceNode& resource : m_resources) {
+            if(resource.firstUse != p) continue;
+            resource.physical = acquireTexture(resource.desc);
+            m_transients++;
+
+            touched.resize(m_pool.size(), false);
+            if(!touched[resource.physical]) {
+                touched[resource.physical] = true;
+                m_physicalTextures++;
+            }
+        }
+        for(ResourceNode& resource : m_resources) {
+            if(resource.lastUse == p) m_pool[resource.physical].inUse = false;
+        }
+    }
+
+    m_compiled = true;
+    return true;
+}
+
+void RenderGraph::execute() {
+    if(!m_compiled) return;
+
+    for(Pass p = 0; p < static_cast<Pass>(m_passes.size()); p++) {
+        PassNode& pass = m_passes[p];
+        if(pass.culled) continue;
+
+        PerfCounters::Scope perfScope(pass.name.c_str());
+        bindTargets(p);
+        if(pass.execute) pass.execute();
+    }
+}
+
+GLuint RenderGraph::getTexture(Resource resource) const {
+    if(!isValid(resource) || m_resources[resource].physical < 0) return 0;
+    return m_pool[m_resources[resource].physical].texture;
+}
+
+int RenderGraph::getPassCount() const {
+    return static_cast<int>(m_passes.size());
+}
+
+int RenderGraph::getCulledPassCount() const {
+    return m_culledPasses;
+}
+
+int RenderGraph::getTransientCount() const {
+    return m_transients;
+}
+
+int RenderGraph::getPhysicalTextureCount() const {
+    return m_physicalTextures;
+}
+
+size_t RenderGraph::getPoolBytes() const {
+    size_t bytes = 0;
+    for(const PooledTexture& pooled : m_pool) {
+        bytes += MemoryTracker::getTextureBytes(pooled.desc.format, pooled.desc.width, pooled.desc.height);
+    }
+    return bytes;
+}
+
+bool RenderGraph::isValid(Resource resource) const {
+    return resource >= 0 && resource < static_cast<Resource>(m_resources.size());
+}
+
+int RenderGraph::acquireTexture(const TextureDesc& desc) {
+    for(int i = 0; i < static_cast<int>(m_pool.size()); i++) {
+        PooledTexture& pooled = m_pool[i];
+        if(pooled.inUse || !(pooled.desc == desc)) continue;
+        pooled.inUse = true;
+        pooled.idleFrames = 0;
+        return i;
+    }
+
+    GLenum format, type;
+    getUploadFormat(desc.format, format, type);
+
+    PooledTexture pooled;
+    pooled.desc = desc;
+    pooled.inUse = true;
+    glGenTextures(1, &pooled.texture);
+    GLState::bindTexture(0, GL_TEXTURE_2D, pooled.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+    MemoryTracker::trackTexture(pooled.texture, MemoryTag::Renderer, MemoryTracker::getTextureBytes(desc.format, desc.width, desc.height));
+
+    m_pool.push_back(pooled);
+    return static_cast<int>(m_pool.size() - 1);
+}
+
+// runs before this frame's placement, so only textures no transient points at can go
+void RenderGraph::trimPool() {
+    for(size_t i = 0; i < m_pool.size();) {
+        PooledTexture& pooled = m_pool[i];
+        if(pooled.idleFrames++ < kMaxIdleFrames) {
+            i++;
+            continue;
+        }
+
+        deleteFramebuffersUsing(pooled.texture);
+        MemoryTracker::untrackTexture(pooled.texture);
+        GLState::forgetTexture(pooled.texture);
+        glDeleteTextures(1, &pooled.texture);
+        m_pool.erase(m_pool.begin() + i);
+    }
+}
+
+void RenderGraph::deleteFramebuffersUsing(GLuint texture) {
+    for(auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+        bool uses = false;
+        for(GLuint attached : it->first) uses = uses || attached == texture;
+        if(!uses) {
+            ++it;
+            continue;
+        }
+
+        GLState::forgetFramebuffer(it->second);
+        glDeleteFramebuffers(1, &it->second);
+        it = m_framebuffers.erase(it);
+    }
+}
+
+GLuint RenderGraph::getFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment) {
+    std::vector<GLuint> key = colors;
+    key.push_back(depth);
+
+    auto found = m_framebuffers.find(key);
+    if(found != m_framebuffers.end()) return found->second;
+
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    std::vector<GLenum> drawBuffers;
+    for(size_t i = 0; i < colors.size(); i++) {
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, colors[i], 0);
+        drawBuffers.push_back(attachment);
+    }
+    if(depth) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+    }
+
+    // a depth only target draws no color
+    if(drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else {
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    }
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR::RENDER_GRAPH:: framebuffer for " << colors.size() << " color attachments is not complete" << std::endl;
+    }
+
+    m_framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+void RenderGraph::bindTargets(Pass index) {
+    const PassNode& pass = m_passes[index];
+
+    const ResourceNode* imported = nullptr;
+    bool clearImported = false;
+    std::vector<GLuint> colors;
+    std::vector<std::pair<GLint, glm::vec4>> colorClears;
+    GLuint depth = 0;
+    GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    bool clearDepth = false;
+    int width = 0;
+    int height = 0;
+
+    for(const Write& write : pass.writes) {
+        const ResourceNode& resource = m_resources[write.resource];
+        bool clear = write.load == Load::Clear;
+
+        if(resource.type == ResourceType::Framebuffer) {
+            imported = &resource;
+            clearImported = clear;
+        }
+        else if(resource.type == ResourceType::Transient) {
+            clear = clear || resource.firstUse == index;
+            GLuint texture = m_pool[resource.physical].texture;
+            if(isDepthFormat(resource.desc.format)) {
+                depth = texture;
+                if(resource.desc.format == GL_DEPTH24_STENCIL8) depthAttachment = GL_DEPTH_STENCIL_ATTACHMENT;
+                clearDepth = clear;
+            }
+            else {
+                if(clear) colorClears.push_back({ static_cast<GLint>(colors.size()), resource.clearColor });
+                colors.push_back(texture);
+            }
+        }
+        else {
+            continue;
+        }
+        width = resource.desc.width;
+        height = resource.desc.height;
+    }
+
+    // nothing to draw into, the pass brings its own targets (shadow maps) or none
+    if(!imported && colors.empty() && !depth) return;
+
+    GLuint framebuffer = imported ? imported->framebuffer : getFramebuffer(colors, depth, depthAttachment);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GLState::setViewport(0, 0, width, height);
+
+    if(clearImported) {
+        glClearColor(imported->clearColor.r, imported->clearColor.g, imported->clearColor.b, imported->clearColor.a);
+        GLState::setDepthMask(true); // a masked depth buffer isn't cleared
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    for(const auto& clear : colorClears) {
+        glClearBufferfv(GL_COLOR, clear.first, &clear.second.x);
+    }
+    if(clearDepth) {
+        GLState::setDepthMask(true);
+        if(depthAttachment == GL_DEPTH_STENCIL_ATTACHMENT) {
+            glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+        }
+        else {
+            GLfloat one = 1.0f;
+            glClearBufferfv(GL_DEPTH, 0, &one);
+        }
+    }
+}
@@ -1,30 +1,97 @@
 #include "renderer/Renderer.h"
+#include "renderer/GLState.h"
+
+#include <algorithm>
+#include <cstdint>
 
 // static member definitions
 GLuint Renderer::s_LineVAO = 0;
-GLuint Renderer::s_LineVBO = 0;
+int Renderer::s_viewportWidth = 1280;
+int Renderer::s_viewportHeight = 720;
 
 std::unique_ptr<Shader> Renderer::s_lineShader = nullptr;
 std::unique_ptr<Skybox> Renderer::s_skybox = nullptr;   
+std::unique_ptr<CascadedShadowMap> Renderer::s_shadowMap = nullptr;
+glm::vec3 Renderer::s_lightDir = glm::normalize(glm::vec3(0.5f, 1.0f, 0.5f));
+std::unique_ptr<ClusteredLighting> Renderer::s_clusteredLighting = nullptr;
+std::unique_ptr<OcclusionCuller> Renderer::s_occlusionCuller = nullptr;
+bool Renderer::s_occlusionCullingEnabled = true;
+int Renderer::s_frustumCulled = 0;
+int Renderer::s_occluded = 0;
+std::unique_ptr<ImageBasedLighting> Renderer::s_environment = nullptr;
+std::unique_ptr<SkinningPalette> Renderer::s_skinningPalette = nullptr;
+std::unique_ptr<SceneTarget> Renderer::s_sceneTarget = nullptr;
+std::unique_ptr<StreamBuffer> Renderer::s_streamBuffer = nullptr;
+GLint Renderer::s_uniformAlignment = 256;
+GLintptr Renderer::s_frameBlockOffset = -1;
+std::vector<unsigned int> Renderer::s_frameBlockPrograms;
+std::unique_ptr<RenderGraph> Renderer::s_renderGraph = nullptr;
+std::unique_ptr<Shader> Renderer::s_compositeShader = nullptr;
+GLuint Renderer::s_emptyVAO = 0;
+std::unique_ptr<ShaderVariants> Renderer::s_litShader = nullptr;
+std::vector<Renderer::DrawItem> Renderer::s_drawQueue;
+int Renderer::s_queuedDraws = 0;
+int Renderer::s_programSwitches = 0;
+bool Renderer::s_backfaceCullingEnabled = true;
+std::vector<GLsizei> Renderer::s_rangeCounts;
+std::vector<const void*> Renderer::s_rangeOffsets;
+int Renderer::s_meshletsTested = 0;
+int Renderer::s_meshletsOutside = 0;
+int Renderer::s_meshletsBackfacing = 0;
+
+// texture unit the lit shader reads the shadow cascades from, above the material textures
+static const int kShadowTextureUnit = 8;
+static const int kLightDataTextureUnit = 9;
+static const int kClusterDataTextureUnit = 10;
+static const int kEnvironmentTextureUnit = 11;
+static const int kBrdfLutTextureUnit = 12;
+static const int kJointPaletteTextureUnit = 13;
+
+// a frame's worth of uniforms and debug lines, grows by itself if a frame needs more
+static const size_t kStreamRegionSize = 1024 * 1024;
+
+static const glm::vec4 kClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+// the view gizmo is drawn into its own square and blended into the corner of the scene
+static const int kGizmoSize = 100;
+static const int kGizmoMargin = 10;
+
+// std140 layout of FrameBlock in default.vert/.frag
+struct FrameBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float padding0;
+    glm::vec3 lightDir;
+    float padding1;
+};
 
 void Renderer::init() {
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::invalidate();
+    GLState::setEnabled(GL_DEPTH_TEST, true);
+    GLState::setEnabled(GL_BLEND, true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // world grid stuff
+    // meshes without baked occlusion leave location 5 disabled and read this instead
+    glVertexAttrib1f(5, 1.0f);
+
+    s_streamBuffer = std::make_unique<StreamBuffer>(kStreamRegionSize);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &s_uniformAlignment);
+
+    // world grid stuff, the vertices come from the stream buffer at draw time
     glGenVertexArrays(1, &s_LineVAO);
-    glGenBuffers(1, &s_LineVBO);
-    
-    glBindVertexArray(s_LineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, s_LineVBO);
-    glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-    
+    GLState::bindVertexArray(s_LineVAO);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     
     s_lineShader = std::make_unique<Shader>("shaders/simple_color.vert", "shaders/simple_color.frag");
 
+    glGenVertexArrays(1, &s_emptyVAO);
+    s_compositeShader = std::make_unique<Shader>("shaders/composite.vert", "shaders/composite.frag");
+    s_renderGraph = std::make_unique<RenderGraph>();
+
+    // bit i of a variant defines keyword i, the first three follow MaterialFlags
+    s_litShader = std::make_unique<ShaderVariants>("shaders/default.vert", "shaders/default.frag",
+        std::vector<std::string>{ "HAS_DIFFUSE_MAP", "HAS_SPECULAR_MAP", "HAS_NORMAL_MAP", "SKINNED" });
+
     // skybox initialization
     std::vector<std::string> faces
     {
@@ -36,48 +103,457 @@ void Renderer::init() {
         "textures/skybox/back.jpg"
     };
     s_skybox = std::make_unique<Skybox>(faces);
+
+    s_shadowMap = std::make_unique<CascadedShadowMap>();
+    s_clusteredLighting = std::make_unique<ClusteredLighting>();
+    s_occlusionCuller = std::make_unique<OcclusionCuller>();
+    s_skinningPalette = std::make_unique<SkinningPalette>();
+    MaterialLibrary::init();
+
+    // baked on the job system the first time, read from the .iblcache afterwards
+    s_environment = std::make_unique<ImageBasedLighting>();
+    s_environment->load("textures/Voxel_Skybox_free/Textures/Deep Midnight.exr");
 }
 
 void Renderer::clear(float r, float g, float b, float a) {
     glClearColor(r, g, b, a);
+    GLState::setDepthMask(true); // a masked depth buffer isn't cleared
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 void Renderer::setViewport(int x, int y, int width, int height) {
-    glViewport(x, y, width, height);
+    s_viewportWidth = width;
+    s_viewportHeight = height;
+    GLState::setViewport(x, y, width, height);
+}
+
+void Renderer::beginFrame(int outputWidth, int outputHeight, float resolutionScale) {
+    // the ui and anything else outside the renderer may have changed state since the last frame
+    GLState::resetStats();
+    GLState::invalidate();
+
+    if(!s_sceneTarget) {
+        s_sceneTarget = std::make_unique<SceneTarget>(outputWidth, outputHeight);
+    }
+    s_sceneTarget->resize(outputWidth, outputHeight);
+
+    // everything that sizes itself by the viewport (clusters, footprints, shadows) sees the scaled size
+    s_sceneTarget->bind(resolutionScale, s_viewportWidth, s_viewportHeight);
+
+    s_streamBuffer->nextFrame();
+    s_frameBlockOffset = -1;
+}
+
+void Renderer::endFrame() {
+    if(!s_sceneTarget) return;
+    s_sceneTarget->resolve();
+}
+
+const SceneTarget* Renderer::getSceneTarget() {
+    return s_sceneTarget.get();
+}
+
+void Renderer::submit(Model& model, const glm::mat4& view, const glm::mat4& projection) {
+    requestTextureFootprints(model, view, projection);
+
+    static const uint32_t kMaterialFeatures = kMaterialHasDiffuse | kMaterialHasSpecular | kMaterialHasNormalMap;
+    uint32_t modelFeatures = model.isSkinned() ? kVariantSkinned : 0u;
+    glm::mat4 world = model.getWorldMatrix();
+    glm::vec3 cameraPos = glm::vec3(glm::inverse(view)[3]);
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    for(const auto& mesh : model.m_meshes) {
+        if(!mesh.m_isVisible || mesh.m_isCulled) continue;
+
+        MaterialHandle material = mesh.getMaterial();
+        const Material& materialData = MaterialLibrary::get(material);
+        uint32_t variant = (materialData.params.flags & kMaterialFeatures) | modelFeatures;
+        bool cullBackfaces = s_backfaceCullingEnabled && !materialData.doubleSided;
+
+        DrawItem item;
+        item.key = (static_cast<uint64_t>(variant) << 32) | material;
+        item.mesh = &mesh;
+        item.model = &model;
+        // meshes from node hierarchies carry their own transform on top of the model's
+        item.world = mesh.m_hasTransform ? world * mesh.m_transform : world;
+
+        if(!mesh.getMeshlets().empty() && !cullMeshlets(mesh, item.world, cameraPos, frustum, cullBackfaces, item)) continue;
+        s_drawQueue.push_back(item);
+    }
+}
+
+// appends the index ranges of the meshlets that survive to the frame's range lists, neighbours
+// in the index buffer merge into one range. false if none survived
+bool Renderer::cullMeshlets(const Mesh& mesh, const glm::mat4& world, const glm::vec3& cameraPos, const Frustum& frustum,
+                            bool cullBackfaces, DrawItem& item) {
+    // the cones are in mesh space, which side is the back survives any transform that doesn't mirror
+    glm::mat3 linear(world);
+    bool testCones = cullBackfaces && glm::determinant(linear) > 0.0f;
+    glm::vec3 localCamera = glm::vec3(glm::inverse(world) * glm::vec4(cameraPos, 1.0f));
+    float maxScale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+
+    item.firstRange = static_cast<int>(s_rangeCounts.size());
+    uint32_t rangeStart = 0;
+    uint32_t rangeEnd = 0;
+    auto closeRange = [&]() {
+        if(rangeEnd == rangeStart) return;
+        s_rangeCounts.push_back(static_cast<GLsizei>(rangeEnd - rangeStart));
+        s_rangeOffsets.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(rangeStart) * sizeof(unsigned int)));
+    };
+
+    for(const Meshlet& meshlet : mesh.getMeshlets()) {
+        s_meshletsTested++;
+
+        BoundingSphere sphere;
+        sphere.center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+        sphere.radius = meshlet.radius * maxScale;
+        if(!frustum.intersectsSphere(sphere)) {
+            s_meshletsOutside++;
+            continue;
+        }
+        if(testCones && glm::dot(glm::normalize(meshlet.coneApex - localCamera), meshlet.coneAxis) >= meshlet.coneCutoff) {
+            s_meshletsBackfacing++;
+            continue;
+        }
+
+        if(meshlet.firstIndex != rangeEnd) {
+            closeRange();
+            rangeStart = meshlet.firstIndex;
+        }
+        rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+    }
+    closeRange();
+
+    item.rangeCount = static_cast<int>(s_rangeCounts.size()) - item.firstRange;
+    return item.rangeCount > 0;
 }
 
-void Renderer::submit(Shader& shader, Model& model, const glm::mat4& view, const glm::mat4& projection) {
+// one program switch per variant and one material bind per material, whatever order the models came in
+void Renderer::drawQueue(const glm::mat4& view, const glm::mat4& projection) {
+    std::sort(s_drawQueue.begin(), s_drawQueue.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.key < b.key;
+    });
+
+    s_queuedDraws = static_cast<int>(s_drawQueue.size());
+    s_programSwitches = 0;
+
+    // the cones drop whole back facing meshlets, the rasterizer the back faces of the rest.
+    // both only for single sided materials, the queue is sorted by material so it toggles rarely
+    bool mirrored = false;
+
+    Shader* shader = nullptr;
+    uint64_t currentVariant = UINT64_MAX;
+    uint64_t currentMaterial = UINT64_MAX;
+    const Model* currentModel = nullptr;
+
+    for(const DrawItem& item : s_drawQueue) {
+        uint64_t variant = item.key >> 32;
+        uint64_t material = item.key & 0xFFFFFFFFull;
+
+        if(variant != currentVariant) {
+            shader = &s_litShader->get(static_cast<uint32_t>(variant));
+            bindLitProgram(*shader, view, projection);
+            currentVariant = variant;
+            currentMaterial = UINT64_MAX;
+            currentModel = nullptr;
+            s_programSwitches++;
+        }
+        if(material != currentMaterial) {
+            MaterialLibrary::bind(static_cast<MaterialHandle>(material));
+            GLState::setEnabled(GL_CULL_FACE, s_backfaceCullingEnabled && !MaterialLibrary::get(static_cast<MaterialHandle>(material)).doubleSided);
+            currentMaterial = material;
+        }
+        if((variant & kVariantSkinned) && item.model != currentModel) {
+            shader->setInt("u_PaletteOffset", item.model->m_paletteOffset);
+        }
+        currentModel = item.model;
+
+        // a mirroring transform turns the winding around
+        bool itemMirrored = glm::determinant(glm::mat3(item.world)) < 0.0f;
+        if(s_backfaceCullingEnabled && itemMirrored != mirrored) {
+            glFrontFace(itemMirrored ? GL_CW : GL_CCW);
+            mirrored = itemMirrored;
+        }
+
+        shader->setMat4("u_Model", item.world);
+        if(item.rangeCount > 0) {
+            item.mesh->drawRanges(&s_rangeCounts[item.firstRange], &s_rangeOffsets[item.firstRange], item.rangeCount);
+        } else {
+            item.mesh->drawDepth();
+        }
+    }
+
+    if(mirrored) glFrontFace(GL_CCW);
+    GLState::setEnabled(GL_CULL_FACE, false);
+
+    s_drawQueue.clear();
+    s_rangeCounts.clear();
+    s_rangeOffsets.clear();
+}
+
+void Renderer::bindLitProgram(Shader& shader, const glm::mat4& view, const glm::mat4& projection) {
     shader.use();
+    MaterialLibrary::setupProgram(shader);
+    setupFrameBlock(shader);
 
-    // set the view and projection matrices
-    // in the shader
-    shader.setMat4("u_View", view);
-    shader.setMat4("u_Projection", projection);
-    shader.setMat4("u_Model", model.getModelMatrix());
+    // view, projection, camera and light go up once a frame, only the model matrix is per draw
+    if(s_frameBlockOffset < 0) {
+        uploadFrameBlock(view, projection);
+    }
+    if(s_shadowMap) {
+        s_shadowMap->bind(shader, kShadowTextureUnit);
+    }
+    if(s_clusteredLighting) {
+        s_clusteredLighting->bind(shader, kLightDataTextureUnit, kClusterDataTextureUnit, s_viewportWidth, s_viewportHeight);
+    }
+    if(s_environment) {
+        s_environment->bind(shader, kEnvironmentTextureUnit, kBrdfLutTextureUnit);
+    }
+    if(s_skinningPalette) {
+        s_skinningPalette->bind(shader, kJointPaletteTextureUnit);
+    }
+}
+
+const ShaderVariants* Renderer::getLitShader() {
+    return s_litShader.get();
+}
+
+int Renderer::getQueuedDrawCount() {
+    return s_queuedDraws;
+}
+
+int Renderer::getProgramSwitchCount() {
+    return s_programSwitches;
+}
+
+void Renderer::setBackfaceCulling(bool enabled) {
+    s_backfaceCullingEnabled = enabled;
+}
 
-    model.draw(shader);
+bool Renderer::isBackfaceCullingEnabled() {
+    return s_backfaceCullingEnabled;
+}
 
+int Renderer::getTestedMeshletCount() {
+    return s_meshletsTested;
 }
 
-void Renderer::beginScene(glm::mat4& view, glm::mat4& projection) {
-    // draw skybox first
-    if(s_skybox) {
-        s_skybox->draw(view, projection);
+int Renderer::getOutsideMeshletCount() {
+    return s_meshletsOutside;
+}
+
+int Renderer::getBackfacingMeshletCount() {
+    return s_meshletsBackfacing;
+}
+
+// estimates how many pixels each visible mesh covers and tells the streamer,
+// so far away or off screen textures never get their top mips
+void Renderer::requestTextureFootprints(const Model& model, const glm::mat4& view, const glm::mat4& projection) {
+    glm::mat4 world = model.getWorldMatrix();
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    for(const auto& mesh : model.m_meshes) {
+        const Material& material = MaterialLibrary::get(mesh.getMaterial());
+        if(!mesh.m_isVisible || mesh.m_isCulled || material.params.flags == 0 || !mesh.m_bounds.isValid()) continue;
+
+        BoundingSphere sphere = getWorldSphere(mesh.m_bounds, world);
+        if(!frustum.intersectsSphere(sphere)) continue;
+
+        // projected diameter in pixels, projection[1][1] is 1 / tan(fov / 2)
+        float depth = -(view * glm::vec4(sphere.center, 1.0f)).z;
+        float footprint = static_cast<float>(s_viewportHeight);
+        if(depth > sphere.radius) {
+            footprint = std::min(footprint, sphere.radius * projection[1][1] / depth * s_viewportHeight);
+        }
+
+        for(GLuint texture : material.textures) {
+            if(texture) TextureStreamer::requestFootprint(texture, footprint);
+        }
     }
+}
+
+void Renderer::setLightDirection(const glm::vec3& direction) {
+    s_lightDir = glm::normalize(direction);
+}
+
+void Renderer::renderShadows(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection) {
+    if(!s_shadowMap) return;
+
+    s_shadowMap->update(models, view, projection, s_lightDir, s_skinningPalette.get(), kJointPaletteTextureUnit);
+
+    // the shadow pass leaves its own viewport behind
+    GLState::setViewport(0, 0, s_viewportWidth, s_viewportHeight);
+}
+
+const CascadedShadowMap* Renderer::getShadowMap() {
+    return s_shadowMap.get();
+}
+
+void Renderer::updateLights(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection) {
+    if(s_clusteredLighting) {
+        s_clusteredLighting->update(lights, view, projection);
+    }
+}
+
+const ClusteredLighting* Renderer::getClusteredLighting() {
+    return s_clusteredLighting.get();
+}
+
+void Renderer::cullScene(const std::vector<std::unique_ptr<Model>>& models, const glm::mat4& view, const glm::mat4& projection) {
+    s_frustumCulled = 0;
+    s_occluded = 0;
+    // the meshlets of what survives here are tested when the models are submitted
+    s_meshletsTested = 0;
+    s_meshletsOutside = 0;
+    s_meshletsBackfacing = 0;
+
+    bool useOcclusion = s_occlusionCullingEnabled && s_occlusionCuller;
+    if(useOcclusion) {
+        s_occlusionCuller->render(models, view, projection);
+    }
+
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    for(auto& model : models) {
+        glm::mat4 world = model->getWorldMatrix();
+
+        for(auto& mesh : model->m_meshes) {
+            mesh.m_isCulled = false;
+            if(!mesh.m_isVisible || !mesh.m_bounds.isValid()) continue;
+
+            BoundingBox worldBox = mesh.m_bounds.transformed(world);
+            if(!frustum.intersectsBox(worldBox)) {
+                mesh.m_isCulled = true;
+                s_frustumCulled++;
+            }
+            else if(useOcclusion && !s_occlusionCuller->isVisible(worldBox)) {
+                mesh.m_isCulled = true;
+                s_occluded++;
+            }
+        }
+    }
+}
+
+void Renderer::setOcclusionCulling(bool enabled) {
+    s_occlusionCullingEnabled = enabled;
+}
+
+bool Renderer::isOcclusionCullingEnabled() {
+    return s_occlusionCullingEnabled;
+}
+
+const OcclusionCuller* Renderer::getOcclusionCuller() {
+    return s_occlusionCuller.get();
+}
+
+int Renderer::getFrustumCulledCount() {
+    return s_frustumCulled;
+}
+
+int Renderer::getOccludedCount() {
+    return s_occluded;
+}
+
+void Renderer::updateSkinning(const std::vector<std::unique_ptr<Model>>& models) {
+    if(s_skinningPalette) {
+        s_skinningPalette->update(models);
+    }
+}
 
-    drawGrid(view, projection);
-    drawAxes(view, projection);
+const SkinningPalette* Renderer::getSkinningPalette() {
+    return s_skinningPalette.get();
+}
+
+const ImageBasedLighting* Renderer::getEnvironment() {
+    return s_environment.get();
+}
+
+void Renderer::renderScene(const std::vector<std::unique_ptr<Model>>& models, const std::vector<Light>& lights,
+                           const glm::mat4& view, const glm::mat4& projection, bool drawOverlays) {
+    RenderGraph& graph = *s_renderGraph;
+    graph.reset();
+
+    RenderGraph::Resource scene = graph.importFramebuffer("Scene", s_sceneTarget->getFramebuffer(), s_viewportWidth, s_viewportHeight, true);
+    graph.setClearColor(scene, kClearColor);
+    // these live in the renderer's own objects, the graph only needs them to order and cull the passes
+    RenderGraph::Resource palette = graph.importExternal("Joint Palette");
+    RenderGraph::Resource shadows = graph.importExternal("Shadow Map");
+    RenderGraph::Resource clusters = graph.importExternal("Light Clusters");
+    RenderGraph::Resource visibility = graph.importExternal("Visibility");
+
+    RenderGraph::Pass skinning = graph.addPass("Skinning", [&]() { updateSkinning(models); });
+    graph.write(skinning, palette);
+
+    RenderGraph::Pass shadowPass = graph.addPass("Shadows", [&]() { renderShadows(models, view, projection); });
+    graph.read(shadowPass, palette);
+    graph.write(shadowPass, shadows);
+
+    RenderGraph::Pass lightPass = graph.addPass("Light Binning", [&]() { updateLights(lights, view, projection); });
+    graph.write(lightPass, clusters);
+
+    RenderGraph::Pass culling = graph.addPass("Culling", [&]() { cullScene(models, view, projection); });
+    graph.write(culling, visibility);
+
+    RenderGraph::Pass sky = graph.addPass("Sky", [&]() {
+        if(s_skybox) s_skybox->draw(view, projection);
+    });
+    graph.write(sky, scene, RenderGraph::Load::Clear);
+
+    RenderGraph::Pass opaque = graph.addPass("Opaque", [&]() {
+        for(auto& model : models) {
+            submit(*model, view, projection);
+        }
+        drawQueue(view, projection);
+    });
+    graph.read(opaque, palette);
+    graph.read(opaque, shadows);
+    graph.read(opaque, clusters);
+    graph.read(opaque, visibility);
+    graph.write(opaque, scene);
+
+    // the gizmo is always declared, without the composite that reads it the graph culls it
+    RenderGraph::Resource gizmoColor = graph.createTexture("Gizmo Color", { kGizmoSize, kGizmoSize, GL_RGBA8 });
+    RenderGraph::Resource gizmoDepth = graph.createTexture("Gizmo Depth", { kGizmoSize, kGizmoSize, GL_DEPTH_COMPONENT24 });
+    RenderGraph::Pass gizmo = graph.addPass("View Gizmo", [&]() { drawViewportGizmo(view); });
+    graph.write(gizmo, gizmoColor);
+    graph.write(gizmo, gizmoDepth);
+
+    if(drawOverlays) {
+        RenderGraph::Pass overlays = graph.addPass("Overlays", [&]() {
+            drawGrid(view, projection);
+            drawAxes(view, projection);
+        });
+        graph.write(overlays, scene);
+
+        RenderGraph::Pass composite = graph.addPass("Gizmo Composite", [&]() {
+            compositeTexture(graph.getTexture(gizmoColor), kGizmoMargin, kGizmoMargin, kGizmoSize, kGizmoSize);
+        });
+        graph.read(composite, gizmoColor);
+        graph.write(composite, scene);
+    }
+
+    if(graph.compile()) {
+        graph.execute();
+    }
+}
+
+const RenderGraph* Renderer::getRenderGraph() {
+    return s_renderGraph.get();
 }
 
 void Renderer::drawGrid(const glm::mat4& view, const glm::mat4& projection) {
     int size = 50; // Total size 100x100
+    std::vector<glm::vec3> points;
+    points.reserve((2 * size + 1) * 4);
     for(int i = -size; i <= size; i++) {
         // Draw lines along X
-        renderLine(glm::vec3(i, 0, -size), glm::vec3(i, 0, size), glm::vec3(0.3f), view, projection); // Pass view, projection
+        points.push_back(glm::vec3(i, 0, -size));
+        points.push_back(glm::vec3(i, 0, size));
         // Draw lines along Z
-        renderLine(glm::vec3(-size, 0, i), glm::vec3(size, 0, i), glm::vec3(0.3f), view, projection); // Pass view, projection
+        points.push_back(glm::vec3(-size, 0, i));
+        points.push_back(glm::vec3(size, 0, i));
     }
+    renderLines(points.data(), points.size(), glm::vec3(0.3f), view, projection);
 }
 
 void Renderer::drawAxes(const glm::mat4& view, const glm::mat4& projection) {
@@ -88,7 +564,7 @@ void Renderer::drawAxes(const glm::mat4& view, const glm::mat4& projection) {
     axisShader.setMat4("u_Projection", projection);
     axisShader.setMat4("u_Model", glm::mat4(1.0f)); // Axes are in world space
 
-    glClear(GL_DEPTH_BUFFER_BIT); // Clear depth only so axes draw on top of everything
+    GLState::setEnabled(GL_DEPTH_TEST, false); // axes draw on top of everything
     glLineWidth(3.0f);
 
     // X - Red
@@ -99,55 +575,113 @@ void Renderer::drawAxes(const glm::mat4& view, const glm::mat4& projection) {
     renderLine(glm::vec3(0,0,0), glm::vec3(0,0,5), glm::vec3(0,0,1), view, projection); // Pass view, projection
 
     glLineWidth(1.0f); // Reset line width
+    GLState::setEnabled(GL_DEPTH_TEST, true);
 }
 
 void Renderer::renderLine(glm::vec3 start, glm::vec3 end, glm::vec3 color, const glm::mat4& view, const glm::mat4& projection) {
+    glm::vec3 points[] = { start, end };
+    renderLines(points, 2, color, view, projection);
+}
+
+void Renderer::renderLines(const glm::vec3* points, size_t count, glm::vec3 color, const glm::mat4& view, const glm::mat4& projection) {
     s_lineShader->use();
     s_lineShader->setMat4("u_View", view);
     s_lineShader->setMat4("u_Projection", projection);
     s_lineShader->setMat4("u_Model", glm::mat4(1.0f)); // Grid/Axes are in world space
     s_lineShader->setVec3("u_Color", color);
 
-    float vertices[] = { start.x, start.y, start.z, end.x, end.y, end.z };
+    GLintptr offset = s_streamBuffer->upload(points, count * sizeof(glm::vec3), sizeof(float));
 
-    glBindVertexArray(s_LineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, s_LineVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Update existing buffer
-    
-    glDrawArrays(GL_LINES, 0, 2);
+    // the buffer can change when the stream grows, so the attribute is pointed at it every draw
+    GLState::bindVertexArray(s_LineVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, s_streamBuffer->getBuffer());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), reinterpret_cast<void*>(offset));
+
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(count));
 }
 
-// ai slop right here
-void Renderer::drawViewportGizmo(const glm::mat4& cameraRotation, const glm::mat4& projection) {
-    // 1. Save current viewport to restore it later
-    GLint oldViewport[4];
-    glGetIntegerv(GL_VIEWPORT, oldViewport);
+void Renderer::setupFrameBlock(const Shader& shader) {
+    for(unsigned int program : s_frameBlockPrograms) {
+        if(program == shader.m_ID) return;
+    }
+    s_frameBlockPrograms.push_back(shader.m_ID);
 
-    // 2. Set viewport to a small square in the top-right or bottom-left corner
-    int gizmoSize = 100;
-    glViewport(10, 10, gizmoSize, gizmoSize); // (x, y, width, height)
+    GLuint block = glGetUniformBlockIndex(shader.m_ID, "FrameBlock");
+    if(block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.m_ID, block, kFrameBlockBinding);
+    }
+}
 
-    // 3. Clear the depth buffer so it draws ON TOP of the cottage
-    glClear(GL_DEPTH_BUFFER_BIT);
+void Renderer::uploadFrameBlock(const glm::mat4& view, const glm::mat4& projection) {
+    FrameBlock block;
+    block.view = view;
+    block.projection = projection;
+    block.viewPos = glm::vec3(glm::inverse(view)[3]);
+    block.padding0 = 0.0f;
+    block.lightDir = s_lightDir;
+    block.padding1 = 0.0f;
 
-    // 4. Create a View Matrix that ONLY has rotation (removes camera position)
-    // This makes the gizmo rotate as you move the mouse, but it stays centered in its tiny box
-    glm::mat4 gizmoView = glm::mat4(glm::mat3(cameraRotation)); 
-    
-    // 5. Use an Orthographic projection so the axes don't look "skewed"
+    s_frameBlockOffset = s_streamBuffer->upload(&block, sizeof(block), static_cast<size_t>(s_uniformAlignment));
+    glBindBufferRange(GL_UNIFORM_BUFFER, kFrameBlockBinding, s_streamBuffer->getBuffer(), s_frameBlockOffset, sizeof(block));
+}
+
+// the render graph binds the gizmo's own square target before this runs
+void Renderer::drawViewportGizmo(const glm::mat4& cameraRotation) {
+    // a view matrix with only the rotation keeps the gizmo centered in its box
+    glm::mat4 gizmoView = glm::mat4(glm::mat3(cameraRotation));
+
+    // orthographic so the axes don't look skewed
     glm::mat4 gizmoProj = glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, 0.1f, 10.0f);
 
-    // 6. Draw the Axes (Reuse your existing logic)
     // X - Red
-    renderLine(glm::vec3(0,0,0), glm::vec3(1,1,0), glm::vec3(1,0,0), gizmoView, gizmoProj); 
+    renderLine(glm::vec3(0,0,0), glm::vec3(1,1,0), glm::vec3(1,0,0), gizmoView, gizmoProj);
     // Y - Green
-    renderLine(glm::vec3(0,0,0), glm::vec3(0,1,0), glm::vec3(0,1,0), gizmoView, gizmoProj); 
+    renderLine(glm::vec3(0,0,0), glm::vec3(0,1,0), glm::vec3(0,1,0), gizmoView, gizmoProj);
     // Z - Blue
-    renderLine(glm::vec3(0,0,0), glm::vec3(0,0,1), glm::vec3(0,0,1), gizmoView, gizmoProj); 
+    renderLine(glm::vec3(0,0,0), glm::vec3(0,0,1), glm::vec3(0,0,1), gizmoView, gizmoProj);
+}
+
+void Renderer::compositeTexture(GLuint texture, int x, int y, int width, int height) {
+    int viewport[4];
+    GLState::getViewport(viewport);
+    GLState::setViewport(x, y, width, height);
+    GLState::setEnabled(GL_DEPTH_TEST, false);
 
-    // 7. Restore the original viewport for the rest of the engine
-    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+    s_compositeShader->use();
+    s_compositeShader->setInt("u_Source", 0);
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+
+    // one triangle over the viewport, the vertex shader makes it from gl_VertexID
+    GLState::bindVertexArray(s_emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    GLState::setEnabled(GL_DEPTH_TEST, true);
+    GLState::setViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 }
 
 void Renderer::shutdown() {
+    MaterialLibrary::shutdown();
+    s_shadowMap.reset();
+    s_clusteredLighting.reset();
+    s_occlusionCuller.reset();
+    s_environment.reset();
+    s_skinningPalette.reset();
+    s_sceneTarget.reset();
+    s_streamBuffer.reset();
+    s_frameBlockPrograms.clear();
+    s_renderGraph.reset();
+    s_compositeShader.reset();
+    s_litShader.reset();
+    s_skybox.reset();
+    s_lineShader.reset();
+    GLState::forgetVertexArray(s_emptyVAO);
+    glDeleteVertexArrays(1, &s_emptyVAO);
+    s_emptyVAO = 0;
+    GLState::forgetVertexArray(s_LineVAO);
+    glDeleteVertexArrays(1, &s_LineVAO);
+    s_LineVAO = 0;
+}
+
+const StreamBuffer* Renderer::getStreamBuffer() {
+    return s_streamBuffer.get();
 }
\ No newline at end of file
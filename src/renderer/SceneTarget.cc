@@ -0,0 +1,101 @@
+#include "renderer/SceneTarget.h"
+#include "renderer/GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+SceneTarget::SceneTarget(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_renderWidth(width)
+    , m_renderHeight(height)
+{
+    create();
+}
+
+SceneTarget::~SceneTarget() {
+    destroy();
+}
+
+void SceneTarget::create() {
+    glGenTextures(1, &m_color);
+    GLState::bindTexture(0, GL_TEXTURE_2D, m_color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_FBO);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+
+    MemoryTracker::trackTexture(m_color, MemoryTag::Renderer, MemoryTracker::getTextureBytes(GL_RGBA8, m_width, m_height));
+    MemoryTracker::trackRenderbuffer(m_depth, MemoryTag::Renderer, MemoryTracker::getTextureBytes(GL_DEPTH24_STENCIL8, m_width, m_height));
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR::FRAMEBUFFER:: scene target is not complete" << std::endl;
+    }
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SceneTarget::destroy() {
+    MemoryTracker::untrackTexture(m_color);
+    MemoryTracker::untrackRenderbuffer(m_depth);
+    GLState::forgetFramebuffer(m_FBO);
+    GLState::forgetTexture(m_color);
+    glDeleteFramebuffers(1, &m_FBO);
+    glDeleteRenderbuffers(1, &m_depth);
+    glDeleteTextures(1, &m_color);
+}
+
+void SceneTarget::bind(float scale, int& renderWidth, int& renderHeight) {
+    m_renderWidth = std::clamp(static_cast<int>(std::lround(m_width * scale)), 1, m_width);
+    m_renderHeight = std::clamp(static_cast<int>(std::lround(m_height * scale)), 1, m_height);
+
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    GLState::setViewport(0, 0, m_renderWidth, m_renderHeight);
+
+    renderWidth = m_renderWidth;
+    renderHeight = m_renderHeight;
+}
+
+void SceneTarget::resolve() {
+    GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+    GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    // only color, the ui on top doesn't need the scene's depth
+    GLenum filter = (m_renderWidth == m_width && m_renderHeight == m_height) ? GL_NEAREST : GL_LINEAR;
+    glBlitFramebuffer(0, 0, m_renderWidth, m_renderHeight, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, filter);
+
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::setViewport(0, 0, m_width, m_height);
+}
+
+void SceneTarget::resize(int width, int height) {
+    if(width == m_width && height == m_height) return;
+    if(width <= 0 || height <= 0) return; // minimized
+
+    m_width = width;
+    m_height = height;
+    destroy();
+    create();
+}
+
+int SceneTarget::getWidth() const {
+    return m_width;
+}
+
+int SceneTarget::getHeight() const {
+    return m_height;
+}
+
+GLuint SceneTarget::getFramebuffer() const {
+    return m_FBO;
+}
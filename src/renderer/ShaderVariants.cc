@@ -0,0 +1,37 @@
+#include "renderer/ShaderVariants.h"
+
+#include <utility>
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, std::vector<std::string> keywords)
+    : m_vertexPath(vertexPath)
+    , m_fragmentPath(fragmentPath)
+    , m_keywords(std::move(keywords))
+{
+}
+
+Shader& ShaderVariants::get(uint32_t features) {
+    // bits without a keyword don't change the code, so they don't get their own variant
+    uint32_t known = m_keywords.size() >= 32 ? ~0u : (1u << m_keywords.size()) - 1u;
+    features &= known;
+
+    auto found = m_variants.find(features);
+    if(found != m_variants.end()) return *found->second;
+
+    std::vector<std::string> defines;
+    for(size_t i = 0; i < m_keywords.size(); i++) {
+        if(features & (1u << i)) defines.push_back(m_keywords[i]);
+    }
+
+    std::cout << "[Debug] Compiling " << m_fragmentPath << " variant 0x" << std::hex << features << std::dec;
+    for(const std::string& define : defines) std::cout << " " << define;
+    std::cout << std::endl;
+
+    auto shader = std::make_unique<Shader>(m_vertexPath, m_fragmentPath, defines);
+    Shader& variant = *shader;
+    m_variants.emplace(features, std::move(shader));
+    return variant;
+}
+
+size_t ShaderVariants::getCompiledCount() const {
+    return m_variants.size();
+}
@@ -1,34 +1,41 @@
 #include "renderer/Shaders.h"
+#include "renderer/GLState.h"
+#include "core/VirtualFileSystem.h"
 
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
+// #version has to stay the first line, the defines go right below it
+static std::string addDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if(defines.empty()) return source;
 
-    // placeholders for the shaders cod3
-    std::string vertexCode, fragmentCode;
-
-    // file streams, to open the shader files
-    std::ifstream vshaderFile, fshaderFile;
+    std::string block;
+    for(const std::string& define : defines) {
+        block += "#define " + define + "\n";
+    }
+    block += "#line 2\n"; // compile errors keep the file's line numbers
 
-    vshaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fshaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    size_t version = source.find("#version");
+    size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+    if(lineEnd == std::string::npos) return block + source;
+    return source.substr(0, lineEnd + 1) + block + source.substr(lineEnd + 1);
+}
 
-    try {
-        vshaderFile.open(vertexPath);
-        fshaderFile.open(fragmentPath);
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
+    : Shader(vertexPath, fragmentPath, {})
+{
+}
 
-        std::stringstream vshaderStream, fshaderStream;
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines) {
 
-        // standard input the file's buffer contents into streams
-        vshaderStream << vshaderFile.rdbuf();
-        fshaderStream << fshaderFile.rdbuf();
+    // placeholders for the shaders cod3
+    std::string vertexCode, fragmentCode;
 
-        // convert stream into string
-        vertexCode = vshaderStream.str();
-        fragmentCode = fshaderStream.str();
+    // through the virtual file system, so they come out of the asset pack when one is mounted
+    FileData vshaderFile = VirtualFileSystem::read(vertexPath);
+    FileData fshaderFile = VirtualFileSystem::read(fragmentPath);
 
-        // close the files
-        vshaderFile.close();
-        fshaderFile.close();
-    } catch (std::ifstream::failure& e) {
+    if(vshaderFile.isValid() && fshaderFile.isValid()) {
+        vertexCode = addDefines(std::string(vshaderFile.data(), vshaderFile.size()), defines);
+        fragmentCode = addDefines(std::string(fshaderFile.data(), fshaderFile.size()), defines);
+    } else {
         std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
 
@@ -64,7 +71,7 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
 }
 
 void Shader::use() {
-    glUseProgram(m_ID);
+    GLState::useProgram(m_ID);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type) {
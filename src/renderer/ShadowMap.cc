@@ -0,0 +1,302 @@
+#include "renderer/ShadowMap.h"
+#include "renderer/GLState.h"
+
+#include <cmath>
+#include <cstring>
+
+// blend between logarithmic and uniform split distances
+static const float kSplitLambda = 0.75f;
+// the cached cascade only moves in steps of this fraction of its radius
+static const float kSnapFraction = 0.25f;
+// casters this far behind a cascade (towards the light) still land in it
+static const float kCasterPadding = 50.0f;
+
+CascadedShadowMap::CascadedShadowMap(int resolution)
+    : m_resolution(resolution)
+{
+    GLuint* textures[] = { &m_staticDepth, &m_depth };
+    for(GLuint* texture : textures) {
+        glGenTextures(1, texture);
+        GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, *texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, m_resolution, m_resolution, kNumCascades,
+                     0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+        float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+        MemoryTracker::trackTexture(*texture, MemoryTag::Renderer,
+                                    MemoryTracker::getTextureBytes(GL_DEPTH_COMPONENT24, m_resolution, m_resolution, kNumCascades));
+    }
+
+    // the sampled array does the depth comparison in hardware (bilinear pcf)
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, m_depth);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    GLuint* fbos[] = { &m_staticFBO, &m_FBO };
+    for(GLuint* fbo : fbos) {
+        glGenFramebuffers(1, fbo);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, *fbo);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_depthShaders = std::make_unique<ShaderVariants>("shaders/shadow_depth.vert", "shaders/shadow_depth.frag",
+        std::vector<std::string>{ "SKINNED" });
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+    GLState::forgetFramebuffer(m_staticFBO);
+    GLState::forgetFramebuffer(m_FBO);
+    GLState::forgetTexture(m_staticDepth);
+    GLState::forgetTexture(m_depth);
+    glDeleteFramebuffers(1, &m_staticFBO);
+    glDeleteFramebuffers(1, &m_FBO);
+    MemoryTracker::untrackTexture(m_staticDepth);
+    MemoryTracker::untrackTexture(m_depth);
+    glDeleteTextures(1, &m_staticDepth);
+    glDeleteTextures(1, &m_depth);
+}
+
+void CascadedShadowMap::update(const std::vector<std::unique_ptr<Model>>& models,
+                               const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDir,
+                               const SkinningPalette* skinning, int paletteUnit)
+{
+    m_staticRedraws = 0;
+    m_casterDraws = 0;
+
+    // a changed light or a moved/added/removed static caster makes every cached layer stale
+    uint64_t staticHash = hashStaticCasters(models);
+    if(lightDir != m_lightDir || staticHash != m_staticHash) {
+        invalidate();
+        m_lightDir = lightDir;
+        m_staticHash = staticHash;
+    }
+
+    fitCascades(view, projection);
+
+    bool anyDynamic = false;
+    for(const auto& model : models) {
+        if(!model->isStaticInHierarchy()) {
+            anyDynamic = true;
+            break;
+        }
+    }
+
+    // the scene may be going into an offscreen target, hand it back afterwards
+    GLuint previousFramebuffer = GLState::getDrawFramebuffer();
+
+    GLState::setViewport(0, 0, m_resolution, m_resolution);
+    GLState::setEnabled(GL_POLYGON_OFFSET_FILL, true);
+    GLState::setDepthMask(true); // the clears below need it
+    glPolygonOffset(2.0f, 4.0f);
+
+    // drawCasters picks the depth variant per model
+    m_skinning = skinning;
+    m_paletteUnit = paletteUnit;
+
+    for(int i = 0; i < kNumCascades; i++) {
+        Cascade& cascade = m_cascades[i];
+
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, m_staticFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticDepth, 0, i);
+
+        if(cascade.staticDirty) {
+            glClear(GL_DEPTH_BUFFER_BIT);
+            drawCasters(models, cascade, true);
+            m_staticRedraws++;
+        }
+
+        // the sampled layer only needs the cached copy again if something changed on top of it
+        bool needsCopy = cascade.staticDirty || cascade.hadDynamic || anyDynamic;
+        if(needsCopy) {
+            GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_FBO);
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth, 0, i);
+            glBlitFramebuffer(0, 0, m_resolution, m_resolution, 0, 0, m_resolution, m_resolution,
+                              GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        }
+
+        if(anyDynamic) {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+            drawCasters(models, cascade, false);
+        }
+
+        cascade.hadDynamic = anyDynamic;
+        cascade.staticDirty = false;
+    }
+
+    GLState::setEnabled(GL_POLYGON_OFFSET_FILL, false);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    m_skinning = nullptr;
+}
+
+void CascadedShadowMap::fitCascades(const glm::mat4& view, const glm::mat4& projection) {
+    // recover the camera parameters from the perspective matrix
+    float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+    float tanHalfX = 1.0f / projection[0][0];
+    float tanHalfY = 1.0f / projection[1][1];
+
+    glm::mat4 inverseView = glm::inverse(view);
+
+    glm::vec3 up = std::abs(m_lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -m_lightDir, up);
+
+    float splitNear = nearPlane;
+    for(int i = 0; i < kNumCascades; i++) {
+        Cascade& cascade = m_cascades[i];
+
+        float t = static_cast<float>(i + 1) / kNumCascades;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float splitFar = kSplitLambda * logSplit + (1.0f - kSplitLambda) * uniformSplit;
+
+        // bounding sphere of the slice, its radius does not change when the camera turns
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        int c = 0;
+        for(float z : { splitNear, splitFar }) {
+            for(float y : { -1.0f, 1.0f }) {
+                for(float x : { -1.0f, 1.0f }) {
+                    glm::vec4 viewCorner(x * z * tanHalfX, y * z * tanHalfY, -z, 1.0f);
+                    corners[c] = glm::vec3(inverseView * viewCorner);
+                    center += corners[c];
+                    c++;
+                }
+            }
+        }
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for(const auto& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // snap the light space center to a coarse grid, the cache survives small camera moves
+        float step = radius * kSnapFraction;
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        glm::vec3 snapped = glm::floor(lightCenter / step) * step;
+
+        if(snapped != cascade.snappedCenter || radius != cascade.radius) {
+            cascade.staticDirty = true;
+            cascade.snappedCenter = snapped;
+            cascade.radius = radius;
+        }
+
+        float extent = radius + step;
+        glm::mat4 lightProjection = glm::ortho(
+            snapped.x - extent, snapped.x + extent,
+            snapped.y - extent, snapped.y + extent,
+            -snapped.z - extent - kCasterPadding, -snapped.z + extent
+        );
+
+        cascade.lightViewProjection = lightProjection * lightView;
+        cascade.splitFar = splitFar;
+        splitNear = splitFar;
+    }
+}
+
+uint64_t CascadedShadowMap::hashStaticCasters(const std::vector<std::unique_ptr<Model>>& models) const {
+    // FNV-1a over the world matrices and visibility of every static caster
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for(size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    for(const auto& model : models) {
+        if(!model->isStaticInHierarchy()) continue;
+
+        const Model* pointer = model.get();
+        mix(&pointer, sizeof(pointer));
+
+        glm::mat4 world = model->getWorldMatrix();
+        mix(&world[0][0], sizeof(float) * 16);
+
+        for(const auto& mesh : model->m_meshes) {
+            bool visible = mesh.m_isVisible;
+            mix(&visible, sizeof(visible));
+        }
+    }
+
+    return hash;
+}
+
+void CascadedShadowMap::drawCasters(const std::vector<std::unique_ptr<Model>>& models, const Cascade& cascade, bool staticCasters) {
+    Frustum frustum = Frustum::fromMatrix(cascade.lightViewProjection);
+
+    // rigid casters first, then skinned ones, so there are at most two program switches
+    for(int skinned = 0; skinned < 2; skinned++) {
+        Shader* shader = nullptr;
+
+        for(const auto& model : models) {
+            if(model->isStaticInHierarchy() != staticCasters || model->isSkinned() != (skinned != 0)) continue;
+
+            glm::mat4 world = model->getWorldMatrix();
+            bool modelMatrixSet = false;
+            bool nodeTransformSet = false;
+
+            for(const auto& mesh : model->m_meshes) {
+                if(!mesh.m_isVisible || !mesh.m_bounds.isValid()) continue;
+
+                // per cascade culling with the same bounds the camera uses
+                if(!frustum.intersectsBox(mesh.m_bounds.transformed(world))) continue;
+
+                // compiled and set up the first time this pass draws anything with it
+                if(!shader) {
+                    shader = &m_depthShaders->get(skinned ? kDepthSkinned : 0u);
+                    shader->use();
+                    shader->setMat4("u_LightSpace", cascade.lightViewProjection);
+                    if(skinned && m_skinning) m_skinning->bind(*shader, m_paletteUnit);
+                }
+                if(!modelMatrixSet) {
+                    shader->setMat4("u_Model", world);
+                    if(skinned) shader->setInt("u_PaletteOffset", model->m_paletteOffset);
+                    modelMatrixSet = true;
+                }
+                if(mesh.m_hasTransform || nodeTransformSet) {
+                    shader->setMat4("u_Model", mesh.m_hasTransform ? world * mesh.m_transform : world);
+                    nodeTransformSet = mesh.m_hasTransform;
+                }
+
+                mesh.drawDepth();
+                m_casterDraws++;
+            }
+        }
+    }
+}
+
+void CascadedShadowMap::bind(Shader& shader, int textureUnit) const {
+    GLState::bindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, m_depth);
+
+    shader.setInt("u_ShadowMap", textureUnit);
+    for(int i = 0; i < kNumCascades; i++) {
+        std::string index = "[" + std::to_string(i) + "]";
+        shader.setMat4("u_LightSpace" + index, m_cascades[i].lightViewProjection);
+        shader.setFloat("u_CascadeSplits" + index, m_cascades[i].splitFar);
+    }
+}
+
+void CascadedShadowMap::invalidate() {
+    for(auto& cascade : m_cascades) {
+        cascade.staticDirty = true;
+    }
+}
+
+int CascadedShadowMap::getStaticRedraws() const {
+    return m_staticRedraws;
+}
+
+int CascadedShadowMap::getCasterDraws() const {
+    return m_casterDraws;
+}
@@ -0,0 +1,63 @@
+#include "renderer/SkinningPalette.h"
+#include "renderer/GLState.h"
+
+SkinningPalette::SkinningPalette() {
+    glGenBuffers(1, &m_buffer);
+    glGenTextures(1, &m_texture);
+
+    // an empty buffer texture is undefined, start with one identity joint
+    glm::vec4 identity[3] = { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) };
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(identity), identity, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, 0);
+}
+
+SkinningPalette::~SkinningPalette() {
+    MemoryTracker::untrackBuffer(m_buffer);
+    GLState::forgetTexture(m_texture);
+    glDeleteTextures(1, &m_texture);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void SkinningPalette::update(const std::vector<std::unique_ptr<Model>>& models) {
+    m_data.clear();
+    m_skinnedModels = 0;
+
+    for(const auto& model : models) {
+        const Animator* animator = model->getAnimator();
+        if(!animator) continue;
+
+        const std::vector<glm::vec4>& palette = animator->getPalette();
+        model->m_paletteOffset = static_cast<int>(m_data.size() / 3);
+        m_data.insert(m_data.end(), palette.begin(), palette.end());
+        m_skinnedModels++;
+    }
+
+    if(m_data.empty()) return;
+
+    // orphan and refill, last frame's draws may still be reading the old storage
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, m_data.size() * sizeof(glm::vec4), m_data.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    MemoryTracker::trackBuffer(m_buffer, MemoryTag::Renderer, m_data.size() * sizeof(glm::vec4));
+}
+
+void SkinningPalette::bind(Shader& shader, int textureUnit) const {
+    GLState::bindTexture(textureUnit, GL_TEXTURE_BUFFER, m_texture);
+
+    shader.setInt("u_JointPalette", textureUnit);
+}
+
+int SkinningPalette::getSkinnedModelCount() const {
+    return m_skinnedModels;
+}
+
+int SkinningPalette::getJointCount() const {
+    return static_cast<int>(m_data.size() / 3);
+}
@@ -0,0 +1,180 @@
+#include "renderer/StreamBuffer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "core/MemoryTracker.h"
+
+// glBufferStorage is GL 4.4, looked up at runtime so the 3.3 build doesn't need it
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (*BufferStorageFunction)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static BufferStorageFunction getBufferStorage() {
+    static BufferStorageFunction function = nullptr;
+    static bool checked = false;
+    if(!checked) {
+        checked = true;
+
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 4) || glfwExtensionSupported("GL_ARB_buffer_storage");
+        if(supported) {
+            function = reinterpret_cast<BufferStorageFunction>(glfwGetProcAddress("glBufferStorage"));
+        }
+        if(!function) {
+            std::cout << "[Debug] No buffer storage, stream buffers map each upload instead" << std::endl;
+        }
+    }
+    return function;
+}
+
+StreamBuffer::StreamBuffer(size_t regionSize) {
+    create(regionSize);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for(GLsync& fence : m_fences) {
+        if(fence) glDeleteSync(fence);
+    }
+    for(const RetiredBuffer& retired : m_retired) {
+        glDeleteBuffers(1, &retired.buffer);
+    }
+
+    MemoryTracker::untrackBuffer(m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    if(m_mapped) glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::create(size_t regionSize) {
+    m_regionSize = regionSize;
+    size_t totalSize = regionSize * kRegionCount;
+
+    // the copy target keeps the setup from disturbing any vao or uniform binding
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+
+    BufferStorageFunction bufferStorage = getBufferStorage();
+    m_persistent = bufferStorage != nullptr;
+    m_mapped = nullptr;
+    if(m_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(totalSize), nullptr, flags);
+        m_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(totalSize), flags));
+        if(!m_mapped) {
+            std::cerr << "ERROR::STREAM_BUFFER:: persistent mapping failed" << std::endl;
+        }
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(totalSize), nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    MemoryTracker::trackBuffer(m_buffer, MemoryTag::Renderer, totalSize);
+}
+
+void StreamBuffer::nextFrame() {
+    // the frame that just finished is done writing its region, the gpu reads it from here on
+    if(m_fences[m_region]) glDeleteSync(m_fences[m_region]);
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_region = (m_region + 1) % kRegionCount;
+    m_cursor = 0;
+
+    if(GLsync fence = m_fences[m_region]) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if(status == GL_TIMEOUT_EXPIRED) {
+            m_stalls++;
+            while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+        }
+        glDeleteSync(fence);
+        m_fences[m_region] = nullptr;
+    }
+
+    for(auto it = m_retired.begin(); it != m_retired.end();) {
+        if(--it->framesLeft > 0) {
+            ++it;
+            continue;
+        }
+        glDeleteBuffers(1, &it->buffer);
+        it = m_retired.erase(it);
+    }
+}
+
+GLintptr StreamBuffer::upload(const void* data, size_t size, size_t alignment) {
+    size_t offset = (m_cursor + alignment - 1) / alignment * alignment;
+    if(offset + size > m_regionSize) {
+        grow(offset + size);
+        offset = 0;
+    }
+    m_cursor = offset + size;
+
+    size_t absolute = m_region * m_regionSize + offset;
+    if(m_mapped) {
+        std::memcpy(m_mapped + absolute, data, size);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        if(void* range = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(absolute), static_cast<GLsizeiptr>(size), access)) {
+            std::memcpy(range, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    return static_cast<GLintptr>(absolute);
+}
+
+void StreamBuffer::grow(size_t needed) {
+    size_t regionSize = m_regionSize * 2;
+    while(regionSize < needed) regionSize *= 2;
+    std::cout << "[Debug] Stream buffer regions grown to " << regionSize / 1024 << " KB" << std::endl;
+
+    // earlier draws this frame still point at the old buffer, it goes once they are done
+    MemoryTracker::untrackBuffer(m_buffer);
+    if(m_mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    m_retired.push_back({ m_buffer, kRegionCount });
+
+    // nothing is in flight in the new buffer, so its fences go too
+    for(GLsync& fence : m_fences) {
+        if(fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    create(regionSize);
+    m_cursor = 0;
+}
+
+GLuint StreamBuffer::getBuffer() const {
+    return m_buffer;
+}
+
+bool StreamBuffer::isPersistent() const {
+    return m_persistent;
+}
+
+size_t StreamBuffer::getRegionSize() const {
+    return m_regionSize;
+}
+
+size_t StreamBuffer::getFrameBytes() const {
+    return m_cursor;
+}
+
+int StreamBuffer::getStalls() const {
+    return m_stalls;
+}
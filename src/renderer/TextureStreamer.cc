@@ -0,0 +1,502 @@
+#include "renderer/TextureStreamer.h"
+#include "renderer/GLState.h"
+#include "core/VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+// static member definitions
+std::vector<TextureStreamer::StreamedTexture> TextureStreamer::s_textures;
+std::vector<size_t> TextureStreamer::s_freeSlots;
+std::unordered_map<unsigned int, size_t> TextureStreamer::s_indexByID;
+
+std::thread TextureStreamer::s_worker;
+std::mutex TextureStreamer::s_mutex;
+std::condition_variable TextureStreamer::s_condition;
+std::deque<TextureStreamer::StreamJob> TextureStreamer::s_jobs;
+std::deque<TextureStreamer::StreamResult> TextureStreamer::s_results;
+std::atomic<bool> TextureStreamer::s_running(false);
+
+size_t TextureStreamer::s_budgetBytes = 0;
+size_t TextureStreamer::s_residentBytes = 0;
+uint64_t TextureStreamer::s_frame = 0;
+
+// the tail is every mip whose largest side is at most this many texels
+static const int kTailSize = 64;
+// textures that were not seen for this many frames fall back to their tail
+static const uint64_t kInvisibleGraceFrames = 120;
+// caps so a camera cut doesn't stall a single frame
+static const size_t kMaxUploadBytesPerFrame = 32ull * 1024 * 1024;
+static const size_t kMaxJobsInFlight = 8;
+
+void TextureStreamer::init(size_t budgetBytes) {
+    s_budgetBytes = budgetBytes;
+    s_running = true;
+    s_worker = std::thread(&TextureStreamer::workerLoop);
+}
+
+void TextureStreamer::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_running = false;
+        s_jobs.clear();
+    }
+    s_condition.notify_all();
+
+    if(s_worker.joinable()) {
+        s_worker.join();
+    }
+
+    s_results.clear();
+
+    // whatever nobody unregistered, while the context is still there
+    for(const auto& texture : s_textures) {
+        if(!texture.id) continue;
+        MemoryTracker::untrackTexture(texture.id);
+        GLState::forgetTexture(texture.id);
+        glDeleteTextures(1, &texture.id);
+    }
+    s_textures.clear();
+    s_freeSlots.clear();
+    s_indexByID.clear();
+    s_residentBytes = 0;
+}
+
+unsigned int TextureStreamer::registerTexture(const std::string& path) {
+    StreamedTexture texture;
+    texture.path = path;
+
+    // only the header is read here, the pixels are decoded on the worker
+    FileData file = VirtualFileSystem::read(path);
+    if(!file.isValid() || !stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                                                 &texture.width, &texture.height, &texture.channels)) {
+        std::cerr << "Texture failed to load at path: " << path << std::endl;
+        return 0;
+    }
+
+    int largest = std::max(texture.width, texture.height);
+    texture.numLevels = static_cast<int>(std::floor(std::log2(largest))) + 1;
+
+    texture.tailMip = 0;
+    while(texture.tailMip < texture.numLevels - 1 && (largest >> texture.tailMip) > kTailSize) {
+        texture.tailMip++;
+    }
+
+    // placeholder sits in the real 1x1 level so the texture is complete from the first frame
+    int last = texture.numLevels - 1;
+    texture.residentMip = last;
+    texture.targetMip = texture.tailMip;
+
+    GLenum format = getFormat(texture.channels);
+    std::vector<unsigned char> grey(texture.channels, 128);
+
+    glGenTextures(1, &texture.id);
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, last, format, 1, 1, 0, format, GL_UNSIGNED_BYTE, grey.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+    s_residentBytes += getLevelBytes(texture, last);
+    MemoryTracker::trackTexture(texture.id, MemoryTag::Textures, getLevelBytes(texture, last));
+
+    if(s_freeSlots.empty()) {
+        s_indexByID[texture.id] = s_textures.size();
+        s_textures.push_back(texture);
+    } else {
+        size_t index = s_freeSlots.back();
+        s_freeSlots.pop_back();
+        texture.generation = s_textures[index].generation;
+        s_indexByID[texture.id] = index;
+        s_textures[index] = texture;
+    }
+
+    std::cout << "[Debug] Streaming texture " << path << " (" << texture.width << "x" << texture.height
+              << ", " << texture.numLevels << " mips, tail from mip " << texture.tailMip << ")" << std::endl;
+
+    return texture.id;
+}
+
+void TextureStreamer::unregisterTexture(unsigned int textureID) {
+    auto it = s_indexByID.find(textureID);
+    if(it == s_indexByID.end()) {
+        return;
+    }
+    size_t index = it->second;
+    s_indexByID.erase(it);
+
+    {
+        // a decode already running comes back with the old generation and is dropped in uploadResult
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_jobs.erase(std::remove_if(s_jobs.begin(), s_jobs.end(),
+            [index](const StreamJob& job) { return job.index == index; }), s_jobs.end());
+        s_results.erase(std::remove_if(s_results.begin(), s_results.end(),
+            [index](const StreamResult& result) { return result.index == index; }), s_results.end());
+    }
+
+    StreamedTexture& texture = s_textures[index];
+    // residentMip is the placeholder's level until the tail arrives, which is what was counted
+    s_residentBytes -= getBytesFrom(texture, texture.residentMip);
+    MemoryTracker::untrackTexture(texture.id);
+    GLState::forgetTexture(texture.id);
+    glDeleteTextures(1, &texture.id);
+
+    uint32_t generation = texture.generation + 1;
+    texture = StreamedTexture();
+    texture.generation = generation;
+    s_freeSlots.push_back(index);
+}
+
+void TextureStreamer::requestFootprint(unsigned int textureID, float screenPixels) {
+    auto it = s_indexByID.find(textureID);
+    if(it == s_indexByID.end()) {
+        return;
+    }
+
+    StreamedTexture& texture = s_textures[it->second];
+    texture.footprint = std::max(texture.footprint, screenPixels);
+    texture.lastVisibleFrame = s_frame;
+}
+
+void TextureStreamer::update() {
+    // 1. upload whatever the worker finished, within the per frame upload cap
+    size_t uploaded = 0;
+    while(uploaded < kMaxUploadBytesPerFrame) {
+        StreamResult result;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            if(s_results.empty()) break;
+            result = std::move(s_results.front());
+            s_results.pop_front();
+        }
+
+        for(const auto& level : result.levels) uploaded += level.size();
+        uploadResult(result);
+    }
+
+    // 2. work out what each texture should have resident and fit that into the budget
+    selectTargets();
+
+    // 3. apply the targets: drops happen right away, additions become decode jobs
+    std::vector<size_t> wanted;
+    for(size_t i = 0; i < s_textures.size(); i++) {
+        StreamedTexture& texture = s_textures[i];
+        if(!texture.id) continue;
+
+        if(texture.hasTail && texture.targetMip > texture.residentMip) {
+            dropMips(texture, texture.targetMip);
+        }
+        else if(!texture.pending && texture.targetMip < texture.residentMip) {
+            wanted.push_back(i);
+        }
+    }
+
+    // the textures covering the most pixels get their jobs first
+    std::sort(wanted.begin(), wanted.end(), [](size_t a, size_t b) {
+        return s_textures[a].footprint > s_textures[b].footprint;
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for(size_t index : wanted) {
+            if(s_jobs.size() >= kMaxJobsInFlight) break;
+
+            StreamedTexture& texture = s_textures[index];
+            StreamJob job;
+            job.index = index;
+            job.generation = texture.generation;
+            job.path = texture.path;
+            job.firstMip = texture.targetMip;
+            job.lastMip = texture.hasTail ? texture.residentMip : texture.numLevels;
+
+            texture.pending = true;
+            s_jobs.push_back(job);
+        }
+    }
+    s_condition.notify_one();
+
+    for(auto& texture : s_textures) {
+        texture.footprint = 0.0f;
+    }
+    s_frame++;
+}
+
+void TextureStreamer::selectTargets() {
+    size_t total = 0;
+
+    for(auto& texture : s_textures) {
+        if(!texture.id) continue;
+        if(!texture.hasTail) {
+            texture.targetMip = texture.tailMip;
+            total += getBytesFrom(texture, texture.tailMip);
+            continue;
+        }
+
+        bool visible = texture.lastVisibleFrame + kInvisibleGraceFrames >= s_frame;
+        int desired = texture.tailMip;
+
+        if(visible && texture.footprint > 0.0f) {
+            // one texel per screen pixel, assuming the uv set covers the texture about once
+            float largest = static_cast<float>(std::max(texture.width, texture.height));
+            float ratio = largest / std::max(texture.footprint, 1.0f);
+            desired = ratio > 1.0f ? static_cast<int>(std::floor(std::log2(ratio))) : 0;
+        }
+        else if(visible) {
+            desired = texture.residentMip; // seen recently but not this frame, hold still
+        }
+
+        desired = std::clamp(desired, 0, texture.tailMip);
+
+        // one level of hysteresis so a texture on the boundary doesn't thrash
+        if(visible && desired == texture.residentMip + 1) {
+            desired = texture.residentMip;
+        }
+
+        texture.targetMip = desired;
+        total += getBytesFrom(texture, desired);
+    }
+
+    if(total <= s_budgetBytes) {
+        return;
+    }
+
+    // over budget: take one mip at a time away from the least important textures,
+    // anything not visible counts as less important than the smallest visible one
+    std::vector<size_t> order;
+    order.reserve(s_textures.size());
+    for(size_t i = 0; i < s_textures.size(); i++) {
+        if(s_textures[i].id) order.push_back(i);
+    }
+
+    auto priority = [](const StreamedTexture& texture) {
+        bool visible = texture.lastVisibleFrame + kInvisibleGraceFrames >= s_frame;
+        return visible ? texture.footprint : -1.0f;
+    };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return priority(s_textures[a]) < priority(s_textures[b]);
+    });
+
+    bool changed = true;
+    while(total > s_budgetBytes && changed) {
+        changed = false;
+        for(size_t index : order) {
+            StreamedTexture& texture = s_textures[index];
+            if(texture.targetMip >= texture.tailMip) continue;
+
+            total -= getLevelBytes(texture, texture.targetMip);
+            texture.targetMip++;
+            changed = true;
+
+            if(total <= s_budgetBytes) break;
+        }
+    }
+}
+
+void TextureStreamer::uploadResult(StreamResult& result) {
+    StreamedTexture& texture = s_textures[result.index];
+    // the texture was unregistered while it was being decoded
+    if(!texture.id || texture.generation != result.generation) return;
+    texture.pending = false;
+
+    int lastMip = result.firstMip + static_cast<int>(result.levels.size());
+    int expectedLast = texture.hasTail ? texture.residentMip : texture.numLevels;
+
+    // decode failed, keep whatever is resident and stop asking for more
+    if(result.levels.empty()) {
+        texture.hasTail = true;
+        texture.tailMip = texture.residentMip;
+        return;
+    }
+
+    // the texture was trimmed while the job was in flight, the levels would leave a gap
+    if(lastMip != expectedLast) {
+        return;
+    }
+
+    GLenum format = getFormat(texture.channels);
+
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for(size_t i = 0; i < result.levels.size(); i++) {
+        int level = result.firstMip + static_cast<int>(i);
+        int w = std::max(1, texture.width >> level);
+        int h = std::max(1, texture.height >> level);
+        glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, format, GL_UNSIGNED_BYTE, result.levels[i].data());
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // the placeholder was already counted as the 1x1 level
+    if(!texture.hasTail) {
+        s_residentBytes -= getLevelBytes(texture, texture.numLevels - 1);
+        s_residentBytes += getBytesFrom(texture, result.firstMip);
+    } else {
+        s_residentBytes += getBytesFrom(texture, result.firstMip) - getBytesFrom(texture, texture.residentMip);
+    }
+
+    texture.hasTail = true;
+    texture.residentMip = result.firstMip;
+    MemoryTracker::trackTexture(texture.id, MemoryTag::Textures, getBytesFrom(texture, texture.residentMip));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentMip);
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void TextureStreamer::dropMips(StreamedTexture& texture, int newResidentMip) {
+    GLenum format = getFormat(texture.channels);
+
+    GLState::bindTexture(0, GL_TEXTURE_2D, texture.id);
+
+    // move the base level first so the texture never samples a released level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, newResidentMip);
+
+    // respecifying a level as 0x0 releases its storage
+    for(int level = texture.residentMip; level < newResidentMip; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+    s_residentBytes -= getBytesFrom(texture, texture.residentMip) - getBytesFrom(texture, newResidentMip);
+    texture.residentMip = newResidentMip;
+    MemoryTracker::trackTexture(texture.id, MemoryTag::Textures, getBytesFrom(texture, texture.residentMip));
+}
+
+void TextureStreamer::workerLoop() {
+    while(true) {
+        StreamJob job;
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            s_condition.wait(lock, [] { return !s_running || !s_jobs.empty(); });
+
+            if(!s_running) return;
+
+            job = s_jobs.front();
+            s_jobs.pop_front();
+        }
+
+        StreamResult result = decodeMips(job);
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_results.push_back(std::move(result));
+    }
+}
+
+TextureStreamer::StreamResult TextureStreamer::decodeMips(const StreamJob& job) {
+    StreamResult result;
+    result.index = job.index;
+    result.generation = job.generation;
+    result.firstMip = job.firstMip;
+
+    FileData file = VirtualFileSystem::read(job.path);
+    unsigned char* data = nullptr;
+    if(file.isValid()) {
+        file.adviseSequential();
+        data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                                     &result.width, &result.height, &result.channels, 0);
+    }
+    if(!data) {
+        std::cerr << "Texture failed to stream at path: " << job.path << std::endl;
+        return result;
+    }
+
+    int channels = result.channels;
+    int w = result.width;
+    int h = result.height;
+
+    std::vector<unsigned char> current(data, data + static_cast<size_t>(w) * h * channels);
+    stbi_image_free(data);
+
+    // 2x2 box filter down the chain, only the requested range is kept. kept levels are moved
+    // into the result and the next one is filtered from there, nothing gets copied
+    result.levels.reserve(static_cast<size_t>(std::max(0, job.lastMip - job.firstMip)));
+    for(int level = 0; level < job.lastMip; level++) {
+        const std::vector<unsigned char>* source = &current;
+        if(level >= job.firstMip) {
+            result.levels.push_back(std::move(current));
+            source = &result.levels.back();
+        }
+        const std::vector<unsigned char>& pixels = *source;
+
+        if(level + 1 == job.lastMip) break;
+
+        int nw = std::max(1, w / 2);
+        int nh = std::max(1, h / 2);
+        std::vector<unsigned char> next(static_cast<size_t>(nw) * nh * channels);
+
+        for(int y = 0; y < nh; y++) {
+            int y0 = std::min(y * 2, h - 1);
+            int y1 = std::min(y * 2 + 1, h - 1);
+            for(int x = 0; x < nw; x++) {
+                int x0 = std::min(x * 2, w - 1);
+                int x1 = std::min(x * 2 + 1, w - 1);
+                for(int c = 0; c < channels; c++) {
+                    int sum = pixels[(static_cast<size_t>(y0) * w + x0) * channels + c]
+                            + pixels[(static_cast<size_t>(y0) * w + x1) * channels + c]
+                            + pixels[(static_cast<size_t>(y1) * w + x0) * channels + c]
+                            + pixels[(static_cast<size_t>(y1) * w + x1) * channels + c];
+                    next[(static_cast<size_t>(y) * nw + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        current = std::move(next);
+        w = nw;
+        h = nh;
+    }
+
+    return result;
+}
+
+GLenum TextureStreamer::getFormat(int channels) {
+    if(channels == 1) return GL_RED;
+    if(channels == 2) return GL_RG;
+    if(channels == 3) return GL_RGB;
+    return GL_RGBA;
+}
+
+size_t TextureStreamer::getLevelBytes(const StreamedTexture& texture, int level) {
+    size_t w = std::max(1, texture.width >> level);
+    size_t h = std::max(1, texture.height >> level);
+    // drivers pad rgb to rgba internally
+    size_t bytesPerTexel = texture.channels == 3 ? 4 : texture.channels;
+    return w * h * bytesPerTexel;
+}
+
+size_t TextureStreamer::getBytesFrom(const StreamedTexture& texture, int firstMip) {
+    size_t total = 0;
+    for(int level = firstMip; level < texture.numLevels; level++) {
+        total += getLevelBytes(texture, level);
+    }
+    return total;
+}
+
+void TextureStreamer::setBudget(size_t budgetBytes) {
+    s_budgetBytes = budgetBytes;
+}
+
+size_t TextureStreamer::getBudget() {
+    return s_budgetBytes;
+}
+
+size_t TextureStreamer::getResidentBytes() {
+    return s_residentBytes;
+}
+
+size_t TextureStreamer::getTextureCount() {
+    return s_textures.size() - s_freeSlots.size();
+}
+
+size_t TextureStreamer::getPendingJobs() {
+    size_t pending = 0;
+    for(const auto& texture : s_textures) {
+        if(texture.pending) pending++;
+    }
+    return pending;
+}
@@ -0,0 +1,486 @@
+#include "scene/AmbientOcclusionBaker.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "core/JobSystem.h"
+#include "core/VirtualFileSystem.h"
+#include "scene/Bounds.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static_assert(AmbientOcclusionBaker::kRayCount % 4 == 0, "rays are traced in packets of four");
+
+// bake parameters, any change here has to bump kCacheVersion
+static const uint32_t kCacheVersion = 1;
+static const uint32_t kLeafTriangles = 4;
+static const int kTraversalStack = 64; // the median split keeps the tree balanced
+static const float kPi = 3.14159265358979f;
+
+// a corner and two edges, what the intersection test wants
+struct BakeTriangle {
+    glm::vec3 v0;
+    glm::vec3 e1;
+    glm::vec3 e2;
+};
+
+// count 0 is an inner node with its children at first and first + 1,
+// a leaf covers the triangles [first, first + count)
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+
+struct Bvh {
+    std::vector<BvhNode> nodes;
+    std::vector<BakeTriangle> triangles; // in leaf order
+};
+
+static Bvh buildBvh(const std::vector<BakeTriangle>& triangles) {
+    uint32_t count = static_cast<uint32_t>(triangles.size());
+    std::vector<glm::vec3> centroids(count);
+    std::vector<uint32_t> order(count);
+    for(uint32_t i = 0; i < count; i++) {
+        centroids[i] = triangles[i].v0 + (triangles[i].e1 + triangles[i].e2) / 3.0f;
+        order[i] = i;
+    }
+
+    struct Range {
+        uint32_t node;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    Bvh bvh;
+    bvh.nodes.reserve(2 * (count / kLeafTriangles) + 1);
+    bvh.nodes.push_back({});
+    std::vector<Range> stack = { { 0, 0, count } };
+
+    while(!stack.empty()) {
+        Range range = stack.back();
+        stack.pop_back();
+
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+        glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+        for(uint32_t i = range.first; i < range.first + range.count; i++) {
+            const BakeTriangle& triangle = triangles[order[i]];
+            glm::vec3 corners[3] = { triangle.v0, triangle.v0 + triangle.e1, triangle.v0 + triangle.e2 };
+            for(const glm::vec3& corner : corners) {
+                boundsMin = glm::min(boundsMin, corner);
+                boundsMax = glm::max(boundsMax, corner);
+            }
+            centroidMin = glm::min(centroidMin, centroids[order[i]]);
+            centroidMax = glm::max(centroidMax, centroids[order[i]]);
+        }
+
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        bvh.nodes[range.node].min = boundsMin;
+        bvh.nodes[range.node].max = boundsMax;
+
+        // small enough, or every centroid in one spot so no split would separate them
+        if(range.count <= kLeafTriangles || extent[axis] <= 0.0f) {
+            bvh.nodes[range.node].first = range.first;
+            bvh.nodes[range.node].count = range.count;
+            continue;
+        }
+
+        uint32_t half = range.count / 2;
+        auto begin = order.begin() + range.first;
+        std::nth_element(begin, begin + half, begin + range.count, [&](uint32_t a, uint32_t b) {
+            return centroids[a][axis] < centroids[b][axis];
+        });
+
+        uint32_t left = static_cast<uint32_t>(bvh.nodes.size());
+        bvh.nodes[range.node].first = left;
+        bvh.nodes[range.node].count = 0;
+        bvh.nodes.push_back({});
+        bvh.nodes.push_back({});
+        stack.push_back({ left, range.first, half });
+        stack.push_back({ left + 1, range.first + half, range.count - half });
+    }
+
+    bvh.triangles.resize(count);
+    for(uint32_t i = 0; i < count; i++) {
+        bvh.triangles[i] = triangles[order[i]];
+    }
+    return bvh;
+}
+
+#if defined(__SSE2__)
+// the four rays share their origin, so the parts of Moller-Trumbore that only depend on the
+// origin and the triangle are done once in scalar; returns a bit per ray that hits
+static int intersectPacket(const BakeTriangle& triangle, const glm::vec3& origin,
+                           __m128 dx, __m128 dy, __m128 dz, __m128 tMin, __m128 tMax) {
+    glm::vec3 toOrigin = origin - triangle.v0;
+    glm::vec3 q = glm::cross(toOrigin, triangle.e1);
+
+    __m128 e2x = _mm_set1_ps(triangle.e2.x), e2y = _mm_set1_ps(triangle.e2.y), e2z = _mm_set1_ps(triangle.e2.z);
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.e1.x), px),
+                                       _mm_mul_ps(_mm_set1_ps(triangle.e1.y), py)),
+                            _mm_mul_ps(_mm_set1_ps(triangle.e1.z), pz));
+    // a parallel ray divides by zero, the NaNs fail every comparison below
+    __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(toOrigin.x), px),
+                                                _mm_mul_ps(_mm_set1_ps(toOrigin.y), py)),
+                                     _mm_mul_ps(_mm_set1_ps(toOrigin.z), pz)), inverse);
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(q.x)),
+                                                _mm_mul_ps(dy, _mm_set1_ps(q.y))),
+                                     _mm_mul_ps(dz, _mm_set1_ps(q.z))), inverse);
+    __m128 t = _mm_mul_ps(_mm_set1_ps(glm::dot(triangle.e2, q)), inverse);
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(t, tMin), _mm_cmplt_ps(t, tMax)));
+    return _mm_movemask_ps(hit);
+}
+
+// any hit for four rays from one origin, returns a bit per ray that is blocked
+static int tracePacket(const Bvh& bvh, const glm::vec3& origin, const glm::vec3 directions[4], float minDistance, float maxDistance) {
+    // a zero component would make 0 * inf in the slab test
+    float inverse[3][4];
+    for(int k = 0; k < 4; k++) {
+        for(int axis = 0; axis < 3; axis++) {
+            float d = directions[k][axis];
+            inverse[axis][k] = 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+        }
+    }
+
+    __m128 dx = _mm_set_ps(directions[3].x, directions[2].x, directions[1].x, directions[0].x);
+    __m128 dy = _mm_set_ps(directions[3].y, directions[2].y, directions[1].y, directions[0].y);
+    __m128 dz = _mm_set_ps(directions[3].z, directions[2].z, directions[1].z, directions[0].z);
+    __m128 idx = _mm_loadu_ps(inverse[0]);
+    __m128 idy = _mm_loadu_ps(inverse[1]);
+    __m128 idz = _mm_loadu_ps(inverse[2]);
+    __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    __m128 tMin = _mm_set1_ps(minDistance);
+    __m128 tMax = _mm_set1_ps(maxDistance);
+    __m128 zero = _mm_setzero_ps();
+
+    int blocked = 0;
+    uint32_t stack[kTraversalStack];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        const BvhNode& node = bvh.nodes[stack[--top]];
+
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.x), ox), idx);
+        __m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.x), ox), idx);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.y), oy), idy);
+        __m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.y), oy), idy);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.z), oz), idz);
+        __m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.z), oz), idz);
+
+        __m128 near = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), zero));
+        __m128 far = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), tMax));
+
+        // only rays that are still open and pass through the box
+        int active = _mm_movemask_ps(_mm_cmple_ps(near, far)) & ~blocked;
+        if(!active) continue;
+
+        if(node.count == 0) {
+            if(top + 2 > kTraversalStack) continue;
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+            continue;
+        }
+
+        for(uint32_t i = node.first; i < node.first + node.count; i++) {
+            blocked |= intersectPacket(bvh.triangles[i], origin, dx, dy, dz, tMin, tMax) & active;
+            if(blocked == 0xF) return blocked;
+        }
+    }
+    return blocked;
+}
+#else
+static bool intersectRay(const BakeTriangle& triangle, const glm::vec3& origin, const glm::vec3& direction, float minDistance, float maxDistance) {
+    glm::vec3 p = glm::cross(direction, triangle.e2);
+    float det = glm::dot(triangle.e1, p);
+    if(det == 0.0f) return false;
+    float inverse = 1.0f / det;
+
+    glm::vec3 toOrigin = origin - triangle.v0;
+    float u = glm::dot(toOrigin, p) * inverse;
+    if(u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(toOrigin, triangle.e1);
+    float v = glm::dot(direction, q) * inverse;
+    if(v < 0.0f || u + v > 1.0f) return false;
+
+    float t = glm::dot(triangle.e2, q) * inverse;
+    return t > minDistance && t < maxDistance;
+}
+
+static bool traceRay(const Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float minDistance, float maxDistance) {
+    glm::vec3 inverse;
+    for(int axis = 0; axis < 3; axis++) {
+        float d = direction[axis];
+        inverse[axis] = 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+    }
+
+    uint32_t stack[kTraversalStack];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        const BvhNode& node = bvh.nodes[stack[--top]];
+
+        glm::vec3 t1 = (node.min - origin) * inverse;
+        glm::vec3 t2 = (node.max - origin) * inverse;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+        float near = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float far = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        if(near > far) continue;
+
+        if(node.count == 0) {
+            if(top + 2 > kTraversalStack) continue;
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+            continue;
+        }
+
+        for(uint32_t i = node.first; i < node.first + node.count; i++) {
+            if(intersectRay(bvh.triangles[i], origin, direction, minDistance, maxDistance)) return true;
+        }
+    }
+    return false;
+}
+
+static int tracePacket(const Bvh& bvh, const glm::vec3& origin, const glm::vec3 directions[4], float minDistance, float maxDistance) {
+    int blocked = 0;
+    for(int k = 0; k < 4; k++) {
+        if(traceRay(bvh, origin, directions[k], minDistance, maxDistance)) blocked |= 1 << k;
+    }
+    return blocked;
+}
+#endif
+
+// cosine weighted directions around +z from a Hammersley set, so the plain fraction of
+// blocked rays is already the cosine weighted occlusion
+static std::vector<glm::vec3> getHemisphere() {
+    std::vector<glm::vec3> directions(AmbientOcclusionBaker::kRayCount);
+    for(int i = 0; i < AmbientOcclusionBaker::kRayCount; i++) {
+        uint32_t bits = static_cast<uint32_t>(i);
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+        float u = (i + 0.5f) / AmbientOcclusionBaker::kRayCount;
+        float phi = 2.0f * kPi * (bits * 2.3283064365386963e-10f);
+        float radius = std::sqrt(u);
+        directions[i] = glm::vec3(radius * std::cos(phi), radius * std::sin(phi), std::sqrt(1.0f - u));
+    }
+    return directions;
+}
+
+static uint8_t bakeVertex(const Bvh& bvh, const Vertex& vertex, const std::vector<glm::vec3>& hemisphere,
+                          uint32_t seed, float bias, float maxDistance) {
+    float length = glm::length(vertex.normal);
+    if(length < 1e-6f) return 255; // no normal, no hemisphere to look into
+
+    // orthonormal basis around the normal (Duff et al.)
+    glm::vec3 normal = vertex.normal / length;
+    float sign = std::copysign(1.0f, normal.z);
+    float a = -1.0f / (sign + normal.z);
+    float b = normal.x * normal.y * a;
+    glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+    glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+    // turned by a per vertex angle, the same set everywhere would band across the surface
+    seed ^= seed >> 16;
+    seed *= 0x7feb352du;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68bu;
+    seed ^= seed >> 16;
+    float angle = 2.0f * kPi * (seed * 2.3283064365386963e-10f);
+    float c = std::cos(angle), s = std::sin(angle);
+    glm::vec3 x = c * tangent + s * bitangent;
+    glm::vec3 y = c * bitangent - s * tangent;
+
+    glm::vec3 origin = vertex.position + normal * bias;
+    int blocked = 0;
+    for(int ray = 0; ray < AmbientOcclusionBaker::kRayCount; ray += 4) {
+        glm::vec3 directions[4];
+        for(int k = 0; k < 4; k++) {
+            const glm::vec3& h = hemisphere[ray + k];
+            directions[k] = x * h.x + y * h.y + normal * h.z;
+        }
+
+        int hits = tracePacket(bvh, origin, directions, bias, maxDistance);
+        for(int k = 0; k < 4; k++) blocked += (hits >> k) & 1;
+    }
+
+    float open = 1.0f - static_cast<float>(blocked) / AmbientOcclusionBaker::kRayCount;
+    return static_cast<uint8_t>(std::lround(open * 255.0f));
+}
+
+bool AmbientOcclusionBaker::bake(const std::string& modelPath, const std::vector<Mesh>& meshes, std::vector<std::vector<uint8_t>>& occlusion) {
+    occlusion.assign(meshes.size(), {});
+
+    std::vector<BakeTriangle> triangles;
+    BoundingBox bounds;
+    for(const Mesh& mesh : meshes) {
+        if(!mesh.hasCpuGeometry()) continue;
+
+        const auto& vertices = mesh.getVertices();
+        const auto& indices = mesh.getIndices();
+        for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3& p0 = vertices[indices[i]].position;
+            const glm::vec3& p1 = vertices[indices[i + 1]].position;
+            const glm::vec3& p2 = vertices[indices[i + 2]].position;
+            triangles.push_back({ p0, p1 - p0, p2 - p0 });
+            bounds.expand(p0);
+            bounds.expand(p1);
+            bounds.expand(p2);
+        }
+    }
+    if(triangles.empty()) return false;
+
+    std::string cachePath = getCachePath(modelPath);
+    uint64_t key = getSourceKey(modelPath, meshes);
+    if(key != 0 && readCache(cachePath, key, meshes, occlusion)) {
+        std::cout << "[Debug] AO loaded from cache: " << cachePath << std::endl;
+        return true;
+    }
+
+    double start = glfwGetTime();
+    Bvh bvh = buildBvh(triangles);
+    std::vector<glm::vec3> hemisphere = getHemisphere();
+
+    float diagonal = glm::length(bounds.max - bounds.min);
+    float maxDistance = diagonal * kMaxDistance;
+    float bias = diagonal * 1e-4f; // keeps the rays off the surface they start on
+
+    size_t vertexCount = 0;
+    for(size_t m = 0; m < meshes.size(); m++) {
+        if(!meshes[m].hasCpuGeometry()) continue;
+
+        const auto& vertices = meshes[m].getVertices();
+        std::vector<uint8_t>& result = occlusion[m];
+        result.resize(vertices.size());
+        vertexCount += vertices.size();
+
+        uint32_t seedBase = static_cast<uint32_t>(m) * 0x9E3779B9u;
+        JobSystem::parallelFor(vertices.size(), 64, [&](size_t begin, size_t end) {
+            for(size_t v = begin; v < end; v++) {
+                result[v] = bakeVertex(bvh, vertices[v], hemisphere, seedBase + static_cast<uint32_t>(v), bias, maxDistance);
+            }
+        });
+    }
+
+    std::cout << "[Debug] AO bake took " << (glfwGetTime() - start) * 1000.0 << " ms for " << vertexCount
+              << " vertices against " << triangles.size() << " triangles" << std::endl;
+
+    if(key != 0) writeCache(cachePath, key, occlusion);
+    return true;
+}
+
+std::string AmbientOcclusionBaker::getCachePath(const std::string& modelPath) {
+    return modelPath + ".aocache";
+}
+
+uint64_t AmbientOcclusionBaker::getSourceKey(const std::string& modelPath, const std::vector<Mesh>& meshes) {
+    uint64_t stamp = VirtualFileSystem::getFileStamp(modelPath);
+    if(stamp == 0) return 0;
+
+    // FNV-1a over everything that changes the baked result
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](uint64_t value) {
+        for(int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    uint32_t distanceBits;
+    std::memcpy(&distanceBits, &kMaxDistance, sizeof(distanceBits));
+
+    mix(stamp);
+    mix(kCacheVersion);
+    mix(kRayCount);
+    mix(distanceBits);
+    // the loader settings can change the geometry of the same file
+    for(const Mesh& mesh : meshes) {
+        mix(mesh.getVertices().size());
+        mix(mesh.getIndices().size());
+    }
+    return hash;
+}
+
+bool AmbientOcclusionBaker::readCache(const std::string& cachePath, uint64_t key, const std::vector<Mesh>& meshes, std::vector<std::vector<uint8_t>>& occlusion) {
+    if(!VirtualFileSystem::exists(cachePath)) return false;
+    FileData cache = VirtualFileSystem::read(cachePath);
+    FileReader file(cache);
+    if(!file) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    uint32_t meshCount = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    file.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
+
+    if(!file || std::memcmp(magic, "AOCC", 4) != 0 || version != kCacheVersion || storedKey != key || meshCount != meshes.size()) {
+        return false;
+    }
+
+    for(size_t m = 0; m < meshes.size(); m++) {
+        uint32_t count = 0;
+        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if(!file || (count != 0 && count != meshes[m].getVertices().size())) return false;
+
+        occlusion[m].resize(count);
+        file.read(reinterpret_cast<char*>(occlusion[m].data()), count);
+    }
+
+    return static_cast<bool>(file);
+}
+
+void AmbientOcclusionBaker::writeCache(const std::string& cachePath, uint64_t key, const std::vector<std::vector<uint8_t>>& occlusion) {
+    // with the assets packed the folder the model came from may not exist on disk
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(cachePath).parent_path();
+    if(!parent.empty()) std::filesystem::create_directories(parent, error);
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if(!file) {
+        std::cerr << "ERROR::AO:: could not write cache " << cachePath << std::endl;
+        return;
+    }
+
+    uint32_t meshCount = static_cast<uint32_t>(occlusion.size());
+    file.write("AOCC", 4);
+    file.write(reinterpret_cast<const char*>(&kCacheVersion), sizeof(kCacheVersion));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(&meshCount), sizeof(meshCount));
+
+    for(const auto& values : occlusion) {
+        uint32_t count = static_cast<uint32_t>(values.size());
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(values.data()), count);
+    }
+}
@@ -0,0 +1,383 @@
+#include "scene/Animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 4 wide helpers for the sampling and blending loops, SSE when available
+#if defined(__SSE2__)
+typedef __m128 Vec4;
+
+static inline Vec4 load4(const glm::vec4& v) { return _mm_loadu_ps(&v.x); }
+static inline void store4(glm::vec4& out, Vec4 v) { _mm_storeu_ps(&out.x, v); }
+
+static inline Vec4 lerp4(Vec4 a, Vec4 b, Vec4 t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+// horizontal sum broadcast to every lane
+static inline Vec4 sum4(Vec4 v) {
+    Vec4 pairs = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static inline Vec4 nlerp4(Vec4 a, Vec4 b, Vec4 t) {
+    // flip b onto a's hemisphere so the blend takes the short way round
+    Vec4 negative = _mm_cmplt_ps(sum4(_mm_mul_ps(a, b)), _mm_setzero_ps());
+    b = _mm_xor_ps(b, _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+
+    Vec4 q = lerp4(a, b, t);
+    return _mm_div_ps(q, _mm_sqrt_ps(sum4(_mm_mul_ps(q, q))));
+}
+
+static inline Vec4 decodeRotation(const int16_t* key) {
+    __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(key));
+    __m128i wide = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16); // sign extend
+    return _mm_mul_ps(_mm_cvtepi32_ps(wide), _mm_set1_ps(1.0f / 32767.0f));
+}
+
+static inline Vec4 decodeRange(const uint16_t* key, const glm::vec4& min, const glm::vec4& step) {
+    // reads a 4th value that belongs to the next key (or the padding), step.w is 0 so it drops out
+    __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(key));
+    __m128i wide = _mm_unpacklo_epi16(raw, _mm_setzero_si128());
+    return _mm_add_ps(load4(min), _mm_mul_ps(_mm_cvtepi32_ps(wide), load4(step)));
+}
+#else
+typedef glm::vec4 Vec4;
+
+static inline Vec4 load4(const glm::vec4& v) { return v; }
+static inline void store4(glm::vec4& out, Vec4 v) { out = v; }
+
+static inline Vec4 lerp4(Vec4 a, Vec4 b, Vec4 t) {
+    return a + (b - a) * t;
+}
+
+static inline Vec4 nlerp4(Vec4 a, Vec4 b, Vec4 t) {
+    if(glm::dot(a, b) < 0.0f) b = -b;
+    return glm::normalize(lerp4(a, b, t));
+}
+
+static inline Vec4 decodeRotation(const int16_t* key) {
+    return glm::vec4(key[0], key[1], key[2], key[3]) * (1.0f / 32767.0f);
+}
+
+static inline Vec4 decodeRange(const uint16_t* key, const glm::vec4& min, const glm::vec4& step) {
+    return min + glm::vec4(key[0], key[1], key[2], 0.0f) * step;
+}
+#endif
+
+static inline Vec4 splat4(float value) {
+#if defined(__SSE2__)
+    return _mm_set1_ps(value);
+#else
+    return glm::vec4(value);
+#endif
+}
+
+void Pose::resize(size_t jointCount) {
+    rotations.resize(jointCount, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    translations.resize(jointCount, glm::vec4(0.0f));
+    scales.resize(jointCount, glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
+}
+
+size_t Pose::size() const {
+    return rotations.size();
+}
+
+int Skeleton::findJoint(const std::string& name) const {
+    for(size_t i = 0; i < names.size(); i++) {
+        if(names[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+size_t Skeleton::getJointCount() const {
+    return names.size();
+}
+
+// linear interpolation of assimp keys at a tick, only used while importing
+static glm::vec4 interpolateKeys(const aiVectorKey* keys, unsigned count, double tick) {
+    const aiVectorKey* next = std::upper_bound(keys, keys + count, tick,
+        [](double t, const aiVectorKey& key) { return t < key.mTime; });
+
+    if(next == keys) return glm::vec4(keys[0].mValue.x, keys[0].mValue.y, keys[0].mValue.z, 0.0f);
+    if(next == keys + count) {
+        const aiVector3D& last = keys[count - 1].mValue;
+        return glm::vec4(last.x, last.y, last.z, 0.0f);
+    }
+
+    const aiVectorKey& previous = *(next - 1);
+    float t = static_cast<float>((tick - previous.mTime) / (next->mTime - previous.mTime));
+    glm::vec3 a(previous.mValue.x, previous.mValue.y, previous.mValue.z);
+    glm::vec3 b(next->mValue.x, next->mValue.y, next->mValue.z);
+    return glm::vec4(glm::mix(a, b, t), 0.0f);
+}
+
+static glm::vec4 interpolateKeys(const aiQuatKey* keys, unsigned count, double tick) {
+    const aiQuatKey* next = std::upper_bound(keys, keys + count, tick,
+        [](double t, const aiQuatKey& key) { return t < key.mTime; });
+
+    auto toQuat = [](const aiQuaternion& q) { return glm::quat(q.w, q.x, q.y, q.z); };
+
+    glm::quat q;
+    if(next == keys) q = toQuat(keys[0].mValue);
+    else if(next == keys + count) q = toQuat(keys[count - 1].mValue);
+    else {
+        const aiQuatKey& previous = *(next - 1);
+        float t = static_cast<float>((tick - previous.mTime) / (next->mTime - previous.mTime));
+        q = glm::slerp(toQuat(previous.mValue), toQuat(next->mValue), t);
+    }
+
+    q = glm::normalize(q);
+    return glm::vec4(q.x, q.y, q.z, q.w);
+}
+
+static bool isConstant(const std::vector<glm::vec4>& values, float epsilon) {
+    for(const auto& value : values) {
+        glm::vec4 difference = glm::abs(value - values[0]);
+        if(std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)) > epsilon) return false;
+    }
+    return true;
+}
+
+// quantizes xyz into 16 bits inside the track's own range
+static void quantizeRange(const std::vector<glm::vec4>& values, std::vector<uint16_t>& keys,
+                          uint32_t& offset, uint32_t& count, glm::vec4& min, glm::vec4& step)
+{
+    offset = static_cast<uint32_t>(keys.size() / 3);
+    count = isConstant(values, 1e-5f) ? 1 : static_cast<uint32_t>(values.size());
+
+    glm::vec3 lo(values[0]), hi(values[0]);
+    for(uint32_t i = 0; i < count; i++) {
+        lo = glm::min(lo, glm::vec3(values[i]));
+        hi = glm::max(hi, glm::vec3(values[i]));
+    }
+
+    glm::vec3 extent = hi - lo;
+    min = glm::vec4(lo, 0.0f);
+    step = glm::vec4(extent / 65535.0f, 0.0f);
+
+    for(uint32_t i = 0; i < count; i++) {
+        for(int c = 0; c < 3; c++) {
+            float normalized = extent[c] > 0.0f ? (values[i][c] - lo[c]) / extent[c] : 0.0f;
+            keys.push_back(static_cast<uint16_t>(std::lround(normalized * 65535.0f)));
+        }
+    }
+}
+
+AnimationClip AnimationClip::fromAssimp(const aiAnimation* animation, const Skeleton& skeleton) {
+    AnimationClip clip;
+    clip.m_name = animation->mName.C_Str();
+
+    double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+    clip.m_duration = static_cast<float>(animation->mDuration / ticksPerSecond);
+    clip.m_frameCount = std::max(1, static_cast<int>(std::ceil(clip.m_duration * kSampleRate)) + 1);
+
+    size_t jointCount = skeleton.getJointCount();
+    std::vector<const aiNodeAnim*> channels(jointCount, nullptr);
+    for(unsigned i = 0; i < animation->mNumChannels; i++) {
+        int joint = skeleton.findJoint(animation->mChannels[i]->mNodeName.C_Str());
+        if(joint >= 0) channels[joint] = animation->mChannels[i];
+    }
+
+    clip.m_tracks.resize(jointCount);
+    std::vector<glm::vec4> rotations(clip.m_frameCount), translations(clip.m_frameCount), scales(clip.m_frameCount);
+
+    for(size_t joint = 0; joint < jointCount; joint++) {
+        const aiNodeAnim* channel = channels[joint];
+
+        // resample everything to the fixed rate, missing channels hold the bind pose
+        for(int frame = 0; frame < clip.m_frameCount; frame++) {
+            double tick = std::min(static_cast<double>(frame) / kSampleRate * ticksPerSecond, animation->mDuration);
+
+            rotations[frame] = channel && channel->mNumRotationKeys > 0
+                ? interpolateKeys(channel->mRotationKeys, channel->mNumRotationKeys, tick)
+                : skeleton.bindPose.rotations[joint];
+            translations[frame] = channel && channel->mNumPositionKeys > 0
+                ? interpolateKeys(channel->mPositionKeys, channel->mNumPositionKeys, tick)
+                : skeleton.bindPose.translations[joint];
+            scales[frame] = channel && channel->mNumScalingKeys > 0
+                ? interpolateKeys(channel->mScalingKeys, channel->mNumScalingKeys, tick)
+                : skeleton.bindPose.scales[joint];
+
+            // keep neighbouring keys on the same hemisphere
+            if(frame > 0 && glm::dot(rotations[frame], rotations[frame - 1]) < 0.0f) {
+                rotations[frame] = -rotations[frame];
+            }
+        }
+
+        Track& track = clip.m_tracks[joint];
+
+        track.rotationOffset = static_cast<uint32_t>(clip.m_rotationKeys.size() / 4);
+        track.rotationCount = isConstant(rotations, 1e-4f) ? 1 : static_cast<uint32_t>(clip.m_frameCount);
+        for(uint32_t i = 0; i < track.rotationCount; i++) {
+            for(int c = 0; c < 4; c++) {
+                float value = std::clamp(rotations[i][c], -1.0f, 1.0f);
+                clip.m_rotationKeys.push_back(static_cast<int16_t>(std::lround(value * 32767.0f)));
+            }
+        }
+
+        quantizeRange(translations, clip.m_translationKeys, track.translationOffset, track.translationCount,
+                      track.translationMin, track.translationStep);
+        quantizeRange(scales, clip.m_scaleKeys, track.scaleOffset, track.scaleCount,
+                      track.scaleMin, track.scaleStep);
+    }
+
+    clip.m_translationKeys.push_back(0);
+    clip.m_scaleKeys.push_back(0);
+
+    std::cout << "[Debug] Animation '" << clip.m_name << "': " << clip.m_duration << " s, " << jointCount
+              << " tracks, " << clip.getCompressedBytes() / 1024.0f << " KB compressed" << std::endl;
+    return clip;
+}
+
+void AnimationClip::sample(float time, Pose& out) const {
+    out.resize(m_tracks.size());
+
+    float frame = 0.0f;
+    if(m_duration > 0.0f) {
+        float wrapped = std::fmod(time, m_duration);
+        if(wrapped < 0.0f) wrapped += m_duration;
+        frame = wrapped * kSampleRate;
+    }
+
+    int frame0 = std::min(static_cast<int>(frame), m_frameCount - 1);
+    int frame1 = std::min(frame0 + 1, m_frameCount - 1);
+    Vec4 alpha = splat4(frame - static_cast<float>(frame0));
+
+    for(size_t joint = 0; joint < m_tracks.size(); joint++) {
+        const Track& track = m_tracks[joint];
+
+        uint32_t r0 = track.rotationOffset + (track.rotationCount > 1 ? frame0 : 0);
+        uint32_t r1 = track.rotationOffset + (track.rotationCount > 1 ? frame1 : 0);
+        store4(out.rotations[joint], nlerp4(decodeRotation(&m_rotationKeys[r0 * 4]),
+                                            decodeRotation(&m_rotationKeys[r1 * 4]), alpha));
+
+        uint32_t t0 = track.translationOffset + (track.translationCount > 1 ? frame0 : 0);
+        uint32_t t1 = track.translationOffset + (track.translationCount > 1 ? frame1 : 0);
+        store4(out.translations[joint], lerp4(decodeRange(&m_translationKeys[t0 * 3], track.translationMin, track.translationStep),
+                                              decodeRange(&m_translationKeys[t1 * 3], track.translationMin, track.translationStep), alpha));
+
+        uint32_t s0 = track.scaleOffset + (track.scaleCount > 1 ? frame0 : 0);
+        uint32_t s1 = track.scaleOffset + (track.scaleCount > 1 ? frame1 : 0);
+        store4(out.scales[joint], lerp4(decodeRange(&m_scaleKeys[s0 * 3], track.scaleMin, track.scaleStep),
+                                        decodeRange(&m_scaleKeys[s1 * 3], track.scaleMin, track.scaleStep), alpha));
+    }
+}
+
+const std::string& AnimationClip::getName() const {
+    return m_name;
+}
+
+float AnimationClip::getDuration() const {
+    return m_duration;
+}
+
+size_t AnimationClip::getCompressedBytes() const {
+    return m_tracks.size() * sizeof(Track)
+        + m_rotationKeys.size() * sizeof(int16_t)
+        + m_translationKeys.size() * sizeof(uint16_t)
+        + m_scaleKeys.size() * sizeof(uint16_t);
+}
+
+void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out) {
+    size_t count = std::min(a.size(), b.size());
+    out.resize(count);
+
+    Vec4 t = splat4(weight);
+    for(size_t i = 0; i < count; i++) {
+        store4(out.rotations[i], nlerp4(load4(a.rotations[i]), load4(b.rotations[i]), t));
+        store4(out.translations[i], lerp4(load4(a.translations[i]), load4(b.translations[i]), t));
+        store4(out.scales[i], lerp4(load4(a.scales[i]), load4(b.scales[i]), t));
+    }
+}
+
+Animator::Animator(const Skeleton* skeleton, const std::vector<AnimationClip>* clips)
+    : m_skeleton(skeleton)
+    , m_clips(clips)
+    , m_pose(skeleton->bindPose)
+{
+    m_globals.resize(m_skeleton->getJointCount());
+    m_palette.resize(m_skeleton->getJointCount() * 3);
+    buildPalette(); // bind pose until something plays
+}
+
+void Animator::play(int clip, float fadeSeconds) {
+    if(clip < 0 || clip >= static_cast<int>(m_clips->size())) return;
+
+    if(fadeSeconds > 0.0f && m_clip >= 0) {
+        m_previousClip = m_clip;
+        m_previousTime = m_time;
+        m_fade = fadeSeconds;
+        m_fadeDuration = fadeSeconds;
+    }
+    else {
+        m_previousClip = -1;
+        m_fade = 0.0f;
+    }
+
+    m_clip = clip;
+    m_time = 0.0f;
+}
+
+void Animator::update(float deltaTime) {
+    if(m_clip < 0) return;
+
+    const AnimationClip& clip = (*m_clips)[m_clip];
+    m_time += deltaTime * m_speed;
+    if(clip.getDuration() > 0.0f) m_time = std::fmod(m_time, clip.getDuration());
+
+    clip.sample(m_time, m_pose);
+
+    if(m_previousClip >= 0) {
+        m_previousTime += deltaTime * m_speed;
+        m_fade -= deltaTime;
+
+        (*m_clips)[m_previousClip].sample(m_previousTime, m_previousPose);
+        float weight = std::clamp(1.0f - m_fade / m_fadeDuration, 0.0f, 1.0f);
+        blendPoses(m_previousPose, m_pose, weight, m_pose);
+
+        if(m_fade <= 0.0f) m_previousClip = -1;
+    }
+
+    buildPalette();
+}
+
+int Animator::getCurrentClip() const {
+    return m_clip;
+}
+
+const std::vector<glm::vec4>& Animator::getPalette() const {
+    return m_palette;
+}
+
+void Animator::buildPalette() {
+    const Skeleton& skeleton = *m_skeleton;
+
+    for(size_t joint = 0; joint < skeleton.getJointCount(); joint++) {
+        const glm::vec4& r = m_pose.rotations[joint];
+        const glm::vec4& t = m_pose.translations[joint];
+        const glm::vec4& s = m_pose.scales[joint];
+
+        // T * R * S without going through three matrix products
+        glm::mat3 rotation = glm::mat3_cast(glm::quat(r.w, r.x, r.y, r.z));
+        glm::mat4 local(glm::vec4(rotation[0] * s.x, 0.0f),
+                        glm::vec4(rotation[1] * s.y, 0.0f),
+                        glm::vec4(rotation[2] * s.z, 0.0f),
+                        glm::vec4(t.x, t.y, t.z, 1.0f));
+
+        int parent = skeleton.parents[joint];
+        m_globals[joint] = parent < 0 ? local : m_globals[parent] * local;
+
+        glm::mat4 skin = skeleton.globalInverse * m_globals[joint] * skeleton.inverseBind[joint];
+
+        // rows of the affine part, the shader rebuilds the matrix from 3 texels
+        for(int row = 0; row < 3; row++) {
+            m_palette[joint * 3 + row] = glm::vec4(skin[0][row], skin[1][row], skin[2][row], skin[3][row]);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#include "scene/Bounds.h"
+
+void BoundingBox::expand(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+bool BoundingBox::isValid() const {
+    return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+glm::vec3 BoundingBox::getCenter() const {
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 BoundingBox::getExtents() const {
+    return (max - min) * 0.5f;
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& transform) const {
+    // Arvo's method, transform the center and the absolute value of the extents
+    glm::vec3 center = glm::vec3(transform * glm::vec4(getCenter(), 1.0f));
+    glm::vec3 extents = getExtents();
+
+    glm::vec3 newExtents(0.0f);
+    for(int col = 0; col < 3; col++) {
+        for(int row = 0; row < 3; row++) {
+            newExtents[row] += std::abs(transform[col][row]) * extents[col];
+        }
+    }
+
+    BoundingBox result;
+    result.min = center - newExtents;
+    result.max = center + newExtents;
+    return result;
+}
+
+BoundingSphere getWorldSphere(const BoundingBox& box, const glm::mat4& transform) {
+    BoundingSphere sphere;
+    sphere.center = glm::vec3(transform * glm::vec4(box.getCenter(), 1.0f));
+
+    // the largest axis scale keeps the sphere conservative
+    float scaleX = glm::length(glm::vec3(transform[0]));
+    float scaleY = glm::length(glm::vec3(transform[1]));
+    float scaleZ = glm::length(glm::vec3(transform[2]));
+    float maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+
+    sphere.radius = glm::length(box.getExtents()) * maxScale;
+    return sphere;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    // Gribb/Hartmann plane extraction, glm is column major so rows are m[c][r]
+    Frustum frustum;
+    for(int i = 0; i < 3; i++) {
+        glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        frustum.planes[i * 2 + 0] = w + row;
+        frustum.planes[i * 2 + 1] = w - row;
+    }
+
+    for(auto& plane : frustum.planes) {
+        float len = glm::length(glm::vec3(plane));
+        if(len > 0.0f) plane /= len;
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const BoundingSphere& sphere) const {
+    for(const auto& plane : planes) {
+        if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const BoundingBox& box) const {
+    glm::vec3 center = box.getCenter();
+    glm::vec3 extents = box.getExtents();
+
+    for(const auto& plane : planes) {
+        glm::vec3 normal(plane);
+        float radius = glm::dot(extents, glm::abs(normal));
+        if(glm::dot(normal, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
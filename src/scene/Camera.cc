@@ -51,6 +51,12 @@ void Camera::processMouseScroll(float yoffset) {
     if (m_zoom > 45.0f) m_zoom = 45.0f;
 }
 
+void Camera::setOrientation(float yaw, float pitch) {
+    m_yaw = yaw;
+    m_pitch = pitch;
+    updateCameraVectors();
+}
+
 // somebody cooking
 void Camera::updateCameraVectors() {
     glm::vec3 front;
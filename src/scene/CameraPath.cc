@@ -0,0 +1,99 @@
+#include "scene/CameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+static const char* kPathHeader = "camerapath 1";
+
+void CameraPath::clear() {
+    m_keys.clear();
+}
+
+void CameraPath::addKey(float time, const Camera& camera) {
+    if(!m_keys.empty() && time <= m_keys.back().time) return;
+    m_keys.push_back({ time, camera.m_position, camera.m_yaw, camera.m_pitch, camera.m_zoom });
+}
+
+void CameraPath::apply(float time, Camera& camera) const {
+    if(m_keys.empty()) return;
+
+    // first key later than time, the camera sits between it and the one before
+    auto next = std::upper_bound(m_keys.begin(), m_keys.end(), time,
+        [](float t, const Key& key) { return t < key.time; });
+
+    Key key;
+    if(next == m_keys.begin()) {
+        key = m_keys.front();
+    } else if(next == m_keys.end()) {
+        key = m_keys.back();
+    } else {
+        const Key& a = *(next - 1);
+        const Key& b = *next;
+        float t = (time - a.time) / (b.time - a.time);
+
+        // yaw is never wrapped while flying, so a straight lerp takes the same way round
+        key.position = glm::mix(a.position, b.position, t);
+        key.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        key.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        key.zoom = a.zoom + (b.zoom - a.zoom) * t;
+    }
+
+    camera.m_position = key.position;
+    camera.m_zoom = key.zoom;
+    camera.setOrientation(key.yaw, key.pitch);
+}
+
+float CameraPath::getDuration() const {
+    return m_keys.empty() ? 0.0f : m_keys.back().time;
+}
+
+size_t CameraPath::getKeyCount() const {
+    return m_keys.size();
+}
+
+bool CameraPath::save(const std::string& path) const {
+    std::ofstream file(path);
+    if(!file) {
+        std::cerr << "ERROR::CAMERA_PATH:: could not write " << path << std::endl;
+        return false;
+    }
+
+    // exact round trips, replays of the same file have to match bit for bit
+    file.precision(9);
+    file << kPathHeader << "\n";
+    for(const Key& key : m_keys) {
+        file << key.time << " " << key.position.x << " " << key.position.y << " " << key.position.z << " "
+             << key.yaw << " " << key.pitch << " " << key.zoom << "\n";
+    }
+
+    std::cout << "[Debug] Camera path with " << m_keys.size() << " keys written to " << path << std::endl;
+    return true;
+}
+
+bool CameraPath::load(const std::string& path) {
+    std::ifstream file(path);
+    if(!file) {
+        std::cerr << "ERROR::CAMERA_PATH:: could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string header;
+    std::getline(file, header);
+    if(header != kPathHeader) {
+        std::cerr << "ERROR::CAMERA_PATH:: " << path << " is not a camera path" << std::endl;
+        return false;
+    }
+
+    m_keys.clear();
+    Key key;
+    while(file >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.zoom) {
+        if(m_keys.empty() || key.time > m_keys.back().time) m_keys.push_back(key);
+    }
+
+    if(m_keys.empty()) {
+        std::cerr << "ERROR::CAMERA_PATH:: " << path << " has no keys" << std::endl;
+        return false;
+    }
+    return true;
+}
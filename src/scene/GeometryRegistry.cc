@@ -0,0 +1,123 @@
+#include "scene/GeometryRegistry.h"
+
+#include <cstring>
+
+#include "core/MemoryTracker.h"
+
+std::unordered_map<GLuint, GeometryRegistry::Entry> GeometryRegistry::s_buffers;
+std::unordered_multimap<uint64_t, GLuint> GeometryRegistry::s_byHash;
+size_t GeometryRegistry::s_references = 0;
+size_t GeometryRegistry::s_residentBytes = 0;
+size_t GeometryRegistry::s_sharedBytes = 0;
+
+GLuint GeometryRegistry::acquire(const void* data, size_t size) {
+    if(!data || size == 0) return 0;
+
+    Digest digest = hashBytes(data, size);
+
+    // repeated parts make a match the common case, so the size and the full 128 bit digest
+    // decide on the cpu, reading the resident bytes back would stall on every one
+    auto range = s_byHash.equal_range(digest.hash);
+    for(auto it = range.first; it != range.second; ++it) {
+        Entry& entry = s_buffers[it->second];
+        if(entry.size != size || entry.digest.check != digest.check) continue;
+
+        entry.references++;
+        s_references++;
+        s_sharedBytes += size;
+        return it->second;
+    }
+
+    // the copy target keeps the upload from disturbing any vao's element buffer
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    MemoryTracker::trackBuffer(buffer, MemoryTag::Meshes, size);
+
+    s_buffers[buffer] = { digest, size, 1 };
+    s_byHash.emplace(digest.hash, buffer);
+    s_references++;
+    s_residentBytes += size;
+    return buffer;
+}
+
+void GeometryRegistry::release(GLuint buffer) {
+    auto found = s_buffers.find(buffer);
+    if(found == s_buffers.end()) return;
+
+    Entry& entry = found->second;
+    s_references--;
+    if(--entry.references > 0) {
+        s_sharedBytes -= entry.size;
+        return;
+    }
+
+    auto range = s_byHash.equal_range(entry.digest.hash);
+    for(auto it = range.first; it != range.second; ++it) {
+        if(it->second == buffer) {
+            s_byHash.erase(it);
+            break;
+        }
+    }
+
+    s_residentBytes -= entry.size;
+    s_buffers.erase(found);
+    MemoryTracker::untrackBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+size_t GeometryRegistry::getBufferCount() {
+    return s_buffers.size();
+}
+
+size_t GeometryRegistry::getReferenceCount() {
+    return s_references;
+}
+
+size_t GeometryRegistry::getResidentBytes() {
+    return s_residentBytes;
+}
+
+size_t GeometryRegistry::getSharedBytes() {
+    return s_sharedBytes;
+}
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+GeometryRegistry::Digest GeometryRegistry::hashBytes(const void* data, size_t size) {
+    // one pass, two unrelated hashes over 8 byte words: FNV-1a, and an xxHash64 style
+    // multiply-rotate round whose finalizer spreads every input bit over the result
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t hash = 1469598103934665603ull;
+    uint64_t check = size * kPrime1;
+
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash ^= word;
+        hash *= 1099511628211ull;
+        check = rotateLeft(check ^ (word * kPrime2), 31) * kPrime1;
+    }
+    for(; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+        check = rotateLeft(check ^ (bytes[i] * kPrime1), 11) * kPrime2;
+    }
+
+    hash ^= size;
+    hash *= 1099511628211ull;
+
+    check ^= check >> 33;
+    check *= kPrime2;
+    check ^= check >> 29;
+    check *= kPrime1;
+    check ^= check >> 32;
+    return { hash, check };
+}
@@ -0,0 +1,437 @@
+#include "scene/GltfLoader.h"
+#include "scene/GeometryRegistry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+
+static const uint32_t kGlbMagic = 0x46546C67;     // "glTF"
+static const uint32_t kChunkJson = 0x4E4F534A;    // "JSON"
+static const uint32_t kChunkBinary = 0x004E4942;  // "BIN\0"
+static const int kMaxNodeDepth = 128;
+
+static int getComponentCount(const std::string& type) {
+    if(type == "SCALAR") return 1;
+    if(type == "VEC2") return 2;
+    if(type == "VEC3") return 3;
+    if(type == "VEC4") return 4;
+    return 0;
+}
+
+static size_t getComponentSize(GLenum componentType) {
+    switch(componentType) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:  return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:          return 4;
+        default:                return 0;
+    }
+}
+
+// count elements of elementSize bytes, stride apart from the accessor's byteOffset, all inside the view
+static bool accessorFitsView(const JsonValue& accessor, const JsonValue& view, double elementSize, double stride) {
+    double offset = accessor["byteOffset"].asNumber();
+    double count = accessor["count"].asNumber();
+    if(offset < 0.0 || count < 0.0) return false;
+    if(count == 0.0) return true;
+    return offset + (count - 1.0) * stride + elementSize <= view["byteLength"].asNumber();
+}
+
+// accessors without a view or with an unknown type are left to getAttribute, which skips them
+static bool attributeFitsView(const JsonValue& document, int accessorIndex) {
+    if(accessorIndex < 0) return true;
+    const JsonValue& accessor = document["accessors"][static_cast<size_t>(accessorIndex)];
+    if(!accessor.has("bufferView")) return true;
+
+    const JsonValue& view = document["bufferViews"][static_cast<size_t>(accessor["bufferView"].asInt(-1))];
+    double elementSize = static_cast<double>(getComponentCount(accessor["type"].asString())
+        * getComponentSize(static_cast<GLenum>(accessor["componentType"].asInt(GL_FLOAT))));
+    if(elementSize <= 0.0) return true;
+
+    int stride = view["byteStride"].asInt(0);
+    return accessorFitsView(accessor, view, elementSize, stride > 0 ? stride : elementSize);
+}
+
+static int getHexValue(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+// %20 and friends, glTF uris are percent encoded. a % without two hex digits after it is kept as is
+static std::string decodeUri(const std::string& uri) {
+    std::string out;
+    for(size_t i = 0; i < uri.size(); i++) {
+        if(uri[i] == '%' && i + 2 < uri.size()
+            && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            out += static_cast<char>(getHexValue(uri[i + 1]) * 16 + getHexValue(uri[i + 2]));
+            i += 2;
+        } else {
+            out += uri[i];
+        }
+    }
+    return out;
+}
+
+static bool decodeBase64(const std::string& text, size_t start, std::vector<char>& out) {
+    static int8_t table[256];
+    static bool tableReady = false;
+    if(!tableReady) {
+        std::memset(table, -1, sizeof(table));
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for(int i = 0; i < 64; i++) table[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+        tableReady = true;
+    }
+
+    out.clear();
+    out.reserve((text.size() - start) / 4 * 3);
+
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for(size_t i = start; i < text.size() && text[i] != '='; i++) {
+        int value = table[static_cast<unsigned char>(text[i])];
+        if(value < 0) return false;
+
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        bitCount += 6;
+        if(bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back(static_cast<char>((bits >> bitCount) & 0xFF));
+        }
+    }
+    return true;
+}
+
+static glm::mat4 getNodeMatrix(const JsonValue& node) {
+    const JsonValue& matrix = node["matrix"];
+    if(matrix.size() == 16) {
+        glm::mat4 result;
+        for(int column = 0; column < 4; column++) {
+            for(int row = 0; row < 4; row++) {
+                result[column][row] = static_cast<float>(matrix[column * 4 + row].asNumber());
+            }
+        }
+        return result;
+    }
+
+    glm::mat4 result(1.0f);
+    const JsonValue& translation = node["translation"];
+    if(translation.size() == 3) {
+        result = glm::translate(result, glm::vec3(
+            translation[0].asNumber(), translation[1].asNumber(), translation[2].asNumber()));
+    }
+
+    const JsonValue& rotation = node["rotation"];
+    if(rotation.size() == 4) {
+        // glTF stores x, y, z, w
+        glm::quat quaternion(static_cast<float>(rotation[3].asNumber()), static_cast<float>(rotation[0].asNumber()),
+                             static_cast<float>(rotation[1].asNumber()), static_cast<float>(rotation[2].asNumber()));
+        result = result * glm::mat4_cast(quaternion);
+    }
+
+    const JsonValue& scale = node["scale"];
+    if(scale.size() == 3) {
+        result = glm::scale(result, glm::vec3(scale[0].asNumber(), scale[1].asNumber(), scale[2].asNumber()));
+    }
+    return result;
+}
+
+bool GltfLoader::load(const std::string& path, GltfData& out) {
+    FileData file = VirtualFileSystem::read(path);
+    if(!file.isValid()) return false;
+
+    Context context;
+    context.out = &out;
+    size_t lastSlash = path.find_last_of("/\\");
+    context.directory = (lastSlash == std::string::npos) ? "." : path.substr(0, lastSlash);
+
+    // a .glb is a small header, the JSON chunk and the binary chunk, a .gltf is only the JSON
+    Source json = { file.data(), file.size() };
+    Source binaryChunk;
+    uint32_t header[3];
+    if(file.size() >= sizeof(header) && (std::memcpy(header, file.data(), sizeof(header)), header[0] == kGlbMagic)) {
+        if(header[1] != 2) {
+            std::cerr << "ERROR::GLTF:: " << path << " is glTF version " << header[1] << ", only 2 is supported" << std::endl;
+            return false;
+        }
+
+        json.size = 0;
+        size_t offset = sizeof(header);
+        size_t length = std::min<size_t>(header[2], file.size());
+        while(offset + 8 <= length) {
+            uint32_t chunk[2]; // length, type
+            std::memcpy(chunk, file.data() + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+            if(offset + chunk[0] > length) break;
+
+            if(chunk[1] == kChunkJson) json = { file.data() + offset, chunk[0] };
+            else if(chunk[1] == kChunkBinary) binaryChunk = { file.data() + offset, chunk[0] };
+            offset += (chunk[0] + 3) & ~3u;
+        }
+    }
+
+    std::string error;
+    if(!json.size || !JsonValue::parse(json.data, json.size, context.document, error)) {
+        std::cerr << "ERROR::GLTF:: Could not parse " << path << ": " << error << std::endl;
+        return false;
+    }
+
+    const JsonValue& document = context.document;
+    if(document["skins"].size() > 0 || document["animations"].size() > 0) {
+        std::cout << "[Debug] " << path << " has skins or animations, leaving it to assimp" << std::endl;
+        return false;
+    }
+
+    if(!loadBuffers(context, binaryChunk)) return false;
+    loadMaterials(context);
+
+    const JsonValue& scene = document["scenes"][static_cast<size_t>(document["scene"].asInt(0))];
+    const JsonValue& roots = scene["nodes"];
+    for(size_t i = 0; i < roots.size(); i++) {
+        loadNode(context, roots[i].asInt(-1), glm::mat4(1.0f), 0);
+    }
+
+    // the GL buffers read straight from the mappings, which can close now
+    for(const auto& entry : context.viewBuffers) {
+        out.buffers.push_back(entry.second);
+    }
+
+    std::cout << "[Debug] glTF " << path << ": " << out.primitives.size() << " primitives from "
+              << out.buffers.size() << " buffer views" << std::endl;
+    return !out.primitives.empty();
+}
+
+bool GltfLoader::loadBuffers(Context& context, const Source& binaryChunk) {
+    const JsonValue& buffers = context.document["buffers"];
+    context.buffers.resize(buffers.size());
+
+    for(size_t i = 0; i < buffers.size(); i++) {
+        const JsonValue& buffer = buffers[i];
+        const std::string& uri = buffer["uri"].asString();
+        size_t byteLength = static_cast<size_t>(buffer["byteLength"].asNumber());
+        Source& source = context.buffers[i];
+
+        if(uri.empty()) {
+            // the first buffer of a .glb lives in its binary chunk
+            source = binaryChunk;
+        }
+        else if(uri.compare(0, 5, "data:") == 0) {
+            size_t comma = uri.find(',');
+            context.decodedBuffers.emplace_back();
+            if(comma == std::string::npos || !decodeBase64(uri, comma + 1, context.decodedBuffers.back())) {
+                std::cerr << "ERROR::GLTF:: Buffer " << i << " has a bad data uri" << std::endl;
+                return false;
+            }
+            source = { context.decodedBuffers.back().data(), context.decodedBuffers.back().size() };
+        }
+        else {
+            auto mapped = std::make_unique<FileData>(VirtualFileSystem::read(context.directory + '/' + decodeUri(uri)));
+            if(!mapped->isValid()) return false;
+            source = { mapped->data(), mapped->size() };
+            context.mappedBuffers.push_back(std::move(mapped));
+        }
+
+        if(source.size < byteLength) {
+            std::cerr << "ERROR::GLTF:: Buffer " << i << " is shorter than its byteLength" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string GltfLoader::getImagePath(Context& context, const JsonValue& textureInfo) {
+    if(textureInfo.isNull()) return std::string();
+
+    const JsonValue& texture = context.document["textures"][static_cast<size_t>(textureInfo["index"].asInt(-1))];
+    const JsonValue& image = context.document["images"][static_cast<size_t>(texture["source"].asInt(-1))];
+    const std::string& uri = image["uri"].asString();
+
+    // the streamer reads textures from files, images packed into the buffers are not supported yet
+    if(uri.empty() || uri.compare(0, 5, "data:") == 0) {
+        std::cout << "[Debug] Skipping embedded glTF image " << image["name"].asString() << std::endl;
+        return std::string();
+    }
+    return decodeUri(uri);
+}
+
+void GltfLoader::loadMaterials(Context& context) {
+    const JsonValue& materials = context.document["materials"];
+    for(size_t i = 0; i < materials.size(); i++) {
+        const JsonValue& source = materials[i];
+        const JsonValue& pbr = source["pbrMetallicRoughness"];
+
+        GltfMaterial material;
+        material.name = source["name"].asString();
+
+        const JsonValue& factor = pbr["baseColorFactor"];
+        if(factor.size() == 4) {
+            material.baseColor = glm::vec4(factor[0].asNumber(), factor[1].asNumber(), factor[2].asNumber(), factor[3].asNumber());
+        }
+        material.roughness = static_cast<float>(pbr["roughnessFactor"].asNumber(1.0));
+        material.doubleSided = source["doubleSided"].asBool(false);
+        material.diffuseMap = getImagePath(context, pbr["baseColorTexture"]);
+        material.normalMap = getImagePath(context, source["normalTexture"]);
+
+        context.out->materials.push_back(material);
+    }
+}
+
+void GltfLoader::loadNode(Context& context, int nodeIndex, const glm::mat4& parent, int depth) {
+    const JsonValue& node = context.document["nodes"][static_cast<size_t>(nodeIndex)];
+    if(!node.isObject() || depth > kMaxNodeDepth) return;
+
+    glm::mat4 transform = parent * getNodeMatrix(node);
+
+    if(node.has("mesh")) {
+        const JsonValue& mesh = context.document["meshes"][static_cast<size_t>(node["mesh"].asInt(-1))];
+        std::string name = node["name"].asString();
+        if(name.empty()) name = mesh["name"].asString();
+
+        const JsonValue& primitives = mesh["primitives"];
+        for(size_t i = 0; i < primitives.size(); i++) {
+            loadPrimitive(context, primitives[i], name, transform);
+        }
+    }
+
+    const JsonValue& children = node["children"];
+    for(size_t i = 0; i < children.size(); i++) {
+        loadNode(context, children[i].asInt(-1), transform, depth + 1);
+    }
+}
+
+void GltfLoader::loadPrimitive(Context& context, const JsonValue& primitive, const std::string& name, const glm::mat4& transform) {
+    if(primitive["mode"].asInt(4) != 4) {
+        std::cout << "[Debug] Skipping non triangle primitive in " << name << std::endl;
+        return;
+    }
+
+    const JsonValue& attributes = primitive["attributes"];
+    GltfPrimitive out;
+    out.name = name;
+    out.material = primitive["material"].asInt(-1);
+    out.transform = transform;
+
+    int positionAccessor = attributes["POSITION"].asInt(-1);
+    int normalAccessor = attributes["NORMAL"].asInt(-1);
+    int texCoordAccessor = attributes["TEXCOORD_0"].asInt(-1);
+
+    // GL would read past the end of the buffer at draw time
+    for(int accessorIndex : { positionAccessor, normalAccessor, texCoordAccessor }) {
+        if(!attributeFitsView(context.document, accessorIndex)) {
+            std::cerr << "ERROR::GLTF:: accessor " << accessorIndex << " runs past its bufferView" << std::endl;
+            return;
+        }
+    }
+
+    if(!getAttribute(context, positionAccessor, out.geometry.attributes[0])) return;
+    getAttribute(context, normalAccessor, out.geometry.attributes[1]);
+    getAttribute(context, texCoordAccessor, out.geometry.attributes[2]);
+
+    const JsonValue& indices = primitive["indices"];
+    if(!indices.isNull()) {
+        const JsonValue& accessor = context.document["accessors"][static_cast<size_t>(indices.asInt(-1))];
+        GLenum type = static_cast<GLenum>(accessor["componentType"].asInt());
+        if(type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT) return;
+
+        int viewIndex = accessor["bufferView"].asInt(-1);
+        double indexSize = static_cast<double>(getComponentSize(type));
+        if(!accessorFitsView(accessor, context.document["bufferViews"][static_cast<size_t>(viewIndex)], indexSize, indexSize)) {
+            std::cerr << "ERROR::GLTF:: index accessor " << indices.asInt(-1) << " runs past its bufferView" << std::endl;
+            return;
+        }
+
+        out.geometry.indexBuffer = getViewBuffer(context, viewIndex);
+        if(!out.geometry.indexBuffer) return;
+        out.geometry.indexType = type;
+        out.geometry.indexOffset = static_cast<size_t>(accessor["byteOffset"].asNumber());
+        out.geometry.count = static_cast<unsigned int>(accessor["count"].asNumber());
+    } else {
+        out.geometry.count = static_cast<unsigned int>(context.document["accessors"][static_cast<size_t>(positionAccessor)]["count"].asNumber());
+    }
+
+    out.geometry.bounds = getPositionBounds(context, positionAccessor).transformed(transform);
+    context.out->primitives.push_back(out);
+}
+
+GLuint GltfLoader::getViewBuffer(Context& context, int viewIndex) {
+    auto found = context.viewBuffers.find(viewIndex);
+    if(found != context.viewBuffers.end()) return found->second;
+
+    const JsonValue& view = context.document["bufferViews"][static_cast<size_t>(viewIndex)];
+    size_t bufferIndex = static_cast<size_t>(view["buffer"].asInt(-1));
+    if(!view.isObject() || bufferIndex >= context.buffers.size()) return 0;
+
+    const Source& source = context.buffers[bufferIndex];
+    size_t offset = static_cast<size_t>(view["byteOffset"].asNumber());
+    size_t length = static_cast<size_t>(view["byteLength"].asNumber());
+    if(offset + length > source.size) {
+        std::cerr << "ERROR::GLTF:: bufferView " << viewIndex << " runs past its buffer" << std::endl;
+        return 0;
+    }
+
+    // straight from the mapping, a view another model already uploaded is shared instead
+    GLuint buffer = GeometryRegistry::acquire(source.data + offset, length);
+    if(!buffer) return 0;
+
+    context.viewBuffers.emplace(viewIndex, buffer);
+    return buffer;
+}
+
+bool GltfLoader::getAttribute(Context& context, int accessorIndex, VertexAttribute& attribute) {
+    if(accessorIndex < 0) return false;
+
+    const JsonValue& accessor = context.document["accessors"][static_cast<size_t>(accessorIndex)];
+    if(accessor.has("sparse") || !accessor.has("bufferView")) {
+        std::cout << "[Debug] Skipping sparse or empty glTF accessor " << accessorIndex << std::endl;
+        return false;
+    }
+
+    int viewIndex = accessor["bufferView"].asInt(-1);
+    attribute.buffer = getViewBuffer(context, viewIndex);
+    if(!attribute.buffer) return false;
+
+    attribute.components = getComponentCount(accessor["type"].asString());
+    attribute.type = static_cast<GLenum>(accessor["componentType"].asInt(GL_FLOAT));
+    attribute.normalized = accessor["normalized"].asBool() ? GL_TRUE : GL_FALSE;
+    attribute.integer = false;
+    // 0 is tightly packed for both glTF and GL
+    attribute.stride = static_cast<GLsizei>(context.document["bufferViews"][static_cast<size_t>(viewIndex)]["byteStride"].asInt(0));
+    attribute.offset = static_cast<size_t>(accessor["byteOffset"].asNumber());
+    return attribute.components > 0 && getComponentSize(attribute.type) > 0;
+}
+
+BoundingBox GltfLoader::getPositionBounds(Context& context, int accessorIndex) {
+    const JsonValue& accessor = context.document["accessors"][static_cast<size_t>(accessorIndex)];
+    BoundingBox bounds;
+
+    // the spec requires min and max on positions, so this is the usual path
+    const JsonValue& min = accessor["min"];
+    const JsonValue& max = accessor["max"];
+    if(min.size() == 3 && max.size() == 3) {
+        bounds.expand(glm::vec3(min[0].asNumber(), min[1].asNumber(), min[2].asNumber()));
+        bounds.expand(glm::vec3(max[0].asNumber(), max[1].asNumber(), max[2].asNumber()));
+        return bounds;
+    }
+
+    const JsonValue& view = context.document["bufferViews"][static_cast<size_t>(accessor["bufferView"].asInt(-1))];
+    size_t bufferIndex = static_cast<size_t>(view["buffer"].asInt(-1));
+    if(bufferIndex >= context.buffers.size() || accessor["componentType"].asInt() != GL_FLOAT) return bounds;
+
+    const Source& source = context.buffers[bufferIndex];
+    size_t stride = static_cast<size_t>(view["byteStride"].asInt(0));
+    if(stride == 0) stride = 3 * sizeof(float);
+    size_t start = static_cast<size_t>(view["byteOffset"].asNumber() + accessor["byteOffset"].asNumber());
+    size_t count = static_cast<size_t>(accessor["count"].asNumber());
+
+    for(size_t i = 0; i < count && start + i * stride + 3 * sizeof(float) <= source.size; i++) {
+        glm::vec3 position;
+        std::memcpy(&position.x, source.data + start + i * stride, sizeof(float));
+        std::memcpy(&position.y, source.data + start + i * stride + 4, sizeof(float));
+        std::memcpy(&position.z, source.data + start + i * stride + 8, sizeof(float));
+        bounds.expand(position);
+    }
+    return bounds;
+}
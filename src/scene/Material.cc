@@ -0,0 +1,174 @@
+#include "scene/Material.h"
+#include "renderer/GLState.h"
+
+#include <cstring>
+#include <algorithm>
+
+std::vector<Material> MaterialLibrary::s_materials;
+std::vector<bool> MaterialLibrary::s_alive;
+std::vector<MaterialHandle> MaterialLibrary::s_freeHandles;
+std::vector<unsigned int> MaterialLibrary::s_configuredPrograms;
+
+GLuint MaterialLibrary::s_UBO = 0;
+size_t MaterialLibrary::s_stride = sizeof(MaterialParams);
+size_t MaterialLibrary::s_capacity = 0;
+bool MaterialLibrary::s_dirty = true;
+
+static uint32_t getSlotFlag(MaterialSlot slot) {
+    switch(slot) {
+        case MaterialSlot::Diffuse:  return kMaterialHasDiffuse;
+        case MaterialSlot::Specular: return kMaterialHasSpecular;
+        case MaterialSlot::Normal:   return kMaterialHasNormalMap;
+        default:                     return 0;
+    }
+}
+
+void Material::setTexture(MaterialSlot slot, GLuint texture) {
+    textures[static_cast<int>(slot)] = texture;
+    if(texture) {
+        params.flags |= getSlotFlag(slot);
+    } else {
+        params.flags &= ~getSlotFlag(slot);
+    }
+}
+
+GLuint Material::getTexture(MaterialSlot slot) const {
+    return textures[static_cast<int>(slot)];
+}
+
+void MaterialLibrary::init() {
+    if(!s_materials.empty()) return;
+
+    // every block has to start on the driver's offset alignment for glBindBufferRange
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    size_t align = static_cast<size_t>(std::max(alignment, 1));
+    s_stride = (sizeof(MaterialParams) + align - 1) / align * align;
+
+    Material fallback;
+    fallback.name = "Default";
+    s_materials.push_back(fallback);
+    s_alive.push_back(true);
+    s_dirty = true;
+}
+
+void MaterialLibrary::shutdown() {
+    if(s_UBO) {
+        MemoryTracker::untrackBuffer(s_UBO);
+        glDeleteBuffers(1, &s_UBO);
+    }
+    s_UBO = 0;
+    s_capacity = 0;
+
+    s_materials.clear();
+    s_alive.clear();
+    s_freeHandles.clear();
+    s_configuredPrograms.clear();
+}
+
+MaterialHandle MaterialLibrary::create(const Material& material) {
+    init();
+
+    MaterialHandle handle;
+    if(!s_freeHandles.empty()) {
+        handle = s_freeHandles.back();
+        s_freeHandles.pop_back();
+        s_materials[handle] = material;
+        s_alive[handle] = true;
+    } else {
+        handle = static_cast<MaterialHandle>(s_materials.size());
+        s_materials.push_back(material);
+        s_alive.push_back(true);
+    }
+
+    s_dirty = true;
+    return handle;
+}
+
+void MaterialLibrary::destroy(MaterialHandle handle) {
+    if(handle == kDefaultMaterial || !isValid(handle)) return;
+
+    // the textures belong to the model's texture loader, only the slot is given back
+    s_materials[handle] = Material();
+    s_alive[handle] = false;
+    s_freeHandles.push_back(handle);
+}
+
+const Material& MaterialLibrary::get(MaterialHandle handle) {
+    init();
+    return isValid(handle) ? s_materials[handle] : s_materials[kDefaultMaterial];
+}
+
+void MaterialLibrary::setParams(MaterialHandle handle, const MaterialParams& params) {
+    if(!isValid(handle)) return;
+
+    // the flags follow the textures, so they are not taken from the caller
+    uint32_t flags = s_materials[handle].params.flags;
+    s_materials[handle].params = params;
+    s_materials[handle].params.flags = flags;
+    s_dirty = true;
+}
+
+void MaterialLibrary::setupProgram(const Shader& shader) {
+    for(unsigned int program : s_configuredPrograms) {
+        if(program == shader.m_ID) return;
+    }
+    s_configuredPrograms.push_back(shader.m_ID);
+
+    GLState::useProgram(shader.m_ID);
+    shader.setInt("texture_diffuse1", static_cast<int>(MaterialSlot::Diffuse));
+    shader.setInt("texture_specular1", static_cast<int>(MaterialSlot::Specular));
+    shader.setInt("texture_normal1", static_cast<int>(MaterialSlot::Normal));
+
+    GLuint block = glGetUniformBlockIndex(shader.m_ID, "MaterialBlock");
+    if(block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader.m_ID, block, kBlockBinding);
+    }
+}
+
+void MaterialLibrary::bind(MaterialHandle handle) {
+    if(s_dirty) upload();
+
+    const Material& material = get(handle);
+    if(!isValid(handle)) handle = kDefaultMaterial;
+
+    // meshes sharing a texture (or having none) skip the bind
+    for(int slot = 0; slot < static_cast<int>(MaterialSlot::Count); slot++) {
+        GLState::bindTexture(slot, GL_TEXTURE_2D, material.textures[slot]);
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, kBlockBinding, s_UBO, handle * s_stride, sizeof(MaterialParams));
+}
+
+size_t MaterialLibrary::getMaterialCount() {
+    return s_materials.size() - s_freeHandles.size();
+}
+
+bool MaterialLibrary::isValid(MaterialHandle handle) {
+    return handle < s_materials.size() && s_alive[handle];
+}
+
+// materials change at load time or from the editor, so the whole buffer is rewritten
+void MaterialLibrary::upload() {
+    init();
+
+    if(!s_UBO) {
+        glGenBuffers(1, &s_UBO);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, s_UBO);
+    if(s_materials.size() > s_capacity) {
+        s_capacity = std::max(s_materials.size(), s_capacity * 2);
+        glBufferData(GL_UNIFORM_BUFFER, s_capacity * s_stride, nullptr, GL_DYNAMIC_DRAW);
+        MemoryTracker::trackBuffer(s_UBO, MemoryTag::Renderer, s_capacity * s_stride);
+    }
+
+    std::vector<unsigned char> staging(s_materials.size() * s_stride, 0);
+    for(size_t i = 0; i < s_materials.size(); i++) {
+        std::memcpy(staging.data() + i * s_stride, &s_materials[i].params, sizeof(MaterialParams));
+    }
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    s_dirty = false;
+}
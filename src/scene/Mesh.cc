@@ -1,49 +1,170 @@
 #include "scene/Mesh.h"
+#include "renderer/GLState.h"
+#include "scene/GeometryRegistry.h"
+#include "scene/MeshletBuilder.h"
 
 Mesh::Mesh(std::vector<Vertex> vertices
     , std::vector<unsigned int> indices
-    , std::vector<Texture> textures
-    , glm::vec4 baseColor
+    , MaterialHandle material
     , const std::string& name
 ) 
-    : m_vertices(vertices)
-    , m_indices(indices)
-    , m_textures(textures)
-    , m_baseColor(baseColor)
+    : m_vertices(std::move(vertices))
+    , m_indices(std::move(indices))
+    , m_material(material)
     , m_name(name)
     , m_VAO(0)
     , m_VBO(0)
     , m_EBO(0) 
 {
+    for(const auto& vertex : m_vertices) {
+        m_bounds.expand(vertex.position);
+        if(vertex.weights.x > 0) m_isSkinned = true;
+    }
+
+    // the bounds only cover the bind pose, leave room for the animation to move the limbs around
+    if(m_isSkinned && m_bounds.isValid()) {
+        glm::vec3 padding = m_bounds.getExtents() * 0.5f;
+        m_bounds.min -= padding;
+        m_bounds.max += padding;
+    }
+
+    // big static meshes are culled meshlet by meshlet, the animation would move skinned ones out of their bounds
+    if(!m_isSkinned && m_indices.size() % 3 == 0 && m_indices.size() / 3 >= MeshletBuilder::kMinTriangles) {
+        m_meshlets = MeshletBuilder::build(m_vertices, m_indices);
+        MemoryTracker::trackCpu(m_meshlets.data(), MemoryTag::Meshes, m_meshlets.capacity() * sizeof(Meshlet));
+    }
+
+    m_drawCount = static_cast<unsigned int>(m_indices.size());
     setupMesh(); 
 }
 
+Mesh::Mesh(const GpuGeometry& geometry, MaterialHandle material, const std::string& name)
+    : m_material(material)
+    , m_name(name)
+    , m_bounds(geometry.bounds)
+    , m_VAO(0)
+    , m_VBO(0)
+    , m_EBO(0)
+    , m_drawCount(geometry.count)
+    , m_indexed(geometry.indexBuffer != 0)
+    , m_indexType(geometry.indexType)
+    , m_indexOffset(geometry.indexOffset)
+{
+    glGenVertexArrays(1, &m_VAO);
+    GLState::bindVertexArray(m_VAO);
+
+    for(GLuint location = 0; location < 5; location++) {
+        const VertexAttribute& attribute = geometry.attributes[location];
+        if(!attribute.buffer) continue;
+
+        glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+        glEnableVertexAttribArray(location);
+        if(attribute.integer) {
+            glVertexAttribIPointer(location, attribute.components, attribute.type, attribute.stride, (void*)attribute.offset);
+        } else {
+            glVertexAttribPointer(location, attribute.components, attribute.type, attribute.normalized, attribute.stride, (void*)attribute.offset);
+        }
+    }
+
+    // the element buffer binding is part of the VAO
+    if(m_indexed) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.indexBuffer);
+    }
+
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_isSkinned = geometry.attributes[4].buffer != 0;
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : m_isVisible(other.m_isVisible)
+    , m_isCulled(other.m_isCulled)
+    , m_name(std::move(other.m_name))
+    , m_bounds(other.m_bounds)
+    , m_transform(other.m_transform)
+    , m_hasTransform(other.m_hasTransform)
+    , m_vertices(std::move(other.m_vertices))
+    , m_indices(std::move(other.m_indices))
+    , m_positions(std::move(other.m_positions))
+    , m_meshlets(std::move(other.m_meshlets))
+    , m_material(other.m_material)
+    , m_VAO(other.m_VAO)
+    , m_VBO(other.m_VBO)
+    , m_EBO(other.m_EBO)
+    , m_occlusionBuffer(other.m_occlusionBuffer)
+    , m_isSkinned(other.m_isSkinned)
+    , m_isOccluder(other.m_isOccluder)
+    , m_drawCount(other.m_drawCount)
+    , m_indexed(other.m_indexed)
+    , m_indexType(other.m_indexType)
+    , m_indexOffset(other.m_indexOffset)
+{
+    other.m_VAO = other.m_VBO = other.m_EBO = 0;
+    other.m_occlusionBuffer = 0;
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if(this == &other) return *this;
+
+    release();
+
+    m_isVisible = other.m_isVisible;
+    m_isCulled = other.m_isCulled;
+    m_name = std::move(other.m_name);
+    m_bounds = other.m_bounds;
+    m_vertices = std::move(other.m_vertices);
+    m_indices = std::move(other.m_indices);
+    m_positions = std::move(other.m_positions);
+    m_meshlets = std::move(other.m_meshlets);
+    m_material = other.m_material;
+    m_VAO = other.m_VAO;
+    m_VBO = other.m_VBO;
+    m_EBO = other.m_EBO;
+    m_occlusionBuffer = other.m_occlusionBuffer;
+    m_isSkinned = other.m_isSkinned;
+    m_isOccluder = other.m_isOccluder;
+    m_transform = other.m_transform;
+    m_hasTransform = other.m_hasTransform;
+    m_drawCount = other.m_drawCount;
+    m_indexed = other.m_indexed;
+    m_indexType = other.m_indexType;
+    m_indexOffset = other.m_indexOffset;
+
+    other.m_VAO = other.m_VBO = other.m_EBO = 0;
+    other.m_occlusionBuffer = 0;
+    return *this;
+}
+
 /**
  * @brief Sets up the mesh for rendering by initializing OpenGL buffers and configuring vertex attributes.
  *
- * This function generates and binds the necessary OpenGL objects for the mesh, including the Vertex Array Object (VAO),
- * Vertex Buffer Object (VBO), and Element Buffer Object (EBO). It uploads the mesh's vertex and index data to the GPU,
- * and specifies how the vertex data is laid out in memory for use in shaders.
+ * This function generates and binds the Vertex Array Object (VAO) for the mesh and gets the Vertex Buffer Object (VBO)
+ * and Element Buffer Object (EBO) from the GeometryRegistry, which only uploads the data if no other mesh already has
+ * identical bytes resident. It then specifies how the vertex data is laid out in memory for use in shaders.
  *
- * The function enables and configures three vertex attributes:
+ * The function enables and configures five vertex attributes:
  *   - Position (location 0): 3 floats per vertex, starting at offset 0.
  *   - Normal (location 1): 3 floats per vertex, starting at the offset of the 'normal' member in the Vertex struct.
  *   - Texture Coordinates (location 2): 2 floats per vertex, starting at the offset of the 'texCoords' member in the Vertex struct.
+ *   - Joint Indices (location 3): 4 unsigned bytes read as integers.
+ *   - Joint Weights (location 4): 4 unsigned bytes normalized to [0, 1].
  *
  * After configuration, the VAO is unbound to prevent accidental modification.
  */
 void Mesh::setupMesh() {
-    glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-    glGenBuffers(1, &m_EBO);
-
-    glBindVertexArray(m_VAO);
+    // shared with every mesh that has the same bytes, the registry tracks the gpu memory
+    m_VBO = GeometryRegistry::acquire(m_vertices.data(), m_vertices.size() * sizeof(Vertex));
+    m_EBO = GeometryRegistry::acquire(m_indices.data(), m_indices.size() * sizeof(unsigned int));
 
+    glGenVertexArrays(1, &m_VAO);
+    GLState::bindVertexArray(m_VAO);
     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), &m_vertices[0], GL_STATIC_DRAW);
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+
+    // the cpu copies are keyed by their storage, which stays put when the mesh is moved
+    MemoryTracker::trackCpu(m_vertices.data(), MemoryTag::Meshes, m_vertices.capacity() * sizeof(Vertex));
+    MemoryTracker::trackCpu(m_indices.data(), MemoryTag::Meshes, m_indices.capacity() * sizeof(unsigned int));
 
     // vertex positions
     glEnableVertexAttribArray(0);
@@ -54,60 +175,149 @@ void Mesh::setupMesh() {
     // vertex texture coords
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    // skinning joints and weights, all zero for static meshes
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(Vertex), (void*)offsetof(Vertex, joints));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 }
 
-void Mesh::drawMesh(Shader& shader) {
-    shader.use();
-    shader.setBool("u_HasTexture", !m_textures.empty());
+// the program's samplers and material block were set up once by MaterialLibrary::setupProgram
+void Mesh::drawMesh() {
+    MaterialLibrary::bind(m_material);
+    draw();
+}
 
-    bool hasDiffuse = false;
-    bool hasSpecular = false;
-    bool hasNormal = false;
+void Mesh::drawDepth() const {
+    draw();
+}
 
-    unsigned int diffuseNr  = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
+// the vao stays bound, nothing binds an element buffer outside of a vao setup
+void Mesh::draw() const {
+    GLState::bindVertexArray(m_VAO);
+    if(m_indexed) {
+        glDrawElements(GL_TRIANGLES, m_drawCount, m_indexType, (void*)m_indexOffset);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, m_drawCount);
+    }
+}
 
-    for(unsigned int i = 0; i < m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i); 
-        
-        std::string number;
-        std::string name = m_textures[i].type;
-        
-        if(name == "texture_diffuse") {
-            number = std::to_string(diffuseNr++);
-            hasDiffuse = true;
-        }
-        else if(name == "texture_specular") {
-            number = std::to_string(specularNr++);
-            hasSpecular = true;
-        }
-        else if(name == "texture_normal") {
-            number = std::to_string(normalNr++);
-            hasNormal = true;
+void Mesh::drawRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount) const {
+    GLState::bindVertexArray(m_VAO);
+    glMultiDrawElements(GL_TRIANGLES, counts, m_indexType, offsets, rangeCount);
+}
+
+const std::vector<Meshlet>& Mesh::getMeshlets() const {
+    return m_meshlets;
+}
+
+MaterialHandle Mesh::getMaterial() const {
+    return m_material;
+}
+
+void Mesh::setMaterial(MaterialHandle material) {
+    m_material = material;
+}
+
+void Mesh::setAmbientOcclusion(const std::vector<uint8_t>& occlusion) {
+    if(!m_VAO || occlusion.empty() || occlusion.size() != m_vertices.size()) return;
+
+    // identical models baked in the same spot share this too
+    GeometryRegistry::release(m_occlusionBuffer);
+    m_occlusionBuffer = GeometryRegistry::acquire(occlusion.data(), occlusion.size());
+
+    GLState::bindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_occlusionBuffer);
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 1, GL_UNSIGNED_BYTE, GL_TRUE, 1, (void*)0);
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool Mesh::hasAmbientOcclusion() const {
+    return m_occlusionBuffer != 0;
+}
+
+void Mesh::releaseCpuGeometry(CpuGeometry keep) {
+    // skinned meshes only have their bind pose on the cpu, useless as an occluder
+    bool occluder = keep != CpuGeometry::None && !m_isSkinned && !m_indices.empty()
+        && m_indices.size() / 3 <= kMaxOccluderTriangles;
+    m_isOccluder = occluder;
+
+    // Full keeps the vertices, which already hold the positions
+    if(occluder && keep != CpuGeometry::Full && m_positions.empty()) {
+        m_positions.reserve(m_vertices.size());
+        for(const Vertex& vertex : m_vertices) {
+            m_positions.push_back(vertex.position);
         }
+        MemoryTracker::trackCpu(m_positions.data(), MemoryTag::Meshes, m_positions.capacity() * sizeof(glm::vec3));
+    }
+
+    // swapping with an empty vector is what actually gives the storage back
+    if(keep != CpuGeometry::Full) {
+        MemoryTracker::untrackCpu(m_vertices.data());
+        std::vector<Vertex>().swap(m_vertices);
+    }
+    if(keep != CpuGeometry::Full && !occluder) {
+        MemoryTracker::untrackCpu(m_indices.data());
+        std::vector<unsigned int>().swap(m_indices);
+    }
+}
+
+bool Mesh::hasCpuGeometry() const {
+    return !m_vertices.empty() && !m_indices.empty();
+}
+
+const std::vector<Vertex>& Mesh::getVertices() const {
+    return m_vertices;
+}
 
-        // This sets "texture_diffuse1" to 0, "texture_diffuse2" to 1, etc.
-        shader.setInt((name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, m_textures[i].id);
+bool Mesh::hasOccluderGeometry() const {
+    return m_isOccluder && (!m_positions.empty() || !m_vertices.empty()) && !m_indices.empty();
+}
+
+PositionView Mesh::getPositions() const {
+    PositionView view;
+    if(!m_positions.empty()) {
+        view.data = reinterpret_cast<const unsigned char*>(m_positions.data());
+    } else if(!m_vertices.empty()) {
+        view.data = reinterpret_cast<const unsigned char*>(&m_vertices[0].position);
+        view.stride = sizeof(Vertex);
     }
+    return view;
+}
 
-    shader.setVec4("u_BaseColor", m_baseColor);
-    shader.setBool("u_HasDiffuse", hasDiffuse);
-    shader.setBool("u_HasSpecular", hasSpecular);
-    shader.setBool("u_HasNormalMap", hasNormal);
+const std::vector<unsigned int>& Mesh::getIndices() const {
+    return m_indices;
+}
 
-    glBindVertexArray(m_VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(m_indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+unsigned int Mesh::getTriangleCount() const {
+    return m_drawCount / 3;
+}
 
-    glActiveTexture(GL_TEXTURE0); // Clean up
+bool Mesh::isSkinned() const {
+    return m_isSkinned;
+}
+
+void Mesh::release() {
+    MemoryTracker::untrackCpu(m_vertices.data());
+    MemoryTracker::untrackCpu(m_indices.data());
+    MemoryTracker::untrackCpu(m_positions.data());
+    MemoryTracker::untrackCpu(m_meshlets.data());
+
+    if(m_VAO) {
+        GLState::forgetVertexArray(m_VAO);
+        glDeleteVertexArrays(1, &m_VAO);
+    }
+    GeometryRegistry::release(m_VBO);
+    GeometryRegistry::release(m_EBO);
+    GeometryRegistry::release(m_occlusionBuffer);
+    m_VAO = m_VBO = m_EBO = 0;
+    m_occlusionBuffer = 0;
 }
 
 Mesh::~Mesh() {
-    // glDeleteVertexArrays(1, &m_VAO);
-    // glDeleteBuffers(1, &m_VBO);
-    // glDeleteBuffers(1, &m_EBO);
+    release();
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "scene/MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// keeps meshlets from picking a neighbour that only fits slightly better but bends the cone
+static const float kNormalWeight = 0.4f;
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::vector<Meshlet> meshlets;
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    if(triangleCount == 0) return meshlets;
+
+    // unit face normals, zero for degenerate triangles
+    std::vector<glm::vec3> normals(triangleCount);
+    for(uint32_t t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    // the triangles around each vertex, flattened
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for(unsigned int index : indices) adjacencyOffsets[index + 1]++;
+    for(uint32_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(uint32_t t = 0; t < triangleCount; t++) {
+            for(int corner = 0; corner < 3; corner++) {
+                adjacency[fill[indices[t * 3 + corner]]++] = t;
+            }
+        }
+    }
+
+    // stamped with the meshlet that last took the vertex or listed the triangle
+    std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> candidateMeshlet(triangleCount, UINT32_MAX);
+    std::vector<bool> used(triangleCount, false);
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(indices.size());
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> candidates;
+    uint32_t seedCursor = 0;
+
+    while(reordered.size() < indices.size()) {
+        uint32_t id = static_cast<uint32_t>(meshlets.size());
+        unsigned int meshletVertices = 0;
+        glm::vec3 normalSum(0.0f);
+        triangles.clear();
+        candidates.clear();
+
+        auto newVertices = [&](uint32_t t) {
+            unsigned int extra = 0;
+            for(int corner = 0; corner < 3; corner++) {
+                if(vertexMeshlet[indices[t * 3 + corner]] != id) extra++;
+            }
+            return extra;
+        };
+
+        auto add = [&](uint32_t t) {
+            used[t] = true;
+            triangles.push_back(t);
+            normalSum += normals[t];
+            for(int corner = 0; corner < 3; corner++) {
+                unsigned int v = indices[t * 3 + corner];
+                if(vertexMeshlet[v] == id) continue;
+                vertexMeshlet[v] = id;
+                meshletVertices++;
+
+                // the neighbours of a vertex that just joined become candidates
+                for(uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; i++) {
+                    uint32_t neighbour = adjacency[i];
+                    if(used[neighbour] || candidateMeshlet[neighbour] == id) continue;
+                    candidateMeshlet[neighbour] = id;
+                    candidates.push_back(neighbour);
+                }
+            }
+        };
+
+        while(used[seedCursor]) seedCursor++;
+        add(seedCursor);
+
+        while(triangles.size() < kMaxTriangles) {
+            glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+
+            int best = -1;
+            float bestScore = 1e30f;
+            for(size_t i = 0; i < candidates.size();) {
+                uint32_t t = candidates[i];
+                if(used[t]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                unsigned int extra = newVertices(t);
+                if(meshletVertices + extra <= kMaxVertices) {
+                    float score = extra + kNormalWeight * (1.0f - glm::dot(normals[t], axis));
+                    if(score < bestScore) {
+                        bestScore = score;
+                        best = static_cast<int>(t);
+                    }
+                }
+                i++;
+            }
+
+            if(best < 0) {
+                // nothing connected fits, a mostly empty meshlet takes the next triangle in index
+                // order instead, which is usually close by, a fuller one is done
+                if(triangles.size() >= kMaxTriangles / 2 || meshletVertices + 3 > kMaxVertices) break;
+                while(seedCursor < triangleCount && used[seedCursor]) seedCursor++;
+                if(seedCursor == triangleCount) break;
+                best = static_cast<int>(seedCursor);
+            }
+            add(static_cast<uint32_t>(best));
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+        meshlet.indexCount = static_cast<uint32_t>(triangles.size() * 3);
+        for(uint32_t t : triangles) {
+            reordered.insert(reordered.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+        computeBounds(vertices, indices, normals, triangles, meshlet);
+        meshlets.push_back(meshlet);
+    }
+
+    indices.swap(reordered);
+    return meshlets;
+}
+
+void MeshletBuilder::computeBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                                   const std::vector<glm::vec3>& normals, const std::vector<uint32_t>& triangles, Meshlet& meshlet) {
+    // sphere around the center of the box, a few percent looser than the smallest one at most
+    BoundingBox box;
+    for(uint32_t t : triangles) {
+        for(int corner = 0; corner < 3; corner++) box.expand(vertices[indices[t * 3 + corner]].position);
+    }
+    meshlet.center = box.getCenter();
+    float radiusSquared = 0.0f;
+    for(uint32_t t : triangles) {
+        for(int corner = 0; corner < 3; corner++) {
+            glm::vec3 offset = vertices[indices[t * 3 + corner]].position - meshlet.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // the cone around the normals, degenerate triangles face nowhere and don't count
+    glm::vec3 normalSum(0.0f);
+    for(uint32_t t : triangles) normalSum += normals[t];
+    if(glm::length(normalSum) <= 0.0f) return;
+    glm::vec3 axis = glm::normalize(normalSum);
+
+    float minDot = 1.0f;
+    for(uint32_t t : triangles) {
+        if(normals[t] != glm::vec3(0.0f)) minDot = std::min(minDot, glm::dot(normals[t], axis));
+    }
+    // at 90 degrees or more from the axis some triangle faces every camera position
+    if(minDot <= 0.0f) return;
+
+    // the apex sits far enough back along the axis that every triangle's plane is in front of it
+    float maxDistance = 0.0f;
+    for(uint32_t t : triangles) {
+        if(normals[t] == glm::vec3(0.0f)) continue;
+        const glm::vec3& corner = vertices[indices[t * 3]].position;
+        float distance = glm::dot(meshlet.center - corner, normals[t]) / glm::dot(axis, normals[t]);
+        maxDistance = std::max(maxDistance, distance);
+    }
+
+    meshlet.coneAxis = axis;
+    meshlet.coneApex = meshlet.center - axis * maxDistance;
+    // back facing for all triangles once the view direction is within 90 degrees minus their spread of the axis
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
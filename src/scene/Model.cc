@@ -1,7 +1,105 @@
 #include "scene/Model.h"
+#include "scene/Scene.h"
+#include "scene/GeometryRegistry.h"
+#include "scene/AmbientOcclusionBaker.h"
+#include "core/PerfCounters.h"
+#include "core/VirtualFileSystem.h"
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <cstring>
+
+bool Model::s_useNativeLoaders = true;
+bool Model::s_bakeAmbientOcclusion = true;
+
+// the same colour can't be seen against the clear colour, so pitch black turns light grey
+static glm::vec4 getVisibleBaseColor(const glm::vec4& color) {
+    if(color.r == 0 && color.g == 0 && color.b == 0) {
+        return glm::vec4(0.6f, 0.6f, 0.6f, 1.0f);
+    }
+    return color;
+}
+
+// assimp reads the model and whatever it references (.mtl, external buffers) through the
+// virtual file system, each file is one FileData instead of assimp's own fopen and freads
+class VfsIOStream : public Assimp::IOStream {
+public:
+    explicit VfsIOStream(FileData file)
+        : m_file(std::move(file))
+    {
+    }
+
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if(size == 0) return 0;
+        size_t available = (m_file.size() - m_position) / size;
+        count = std::min(count, available);
+        std::memcpy(buffer, m_file.data() + m_position, size * count);
+        m_position += size * count;
+        return count;
+    }
+
+    size_t Write(const void*, size_t, size_t) override {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        // offsets can't be negative, from the end they count backwards like assimp's MemoryIOStream
+        if(origin == aiOrigin_END) {
+            if(offset > m_file.size()) return aiReturn_FAILURE;
+            m_position = m_file.size() - offset;
+            return aiReturn_SUCCESS;
+        }
+
+        size_t base = origin == aiOrigin_CUR ? m_position : 0;
+        if(offset > m_file.size() - base) return aiReturn_FAILURE;
+        m_position = base + offset;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override {
+        return m_position;
+    }
+
+    size_t FileSize() const override {
+        return m_file.size();
+    }
+
+    void Flush() override {
+    }
+
+private:
+    FileData m_file;
+    size_t m_position = 0;
+};
+
+class VfsIOSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char* path) const override {
+        return VirtualFileSystem::exists(path);
+    }
+
+    char getOsSeparator() const override {
+        return '/';
+    }
+
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override {
+        // read only, the packs can't be written to
+        if(std::strchr(mode, 'w') || std::strchr(mode, 'a')) return nullptr;
+        if(!VirtualFileSystem::exists(path)) return nullptr;
+
+        FileData file = VirtualFileSystem::read(path);
+        if(!file.isValid()) return nullptr;
+        return new VfsIOStream(std::move(file));
+    }
+
+    void Close(Assimp::IOStream* stream) override {
+        delete stream;
+    }
+};
 
 // implementing the constructor
-Model::Model(const std::string& filePath)
+Model::Model(const std::string& filePath, CpuGeometry cpuGeometry)
 : 
     m_filePath(filePath),
     m_scene(nullptr),
@@ -17,23 +115,57 @@ Model::Model(const std::string& filePath)
     std::cout << "[Debug] Model directory set to: " << directory << std::endl;
     m_textureLoader.m_directory = directory;
 
-    loadModel(filePath);
-    if (m_scene == nullptr) {
+    // meshes, textures and the importer's scene all count towards this file
+    MemoryTracker::AssetScope memoryScope(filePath);
+
+    // the importer owns the scene, both go at the end of the constructor
+    Assimp::Importer importer;
+    loadModel(filePath, importer);
+    if(m_scene != nullptr) {
+        trackImporterMemory(importer);
+        loadSkeleton();
+        loadMaterials();
+        processMeshes();
+        loadAnimations();
+
+        MemoryTracker::untrackCpu(&importer);
+        m_scene = nullptr;
+        m_rootNode = nullptr;
+    }
+    else if(m_meshes.empty()) {
         std::cerr << "Failed to load model: " << filePath << std::endl;
         return;
     }
 
-    processMeshes();
+    // skinned meshes move away from whatever occlusion their bind pose had
+    if(s_bakeAmbientOcclusion && !isSkinned()) {
+        bakeAmbientOcclusion();
+    }
+
+    // everything is on the gpu now, only keep what was asked for
+    for(Mesh& mesh : m_meshes) {
+        mesh.releaseCpuGeometry(cpuGeometry);
+    }
     std::cout << "Successfully loaded: " << m_filePath << " with " << m_numMeshes << " meshes." << std::endl;
 }
 
-void Model::loadModel(const std::string& path) {
+void Model::loadModel(const std::string& path, Assimp::Importer& importer) {
 
     unsigned int flags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices;
 
     std::string ext = path.substr(path.find_last_of('.') + 1); // substring after last dot
     for(auto& c: ext) c = static_cast<char>(std::tolower(c)); // convert to lower case
 
+    // the native loader hands back finished meshes, assimp is only the fallback
+    if(ext == "obj" && s_useNativeLoaders) {
+        if(loadObj(path)) return;
+        std::cerr << "ERROR::OBJ_LOADER:: Falling back to assimp for " << path << std::endl;
+    }
+    if((ext == "gltf" || ext == "glb") && s_useNativeLoaders) {
+        if(loadGltf(path)) return;
+        std::cout << "[Debug] Loading " << path << " through assimp instead" << std::endl;
+    }
+
     if(ext == "obj") {
         flags |= aiProcess_FlipUVs; // Example: flip UVs for OBJ files
     } 
@@ -41,7 +173,9 @@ void Model::loadModel(const std::string& path) {
         flags |= aiProcess_GenNormals; // Example: generate normals for FBX files
     }
     
-    m_scene = m_importer.ReadFile(
+    // the importer takes ownership of the io system
+    importer.SetIOHandler(new VfsIOSystem());
+    m_scene = importer.ReadFile(
         path, 
         flags | aiProcess_CalcTangentSpace       | aiProcess_LimitBoneWeights        |
         aiProcess_SortByPType
@@ -49,7 +183,7 @@ void Model::loadModel(const std::string& path) {
 
     if(m_scene == nullptr || m_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !m_scene->mRootNode) {
         // handle error
-        std::cerr << "ERROR::ASSIMP:: " << m_importer.GetErrorString() << std::endl;
+        std::cerr << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
         m_scene = nullptr;
         return;
     }
@@ -58,13 +192,132 @@ void Model::loadModel(const std::string& path) {
     m_numMeshes = m_scene->mNumMeshes;
 }
 
+bool Model::loadObj(const std::string& path) {
+    ObjData data;
+    if(!ObjLoader::load(path, data)) return false;
+
+    for(const ObjMaterial& objMaterial : data.materials) {
+        Material material;
+        material.name = objMaterial.name;
+        if(!objMaterial.diffuseMap.empty()) {
+            material.setTexture(MaterialSlot::Diffuse, m_textureLoader.loadTexture(objMaterial.diffuseMap, "texture_diffuse").id);
+        }
+        if(!objMaterial.specularMap.empty()) {
+            material.setTexture(MaterialSlot::Specular, m_textureLoader.loadTexture(objMaterial.specularMap, "texture_specular").id);
+        }
+        if(!objMaterial.normalMap.empty()) {
+            material.setTexture(MaterialSlot::Normal, m_textureLoader.loadTexture(objMaterial.normalMap, "texture_normal").id);
+        }
+        material.params.baseColor = getVisibleBaseColor(objMaterial.diffuse);
+
+        m_materials.push_back(MaterialLibrary::create(material));
+    }
+
+    m_meshes.reserve(data.meshes.size());
+    for(ObjMesh& objMesh : data.meshes) {
+        MaterialHandle material = objMesh.material >= 0 ? m_materials[objMesh.material] : MaterialLibrary::kDefaultMaterial;
+        m_meshes.emplace_back(std::move(objMesh.vertices), std::move(objMesh.indices), material, objMesh.name);
+    }
+    m_numMeshes = static_cast<unsigned int>(m_meshes.size());
+    return true;
+}
+
+bool Model::loadGltf(const std::string& path) {
+    GltfData data;
+    bool loaded = GltfLoader::load(path, data);
+    // whatever got uploaded belongs to the model, even if the file turned out unusable
+    m_sharedBuffers = std::move(data.buffers);
+    if(!loaded) return false;
+
+    for(const GltfMaterial& gltfMaterial : data.materials) {
+        Material material;
+        material.name = gltfMaterial.name;
+        if(!gltfMaterial.diffuseMap.empty()) {
+            material.setTexture(MaterialSlot::Diffuse, m_textureLoader.loadTexture(gltfMaterial.diffuseMap, "texture_diffuse").id);
+        }
+        if(!gltfMaterial.normalMap.empty()) {
+            material.setTexture(MaterialSlot::Normal, m_textureLoader.loadTexture(gltfMaterial.normalMap, "texture_normal").id);
+        }
+        material.params.baseColor = getVisibleBaseColor(gltfMaterial.baseColor);
+        material.doubleSided = gltfMaterial.doubleSided;
+        // the shader treats the specular strength as 1 - roughness
+        material.params.specularStrength = 1.0f - gltfMaterial.roughness;
+
+        m_materials.push_back(MaterialLibrary::create(material));
+    }
+
+    m_meshes.reserve(data.primitives.size());
+    for(const GltfPrimitive& primitive : data.primitives) {
+        bool hasMaterial = primitive.material >= 0 && static_cast<size_t>(primitive.material) < m_materials.size();
+        MaterialHandle material = hasMaterial ? m_materials[primitive.material] : MaterialLibrary::kDefaultMaterial;
+
+        m_meshes.emplace_back(primitive.geometry, material, primitive.name);
+        m_meshes.back().m_transform = primitive.transform;
+        m_meshes.back().m_hasTransform = primitive.transform != glm::mat4(1.0f);
+    }
+    m_numMeshes = static_cast<unsigned int>(m_meshes.size());
+    return true;
+}
+
+// one material per assimp material, the meshes share them by handle
+void Model::loadMaterials() {
+    for(unsigned int i = 0; i < m_scene->mNumMaterials; i++) {
+        aiMaterial* aiMat = m_scene->mMaterials[i];
+
+        aiColor4D diffuseColor(1.0f, 1.0f, 1.0f, 1.0f);
+        aiMat->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+
+        printAllTextureTypes(aiMat);
+
+        // DEBUG: Print counts for common types
+        int dCount = aiMat->GetTextureCount(aiTextureType_DIFFUSE);
+        int aCount = aiMat->GetTextureCount(aiTextureType_AMBIENT);
+
+        if(dCount > 0 || aCount > 0) {
+            std::cout << "Material " << i << " has " << dCount << " diffuse and " << aCount << " ambient textures." << std::endl;
+        }
+
+        // Try loading Ambient if Diffuse is 0
+        std::vector<Texture> diffuseMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_DIFFUSE, "texture_diffuse");
+        if(diffuseMaps.empty())
+            diffuseMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_BASE_COLOR, "texture_diffuse");
+        if(diffuseMaps.empty())
+            diffuseMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_AMBIENT, "texture_diffuse");
+        if(diffuseMaps.empty())
+            diffuseMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_UNKNOWN, "texture_diffuse");
+
+        std::vector<Texture> specularMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_SPECULAR, "texture_specular");
+
+        std::vector<Texture> normalMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_HEIGHT, "texture_normal");
+        if(normalMaps.empty()) {
+            normalMaps = m_textureLoader.loadTextures(aiMat, aiTextureType_NORMALS, "texture_normal");
+        }
+
+        // the shader only ever samples the first map of each kind
+        Material material;
+        material.name = aiMat->GetName().C_Str();
+        if(!diffuseMaps.empty()) material.setTexture(MaterialSlot::Diffuse, diffuseMaps[0].id);
+        if(!specularMaps.empty()) material.setTexture(MaterialSlot::Specular, specularMaps[0].id);
+        if(!normalMaps.empty()) material.setTexture(MaterialSlot::Normal, normalMaps[0].id);
+
+        material.params.baseColor = getVisibleBaseColor(glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a));
+
+        m_materials.push_back(MaterialLibrary::create(material));
+    }
+}
+
 void Model::processMeshes() {
+    PerfCounters::Scope perfScope("processMeshes");
+
+    m_meshes.reserve(m_numMeshes);
     for(unsigned int i = 0; i < m_numMeshes; i++) {
         aiMesh* mesh = m_scene->mMeshes[i];
         // mesh->m_isVisible = true; 
 
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3); // triangulated
 
         std::string meshName = mesh->mName.C_Str();
         std::cout << "[Debug] Processing mesh: " << meshName << " with " << mesh->mNumVertices << " vertices and " << mesh->mNumFaces << " faces." << std::endl;
@@ -99,98 +352,233 @@ void Model::processMeshes() {
             vertices.push_back(vertex);
         }
 
-        std::cout << "Mesh " << i << " material index: " << mesh->mMaterialIndex << std::endl;
+        if(mesh->mNumBones > 0 && !m_skeleton.names.empty()) {
+            loadBoneWeights(mesh, vertices);
+        }
 
+        MaterialHandle material = MaterialLibrary::kDefaultMaterial;
+        if(mesh->mMaterialIndex < m_materials.size()) {
+            material = m_materials[mesh->mMaterialIndex];
+        }
 
-        std::vector<Texture> textures;
-        aiColor4D diffuseColor(1.0f, 1.0f, 1.0f, 1.0f);
+        for(unsigned int f = 0; f < mesh->mNumFaces; f++) {
+            aiFace face = mesh->mFaces[f];
+            for(unsigned int j = 0; j < face.mNumIndices; j++) {
+                indices.push_back(face.mIndices[j]);
+            }
+        }
 
-        //loading the textures for the mesh
-        if(mesh->mMaterialIndex >= 0) {
-            aiMaterial* material = m_scene->mMaterials[mesh->mMaterialIndex];
-            material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+        m_meshes.emplace_back(std::move(vertices), std::move(indices), material, meshName);
+    }
+}
 
-            printAllTextureTypes(material);
+// assimp matrices are row major
+static glm::mat4 toGlm(const aiMatrix4x4& m) {
+    return glm::mat4(glm::vec4(m.a1, m.b1, m.c1, m.d1),
+                     glm::vec4(m.a2, m.b2, m.c2, m.d2),
+                     glm::vec4(m.a3, m.b3, m.c3, m.d3),
+                     glm::vec4(m.a4, m.b4, m.c4, m.d4));
+}
 
-            // DEBUG: Print counts for common types
-            int dCount = material->GetTextureCount(aiTextureType_DIFFUSE);
-            int aCount = material->GetTextureCount(aiTextureType_AMBIENT);
-            int bCount = material->GetTextureCount(aiTextureType_BASE_COLOR); // If using Assimp 5.1+
+void Model::loadSkeleton() {
+    std::vector<std::string> boneNames;
+    for(unsigned int i = 0; i < m_numMeshes; i++) {
+        const aiMesh* mesh = m_scene->mMeshes[i];
+        for(unsigned int b = 0; b < mesh->mNumBones; b++) {
+            boneNames.push_back(mesh->mBones[b]->mName.C_Str());
+        }
+    }
 
-            if(dCount > 0 || aCount > 0) {
-                std::cout << "Material " << mesh->mMaterialIndex << " has " << dCount << " diffuse and " << aCount << " ambient textures." << std::endl;
-            }
+    if(boneNames.empty()) return;
+
+    // flatten the node tree parent first
+    struct NodeEntry {
+        const aiNode* node;
+        int parent;
+    };
+    std::vector<NodeEntry> nodes;
+    std::vector<NodeEntry> stack = { { m_rootNode, -1 } };
+    while(!stack.empty()) {
+        NodeEntry entry = stack.back();
+        stack.pop_back();
+
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(entry);
+        for(unsigned int c = 0; c < entry.node->mNumChildren; c++) {
+            stack.push_back({ entry.node->mChildren[c], index });
+        }
+    }
 
-            // Try loading Ambient if Diffuse is 0
-            std::vector<Texture> diffuseMaps = m_textureLoader.loadTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-            if(diffuseMaps.empty())
-                diffuseMaps = m_textureLoader.loadTextures(material, aiTextureType_BASE_COLOR, "texture_diffuse");
-            if(diffuseMaps.empty())
-                diffuseMaps = m_textureLoader.loadTextures(material, aiTextureType_AMBIENT, "texture_diffuse");
-            if(diffuseMaps.empty())
-                diffuseMaps = m_textureLoader.loadTextures(material, aiTextureType_UNKNOWN, "texture_diffuse");
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-            // specular maps
-            std::vector<Texture> specularMaps = m_textureLoader.loadTextures(material, aiTextureType_SPECULAR, "texture_specular");
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
-            // normal maps 
-            std::vector<Texture> normalMaps = m_textureLoader.loadTextures(material, aiTextureType_HEIGHT, "texture_normal");
-            if(normalMaps.empty()) {
-                normalMaps = m_textureLoader.loadTextures(material, aiTextureType_NORMALS, "texture_normal");
-            }
-            textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+    // the skeleton is every bone plus whatever sits between it and the root
+    std::vector<bool> needed(nodes.size(), false);
+    for(size_t i = 0; i < nodes.size(); i++) {
+        if(std::find(boneNames.begin(), boneNames.end(), nodes[i].node->mName.C_Str()) == boneNames.end()) continue;
+        for(int n = static_cast<int>(i); n >= 0 && !needed[n]; n = nodes[n].parent) {
+            needed[n] = true;
         }
+    }
 
+    std::vector<int> remap(nodes.size(), -1);
+    for(size_t i = 0; i < nodes.size(); i++) {
+        if(!needed[i]) continue;
 
-        glm::vec4 baseColor(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a);
+        remap[i] = static_cast<int>(m_skeleton.names.size());
+        m_skeleton.names.push_back(nodes[i].node->mName.C_Str());
+        m_skeleton.parents.push_back(nodes[i].parent >= 0 ? remap[nodes[i].parent] : -1);
+        m_skeleton.inverseBind.push_back(glm::mat4(1.0f));
+    }
 
-        if (diffuseColor.r == 0 && diffuseColor.g == 0 && diffuseColor.b == 0) {
-            // If the material color is pitch black, default to a light grey 
-            // so we can actually see the model.
-            baseColor = glm::vec4(0.6f, 0.6f, 0.6f, 1.0f);
-        }
+    if(m_skeleton.names.size() > Skeleton::kMaxJoints) {
+        std::cerr << "ERROR::SKELETON:: " << m_skeleton.names.size() << " joints, only " << Skeleton::kMaxJoints
+                  << " are supported, loading " << m_filePath << " unskinned" << std::endl;
+        m_skeleton = Skeleton();
+        return;
+    }
 
-        for(unsigned int f = 0; f < mesh->mNumFaces; f++) {
-            aiFace face = mesh->mFaces[f];
-            for(unsigned int j = 0; j < face.mNumIndices; j++) {
-                indices.push_back(face.mIndices[j]);
+    // bind pose from the node transforms
+    m_skeleton.bindPose.resize(m_skeleton.names.size());
+    for(size_t i = 0; i < nodes.size(); i++) {
+        if(remap[i] < 0) continue;
+
+        glm::mat4 local = toGlm(nodes[i].node->mTransformation);
+        glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+        glm::quat rotation = glm::normalize(glm::quat_cast(glm::mat3(
+            glm::vec3(local[0]) / scale.x, glm::vec3(local[1]) / scale.y, glm::vec3(local[2]) / scale.z)));
+
+        int joint = remap[i];
+        m_skeleton.bindPose.rotations[joint] = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+        m_skeleton.bindPose.translations[joint] = glm::vec4(glm::vec3(local[3]), 0.0f);
+        m_skeleton.bindPose.scales[joint] = glm::vec4(scale, 0.0f);
+    }
+
+    m_skeleton.globalInverse = glm::inverse(toGlm(m_rootNode->mTransformation));
+
+    std::cout << "[Debug] Skeleton with " << m_skeleton.names.size() << " joints" << std::endl;
+}
+
+void Model::loadBoneWeights(const aiMesh* mesh, std::vector<Vertex>& vertices) {
+    // keep the 4 strongest influences per vertex
+    std::vector<glm::vec4> weights(vertices.size(), glm::vec4(0.0f));
+    std::vector<glm::ivec4> joints(vertices.size(), glm::ivec4(0));
+
+    for(unsigned int b = 0; b < mesh->mNumBones; b++) {
+        const aiBone* bone = mesh->mBones[b];
+        int joint = m_skeleton.findJoint(bone->mName.C_Str());
+        if(joint < 0) continue;
+
+        m_skeleton.inverseBind[joint] = toGlm(bone->mOffsetMatrix);
+
+        for(unsigned int w = 0; w < bone->mNumWeights; w++) {
+            unsigned int vertex = bone->mWeights[w].mVertexId;
+            float weight = bone->mWeights[w].mWeight;
+            if(vertex >= vertices.size()) continue;
+
+            int weakest = 0;
+            for(int slot = 1; slot < 4; slot++) {
+                if(weights[vertex][slot] < weights[vertex][weakest]) weakest = slot;
+            }
+            if(weight > weights[vertex][weakest]) {
+                weights[vertex][weakest] = weight;
+                joints[vertex][weakest] = joint;
             }
         }
+    }
 
-        m_meshes.emplace_back(vertices, indices, textures, baseColor, meshName);
+    // quantize to bytes, whatever rounding loses goes to the strongest influence
+    for(size_t v = 0; v < vertices.size(); v++) {
+        float total = weights[v].x + weights[v].y + weights[v].z + weights[v].w;
+        if(total <= 0.0f) continue;
+
+        int quantized[4];
+        int sum = 0, strongest = 0;
+        for(int slot = 0; slot < 4; slot++) {
+            quantized[slot] = static_cast<int>(std::lround(weights[v][slot] / total * 255.0f));
+            sum += quantized[slot];
+            if(weights[v][slot] > weights[v][strongest]) strongest = slot;
+        }
+        quantized[strongest] += 255 - sum;
+
+        // the strongest influence goes first, Mesh checks weights.x to spot skinned vertices
+        std::swap(quantized[0], quantized[strongest]);
+        std::swap(joints[v][0], joints[v][strongest]);
+
+        for(int slot = 0; slot < 4; slot++) {
+            vertices[v].joints[slot] = static_cast<uint8_t>(joints[v][slot]);
+            vertices[v].weights[slot] = static_cast<uint8_t>(quantized[slot]);
+        }
     }
 }
 
-void Model::draw(Shader& shader) {
+void Model::loadAnimations() {
+    if(m_skeleton.names.empty()) return;
 
-    glm::mat4 transform = glm::mat4(1.0f);
-    
-    // transformations
-    transform = glm::translate(transform, m_position);
+    for(unsigned int i = 0; i < m_scene->mNumAnimations; i++) {
+        m_clips.push_back(AnimationClip::fromAssimp(m_scene->mAnimations[i], m_skeleton));
+    }
 
+    m_animator = std::make_unique<Animator>(&m_skeleton, &m_clips);
+    m_animator->play(0);
 
-    // rotations
-    transform = glm::rotate(transform, glm::radians(m_rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    transform = glm::rotate(transform, glm::radians(m_rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    transform = glm::rotate(transform, glm::radians(m_rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-    
-    // scaling
-    transform = glm::scale(transform, glm::vec3(m_scale));
-    
-    shader.setMat4("u_Model", getWorldMatrix());
+    size_t animationBytes = m_skeleton.getJointCount() * (sizeof(glm::mat4) + sizeof(int) + 3 * sizeof(glm::vec4));
+    for(const auto& clip : m_clips) {
+        animationBytes += clip.getCompressedBytes();
+    }
+    MemoryTracker::trackCpu(&m_skeleton, MemoryTag::Animation, animationBytes);
+}
 
-    drawModel(shader);
+void Model::bakeAmbientOcclusion() {
+    std::vector<std::vector<uint8_t>> occlusion;
+    if(!AmbientOcclusionBaker::bake(m_filePath, m_meshes, occlusion)) return;
+
+    for(size_t i = 0; i < m_meshes.size(); i++) {
+        m_meshes[i].setAmbientOcclusion(occlusion[i]);
+    }
 }
 
-void Model::drawModel(Shader& shader)  {
-    for(auto& mesh : m_meshes) {
-        // this is for that check box list and stuff so yeah
-        if(mesh.m_isVisible) {
-            mesh.drawMesh(shader);
+// assimp allocates the scene itself, so this walks it and adds up the arrays it holds
+void Model::trackImporterMemory(const Assimp::Importer& importer) {
+    size_t bytes = sizeof(aiScene);
+
+    for(unsigned int i = 0; i < m_scene->mNumMeshes; i++) {
+        const aiMesh* mesh = m_scene->mMeshes[i];
+        size_t perVertex = sizeof(aiVector3D); // positions
+        if(mesh->mNormals) perVertex += sizeof(aiVector3D);
+        if(mesh->mTangents) perVertex += 2 * sizeof(aiVector3D); // tangents and bitangents
+        for(int channel = 0; channel < 8; channel++) {
+            if(mesh->mTextureCoords[channel]) perVertex += sizeof(aiVector3D);
+        }
+
+        bytes += sizeof(aiMesh) + mesh->mNumVertices * perVertex;
+        for(unsigned int f = 0; f < mesh->mNumFaces; f++) {
+            bytes += sizeof(aiFace) + mesh->mFaces[f].mNumIndices * sizeof(unsigned int);
+        }
+        for(unsigned int b = 0; b < mesh->mNumBones; b++) {
+            bytes += sizeof(aiBone) + mesh->mBones[b]->mNumWeights * sizeof(aiVertexWeight);
+        }
+    }
+
+    for(unsigned int i = 0; i < m_scene->mNumAnimations; i++) {
+        const aiAnimation* animation = m_scene->mAnimations[i];
+        bytes += sizeof(aiAnimation);
+        for(unsigned int c = 0; c < animation->mNumChannels; c++) {
+            const aiNodeAnim* channel = animation->mChannels[c];
+            bytes += sizeof(aiNodeAnim)
+                + (channel->mNumPositionKeys + channel->mNumScalingKeys) * sizeof(aiVectorKey)
+                + channel->mNumRotationKeys * sizeof(aiQuatKey);
+        }
+    }
+
+    std::vector<const aiNode*> stack = { m_rootNode };
+    while(!stack.empty()) {
+        const aiNode* node = stack.back();
+        stack.pop_back();
+        bytes += sizeof(aiNode) + node->mNumMeshes * sizeof(unsigned int) + node->mNumChildren * sizeof(aiNode*);
+        for(unsigned int c = 0; c < node->mNumChildren; c++) {
+            stack.push_back(node->mChildren[c]);
         }
     }
+
+    MemoryTracker::trackCpu(&importer, MemoryTag::Importer, bytes);
 }
 
 std::string Model::getName() const {
@@ -221,8 +609,8 @@ glm::mat4 Model::getModelMatrix() const {
 glm::mat4 Model::getWorldMatrix() const {
     glm::mat4 local = getLocalMatrix();
 
-    if(m_parent) {
-        return m_parent->getWorldMatrix() * local;
+    if(const Model* parent = getParent()) {
+        return parent->getWorldMatrix() * local;
     }
     return local;
 }
@@ -242,7 +630,19 @@ glm::mat4 Model::getLocalMatrix() const {
 }
 
 Model::~Model() {
-    // Assimp's Importer automatically cleans up the scene
+    MemoryTracker::untrackCpu(&m_skeleton);
+
+    for(MaterialHandle material : m_materials) {
+        MaterialLibrary::destroy(material);
+    }
+    // textures other models still use stay streamed
+    m_textureLoader.releaseTextures();
+
+    // the meshes only reference these, so they go after the meshes' VAOs are gone
+    m_meshes.clear();
+    for(GLuint buffer : m_sharedBuffers) {
+        GeometryRegistry::release(buffer);
+    }
 }
 
 // for debugging texture types
@@ -256,7 +656,39 @@ void printAllTextureTypes(aiMaterial* material) {
     }
 }
 
-void Model::addChild(Model* child) {
-    child->m_parent = this; // set the parent pointer to the child thats being added
-    m_children.push_back(child);
-}
\ No newline at end of file
+const Scene* Model::getScene() const {
+    return m_owner;
+}
+
+ModelHandle Model::getHandle() const {
+    return m_handle;
+}
+
+const Model* Model::getParent() const {
+    return m_owner ? m_owner->getModel(m_parent) : nullptr;
+}
+
+bool Model::isStaticInHierarchy() const {
+    // an animated skin deforms every frame even when the transforms don't change
+    if(isSkinned()) return false;
+
+    for(const Model* model = this; model; model = model->getParent()) {
+        if(!model->m_isStatic) return false;
+    }
+    return true;
+}
+bool Model::isSkinned() const {
+    return m_animator != nullptr;
+}
+
+Animator* Model::getAnimator() {
+    return m_animator.get();
+}
+
+const Animator* Model::getAnimator() const {
+    return m_animator.get();
+}
+
+const std::vector<AnimationClip>& Model::getClips() const {
+    return m_clips;
+}
@@ -0,0 +1,561 @@
+#include "scene/ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// chunks smaller than this are not worth a job of their own
+static const size_t kMinChunkBytes = 1 << 20;
+// meshes below this many corners dedupe in a single shard
+static const size_t kShardedCorners = 1 << 16;
+static const int kShardBits = 6;
+static const size_t kBlockCorners = 1 << 16;
+static const uint32_t kEmptySlot = 0xFFFFFFFFu;
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+    while(p < end && isSpace(*p)) p++;
+    return p;
+}
+
+static inline const char* skipToken(const char* p, const char* end) {
+    while(p < end && !isSpace(*p)) p++;
+    return p;
+}
+
+// rest of the line without the surrounding whitespace
+static std::string getRest(const char* p, const char* end) {
+    p = skipSpaces(p, end);
+    while(end > p && isSpace(end[-1])) end--;
+    return std::string(p, end);
+}
+
+static inline bool startsWith(const char* p, const char* end, const char* keyword) {
+    size_t length = std::strlen(keyword);
+    return static_cast<size_t>(end - p) > length && std::memcmp(p, keyword, length) == 0 && isSpace(p[length]);
+}
+
+// decimal float without locale or strtod, accurate to a few ulps which is plenty for geometry
+static const char* parseFloat(const char* p, const char* end, float& out) {
+    static const double kPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    p = skipSpaces(p, end);
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    for(; p < end && isDigit(*p); p++) {
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa) digits++;
+        } else {
+            exponent++;
+        }
+    }
+
+    if(p < end && *p == '.') {
+        for(p++; p < end && isDigit(*p); p++) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int value = 0;
+        for(; p < end && isDigit(*p); p++) {
+            if(value < 10000) value = value * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double result = static_cast<double>(mantissa);
+    if(exponent != 0) {
+        int magnitude = exponent < 0 ? -exponent : exponent;
+        double scale = magnitude <= 22 ? kPow10[magnitude] : std::pow(10.0, magnitude);
+        result = exponent < 0 ? result / scale : result * scale;
+    }
+
+    out = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+static inline const char* parseInt(const char* p, const char* end, int& out) {
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    int value = 0;
+    for(; p < end && isDigit(*p); p++) {
+        value = value * 10 + (*p - '0');
+    }
+
+    out = negative ? -value : value;
+    return p;
+}
+
+// 1 based absolute or negative relative index to 0 based, relative ones stay chunk local
+static inline int32_t resolveIndex(int value, size_t localCount, bool& relative) {
+    relative = value < 0;
+    if(value > 0) return value - 1;
+    if(value < 0) return static_cast<int32_t>(localCount) + value;
+    return -1;
+}
+
+void ObjLoader::parseChunk(Chunk& chunk) {
+    std::vector<Corner> polygon;
+    std::vector<uint8_t> polygonRelative; // bit 0 position, 1 uv, 2 normal
+
+    const char* p = chunk.begin;
+    while(p < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        if(!lineEnd) lineEnd = chunk.end;
+
+        p = skipSpaces(p, lineEnd);
+        if(p + 1 < lineEnd) {
+            if(p[0] == 'v' && isSpace(p[1])) {
+                glm::vec3 position;
+                const char* q = parseFloat(p + 2, lineEnd, position.x);
+                q = parseFloat(q, lineEnd, position.y);
+                parseFloat(q, lineEnd, position.z);
+                chunk.positions.push_back(position);
+            }
+            else if(p[0] == 'v' && p[1] == 't') {
+                glm::vec2 texCoord;
+                const char* q = parseFloat(p + 2, lineEnd, texCoord.x);
+                parseFloat(q, lineEnd, texCoord.y);
+                chunk.texCoords.push_back(texCoord);
+            }
+            else if(p[0] == 'v' && p[1] == 'n') {
+                glm::vec3 normal;
+                const char* q = parseFloat(p + 2, lineEnd, normal.x);
+                q = parseFloat(q, lineEnd, normal.y);
+                parseFloat(q, lineEnd, normal.z);
+                chunk.normals.push_back(normal);
+            }
+            else if(p[0] == 'f' && isSpace(p[1])) {
+                polygon.clear();
+                polygonRelative.clear();
+
+                const char* q = p + 2;
+                while(true) {
+                    q = skipSpaces(q, lineEnd);
+                    if(q >= lineEnd || !(isDigit(*q) || *q == '-' || *q == '+')) break;
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    int position = 0, texCoord = 0, normal = 0;
+                    q = parseInt(q, lineEnd, position);
+                    if(q < lineEnd && *q == '/') {
+                        q++;
+                        if(q < lineEnd && *q != '/') q = parseInt(q, lineEnd, texCoord);
+                        if(q < lineEnd && *q == '/') q = parseInt(q + 1, lineEnd, normal);
+                    }
+                    q = skipToken(q, lineEnd);
+
+                    bool relativePosition, relativeTexCoord, relativeNormal;
+                    Corner corner;
+                    corner.position = resolveIndex(position, chunk.positions.size(), relativePosition);
+                    corner.texCoord = resolveIndex(texCoord, chunk.texCoords.size(), relativeTexCoord);
+                    corner.normal = resolveIndex(normal, chunk.normals.size(), relativeNormal);
+                    polygon.push_back(corner);
+                    polygonRelative.push_back(static_cast<uint8_t>(relativePosition | (relativeTexCoord << 1) | (relativeNormal << 2)));
+                }
+
+                // fan triangulation
+                for(size_t i = 1; i + 1 < polygon.size(); i++) {
+                    const size_t fan[3] = { 0, i, i + 1 };
+                    for(size_t k : fan) {
+                        uint32_t slot = static_cast<uint32_t>(chunk.corners.size());
+                        chunk.corners.push_back(polygon[k]);
+                        if(polygonRelative[k] & 1) chunk.relativePositions.push_back(slot);
+                        if(polygonRelative[k] & 2) chunk.relativeTexCoords.push_back(slot);
+                        if(polygonRelative[k] & 4) chunk.relativeNormals.push_back(slot);
+                    }
+                }
+            }
+            else if(startsWith(p, lineEnd, "usemtl") || ((p[0] == 'o' || p[0] == 'g') && isSpace(p[1]))) {
+                bool isMaterial = p[0] == 'u';
+                std::string name = getRest(p + (isMaterial ? 6 : 1), lineEnd);
+                if(name.empty()) name = "default";
+
+                if(chunk.segments.empty() || chunk.segments.back().firstCorner != chunk.corners.size()) {
+                    chunk.segments.push_back({ chunk.corners.size(), std::string(), std::string() });
+                }
+                (isMaterial ? chunk.segments.back().material : chunk.segments.back().group) = name;
+            }
+            else if(startsWith(p, lineEnd, "mtllib")) {
+                chunk.materialLibraries.push_back(getRest(p + 6, lineEnd));
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+void ObjLoader::parseMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials) {
+    FileData file = VirtualFileSystem::read(path);
+    if(!file.isValid()) return;
+
+    ObjMaterial* current = nullptr;
+    std::string ambientMap;
+
+    auto finish = [&]() {
+        // same fallback as the assimp path, ambient maps stand in for missing diffuse ones
+        if(current && current->diffuseMap.empty()) current->diffuseMap = ambientMap;
+        ambientMap.clear();
+    };
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+    while(p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if(!lineEnd) lineEnd = end;
+
+        p = skipSpaces(p, lineEnd);
+        const char* keyEnd = skipToken(p, lineEnd);
+        std::string key(p, keyEnd);
+
+        // texture statements can carry options like -bm 1.0, the file name comes last
+        const char* lastToken = lineEnd;
+        while(lastToken > keyEnd && isSpace(lastToken[-1])) lastToken--;
+        const char* fileEnd = lastToken;
+        while(lastToken > keyEnd && !isSpace(lastToken[-1])) lastToken--;
+        std::string fileName(lastToken, fileEnd);
+
+        if(key == "newmtl") {
+            finish();
+            materials.emplace_back();
+            current = &materials.back();
+            current->name = getRest(keyEnd, lineEnd);
+        }
+        else if(current) {
+            if(key == "Kd") {
+                const char* q = parseFloat(keyEnd, lineEnd, current->diffuse.r);
+                q = parseFloat(q, lineEnd, current->diffuse.g);
+                parseFloat(q, lineEnd, current->diffuse.b);
+            }
+            else if(key == "d") {
+                parseFloat(keyEnd, lineEnd, current->diffuse.a);
+            }
+            else if(key == "Tr") {
+                float transparency = 0.0f;
+                parseFloat(keyEnd, lineEnd, transparency);
+                current->diffuse.a = 1.0f - transparency;
+            }
+            else if(key == "map_Kd") {
+                current->diffuseMap = fileName;
+            }
+            else if(key == "map_Ka") {
+                ambientMap = fileName;
+            }
+            else if(key == "map_Ks") {
+                current->specularMap = fileName;
+            }
+            else if(key == "map_Bump" || key == "map_bump" || key == "bump" || key == "norm" || key == "map_Kn") {
+                current->normalMap = fileName;
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+    finish();
+}
+
+static inline uint32_t hashCorner(int32_t position, int32_t texCoord, int32_t normal) {
+    uint64_t h = static_cast<uint32_t>(position) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<uint32_t>(texCoord) * 0xC2B2AE3D27D4EB4Full;
+    h ^= static_cast<uint32_t>(normal) * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+// the shard comes from the top bits, the hash table slot from the bottom ones
+static inline uint32_t getShard(uint32_t hash, int shardBits) {
+    return shardBits ? hash >> (32 - shardBits) : 0;
+}
+
+void ObjLoader::buildMesh(const std::vector<Corner>& corners,
+                          const std::vector<glm::vec3>& positions,
+                          const std::vector<glm::vec2>& texCoords,
+                          const std::vector<glm::vec3>& normals,
+                          ObjMesh& mesh)
+{
+    const size_t count = corners.size();
+    const int shardBits = count < kShardedCorners ? 0 : kShardBits;
+    const size_t shardCount = size_t(1) << shardBits;
+    const size_t blockCount = (count + kBlockCorners - 1) / kBlockCorners;
+
+    // hash every corner and count how many land in each shard, per block
+    std::vector<uint32_t> hashes(count);
+    std::vector<size_t> blockOffsets(blockCount * shardCount, 0);
+    JobSystem::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for(size_t b = begin; b < end; b++) {
+            size_t* counts = &blockOffsets[b * shardCount];
+            size_t last = std::min(count, (b + 1) * kBlockCorners);
+            for(size_t i = b * kBlockCorners; i < last; i++) {
+                const Corner& corner = corners[i];
+                hashes[i] = hashCorner(corner.position, corner.texCoord, corner.normal);
+                counts[getShard(hashes[i], shardBits)]++;
+            }
+        }
+    });
+
+    // shard major prefix sum, so each shard's corners end up together and in file order
+    std::vector<size_t> shardBegin(shardCount + 1, 0);
+    size_t running = 0;
+    for(size_t s = 0; s < shardCount; s++) {
+        shardBegin[s] = running;
+        for(size_t b = 0; b < blockCount; b++) {
+            size_t cornersInBlock = blockOffsets[b * shardCount + s];
+            blockOffsets[b * shardCount + s] = running;
+            running += cornersInBlock;
+        }
+    }
+    shardBegin[shardCount] = running;
+
+    std::vector<uint32_t> order(count);
+    JobSystem::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for(size_t b = begin; b < end; b++) {
+            size_t* offsets = &blockOffsets[b * shardCount];
+            size_t last = std::min(count, (b + 1) * kBlockCorners);
+            for(size_t i = b * kBlockCorners; i < last; i++) {
+                order[offsets[getShard(hashes[i], shardBits)]++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    // every shard dedupes on its own with a private open addressing table
+    std::vector<uint32_t> localIndex(count);
+    std::vector<std::vector<uint32_t>> shardUnique(shardCount); // first corner of each unique vertex
+    JobSystem::parallelFor(shardCount, 1, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> table;
+        for(size_t s = begin; s < end; s++) {
+            size_t size = 16;
+            while(size < (shardBegin[s + 1] - shardBegin[s]) * 2) size <<= 1;
+            table.assign(size, kEmptySlot);
+
+            std::vector<uint32_t>& unique = shardUnique[s];
+            for(size_t k = shardBegin[s]; k < shardBegin[s + 1]; k++) {
+                uint32_t cornerIndex = order[k];
+                const Corner& corner = corners[cornerIndex];
+
+                size_t slot = hashes[cornerIndex] & (size - 1);
+                while(true) {
+                    uint32_t id = table[slot];
+                    if(id == kEmptySlot) {
+                        id = static_cast<uint32_t>(unique.size());
+                        table[slot] = id;
+                        unique.push_back(cornerIndex);
+                        localIndex[cornerIndex] = id;
+                        break;
+                    }
+
+                    const Corner& other = corners[unique[id]];
+                    if(other.position == corner.position && other.texCoord == corner.texCoord && other.normal == corner.normal) {
+                        localIndex[cornerIndex] = id;
+                        break;
+                    }
+                    slot = (slot + 1) & (size - 1);
+                }
+            }
+        }
+    });
+
+    std::vector<uint32_t> shardBase(shardCount);
+    size_t vertexCount = 0;
+    for(size_t s = 0; s < shardCount; s++) {
+        shardBase[s] = static_cast<uint32_t>(vertexCount);
+        vertexCount += shardUnique[s].size();
+    }
+
+    mesh.vertices.resize(vertexCount);
+    JobSystem::parallelFor(shardCount, 1, [&](size_t begin, size_t end) {
+        for(size_t s = begin; s < end; s++) {
+            for(size_t i = 0; i < shardUnique[s].size(); i++) {
+                const Corner& corner = corners[shardUnique[s][i]];
+                Vertex& vertex = mesh.vertices[shardBase[s] + i];
+
+                bool hasPosition = corner.position >= 0 && static_cast<size_t>(corner.position) < positions.size();
+                bool hasTexCoord = corner.texCoord >= 0 && static_cast<size_t>(corner.texCoord) < texCoords.size();
+                bool hasNormal = corner.normal >= 0 && static_cast<size_t>(corner.normal) < normals.size();
+
+                vertex.position = hasPosition ? positions[corner.position] : glm::vec3(0.0f);
+                vertex.normal = hasNormal ? normals[corner.normal] : glm::vec3(0.0f);
+                // flipped like aiProcess_FlipUVs does for the assimp path
+                vertex.texCoords = hasTexCoord ? glm::vec2(texCoords[corner.texCoord].x, 1.0f - texCoords[corner.texCoord].y) : glm::vec2(0.0f);
+            }
+        }
+    });
+
+    mesh.indices.resize(count);
+    JobSystem::parallelFor(count, kBlockCorners, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            mesh.indices[i] = shardBase[getShard(hashes[i], shardBits)] + localIndex[i];
+        }
+    });
+}
+
+bool ObjLoader::load(const std::string& path, ObjData& out) {
+    auto start = std::chrono::steady_clock::now();
+
+    FileData file = VirtualFileSystem::read(path);
+    if(!file.isValid()) return false;
+    file.adviseSequential();
+
+    // line aligned chunks, a few per thread so uneven ones even out
+    std::vector<Chunk> chunks;
+    size_t chunkBytes = std::max(kMinChunkBytes, file.size() / (JobSystem::getThreadCount() * 4));
+    for(size_t begin = 0; begin < file.size();) {
+        size_t end = std::min(file.size(), begin + chunkBytes);
+        const char* newline = static_cast<const char*>(std::memchr(file.data() + end, '\n', file.size() - end));
+        end = newline ? static_cast<size_t>(newline - file.data()) + 1 : file.size();
+
+        chunks.emplace_back();
+        chunks.back().begin = file.data() + begin;
+        chunks.back().end = file.data() + end;
+        begin = end;
+    }
+
+    JobSystem::parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t c = begin; c < end; c++) {
+            parseChunk(chunks[c]);
+        }
+    });
+
+    // where each chunk's vertices go in the combined arrays
+    std::vector<size_t> positionBase(chunks.size()), texCoordBase(chunks.size()), normalBase(chunks.size());
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+    for(size_t c = 0; c < chunks.size(); c++) {
+        positionBase[c] = positionCount;
+        texCoordBase[c] = texCoordCount;
+        normalBase[c] = normalCount;
+        positionCount += chunks[c].positions.size();
+        texCoordCount += chunks[c].texCoords.size();
+        normalCount += chunks[c].normals.size();
+    }
+
+    std::vector<glm::vec3> positions(positionCount);
+    std::vector<glm::vec2> texCoords(texCoordCount);
+    std::vector<glm::vec3> normals(normalCount);
+    JobSystem::parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t c = begin; c < end; c++) {
+            Chunk& chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[c]);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + texCoordBase[c]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[c]);
+
+            for(uint32_t slot : chunk.relativePositions) chunk.corners[slot].position += static_cast<int32_t>(positionBase[c]);
+            for(uint32_t slot : chunk.relativeTexCoords) chunk.corners[slot].texCoord += static_cast<int32_t>(texCoordBase[c]);
+            for(uint32_t slot : chunk.relativeNormals) chunk.corners[slot].normal += static_cast<int32_t>(normalBase[c]);
+
+            chunk.positions = std::vector<glm::vec3>();
+            chunk.texCoords = std::vector<glm::vec2>();
+            chunk.normals = std::vector<glm::vec3>();
+        }
+    });
+
+    // materials
+    size_t lastSlash = path.find_last_of("/\\");
+    std::string directory = (lastSlash == std::string::npos) ? "." : path.substr(0, lastSlash);
+
+    std::vector<std::string> libraries;
+    for(const Chunk& chunk : chunks) {
+        for(const std::string& library : chunk.materialLibraries) {
+            if(std::find(libraries.begin(), libraries.end(), library) == libraries.end()) {
+                libraries.push_back(library);
+                parseMaterialLibrary(directory + '/' + library, out.materials);
+            }
+        }
+    }
+
+    std::unordered_map<std::string, int> materialByName;
+    for(size_t i = 0; i < out.materials.size(); i++) {
+        materialByName.emplace(out.materials[i].name, static_cast<int>(i));
+    }
+
+    // walk the segments in file order and give every group/material pair its own mesh
+    struct Range {
+        size_t chunk, begin, end;
+    };
+    std::vector<std::vector<Range>> meshRanges;
+    std::unordered_map<std::string, size_t> meshByKey;
+    std::string group = "default";
+    std::string material;
+
+    auto addRange = [&](size_t chunk, size_t begin, size_t end) {
+        if(begin == end) return;
+
+        std::string key = group + '\n' + material;
+        auto it = meshByKey.find(key);
+        if(it == meshByKey.end()) {
+            it = meshByKey.emplace(key, out.meshes.size()).first;
+
+            ObjMesh mesh;
+            mesh.name = group;
+            auto found = materialByName.find(material);
+            mesh.material = found != materialByName.end() ? found->second : -1;
+            out.meshes.push_back(std::move(mesh));
+            meshRanges.emplace_back();
+        }
+        meshRanges[it->second].push_back({ chunk, begin, end });
+    };
+
+    for(size_t c = 0; c < chunks.size(); c++) {
+        size_t cursor = 0;
+        for(const Segment& segment : chunks[c].segments) {
+            addRange(c, cursor, segment.firstCorner);
+            cursor = segment.firstCorner;
+            if(!segment.group.empty()) group = segment.group;
+            if(!segment.material.empty()) material = segment.material;
+        }
+        addRange(c, cursor, chunks[c].corners.size());
+    }
+
+    // the meshes build in parallel and each one spreads its own dedupe over the workers too
+    JobSystem::parallelFor(out.meshes.size(), 1, [&](size_t begin, size_t end) {
+        std::vector<Corner> corners;
+        for(size_t m = begin; m < end; m++) {
+            corners.clear();
+            for(const Range& range : meshRanges[m]) {
+                const std::vector<Corner>& source = chunks[range.chunk].corners;
+                corners.insert(corners.end(), source.begin() + range.begin, source.begin() + range.end);
+            }
+            buildMesh(corners, positions, texCoords, normals, out.meshes[m]);
+        }
+    });
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Debug] OBJ " << path << ": " << out.meshes.size() << " meshes, " << positionCount
+              << " positions, " << chunks.size() << " chunks in " << elapsed << " ms" << std::endl;
+
+    return !out.meshes.empty();
+}
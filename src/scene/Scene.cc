@@ -1,29 +1,105 @@
 #include "scene/Scene.h"
 
-std::vector<std::unique_ptr<Model>>& Scene::getModels() {
-    return m_models;
-} 
+#include <algorithm>
 
-Model* Scene::getModel(int index) {
-    if(index < 0 || index >= m_models.size()) {
-        return nullptr;
+#include "core/JobSystem.h"
+#include "core/PerfCounters.h"
+
+const std::vector<std::unique_ptr<Model>>& Scene::getModels() const {
+    return m_models.getValues();
+}
+
+Model* Scene::getModel(ModelHandle handle) {
+    std::unique_ptr<Model>* model = m_models.get(handle);
+    return model ? model->get() : nullptr;
+}
+
+const Model* Scene::getModel(ModelHandle handle) const {
+    const std::unique_ptr<Model>* model = m_models.get(handle);
+    return model ? model->get() : nullptr;
+}
+
+ModelHandle Scene::addModel(std::unique_ptr<Model> model) {
+    Model* added = model.get();
+    ModelHandle handle = m_models.insert(std::move(model));
+    added->m_owner = this;
+    added->m_handle = handle;
+    m_hierarchyVersion++;
+    return handle;
+}
+
+bool Scene::removeModel(ModelHandle handle) {
+    Model* model = getModel(handle);
+    if(!model) return false;
+
+    if(Model* parent = getModel(model->m_parent)) {
+        auto& siblings = parent->m_children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), handle), siblings.end());
+    }
+    for(ModelHandle child : model->m_children) {
+        if(Model* orphan = getModel(child)) orphan->m_parent = ModelHandle();
+    }
+
+    m_models.remove(handle);
+    m_hierarchyVersion++;
+    return true;
+}
+
+bool Scene::setParent(ModelHandle child, ModelHandle parent) {
+    Model* model = getModel(child);
+    if(!model) return false;
+    if(!parent.isNull() && !getModel(parent)) return false;
+
+    // a model can't end up below itself
+    for(const Model* ancestor = getModel(parent); ancestor; ancestor = getModel(ancestor->m_parent)) {
+        if(ancestor == model) return false;
+    }
+
+    if(Model* oldParent = getModel(model->m_parent)) {
+        auto& siblings = oldParent->m_children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
     }
+    model->m_parent = parent;
+    if(Model* newParent = getModel(parent)) {
+        newParent->m_children.push_back(child);
+    }
+    m_hierarchyVersion++;
+    return true;
+}
+
+uint64_t Scene::getHierarchyVersion() const {
+    return m_hierarchyVersion;
+}
 
-    return m_models[index].get(); // returns raw pointer
+std::vector<Light>& Scene::getLights() {
+    return m_lights;
 }
 
-void Scene::addModel(std::unique_ptr<Model> model) {
-    m_models.push_back(std::move(model));
+void Scene::addLight(const Light& light) {
+    m_lights.push_back(light);
 }
 
-void Scene::removeModel(int index) {
-    if(index < 0 || index >= m_models.size()) {
+void Scene::removeLight(int index) {
+    if(index < 0 || index >= m_lights.size()) {
         return;
     }
 
-    m_models.erase(m_models.begin() + index);
+    m_lights.erase(m_lights.begin() + index);
 }
 
 void Scene::onUpdate(float deltaTime) {
-    // currently does nothing, but can be extended to update model animations, etc.
+    // every animator only writes its own pose and palette, so they all sample in parallel
+    m_animators.clear();
+    for(auto& model : m_models.getValues()) {
+        if(Animator* animator = model->getAnimator()) {
+            m_animators.push_back(animator);
+        }
+    }
+
+    JobSystem::parallelFor(m_animators.size(), 4, [this, deltaTime](size_t begin, size_t end) {
+        PerfCounters::Scope perfScope("Animation"); // counted on whichever thread runs the chunk
+        for(size_t i = begin; i < end; i++) {
+            m_animators[i]->update(deltaTime);
+        }
+    });
 }
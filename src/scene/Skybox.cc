@@ -1,4 +1,5 @@
 #include "scene/Skybox.h"
+#include "renderer/GLState.h"
 
 Skybox::Skybox(const std::vector<std::string>& faces) {
     float skyboxVertices[] = {
@@ -46,13 +47,15 @@ Skybox::Skybox(const std::vector<std::string>& faces) {
          1.0f, -1.0f,  1.0f
     };
 
+    glGenVertexArrays(1, &m_VAO);
     glGenBuffers(1, &m_VBO);
-    glBindVertexArray(m_VAO);
+    GLState::bindVertexArray(m_VAO);
     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    GLState::bindVertexArray(0);
 
     m_CubemapID = loadCubemap(faces);
 
@@ -60,8 +63,8 @@ Skybox::Skybox(const std::vector<std::string>& faces) {
 }
 
 void Skybox::draw(const glm::mat4& view, const glm::mat4& projection) {
-    glDepthFunc(GL_LEQUAL); 
-    glDepthMask(GL_FALSE);
+    GLState::setDepthFunc(GL_LEQUAL);
+    GLState::setDepthMask(false);
     m_shader->use();
 
     glm::mat4 viewNoTranslation = glm::mat4(glm::mat3(view)); 
@@ -69,11 +72,10 @@ void Skybox::draw(const glm::mat4& view, const glm::mat4& projection) {
     m_shader->setMat4("view", viewNoTranslation);
     m_shader->setMat4("projection", projection);
 
-    glBindVertexArray(m_VAO);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubemapID);
+    GLState::bindVertexArray(m_VAO);
+    GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, m_CubemapID);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
     
-    glDepthMask(GL_FALSE);
-    glDepthFunc(GL_LESS); // Set back to default
+    GLState::setDepthMask(true);
+    GLState::setDepthFunc(GL_LESS); // Set back to default
 }
\ No newline at end of file
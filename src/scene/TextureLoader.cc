@@ -1,4 +1,8 @@
 #include "scene/TextureLoader.h"
+#include "renderer/GLState.h"
+#include "core/VirtualFileSystem.h"
+
+std::unordered_map<std::string, TextureLoader::SharedTexture> TextureLoader::s_shared;
 
 std::vector<Texture> TextureLoader::loadTextures(aiMaterial* material, aiTextureType type, std::string typeName)  {
     std::vector<Texture> textures;
@@ -11,86 +15,85 @@ std::vector<Texture> TextureLoader::loadTextures(aiMaterial* material, aiTexture
         material->GetTexture(type, i, &aiPath);
 
         std::string str(aiPath.C_Str()); // typecast aiString to std::string
+        textures.push_back(loadTexture(str, typeName));
+    }
 
-        bool skip = false;
-
-        // caching textures, if teh texture is already loaded, don't load it again
-        for(unsigned int j =  0; j < m_texturesLoaded.size(); j++) {
-            if(std::strcmp(m_texturesLoaded[j].path.data(), str.c_str()) == 0)
-            {
-                textures.push_back(m_texturesLoaded[j]);
-                skip = true;
-                break;
-            }
-        }
-
-        if(!skip) {
-            std::cout << "is this even working" << std::endl;
-            Texture texture;
-            texture.id = loadTextureFromFile(str, m_directory);
-            texture.type = typeName;
-            texture.path = str;
-            textures.push_back(texture);
+    return textures;
+}
 
-            m_texturesLoaded.push_back(texture); // add to loaded textures
+Texture TextureLoader::loadTexture(const std::string& path, const std::string& typeName) {
+    // caching textures, if teh texture is already loaded, don't load it again
+    for(unsigned int j =  0; j < m_texturesLoaded.size(); j++) {
+        if(std::strcmp(m_texturesLoaded[j].path.data(), path.c_str()) == 0) {
+            return m_texturesLoaded[j];
         }
     }
 
-    return textures;
+    Texture texture;
+    texture.id = loadTextureFromFile(path, m_directory);
+    texture.type = typeName;
+    texture.path = path;
+
+    m_texturesLoaded.push_back(texture); // add to loaded textures
+    return texture;
 }
 
 unsigned int TextureLoader::loadTextureFromFile(const std::string& path, const std::string& directory) {
     std::string filename = directory + '/' + path;
 
 
+    auto found = s_shared.find(filename);
+    if(found != s_shared.end()) {
+        found->second.references++;
+        m_files.push_back(filename);
+        return found->second.id;
+    }
+
     std::cout << "[Debug] Loading texture at path: " << filename << std::endl;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID); // using opengl to generate texture
-
-    // load image using stb_image
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        stbi_image_free(data);
-
-        return textureID;
-    } 
-
-    std::cerr << "Texture failed to load at path: " << filename << std::endl;
-    stbi_image_free(data);
-        
-    return 0; // if the image loading failed return 0
+    // only the small tail mips are resident at first, the streamer brings in
+    // the rest once the renderer reports the texture is actually seen up close
+    unsigned int id = TextureStreamer::registerTexture(filename);
+    if(id) {
+        s_shared[filename] = { id, 1 };
+        m_files.push_back(filename);
+    }
+    return id;
+}
+
+void TextureLoader::releaseTextures() {
+    for(const std::string& file : m_files) {
+        auto found = s_shared.find(file);
+        if(found == s_shared.end()) continue;
+        if(--found->second.references == 0) {
+            TextureStreamer::unregisterTexture(found->second.id);
+            s_shared.erase(found);
+        }
+    }
+    m_files.clear();
+    m_texturesLoaded.clear();
 }
 
 unsigned int loadCubemap(const std::vector<std::string>& faces) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState::bindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    size_t cubemapBytes = 0;
     for (unsigned int i = 0; i < faces.size(); i++) {
         // stbi_set_flip_vertically_on_load(false); // Cubemaps usually don't need flipping
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        FileData file = VirtualFileSystem::read(faces[i]);
+        unsigned char *data = nullptr;
+        if (file.isValid()) {
+            data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                                         &width, &height, &nrChannels, 0);
+        }
         if (data) {
             // GL_TEXTURE_CUBE_MAP_POSITIVE_X is the first face, the others follow in order
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
                          0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            cubemapBytes += MemoryTracker::getTextureBytes(GL_RGB, width, height);
             stbi_image_free(data);
         } else {
             std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
@@ -105,5 +108,6 @@ unsigned int loadCubemap(const std::vector<std::string>& faces) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+    MemoryTracker::trackTexture(textureID, MemoryTag::Renderer, cubemapBytes);
     return textureID;
 }
\ No newline at end of file
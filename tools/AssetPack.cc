@@ -0,0 +1,178 @@
+// Packs asset folders into one archive for VirtualFileSystem to mount, see PackFormat.h.
+// usage: assetpack <output.pak> <folder or file>...
+// Paths are stored as given on the command line, so run it from where the engine runs its
+// relative paths from (the CMake target runs it in the source folder).
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/Lz4.h"
+#include "core/PackFormat.h"
+
+struct InputFile {
+    std::string path;
+    std::filesystem::path source;
+};
+
+// archives the engine can't open and bake caches, which are keyed on the loose files
+// and get written next to them at runtime anyway
+static bool isSkipped(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    for(char& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".zip" || ext == ".aocache" || ext == ".iblcache";
+}
+
+static bool readWhole(const std::filesystem::path& path, std::vector<char>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) return false;
+    file.seekg(0, std::ios::end);
+    bytes.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+static void padTo(std::ofstream& out, uint64_t& offset, size_t alignment) {
+    static const char zeros[kPackAlignment] = {};
+    size_t padding = static_cast<size_t>((alignment - offset % alignment) % alignment);
+    out.write(zeros, static_cast<std::streamsize>(padding));
+    offset += padding;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <output.pak> <folder or file>..." << std::endl;
+        return 1;
+    }
+    std::string outputPath = argv[1];
+
+    std::vector<InputFile> inputs;
+    for(int i = 2; i < argc; i++) {
+        std::filesystem::path root = argv[i];
+        std::error_code error;
+        if(std::filesystem::is_regular_file(root, error)) {
+            inputs.push_back({ normalizePackPath(root.generic_string()), root });
+            continue;
+        }
+        if(!std::filesystem::is_directory(root, error)) {
+            std::cerr << "ERROR::ASSET_PACK:: " << root << " doesn't exist" << std::endl;
+            return 1;
+        }
+        for(const auto& item : std::filesystem::recursive_directory_iterator(root)) {
+            if(!item.is_regular_file() || isSkipped(item.path())) continue;
+            inputs.push_back({ normalizePackPath(item.path().generic_string()), item.path() });
+        }
+    }
+    // the same folders always give the same pack
+    std::sort(inputs.begin(), inputs.end(), [](const InputFile& a, const InputFile& b) {
+        return a.path < b.path;
+    });
+
+    // written next to the output and renamed at the end, a failed run leaves the old pack alone
+    std::string tempPath = outputPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if(!out) {
+        std::cerr << "ERROR::ASSET_PACK:: could not write " << tempPath << std::endl;
+        return 1;
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+    header.version = kPackVersion;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    std::vector<PackEntry> entries;
+    std::string names;
+    std::unordered_map<uint64_t, std::string> pathsByHash;
+    uint64_t totalSize = 0;
+    uint64_t totalStored = 0;
+
+    std::vector<char> bytes;
+    std::vector<char> compressed;
+    for(const InputFile& input : inputs) {
+        PackEntry entry = {};
+        entry.pathHash = hashPackBytes(input.path.data(), input.path.size());
+
+        // the engine only compares names after the hash matched, two paths can't share one
+        auto inserted = pathsByHash.emplace(entry.pathHash, input.path);
+        if(!inserted.second) {
+            std::cerr << "ERROR::ASSET_PACK:: " << input.path << " and " << inserted.first->second << " have the same path hash" << std::endl;
+            return 1;
+        }
+
+        if(!readWhole(input.source, bytes)) {
+            std::cerr << "ERROR::ASSET_PACK:: could not read " << input.source << std::endl;
+            return 1;
+        }
+
+        entry.contentHash = hashPackBytes(bytes.data(), bytes.size());
+        // a missing file is stamped 0, an empty one mustn't look like it
+        if(entry.contentHash == 0) entry.contentHash = 1;
+        entry.size = bytes.size();
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        names += input.path;
+        names += '\0';
+
+        // compressed only when it pays for the decode, already compressed images (jpg, png) stay raw
+        // and come straight out of the mapping
+        const char* stored = bytes.data();
+        entry.storedSize = bytes.size();
+        compressed.resize(Lz4::getMaxCompressedSize(bytes.size()));
+        size_t compressedSize = Lz4::compress(bytes.data(), bytes.size(), compressed.data(), compressed.size());
+        if(compressedSize > 0 && compressedSize < bytes.size() - bytes.size() / 10) {
+            stored = compressed.data();
+            entry.storedSize = compressedSize;
+            entry.flags |= kPackCompressed;
+        }
+
+        padTo(out, offset, kPackAlignment);
+        entry.offset = offset;
+        out.write(stored, static_cast<std::streamsize>(entry.storedSize));
+        offset += entry.storedSize;
+
+        totalSize += entry.size;
+        totalStored += entry.storedSize;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) {
+        return a.pathHash < b.pathHash;
+    });
+
+    padTo(out, offset, kPackAlignment);
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.entriesOffset = offset;
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+    offset += entries.size() * sizeof(PackEntry);
+
+    header.namesOffset = offset;
+    header.namesSize = names.size();
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if(!out) {
+        std::cerr << "ERROR::ASSET_PACK:: writing " << tempPath << " failed" << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, outputPath, error);
+    if(error) {
+        std::cerr << "ERROR::ASSET_PACK:: could not move " << tempPath << " to " << outputPath << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << entries.size() << " files into " << outputPath << ", "
+              << totalSize / 1024 << " KiB stored as " << totalStored / 1024 << " KiB" << std::endl;
+    return 0;
+}
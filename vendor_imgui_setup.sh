@@ -16,3 +16,8 @@ wget https://raw.githubusercontent.com/ocornut/imgui/master/backends/imgui_impl_
 wget https://raw.githubusercontent.com/ocornut/imgui/master/backends/imgui_impl_glfw.h -P vendor/imgui/backends
 wget https://raw.githubusercontent.com/ocornut/imgui/master/backends/imgui_impl_opengl3.cpp -P vendor/imgui/backends
 wget https://raw.githubusercontent.com/ocornut/imgui/master/backends/imgui_impl_opengl3.h -P vendor/imgui/backends
+
+mkdir -p ./vendor/stb
+
+wget https://raw.githubusercontent.com/nothings/stb/master/stb_image.h -P vendor/stb/
+wget https://raw.githubusercontent.com/nothings/stb/master/stb_image_write.h -P vendor/stb/